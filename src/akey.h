@@ -38,6 +38,7 @@
 #ifdef USE_UI_BASIC_ONSCREEN_KEYBOARD
 #define AKEY_KEYB                  -32
 #endif
+#define AKEY_REWIND                -33
 
 #if SDL2
 	// SDL_GameControllerButton(s) in AKEY
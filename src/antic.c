@@ -34,8 +34,10 @@
 #include "gtia.h"
 #include "log.h"
 #include "memory.h"
+#include "perfstat.h"
 #include "platform.h"
 #include "pokey.h"
+#include "profiler.h"
 #include "util.h"
 #if !defined(BASIC) && !defined(CURSES_BASIC)
 #include "input.h"
@@ -72,6 +74,7 @@ static int dmactl_bug_chdata;
 #ifndef NO_SIMPLE_PAL_BLENDING
 int ANTIC_pal_blending = 0;
 #endif /* NO_SIMPLE_PAL_BLENDING */
+int ANTIC_compute_only = FALSE;
 
 /* Video memory access is hidden behind these macros. It allows to track dirty video memory
    to improve video system performance */
@@ -247,6 +250,10 @@ static UBYTE antic_memory[52];
    ------------------------------------------------------------------------ */
 
 static UWORD *scrn_ptr;
+
+/* In compute-only mode, scanlines are drawn here just for the collisions.
+   A few extra bytes for drawing routines that overshoot the line. */
+static ULONG compute_line[Screen_WIDTH / 4 + 8];
 #endif /* !defined(BASIC) && !defined(CURSES_BASIC) */
 
 /* Separate access to XE extended memory ----------------------------------- */
@@ -263,6 +270,11 @@ static UWORD *scrn_ptr;
    then NULL. */
 const UBYTE *ANTIC_xe_ptr = NULL;
 
+#ifdef PAGED_MEM
+/* Reads a byte from ADDR as seen by ANTIC. */
+#define ANTIC_dGetByte(addr)	(ANTIC_xe_ptr != NULL && ((addr) & 0xc000) == 0x4000 ? ANTIC_xe_ptr[(addr) & 0x3fff] : MEMORY_dGetByte(addr))
+#endif
+
 /* ANTIC Timing --------------------------------------------------------------
 
 NOTE: this information was written before NEW_CYCLE_EXACT was introduced!
@@ -810,54 +822,70 @@ static const UBYTE hold_missiles_tab[16] = {
 	0x00,0x03,0x0c,0x0f,0x30,0x33,0x3c,0x3f,
 	0xc0,0xc3,0xcc,0xcf,0xf0,0xf3,0xfc,0xff};
 
+#ifdef PAGED_MEM
+#define PMG_BYTE(offset)	ANTIC_dGetByte(base + (offset))
+#else
+#define PMG_BYTE(offset)	base[offset]
+#endif
+
 static void pmg_dma(void)
 {
 	/* VDELAY bit set == GTIA ignores PMG DMA in even lines */
 	if (ANTIC_player_dma_enabled) {
 		if (ANTIC_player_gra_enabled) {
+#ifdef PAGED_MEM
+			UWORD base;
+			if (singleline) {
+				base = pmbase_s + ANTIC_ypos;
+#else
 			const UBYTE *base;
 			if (singleline) {
 				if (ANTIC_xe_ptr != NULL && pmbase_s < 0x8000 && pmbase_s >= 0x4000)
 					base = ANTIC_xe_ptr + pmbase_s - 0x4000 + ANTIC_ypos;
 				else
 					base = MEMORY_mem + pmbase_s + ANTIC_ypos;
+#endif
 				if (ANTIC_ypos & 1) {
-					GTIA_GRAFP0 = base[0x400];
-					GTIA_GRAFP1 = base[0x500];
-					GTIA_GRAFP2 = base[0x600];
-					GTIA_GRAFP3 = base[0x700];
+					GTIA_GRAFP0 = PMG_BYTE(0x400);
+					GTIA_GRAFP1 = PMG_BYTE(0x500);
+					GTIA_GRAFP2 = PMG_BYTE(0x600);
+					GTIA_GRAFP3 = PMG_BYTE(0x700);
 				}
 				else {
 					if ((GTIA_VDELAY & 0x10) == 0)
-						GTIA_GRAFP0 = base[0x400];
+						GTIA_GRAFP0 = PMG_BYTE(0x400);
 					if ((GTIA_VDELAY & 0x20) == 0)
-						GTIA_GRAFP1 = base[0x500];
+						GTIA_GRAFP1 = PMG_BYTE(0x500);
 					if ((GTIA_VDELAY & 0x40) == 0)
-						GTIA_GRAFP2 = base[0x600];
+						GTIA_GRAFP2 = PMG_BYTE(0x600);
 					if ((GTIA_VDELAY & 0x80) == 0)
-						GTIA_GRAFP3 = base[0x700];
+						GTIA_GRAFP3 = PMG_BYTE(0x700);
 				}
 			}
 			else {
+#ifdef PAGED_MEM
+				base = pmbase_d + (ANTIC_ypos >> 1);
+#else
 				if (ANTIC_xe_ptr != NULL && pmbase_d < 0x8000 && pmbase_d >= 0x4000)
 					base = ANTIC_xe_ptr + (pmbase_d - 0x4000) + (ANTIC_ypos >> 1);
 				else
 					base = MEMORY_mem + pmbase_d + (ANTIC_ypos >> 1);
+#endif
 				if (ANTIC_ypos & 1) {
-					GTIA_GRAFP0 = base[0x200];
-					GTIA_GRAFP1 = base[0x280];
-					GTIA_GRAFP2 = base[0x300];
-					GTIA_GRAFP3 = base[0x380];
+					GTIA_GRAFP0 = PMG_BYTE(0x200);
+					GTIA_GRAFP1 = PMG_BYTE(0x280);
+					GTIA_GRAFP2 = PMG_BYTE(0x300);
+					GTIA_GRAFP3 = PMG_BYTE(0x380);
 				}
 				else {
 					if ((GTIA_VDELAY & 0x10) == 0)
-						GTIA_GRAFP0 = base[0x200];
+						GTIA_GRAFP0 = PMG_BYTE(0x200);
 					if ((GTIA_VDELAY & 0x20) == 0)
-						GTIA_GRAFP1 = base[0x280];
+						GTIA_GRAFP1 = PMG_BYTE(0x280);
 					if ((GTIA_VDELAY & 0x40) == 0)
-						GTIA_GRAFP2 = base[0x300];
+						GTIA_GRAFP2 = PMG_BYTE(0x300);
 					if ((GTIA_VDELAY & 0x80) == 0)
-						GTIA_GRAFP3 = base[0x380];
+						GTIA_GRAFP3 = PMG_BYTE(0x380);
 				}
 			}
 		}
@@ -965,9 +993,12 @@ int ANTIC_Initialise(int *argc, char *argv[])
 			}
 			else a_m = TRUE;
 		}
+		else if (strcmp(argv[i], "-headless") == 0)
+			ANTIC_compute_only = TRUE;
 		else {
 			if (strcmp(argv[i], "-help") == 0) {
 				Log_print("\t-artif <num>     Set artifacting mode 0-4 (0 = disable)");
+				Log_print("\t-headless        Emulate without drawing the screen");
 			}
 			argv[j++] = argv[i];
 		}
@@ -1457,7 +1488,7 @@ static void draw_an_gtia_bug(const ULONG *t_pm_scanline_ptr)
 
 #define GET_CHDATA_ANTIC_2	chdata = (screendata & invert_mask) ? 0xff : 0;\
 	if (blank_lookup[screendata & blank_mask])\
-		chdata ^= MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
+		chdata ^= ANTIC_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
 
 #else /* PAGED_MEM */
 
@@ -1830,7 +1861,7 @@ static void draw_antic_4(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 		else
 			lookup = lookup2;
 #ifdef PAGED_MEM
-		chdata = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
+		chdata = ANTIC_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
 #else
 		chdata = chptr[(screendata & 0x7f) << 3];
 #endif
@@ -1881,7 +1912,7 @@ static void prepare_an_antic_4(int nchars, const UBYTE *antic_memptr, const ULON
 		UBYTE an;
 		UBYTE chdata;
 #ifdef PAGED_MEM
-		chdata = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
+		chdata = ANTIC_dGetByte(t_chbase + ((UWORD) (screendata & 0x7f) << 3));
 #else
 		chdata = chptr[(screendata & 0x7f) << 3];
 #endif
@@ -1918,7 +1949,7 @@ static void draw_antic_6(int nchars, const UBYTE *antic_memptr, UWORD *ptr, cons
 		int kk = 2;
 		colour = COLOUR((playfield_lookup + 0x40)[screendata & 0xc0]);
 #ifdef PAGED_MEM
-		chdata = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x3f) << 3));
+		chdata = ANTIC_dGetByte(t_chbase + ((UWORD) (screendata & 0x3f) << 3));
 #else
 		chdata = chptr[(screendata & 0x3f) << 3];
 #endif
@@ -1996,7 +2027,7 @@ static void prepare_an_antic_6(int nchars, const UBYTE *antic_memptr, const ULON
 		UBYTE an = screendata >> 6;
 		UBYTE chdata;
 #ifdef PAGED_MEM
-		chdata = MEMORY_dGetByte(t_chbase + ((UWORD) (screendata & 0x3f) << 3));
+		chdata = ANTIC_dGetByte(t_chbase + ((UWORD) (screendata & 0x3f) << 3));
 #else
 		chdata = chptr[(screendata & 0x3f) << 3];
 #endif
@@ -2797,14 +2828,17 @@ static void antic_load(void)
 	UBYTE *antic_memptr = antic_memory + ANTIC_margin;
 	UWORD new_screenaddr = screenaddr + chars_read[md];
 	if ((screenaddr ^ new_screenaddr) & 0xf000) {
-		do
-			*antic_memptr++ = MEMORY_dGetByte(screenaddr++);
-		while (screenaddr & 0xfff);
+		do {
+			*antic_memptr++ = ANTIC_dGetByte(screenaddr);
+			screenaddr++;
+		} while (screenaddr & 0xfff);
 		screenaddr -= 0x1000;
 		new_screenaddr -= 0x1000;
 	}
-	while (screenaddr < new_screenaddr)
-		*antic_memptr++ = MEMORY_dGetByte(screenaddr++);
+	while (screenaddr < new_screenaddr) {
+		*antic_memptr++ = ANTIC_dGetByte(screenaddr);
+		screenaddr++;
+	}
 #else
 	UWORD new_screenaddr = screenaddr + chars_read[md];
 	if ((screenaddr ^ new_screenaddr) & 0xf000) {
@@ -2859,6 +2893,8 @@ void ANTIC_Frame(int draw_display)
 		{ 0, 0, 7, 9, 7, 15, 7, 15, 7, 3, 3, 1, 0, 1, 0, 0 };
 	UBYTE vscrol_flag = FALSE;
 	UBYTE no_jvb = TRUE;
+	int compute_only;
+	int line_step;
 #ifndef NEW_CYCLE_EXACT
 	UBYTE need_load;
 #endif
@@ -2867,13 +2903,28 @@ void ANTIC_Frame(int draw_display)
 	int cpu2antic_index;
 #endif /* NEW_CYCLE_EXACT */
 
+	PERFSTAT_ENTER(PERFSTAT_ANTIC);
 	ANTIC_ypos = 0;
 	do {
 		POKEY_Scanline();		/* check and generate IRQ */
 		OVERSCREEN_LINE;
 	} while (ANTIC_ypos < 8);
 
-	scrn_ptr = (UWORD *) Screen_atari;
+#if defined(NEW_CYCLE_EXACT) || defined(DIRTYRECT)
+	/* register writes draw partial scanlines, and DIRTYRECT tracks every
+	   write relative to Screen_atari, so always draw the screen */
+	compute_only = FALSE;
+#else
+	compute_only = draw_display && ANTIC_compute_only;
+#endif
+	if (compute_only) {
+		scrn_ptr = (UWORD *) compute_line;
+		line_step = 0;
+	}
+	else {
+		scrn_ptr = (UWORD *) Screen_atari;
+		line_step = Screen_WIDTH / 2;
+	}
 #ifdef NEW_CYCLE_EXACT
 	ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
 #endif
@@ -3083,7 +3134,7 @@ void ANTIC_Frame(int draw_display)
 			UPDATE_GTIA_BUG;
 			ANTIC_cur_screen_pos = ANTIC_NOT_DRAWING;
 			YPOS_BREAK_FLICKER;
-			scrn_ptr += Screen_WIDTH / 2;
+			scrn_ptr += line_step;
 			if (no_jvb) {
 				dctr++;
 				dctr &= 0xf;
@@ -3107,10 +3158,12 @@ void ANTIC_Frame(int draw_display)
 		ANTIC_xpos += ANTIC_DMAR;
 
 		if (anticmode < 2 || (ANTIC_DMACTL & 3) == 0) {
-			draw_antic_0_ptr();
+			/* blank lines have no playfield to collide with */
+			if (!compute_only)
+				draw_antic_0_ptr();
 			GOEOL;
 			YPOS_BREAK_FLICKER;
-			scrn_ptr += Screen_WIDTH / 2;
+			scrn_ptr += line_step;
 			if (no_jvb) {
 				dctr++;
 				dctr &= 0xf;
@@ -3134,22 +3187,27 @@ void ANTIC_Frame(int draw_display)
 				ANTIC_xpos -= extra_cycles[md];
 		}
 
-		draw_antic_ptr(chars_displayed[md],
-			antic_memory + ANTIC_margin + ch_offset[md],
-			scrn_ptr + x_min[md],
-			(ULONG *) &GTIA_pm_scanline[x_min[md]]);
+		/* Without players and missiles on the line there are no collisions,
+		   so compute-only mode just accounts for the font fetches. */
+		if (!compute_only || GTIA_pm_dirty)
+			draw_antic_ptr(chars_displayed[md],
+				antic_memory + ANTIC_margin + ch_offset[md],
+				scrn_ptr + x_min[md],
+				(ULONG *) &GTIA_pm_scanline[x_min[md]]);
+		else if (anticmode < 8)
+			ANTIC_xpos += font_cycles[md];
 
 		GOEOL;
 #endif /* NEW_CYCLE_EXACT */
 		YPOS_BREAK_FLICKER;
-		scrn_ptr += Screen_WIDTH / 2;
+		scrn_ptr += line_step;
 		dctr++;
 		dctr &= 0xf;
 	} while (ANTIC_ypos < (Screen_HEIGHT + 8));
 
 #ifndef NO_SIMPLE_PAL_BLENDING
 	/* Simple PAL blending, using only the base 256 color palette. */
-	if (ANTIC_pal_blending)
+	if (ANTIC_pal_blending && !compute_only)
 	{
 		int ypos = ANTIC_ypos - 1;
 		/* Start at the last screen line (248). */
@@ -3194,6 +3252,7 @@ void ANTIC_Frame(int draw_display)
 		OVERSCREEN_LINE;
 	} while (ANTIC_ypos < Atari800_tv_mode);
 	ANTIC_ypos = 0; /* just for monitor.c */
+	PERFSTAT_LEAVE();
 }
 
 #ifdef NEW_CYCLE_EXACT
@@ -3681,6 +3740,9 @@ void ANTIC_SetPrior(UBYTE byte)
 
 void ANTIC_PutByte(UWORD addr, UBYTE byte)
 {
+#ifdef PROFILER
+	int wsync_from;
+#endif
 	switch (addr & 0xf) {
 	case ANTIC_OFFSET_DLISTL:
 		ANTIC_dlist = (ANTIC_dlist & 0xff00) | byte;
@@ -4031,6 +4093,9 @@ glitch */
 		break;
 #endif /* defined(BASIC) || defined(CURSES_BASIC) */
 	case ANTIC_OFFSET_WSYNC:
+#ifdef PROFILER
+		wsync_from = ANTIC_xpos;
+#endif
 #ifdef NEW_CYCLE_EXACT
 		if (ANTIC_DRAWING_SCREEN) {
 			if (ANTIC_xpos <= ANTIC_antic2cpu_ptr[ANTIC_WSYNC_C] && ANTIC_xpos_limit >= ANTIC_antic2cpu_ptr[ANTIC_WSYNC_C])
@@ -4072,6 +4137,9 @@ case we have ANTIC_cpu2antic_ptr[ANTIC_WSYNC_C+1]-1 = 8 and in the 2nd =12  */
 #ifdef NEW_CYCLE_EXACT
 		}
 #endif /* NEW_CYCLE_EXACT */
+#ifdef PROFILER
+		PROFILER_WsyncSkip(wsync_from);
+#endif
 		break;
 	case ANTIC_OFFSET_NMIEN:
 		ANTIC_NMIEN = byte;
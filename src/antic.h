@@ -74,6 +74,13 @@ extern UBYTE ANTIC_PENV_input;
 int ANTIC_Initialise(int *argc, char *argv[]);
 void ANTIC_Reset(void);
 void ANTIC_Frame(int draw_display);
+
+/* When set, ANTIC_Frame(TRUE) emulates everything the Atari program can
+   observe - DMA cycles, collisions, DLIs and VBI - but doesn't write to
+   Screen_atari. Only lines with players or missiles are drawn, into a
+   scratch buffer, for the collisions. Ignored with NEW_CYCLE_EXACT and
+   DIRTYRECT. */
+extern int ANTIC_compute_only;
 UBYTE ANTIC_GetByte(UWORD addr, int no_side_effects);
 void ANTIC_PutByte(UWORD addr, UBYTE byte);
 
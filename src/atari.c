@@ -71,6 +71,10 @@
 #include "devices.h"
 #include "esc.h"
 #include "gtia.h"
+#ifdef HWTRACE
+#include "hwtrace.h"
+#endif
+#include "imagestore.h"
 #include "input.h"
 #include "log.h"
 #include "memory.h"
@@ -83,7 +87,9 @@
 #endif
 #include "pia.h"
 #include "platform.h"
+#include "perfstat.h"
 #include "pokey.h"
+#include "profiler.h"
 #include "rtime.h"
 #include "pbi.h"
 #include "sio.h"
@@ -91,6 +97,8 @@
 #include "util.h"
 #if !defined(BASIC) && !defined(CURSES_BASIC)
 #include "colours.h"
+#include "movie.h"
+#include "rewind.h"
 #include "screen.h"
 #endif
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
@@ -256,6 +264,10 @@ void Atari800_Warmstart(void)
 	if (netsio_enabled)
 		netsio_warm_reset();
 #endif /* NETSIO */
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	REWIND_Mark();
+	MOVIE_Mark();
+#endif
 }
 
 void Atari800_Coldstart(void)
@@ -292,6 +304,10 @@ void Atari800_Coldstart(void)
 	if(netsio_enabled)
 		netsio_cold_reset();
 #endif /* NETSIO */
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	REWIND_Mark();
+	MOVIE_Mark();
+#endif
 }
 
 int Atari800_LoadImage(const char *filename, UBYTE *buffer, int nbytes)
@@ -852,6 +868,13 @@ int Atari800_Initialise(int *argc, char *argv[])
 #ifdef POKEYREC
 		|| !POKEYREC_Initialise(argc, argv)
 #endif
+#ifdef HWTRACE
+		|| !HWTRACE_Initialise(argc, argv)
+#endif
+#ifdef PROFILER
+		|| !PROFILER_Initialise(argc, argv)
+#endif
+		|| !PERFSTAT_Initialise(argc, argv)
 		|| !SIO_Initialise (argc, argv)
 		|| !CARTRIDGE_Initialise(argc, argv)
 		|| !CASSETTE_Initialise(argc, argv)
@@ -862,6 +885,10 @@ int Atari800_Initialise(int *argc, char *argv[])
 #ifndef BASIC
 		|| !INPUT_Initialise(argc, argv)
 #endif
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+		|| !REWIND_Initialise(argc, argv)
+		|| !MOVIE_Initialise(argc, argv)
+#endif
 #ifdef XEP80_EMULATION
 		|| !XEP80_Initialise(argc, argv)
 #endif
@@ -1141,16 +1168,27 @@ int Atari800_Exit(int run_monitor)
 #endif
 #ifndef BASIC
 		INPUT_Exit();	/* finish event recording */
+#endif
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+		MOVIE_Exit();
+		REWIND_Exit();
 #endif
 		PBI_Exit();
 		CASSETTE_Exit(); /* Finish writing to the cassette file */
 		CARTRIDGE_Exit();
-		SIO_Exit();	/* umount disks, so temporary files are deleted */
+		SIO_Exit();	/* umount disks, so modified images are written back */
+		IMAGESTORE_Exit();
 #ifdef IDE
 		IDE_Exit();
 #endif
 #ifdef POKEYREC
 		POKEYREC_Exit();
+#endif
+#ifdef HWTRACE
+		HWTRACE_Exit();
+#endif
+#ifdef PROFILER
+		PROFILER_Exit();
 #endif
 		Devices_Exit();
 #ifdef R_IO_DEVICE
@@ -1328,7 +1366,15 @@ static void basic_antic_scanline(void)
 	}
 #ifdef CURSES_BASIC
 	if (--scanlines_to_curses_display == 0) {
+#ifdef PAGED_MEM
+		{
+			UBYTE line[48];
+			MEMORY_dCopyFromMem(screenaddr, line, 48);
+			curses_display_line(IR & 0xf, line);
+		}
+#else
 		curses_display_line(IR & 0xf, MEMORY_mem + screenaddr);
+#endif
 		/* 4k wrap */
 		if (((screenaddr ^ newscreenaddr) & 0x1000) != 0)
 			screenaddr = newscreenaddr - 0x1000;
@@ -1427,7 +1473,18 @@ void Atari800_Frame(void)
 #ifdef SOUND
 		Sound_Continue();
 #endif
+#ifndef CURSES_BASIC
+		/* the UI may have changed the machine in any way */
+		REWIND_Mark();
+		MOVIE_Mark();
+#endif
+		break;
+#ifndef CURSES_BASIC
+	case AKEY_REWIND:
+		/* holding the key rewinds at twice the normal speed */
+		REWIND_StepBack(3);
 		break;
+#endif
 #ifdef SCREENSHOTS
 	case AKEY_SCREENSHOT:
 		Screen_SaveNextScreenshot(FALSE);
@@ -1444,6 +1501,10 @@ void Atari800_Frame(void)
 	default:
 		break;
 	}
+#ifndef CURSES_BASIC
+	MOVIE_Frame();
+	REWIND_Frame();
+#endif
 #endif /* BASIC */
 
 #ifdef PBI_BB
@@ -1453,9 +1514,20 @@ void Atari800_Frame(void)
 	VOTRAXSND_Frame(); /* for the Votrax */
 #endif
 	Devices_Frame();
+	SIO_Frame();
+#ifdef NETSIO
+	netsio_send_pending();
+#endif /* NETSIO */
 #ifndef BASIC
 	INPUT_Frame();
 #endif
+#ifdef HWTRACE
+	HWTRACE_Frame();
+#endif
+#ifdef PROFILER
+	PROFILER_Frame();
+#endif
+	PERFSTAT_Frame();
 	GTIA_Frame();
 
 #ifdef BASIC
@@ -1472,6 +1544,7 @@ void Atari800_Frame(void)
 		ANTIC_Frame(TRUE);
 		INPUT_DrawMousePointer();
 		Screen_DrawAtariSpeed(Util_time());
+		Screen_DrawPerfStats(Util_time());
 		Screen_DrawDiskLED();
 		Screen_Draw1200LED();
 		Screen_DrawStatusText();
@@ -1493,10 +1566,14 @@ void Atari800_Frame(void)
 #endif /* BASIC */
 	POKEY_Frame();
 #ifdef VIDEO_RECORDING
+	PERFSTAT_ENTER(PERFSTAT_EXPORT);
 	File_Export_WriteVideo();
+	PERFSTAT_LEAVE();
 #endif
 #ifdef SOUND
+	PERFSTAT_ENTER(PERFSTAT_SOUND);
 	Sound_Update();
+	PERFSTAT_LEAVE();
 #endif
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 	/* multimedia stats are drawn here so they don't get recorded in the video */
@@ -1531,11 +1608,39 @@ void Atari800_Frame(void)
 		else
 			Atari800_Sync();
 #endif /* BENCHMARK */
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+	/* nothing was drawn */
+	if (ANTIC_compute_only)
+		Atari800_display_screen = FALSE;
+#endif
 #endif /* LIBATARI800 */
 }
 
 #endif /* __PLUS */
 
+#if !defined(BASIC) && !defined(CURSES_BASIC)
+void Atari800_ReplayFrame(void)
+{
+	int compute_only = ANTIC_compute_only;
+
+#ifdef PBI_BB
+	PBI_BB_Frame();
+#endif
+#if defined(PBI_XLD) || defined (VOICEBOX)
+	VOTRAXSND_Frame();
+#endif
+	Devices_Frame();
+	INPUT_Frame();
+	GTIA_Frame();
+	/* the frame is not displayed */
+	ANTIC_compute_only = TRUE;
+	ANTIC_Frame(TRUE);
+	ANTIC_compute_only = compute_only;
+	POKEY_Frame();
+	Atari800_nframes++;
+}
+#endif /* !defined(BASIC) && !defined(CURSES_BASIC) */
+
 #ifndef BASIC
 
 void Atari800_StateSave(void)
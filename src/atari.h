@@ -133,6 +133,10 @@ int Atari800_Initialise(int *argc, char *argv[]);
 /* Emulates one frame (1/50sec for PAL, 1/60sec for NTSC). */
 void Atari800_Frame(void);
 
+/* Emulates one frame without host output, taking the input from
+   INPUT_replay. Used to bring the machine forward from a snapshot. */
+void Atari800_ReplayFrame(void);
+
 /* Reboots the emulated Atari. */
 void Atari800_Coldstart(void);
 
@@ -0,0 +1,380 @@
+/*
+ * blit.c - vectorised inner loops of the software blitters
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "atari.h"
+#include "blit.h"
+
+/* GCC vector extensions compile to SSE2 on x86-64 and to NEON on ARM. */
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__))
+#define BLIT_VECTOR
+typedef ULONG v4u32 __attribute__((vector_size(16)));
+typedef UWORD v8u16 __attribute__((vector_size(16)));
+typedef UBYTE v16u8 __attribute__((vector_size(16)));
+#endif
+
+/* AVX2 has gathers, which the palette lookups need. */
+#if defined(BLIT_VECTOR) && (defined(__x86_64__) || defined(__i386__))
+#define BLIT_AVX2
+#include <immintrin.h>
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+static void Expand16(UWORD *dest, UBYTE const *src, int size, UWORD const *palette)
+{
+	int i;
+	for (i = 0; i < size; i++)
+		dest[i] = palette[src[i]];
+}
+
+static void Expand32(ULONG *dest, UBYTE const *src, int size, ULONG const *palette)
+{
+	int i;
+	for (i = 0; i < size; i++)
+		dest[i] = palette[src[i]];
+}
+
+static void Gather16(UWORD *dest, UWORD const *src, int const *index, int size)
+{
+	int i;
+	for (i = 0; i < size; i++)
+		dest[i] = src[index[i]];
+}
+
+static void Gather32(ULONG *dest, ULONG const *src, int const *index, int size)
+{
+	int i;
+	for (i = 0; i < size; i++)
+		dest[i] = src[index[i]];
+}
+
+#ifdef BLIT_AVX2
+static AVX2 void Expand16AVX2(UWORD *dest, UBYTE const *src, int size, UWORD const *palette)
+{
+	__m256i const mask = _mm256_set1_epi32(0xffff);
+	int i;
+	for (i = 0; i + 8 <= size; i += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *)(src + i)));
+		/* Reads two bytes past each entry, hence the padding requirement. */
+		__m256i v = _mm256_and_si256(_mm256_i32gather_epi32((int const *)palette, idx, 2), mask);
+		v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+		_mm_storeu_si128((__m128i *)(dest + i), _mm256_castsi256_si128(v));
+	}
+	Expand16(dest + i, src + i, size - i, palette);
+}
+
+static AVX2 void Expand32AVX2(ULONG *dest, UBYTE const *src, int size, ULONG const *palette)
+{
+	int i;
+	for (i = 0; i + 8 <= size; i += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *)(src + i)));
+		_mm256_storeu_si256((__m256i *)(dest + i), _mm256_i32gather_epi32((int const *)palette, idx, 4));
+	}
+	Expand32(dest + i, src + i, size - i, palette);
+}
+
+static AVX2 void Gather16AVX2(UWORD *dest, UWORD const *src, int const *index, int size)
+{
+	__m256i const mask = _mm256_set1_epi32(0xffff);
+	int i;
+	for (i = 0; i + 8 <= size; i += 8) {
+		__m256i idx = _mm256_loadu_si256((__m256i const *)(index + i));
+		__m256i v = _mm256_and_si256(_mm256_i32gather_epi32((int const *)src, idx, 2), mask);
+		v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+		_mm_storeu_si128((__m128i *)(dest + i), _mm256_castsi256_si128(v));
+	}
+	Gather16(dest + i, src, index + i, size - i);
+}
+
+static AVX2 void Gather32AVX2(ULONG *dest, ULONG const *src, int const *index, int size)
+{
+	int i;
+	for (i = 0; i + 8 <= size; i += 8) {
+		__m256i idx = _mm256_loadu_si256((__m256i const *)(index + i));
+		_mm256_storeu_si256((__m256i *)(dest + i), _mm256_i32gather_epi32((int const *)src, idx, 4));
+	}
+	Gather32(dest + i, src, index + i, size - i);
+}
+#endif /* BLIT_AVX2 */
+
+static int initialised = FALSE;
+static void (*expand16)(UWORD *dest, UBYTE const *src, int size, UWORD const *palette) = Expand16;
+static void (*expand32)(ULONG *dest, UBYTE const *src, int size, ULONG const *palette) = Expand32;
+static void (*gather16)(UWORD *dest, UWORD const *src, int const *index, int size) = Gather16;
+static void (*gather32)(ULONG *dest, ULONG const *src, int const *index, int size) = Gather32;
+
+int BLIT_SelectKernels(int use_simd)
+{
+	initialised = TRUE;
+#ifdef BLIT_AVX2
+	__builtin_cpu_init();
+	if (use_simd && __builtin_cpu_supports("avx2")) {
+		expand16 = Expand16AVX2;
+		expand32 = Expand32AVX2;
+		gather16 = Gather16AVX2;
+		gather32 = Gather32AVX2;
+		return TRUE;
+	}
+#endif /* BLIT_AVX2 */
+	expand16 = Expand16;
+	expand32 = Expand32;
+	gather16 = Gather16;
+	gather32 = Gather32;
+	return FALSE;
+}
+
+static void Initialise(void)
+{
+	BLIT_SelectKernels(TRUE);
+}
+
+void BLIT_Expand16(UWORD *dest, UBYTE const *src, int size, UWORD const *palette)
+{
+	if (!initialised)
+		Initialise();
+	expand16(dest, src, size, palette);
+}
+
+void BLIT_Expand32(ULONG *dest, UBYTE const *src, int size, ULONG const *palette)
+{
+	if (!initialised)
+		Initialise();
+	expand32(dest, src, size, palette);
+}
+
+void BLIT_Gather16(UWORD *dest, UWORD const *src, int const *index, int size)
+{
+	if (!initialised)
+		Initialise();
+	gather16(dest, src, index, size);
+}
+
+void BLIT_Gather32(ULONG *dest, ULONG const *src, int const *index, int size)
+{
+	if (!initialised)
+		Initialise();
+	gather32(dest, src, index, size);
+}
+
+int BLIT_ScaleIndex(int *index, int size, int src_width, int dx, int *width)
+{
+	int x = (src_width << 16) - 0x4000;
+	int first;
+	int i;
+	/* The blitters walked from the right edge, so the rounding follows. */
+	for (i = size - 1; i >= 0; i--) {
+		index[i] = x >> 16;
+		x -= dx;
+	}
+	first = index[0];
+	for (i = 0; i < size; i++)
+		index[i] -= first;
+	*width = size > 0 ? index[size - 1] + 1 : 0;
+	return first;
+}
+
+/* The remaining loops are plain arithmetic, which the vector extensions
+   cover on every architecture. */
+
+void BLIT_MixLuma(UBYTE *dest, UBYTE const *hi, UBYTE const *lo, int size)
+{
+	int i = 0;
+#ifdef BLIT_VECTOR
+	for (; i + 16 <= size; i += 16) {
+		v16u8 h, l;
+		memcpy(&h, hi + i, sizeof(h));
+		memcpy(&l, lo + i, sizeof(l));
+		h = (h & 0xf0) | (l & 0x0f);
+		memcpy(dest + i, &h, sizeof(h));
+	}
+#endif /* BLIT_VECTOR */
+	for (; i < size; i++)
+		dest[i] = (hi[i] & 0xf0) | (lo[i] & 0x0f);
+}
+
+void BLIT_Average16(UWORD *dest, UWORD const *a, UWORD const *b, int size, UWORD mask)
+{
+	int i = 0;
+#ifdef BLIT_VECTOR
+	for (; i + 8 <= size; i += 8) {
+		v8u16 x, y;
+		memcpy(&x, a + i, sizeof(x));
+		memcpy(&y, b + i, sizeof(y));
+		x = (x & y) + (((x ^ y) & mask) >> 1);
+		memcpy(dest + i, &x, sizeof(x));
+	}
+#endif /* BLIT_VECTOR */
+	for (; i < size; i++)
+		dest[i] = (a[i] & b[i]) + (((a[i] ^ b[i]) & mask) >> 1);
+}
+
+void BLIT_Average32(ULONG *dest, ULONG const *a, ULONG const *b, int size, ULONG mask)
+{
+	int i = 0;
+#ifdef BLIT_VECTOR
+	for (; i + 4 <= size; i += 4) {
+		v4u32 x, y;
+		memcpy(&x, a + i, sizeof(x));
+		memcpy(&y, b + i, sizeof(y));
+		x = (x & y) + (((x ^ y) & mask) >> 1);
+		memcpy(dest + i, &x, sizeof(x));
+	}
+#endif /* BLIT_VECTOR */
+	for (; i < size; i++)
+		dest[i] = (a[i] & b[i]) + (((a[i] ^ b[i]) & mask) >> 1);
+}
+
+/* The 565 format is split into two words with gaps of 5 bits above every
+   component, so that all three are multiplied at once. */
+void BLIT_Scanline565(ULONG *dest, ULONG const *src, ULONG const *src2, int size, ULONG factor)
+{
+	int i = 0;
+	if (src2 == NULL) {
+#ifdef BLIT_VECTOR
+		for (; i + 4 <= size; i += 4) {
+			v4u32 p;
+			memcpy(&p, src + i, sizeof(p));
+			p = ((((p & 0x07e0f81f) * factor) & 0xfc1f03e0) >> 5)
+			    | ((((p >> 5) & 0x07c0f83f) * factor) & 0xf81f07e0);
+			memcpy(dest + i, &p, sizeof(p));
+		}
+#endif /* BLIT_VECTOR */
+		for (; i < size; i++) {
+			ULONG pixel = src[i];
+			ULONG a = (((pixel & 0x07e0f81f) * factor) & 0xfc1f03e0) >> 5;
+			ULONG b = (((pixel >> 5) & 0x07c0f83f) * factor) & 0xf81f07e0;
+			dest[i] = a | b;
+		}
+	}
+	else {
+#ifdef BLIT_VECTOR
+		for (; i + 4 <= size; i += 4) {
+			v4u32 p, q;
+			memcpy(&p, src + i, sizeof(p));
+			memcpy(&q, src2 + i, sizeof(q));
+			p = (((((p & 0x07e0f81f) + (q & 0x07e0f81f)) * factor) & 0xfc1f03e0) >> 5)
+			    | (((((p >> 5) & 0x07c0f83f) + ((q >> 5) & 0x07c0f83f)) * factor) & 0xf81f07e0);
+			memcpy(dest + i, &p, sizeof(p));
+		}
+#endif /* BLIT_VECTOR */
+		for (; i < size; i++) {
+			ULONG pixel = src[i];
+			ULONG pixel2 = src2[i];
+			ULONG a = ((((pixel & 0x07e0f81f) + (pixel2 & 0x07e0f81f)) * factor) & 0xfc1f03e0) >> 5;
+			ULONG b = ((((pixel >> 5) & 0x07c0f83f) + ((pixel2 >> 5) & 0x07c0f83f)) * factor) & 0xf81f07e0;
+			dest[i] = a | b;
+		}
+	}
+}
+
+void BLIT_ScanlineARGB(ULONG *dest, ULONG const *src, ULONG const *src2, int size, ULONG factor)
+{
+	int i = 0;
+	if (src2 == NULL) {
+#ifdef BLIT_VECTOR
+		for (; i + 4 <= size; i += 4) {
+			v4u32 p;
+			memcpy(&p, src + i, sizeof(p));
+			p = ((((p & 0x00ff00ff) * factor) & 0xff00ff00) >> 8)
+			    | ((((p & 0x0000ff00) >> 8) * factor) & 0x0000ff00);
+			memcpy(dest + i, &p, sizeof(p));
+		}
+#endif /* BLIT_VECTOR */
+		for (; i < size; i++) {
+			ULONG pixel = src[i];
+			ULONG a = (((pixel & 0x00ff00ff) * factor) & 0xff00ff00) >> 8;
+			ULONG b = (((pixel & 0x0000ff00) >> 8) * factor) & 0x0000ff00;
+			dest[i] = a | b;
+		}
+	}
+	else {
+#ifdef BLIT_VECTOR
+		for (; i + 4 <= size; i += 4) {
+			v4u32 p, q;
+			memcpy(&p, src + i, sizeof(p));
+			memcpy(&q, src2 + i, sizeof(q));
+			p = (((((p & 0x00ff00ff) + (q & 0x00ff00ff)) * factor) & 0xff00ff00) >> 8)
+			    | (((((p & 0x0000ff00) + (q & 0x0000ff00)) >> 8) * factor) & 0x0000ff00);
+			memcpy(dest + i, &p, sizeof(p));
+		}
+#endif /* BLIT_VECTOR */
+		for (; i < size; i++) {
+			ULONG pixel = src[i];
+			ULONG pixel2 = src2[i];
+			ULONG a = ((((pixel & 0x00ff00ff) + (pixel2 & 0x00ff00ff)) * factor) & 0xff00ff00) >> 8;
+			ULONG b = ((((pixel & 0x0000ff00) + (pixel2 & 0x0000ff00)) >> 8) * factor) & 0x0000ff00;
+			dest[i] = a | b;
+		}
+	}
+}
+
+void BLIT_Max8(UBYTE *dest, UBYTE const *a, UBYTE const *b, int size)
+{
+	int i = 0;
+#ifdef BLIT_VECTOR
+	for (; i + 16 <= size; i += 16) {
+		v16u8 p, q;
+		memcpy(&p, a + i, sizeof(p));
+		memcpy(&q, b + i, sizeof(q));
+		/* Comparisons give all ones where true. */
+		p = (p & (v16u8) (p > q)) | (q & (v16u8) (p <= q));
+		memcpy(dest + i, &p, sizeof(p));
+	}
+#endif /* BLIT_VECTOR */
+	for (; i < size; i++)
+		dest[i] = a[i] > b[i] ? a[i] : b[i];
+}
+
+void BLIT_MulAddPairs8(UWORD *even, UWORD *odd, UBYTE const *src, int size, UWORD weight)
+{
+	int i = 0;
+#ifdef BLIT_VECTOR
+	for (; i + 16 <= size; i += 16) {
+		v8u16 p, e, o;
+		memcpy(&p, src + i, sizeof(p));
+		memcpy(&e, even + i / 2, sizeof(e));
+		memcpy(&o, odd + i / 2, sizeof(o));
+#ifdef WORDS_BIGENDIAN
+		e += (p >> 8) * weight;
+		o += (p & 0xff) * weight;
+#else
+		e += (p & 0xff) * weight;
+		o += (p >> 8) * weight;
+#endif
+		memcpy(even + i / 2, &e, sizeof(e));
+		memcpy(odd + i / 2, &o, sizeof(o));
+	}
+#endif /* BLIT_VECTOR */
+	for (; i + 2 <= size; i += 2) {
+		even[i / 2] += src[i] * weight;
+		odd[i / 2] += src[i + 1] * weight;
+	}
+	if (i < size)
+		even[i / 2] += src[i] * weight;
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,61 @@
+#ifndef BLIT_H_
+#define BLIT_H_
+
+#include "atari.h"
+
+/* Inner loops of the software blitters. Every function has a portable
+   version and, where the compiler and host support them, versions that use
+   SSE2 or NEON (through GCC vector extensions) and AVX2 (selected at runtime
+   by CPUID). All versions give identical results. */
+
+/* DEST[i] = PALETTE[SRC[i]] for 0 <= i < SIZE.
+   The AVX2 version of BLIT_Expand16 gathers 32-bit words, so it reads two
+   bytes past the entry it looks up: the caller must pad PALETTE with at
+   least one UWORD after its 256th entry. */
+void BLIT_Expand16(UWORD *dest, UBYTE const *src, int size, UWORD const *palette);
+void BLIT_Expand32(ULONG *dest, UBYTE const *src, int size, ULONG const *palette);
+
+/* DEST[i] = SRC[INDEX[i]] for 0 <= i < SIZE.
+   Like BLIT_Expand16, BLIT_Gather16 reads two bytes past the entry it looks
+   up: the caller must pad SRC with at least one UWORD after its highest
+   indexed entry. */
+void BLIT_Gather16(UWORD *dest, UWORD const *src, int const *index, int size);
+void BLIT_Gather32(ULONG *dest, ULONG const *src, int const *index, int size);
+
+/* Selects the versions of BLIT_Expand* and BLIT_Gather* used from now on:
+   the fastest the host supports if USE_SIMD is TRUE (the default), the
+   portable ones otherwise. Returns TRUE if the AVX2 versions are selected.
+   Used by the tests to check every version. */
+int BLIT_SelectKernels(int use_simd);
+
+/* Fills INDEX[0..SIZE-1] with the source columns shown by a row of SIZE
+   pixels when scaling a row of SRC_WIDTH pixels with a step of DX (16.16
+   fixed point), taking the same steps as the scaling blitters. The indexes
+   are relative to the leftmost column shown, which is returned and may be
+   -1; the number of columns shown is stored in *WIDTH. */
+int BLIT_ScaleIndex(int *index, int size, int src_width, int dx, int *width);
+
+/* DEST[i] = (HI[i] & 0xf0) | (LO[i] & 0x0f): the luminance of HI with the
+   hue of LO. */
+void BLIT_MixLuma(UBYTE *dest, UBYTE const *hi, UBYTE const *lo, int size);
+
+/* DEST[i] = (A[i] & B[i]) + (((A[i] ^ B[i]) & MASK) >> 1). When MASK clears
+   the lowest bit of every colour component, this is the average of A[i] and
+   B[i] rounded down. DEST may be equal to A or B. */
+void BLIT_Average16(UWORD *dest, UWORD const *a, UWORD const *b, int size, UWORD mask);
+void BLIT_Average32(ULONG *dest, ULONG const *a, ULONG const *b, int size, ULONG mask);
+
+/* Darkens SIZE words of SRC into DEST by FACTOR/32 (two RGB565 pixels per
+   word) or FACTOR/256 (ARGB8888), for drawing scanlines. If SRC2 is not NULL,
+   the sum of SRC and SRC2 is darkened instead. */
+void BLIT_Scanline565(ULONG *dest, ULONG const *src, ULONG const *src2, int size, ULONG factor);
+void BLIT_ScanlineARGB(ULONG *dest, ULONG const *src, ULONG const *src2, int size, ULONG factor);
+
+/* DEST[i] = max(A[i], B[i]). DEST may be equal to A or B. */
+void BLIT_Max8(UBYTE *dest, UBYTE const *a, UBYTE const *b, int size);
+
+/* EVEN[i] += WEIGHT * SRC[2 * i] and ODD[i] += WEIGHT * SRC[2 * i + 1] for
+   the SIZE bytes of SRC, for resampling. The sums must fit in 16 bits. */
+void BLIT_MulAddPairs8(UWORD *even, UWORD *odd, UBYTE const *src, int size, UWORD weight);
+
+#endif /* BLIT_H_ */
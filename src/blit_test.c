@@ -0,0 +1,319 @@
+/*
+ * blit_test.c - checks the blitter kernels against plain loops
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Runs every version of the kernels in blit.c that the host supports (the
+   portable ones, the GCC vector extension ones, which are SSE2 on x86 and
+   NEON on ARM, and the AVX2 ones) on random data, and compares the output
+   byte for byte with the plain loops below. Every width from 0 to
+   MAX_SIZE - 1 is tried, odd ones included, so the vector loops are checked
+   together with their scalar tails, at every alignment up to 4 elements.
+   The bytes around each output are checked for stray writes.
+
+   Built and run by "make check". */
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "atari.h"
+#include "blit.h"
+
+/* Widest row tried: more than two of the widest vectors plus a tail. */
+#define MAX_SIZE 80
+/* Elements before and after each output, checked for stray writes. */
+#define PAD 8
+#define N_OFFSETS 4
+
+typedef union {
+	UBYTE b[(MAX_SIZE + 2 * PAD) * 4];
+	UWORD w[(MAX_SIZE + 2 * PAD) * 2];
+	ULONG l[MAX_SIZE + 2 * PAD];
+} buffer_t;
+
+static buffer_t got;
+static buffer_t want;
+static buffer_t in_a;
+static buffer_t in_b;
+static buffer_t in_c;
+/* The 16-bit palette is padded as blit.h requires. */
+static UWORD palette16[256 + 1];
+static ULONG palette32[256];
+static int columns[MAX_SIZE];
+
+static ULONG seed = 1;
+static int failures = 0;
+
+static ULONG Random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static void Fill(void *buf, size_t size)
+{
+	UBYTE *ptr = (UBYTE *) buf;
+	size_t i;
+	for (i = 0; i < size; i++)
+		ptr[i] = (UBYTE) (Random() >> 24);
+}
+
+/* Fills the inputs with random data and the outputs with the same random
+   data, so that stray writes show up. */
+static void Prepare(void)
+{
+	Fill(&in_a, sizeof(in_a));
+	Fill(&in_b, sizeof(in_b));
+	Fill(&in_c, sizeof(in_c));
+	Fill(&got, sizeof(got));
+	memcpy(&want, &got, sizeof(got));
+}
+
+static void Check(char const *name, int size, int offset)
+{
+	if (memcmp(&got, &want, sizeof(got)) != 0) {
+		size_t i;
+		for (i = 0; got.b[i] == want.b[i]; i++);
+		printf("%s: width %d, offset %d: byte %d differs\n", name, size, offset, (int) i);
+		failures++;
+	}
+}
+
+static void TestExpand(int size, int offset)
+{
+	int i;
+
+	Prepare();
+	BLIT_Expand16(got.w + PAD + offset, in_a.b + offset, size, palette16);
+	for (i = 0; i < size; i++)
+		want.w[PAD + offset + i] = palette16[in_a.b[offset + i]];
+	Check("BLIT_Expand16", size, offset);
+
+	Prepare();
+	BLIT_Expand32(got.l + PAD + offset, in_a.b + offset, size, palette32);
+	for (i = 0; i < size; i++)
+		want.l[PAD + offset + i] = palette32[in_a.b[offset + i]];
+	Check("BLIT_Expand32", size, offset);
+}
+
+static void TestGather(int size, int offset)
+{
+	int i;
+
+	/* The rows are gathered from the first MAX_SIZE entries, so the rest of
+	   the buffer pads them. */
+	for (i = 0; i < size; i++)
+		columns[i] = (int) (Random() % MAX_SIZE);
+
+	Prepare();
+	BLIT_Gather16(got.w + PAD + offset, in_c.w, columns, size);
+	for (i = 0; i < size; i++)
+		want.w[PAD + offset + i] = in_c.w[columns[i]];
+	Check("BLIT_Gather16", size, offset);
+
+	Prepare();
+	BLIT_Gather32(got.l + PAD + offset, in_c.l, columns, size);
+	for (i = 0; i < size; i++)
+		want.l[PAD + offset + i] = in_c.l[columns[i]];
+	Check("BLIT_Gather32", size, offset);
+}
+
+static void TestMixLuma(int size, int offset)
+{
+	int i;
+
+	Prepare();
+	BLIT_MixLuma(got.b + PAD + offset, in_a.b + offset, in_b.b + offset, size);
+	for (i = 0; i < size; i++)
+		want.b[PAD + offset + i] = (in_a.b[offset + i] & 0xf0) | (in_b.b[offset + i] & 0x0f);
+	Check("BLIT_MixLuma", size, offset);
+}
+
+static void TestAverage(int size, int offset)
+{
+	UWORD const mask16 = 0xf7de;	/* RGB565 without the lowest bits */
+	ULONG const mask32 = 0xfefefe;
+	int i;
+
+	Prepare();
+	BLIT_Average16(got.w + PAD + offset, in_a.w + offset, in_b.w + offset, size, mask16);
+	for (i = 0; i < size; i++) {
+		UWORD a = in_a.w[offset + i];
+		UWORD b = in_b.w[offset + i];
+		want.w[PAD + offset + i] = (a & b) + (((a ^ b) & mask16) >> 1);
+	}
+	Check("BLIT_Average16", size, offset);
+
+	/* DEST may be equal to A. */
+	Prepare();
+	memcpy(got.w + PAD, in_a.w, (size + offset) * sizeof(UWORD));
+	memcpy(want.w + PAD, in_a.w, (size + offset) * sizeof(UWORD));
+	BLIT_Average16(got.w + PAD + offset, got.w + PAD + offset, in_b.w + offset, size, mask16);
+	for (i = 0; i < size; i++) {
+		UWORD a = in_a.w[offset + i];
+		UWORD b = in_b.w[offset + i];
+		want.w[PAD + offset + i] = (a & b) + (((a ^ b) & mask16) >> 1);
+	}
+	Check("BLIT_Average16 in place", size, offset);
+
+	Prepare();
+	BLIT_Average32(got.l + PAD + offset, in_a.l + offset, in_b.l + offset, size, mask32);
+	for (i = 0; i < size; i++) {
+		ULONG a = in_a.l[offset + i];
+		ULONG b = in_b.l[offset + i];
+		want.l[PAD + offset + i] = (a & b) + (((a ^ b) & mask32) >> 1);
+	}
+	Check("BLIT_Average32", size, offset);
+}
+
+static void TestScanline(int size, int offset)
+{
+	ULONG factor;
+	int i;
+
+	factor = Random() % 33;
+	Prepare();
+	BLIT_Scanline565(got.l + PAD + offset, in_a.l + offset, NULL, size, factor);
+	for (i = 0; i < size; i++) {
+		ULONG pixel = in_a.l[offset + i];
+		want.l[PAD + offset + i] = ((((pixel & 0x07e0f81f) * factor) & 0xfc1f03e0) >> 5)
+		                           | ((((pixel >> 5) & 0x07c0f83f) * factor) & 0xf81f07e0);
+	}
+	Check("BLIT_Scanline565", size, offset);
+
+	Prepare();
+	BLIT_Scanline565(got.l + PAD + offset, in_a.l + offset, in_b.l + offset, size, factor);
+	for (i = 0; i < size; i++) {
+		ULONG pixel = in_a.l[offset + i];
+		ULONG pixel2 = in_b.l[offset + i];
+		want.l[PAD + offset + i] = (((((pixel & 0x07e0f81f) + (pixel2 & 0x07e0f81f)) * factor) & 0xfc1f03e0) >> 5)
+		                           | (((((pixel >> 5) & 0x07c0f83f) + ((pixel2 >> 5) & 0x07c0f83f)) * factor) & 0xf81f07e0);
+	}
+	Check("BLIT_Scanline565 of two rows", size, offset);
+
+	factor = Random() % 257;
+	Prepare();
+	BLIT_ScanlineARGB(got.l + PAD + offset, in_a.l + offset, NULL, size, factor);
+	for (i = 0; i < size; i++) {
+		ULONG pixel = in_a.l[offset + i];
+		want.l[PAD + offset + i] = ((((pixel & 0x00ff00ff) * factor) & 0xff00ff00) >> 8)
+		                           | ((((pixel & 0x0000ff00) >> 8) * factor) & 0x0000ff00);
+	}
+	Check("BLIT_ScanlineARGB", size, offset);
+
+	Prepare();
+	BLIT_ScanlineARGB(got.l + PAD + offset, in_a.l + offset, in_b.l + offset, size, factor);
+	for (i = 0; i < size; i++) {
+		ULONG pixel = in_a.l[offset + i];
+		ULONG pixel2 = in_b.l[offset + i];
+		want.l[PAD + offset + i] = (((((pixel & 0x00ff00ff) + (pixel2 & 0x00ff00ff)) * factor) & 0xff00ff00) >> 8)
+		                           | (((((pixel & 0x0000ff00) + (pixel2 & 0x0000ff00)) >> 8) * factor) & 0x0000ff00);
+	}
+	Check("BLIT_ScanlineARGB of two rows", size, offset);
+}
+
+static void TestMax(int size, int offset)
+{
+	int i;
+
+	Prepare();
+	BLIT_Max8(got.b + PAD + offset, in_a.b + offset, in_b.b + offset, size);
+	for (i = 0; i < size; i++) {
+		UBYTE a = in_a.b[offset + i];
+		UBYTE b = in_b.b[offset + i];
+		want.b[PAD + offset + i] = a > b ? a : b;
+	}
+	Check("BLIT_Max8", size, offset);
+
+	/* DEST may be equal to B. */
+	Prepare();
+	memcpy(got.b + PAD, in_b.b, size + offset);
+	memcpy(want.b + PAD, in_b.b, size + offset);
+	BLIT_Max8(got.b + PAD + offset, in_a.b + offset, got.b + PAD + offset, size);
+	for (i = 0; i < size; i++) {
+		UBYTE a = in_a.b[offset + i];
+		UBYTE b = in_b.b[offset + i];
+		want.b[PAD + offset + i] = a > b ? a : b;
+	}
+	Check("BLIT_Max8 in place", size, offset);
+}
+
+static void TestMulAddPairs(int size, int offset)
+{
+	/* The odd sums go to the second half of the output. */
+	int const odd = PAD + MAX_SIZE / 2 + PAD;
+	UWORD weight = (UWORD) (Random() % 256);
+	int i;
+
+	Prepare();
+	/* Small starting sums, so that the results fit in 16 bits. */
+	for (i = 0; i < (size + 1) / 2; i++) {
+		got.w[PAD + offset + i] = want.w[PAD + offset + i] = got.w[PAD + offset + i] & 0xff;
+		got.w[odd + offset + i] = want.w[odd + offset + i] = got.w[odd + offset + i] & 0xff;
+	}
+	BLIT_MulAddPairs8(got.w + PAD + offset, got.w + odd + offset, in_a.b + offset, size, weight);
+	for (i = 0; i < size; i++) {
+		if (i % 2 == 0)
+			want.w[PAD + offset + i / 2] += in_a.b[offset + i] * weight;
+		else
+			want.w[odd + offset + i / 2] += in_a.b[offset + i] * weight;
+	}
+	Check("BLIT_MulAddPairs8", size, offset);
+}
+
+int main(void)
+{
+	int use_simd;
+
+	for (use_simd = FALSE; use_simd <= TRUE; use_simd++) {
+		int avx2 = BLIT_SelectKernels(use_simd);
+		int size;
+		int offset;
+
+		if (use_simd && !avx2)
+			break;
+		printf("Checking the %s palette and gather kernels\n", avx2 ? "AVX2" : "portable");
+		Fill(palette16, sizeof(palette16));
+		Fill(palette32, sizeof(palette32));
+		for (size = 0; size < MAX_SIZE; size++) {
+			for (offset = 0; offset < N_OFFSETS; offset++) {
+				TestExpand(size, offset);
+				TestGather(size, offset);
+				TestMixLuma(size, offset);
+				TestAverage(size, offset);
+				TestScanline(size, offset);
+				TestMax(size, offset);
+				TestMulAddPairs(size, offset);
+			}
+		}
+	}
+	BLIT_SelectKernels(TRUE);
+
+	if (failures > 0) {
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("All kernels give the same output as the plain loops\n");
+	return 0;
+}
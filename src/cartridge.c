@@ -30,6 +30,7 @@
 #include "atari.h"
 #include "binload.h" /* BINLOAD_loading_basic */
 #include "cartridge.h"
+#include "imagestore.h"
 #include "memory.h"
 #ifdef IDE
 #  include "ide.h"
@@ -73,14 +74,58 @@ static int CartIsFor5200(int type)
 	return FALSE;
 }
 
+/* Cartridges with RAM keep the RAM contents in their image, and write them
+   back to the file when removed. */
+static int CartIsWritable(int type)
+{
+	switch (type) {
+	case CARTRIDGE_RAMCART_64:
+	case CARTRIDGE_RAMCART_128:
+	case CARTRIDGE_DOUBLE_RAMCART_256:
+	case CARTRIDGE_RAMCART_1M:
+	case CARTRIDGE_RAMCART_2M:
+	case CARTRIDGE_RAMCART_4M:
+	case CARTRIDGE_RAMCART_8M:
+	case CARTRIDGE_RAMCART_16M:
+	case CARTRIDGE_RAMCART_32M:
+	case CARTRIDGE_SIDICAR_32:
+		return TRUE;
+	default:
+		break;
+	}
+	return FALSE;
+}
+
+static void FreeImage(CARTRIDGE_image_t *cart)
+{
+	if (cart->shared)
+		IMAGESTORE_Release(cart->image);
+	else
+		free(cart->image);
+	cart->image = NULL;
+	cart->shared = FALSE;
+}
+
+/* Gives CART a copy of its image of its own, if it is shared with other
+   machines through the image store. */
+static void UnshareImage(CARTRIDGE_image_t *cart)
+{
+	if (cart->shared) {
+		UBYTE *image = (UBYTE *) Util_malloc(cart->size << 10);
+		memcpy(image, cart->image, cart->size << 10);
+		FreeImage(cart);
+		cart->image = image;
+	}
+}
+
 static int CartIsPassthrough(int type)
 {
 	return type == CARTRIDGE_SDX_64 || type == CARTRIDGE_SDX_128 ||
 	       type == CARTRIDGE_ATRAX_SDX_64 || type == CARTRIDGE_ATRAX_SDX_128;
 }
 
-CARTRIDGE_image_t CARTRIDGE_main = { CARTRIDGE_NONE, 0, 0, NULL, "", TRUE }; /* Left/Right cartridge */
-CARTRIDGE_image_t CARTRIDGE_piggyback = { CARTRIDGE_NONE, 0, 0, NULL, "", TRUE }; /* Pass through cartridge for SpartaDOSX */
+CARTRIDGE_image_t CARTRIDGE_main = { CARTRIDGE_NONE, 0, 0, NULL, "", TRUE, FALSE }; /* Left/Right cartridge */
+CARTRIDGE_image_t CARTRIDGE_piggyback = { CARTRIDGE_NONE, 0, 0, NULL, "", TRUE, FALSE }; /* Pass through cartridge for SpartaDOSX */
 
 /* The currently active cartridge in the left slot - normally points to
    CARTRIDGE_main but can be switched to CARTRIDGE_piggyback if the main
@@ -137,7 +182,7 @@ static void set_bank_XEGS_8F_64(void)
 		MEMORY_CopyFromCart(0x8000, 0x9fff, active_cart->image + (active_cart->state & ~0x08) * 0x2000);
 	else
 		/* $8000-$9FFF is left unconnected. */
-		MEMORY_dFillMem(0x8000, 0xff, 0x2000);
+		MEMORY_FillCart(0x8000, 0x9fff, 0xff);
 }
 
 /* OSS_034M_16, OSS_043M_16, OSS_M091_16, OSS_8 */
@@ -149,7 +194,7 @@ static void set_bank_A0AF(int main, int old_state)
 		MEMORY_CartA0bfEnable();
 		if (active_cart->state == 0xff)
 			/* Fill cart area with 0xFF. */
-			MEMORY_dFillMem(0xa000, 0xff, 0x1000);
+			MEMORY_FillCart(0xa000, 0xafff, 0xff);
 		else
 			MEMORY_CopyFromCart(0xa000, 0xafff, active_cart->image + active_cart->state * 0x1000);
 		if (old_state < 0)
@@ -561,7 +606,7 @@ static void MapActiveCart(void)
 			break;
 		default:
 			/* clear cartridge area so the 5200 will crash */
-			MEMORY_dFillMem(0x4000, 0, 0x8000);
+			MEMORY_FillCart(0x4000, 0xbfff, 0);
 			break;
 		}
 	}
@@ -570,13 +615,13 @@ static void MapActiveCart(void)
 		case CARTRIDGE_STD_2:
 			MEMORY_Cart809fDisable();
 			MEMORY_CartA0bfEnable();
-			MEMORY_dFillMem(0xa000, 0xff, 0x1800);
+			MEMORY_FillCart(0xa000, 0xb7ff, 0xff);
 			MEMORY_CopyFromCart(0xb800, 0xbfff, active_cart->image);
 			break;
 		case CARTRIDGE_STD_4:
 			MEMORY_Cart809fDisable();
 			MEMORY_CartA0bfEnable();
-			MEMORY_dFillMem(0xa000, 0xff, 0x1000);
+			MEMORY_FillCart(0xa000, 0xafff, 0xff);
 			MEMORY_CopyFromCart(0xb000, 0xbfff, active_cart->image);
 			break;
 		case CARTRIDGE_BLIZZARD_4:
@@ -715,7 +760,7 @@ static void MapActiveCart(void)
 		case CARTRIDGE_RIGHT_4:
 			if (Atari800_machine_type == Atari800_MACHINE_800) {
 				MEMORY_Cart809fEnable();
-				MEMORY_dFillMem(0x8000, 0xff, 0x1000);
+				MEMORY_FillCart(0x8000, 0x8fff, 0xff);
 				MEMORY_CopyFromCart(0x9000, 0x9fff, active_cart->image);
 				if ((!Atari800_disable_basic || BINLOAD_loading_basic) && MEMORY_have_basic) {
 					MEMORY_CartA0bfEnable();
@@ -1577,7 +1622,7 @@ static void PreprocessCart(CARTRIDGE_image_t *cart)
 				(byte & 0x40 ? map->data[6] : 0) |
 				(byte & 0x80 ? map->data[7] : 0);
 		}
-		free(cart->image);
+		FreeImage(cart);
 		cart->image = new_image;
 	}
 }
@@ -1586,6 +1631,8 @@ static void PreprocessCart(CARTRIDGE_image_t *cart)
    or CARTRIDGE_Insert_Second and CARTRIDGE_SetType. */
 static void InitCartridge(CARTRIDGE_image_t *cart)
 {
+	if (CartIsWritable(cart->type))
+		UnshareImage(cart);
 	PreprocessCart(cart);
 	ResetCartState(cart);
 	if (cart == &CARTRIDGE_main) {
@@ -1655,22 +1702,9 @@ int CARTRIDGE_WriteImage(char *filename, int type, UBYTE *image, int size, int r
 static void RemoveCart(CARTRIDGE_image_t *cart)
 {
 	if (cart->image != NULL) {
-		switch (cart->type) {
-		case CARTRIDGE_RAMCART_64:
-		case CARTRIDGE_RAMCART_128:
-		case CARTRIDGE_DOUBLE_RAMCART_256:
-		case CARTRIDGE_RAMCART_1M:
-		case CARTRIDGE_RAMCART_2M:
-		case CARTRIDGE_RAMCART_4M:
-		case CARTRIDGE_RAMCART_8M:
-		case CARTRIDGE_RAMCART_16M:
-		case CARTRIDGE_RAMCART_32M:
-		case CARTRIDGE_SIDICAR_32:
+		if (CartIsWritable(cart->type))
 			CARTRIDGE_WriteImage(cart->filename, cart->type, cart->image, cart->size << 10, cart->raw, -1);
-		}
-
-		free(cart->image);
-		cart->image = NULL;
+		FreeImage(cart);
 	}
 	if (cart->type != CARTRIDGE_NONE) {
 		cart->type = CARTRIDGE_NONE;
@@ -1712,20 +1746,35 @@ void CARTRIDGE_ColdStart(void) {
 	MapActiveCart();
 }
 
-int CARTRIDGE_ReadImage(const char *filename, CARTRIDGE_image_t *cart)
+/* Points CART->IMAGE to LEN bytes at DATA, returned by IMAGESTORE_Load. If
+   SHARED is FALSE, they are copied and DATA is released. */
+static void SetImage(CARTRIDGE_image_t *cart, UBYTE *data, int len, int shared)
+{
+	if (shared)
+		cart->image = data;
+	else {
+		cart->image = (UBYTE *) Util_malloc(len);
+		memcpy(cart->image, data, len);
+		IMAGESTORE_Release(data);
+	}
+	cart->shared = shared;
+}
+
+/* See CARTRIDGE_ReadImage. If SHARED is TRUE, CART->IMAGE is shared with
+   the other machines through the image store. */
+static int ReadImage(const char *filename, CARTRIDGE_image_t *cart, int shared)
 {
-	FILE *fp;
+	UBYTE *data;
+	ULONG file_len;
 	int len;
 	int type;
-	UBYTE header[16];
+	UBYTE *header;
 
-	/* open file */
-	fp = fopen(filename, "rb");
-	if (fp == NULL)
+	/* read file */
+	data = IMAGESTORE_Load(filename, &file_len);
+	if (data == NULL)
 		return CARTRIDGE_CANT_OPEN;
-	/* check file length */
-	len = Util_flen(fp);
-	Util_rewind(fp);
+	len = (int) file_len;
 
 	/* Guard against providing cart->filename as parameter. */
 	if (cart->filename != filename)
@@ -1736,16 +1785,7 @@ int CARTRIDGE_ReadImage(const char *filename, CARTRIDGE_image_t *cart)
 
 	/* if full kilobytes, assume it is raw image */
 	if ((len & 0x3ff) == 0) {
-		/* alloc memory and read data */
-		cart->image = (UBYTE *) Util_malloc(len);
-		if (fread(cart->image, 1, len, fp) < len) {
-			Log_print("Error reading cartridge.\n");
-			fclose(fp);
-			free(cart->image);
-			cart->image = NULL;
-			return CARTRIDGE_TOO_FEW_DATA;
-		}
-		fclose(fp);
+		SetImage(cart, data, len, shared);
 		/* find cart type */
 		cart->type = CARTRIDGE_NONE;
 		len >>= 10;	/* number of kilobytes */
@@ -1764,17 +1804,17 @@ int CARTRIDGE_ReadImage(const char *filename, CARTRIDGE_image_t *cart)
 			/*InitCartridge(cart);*/
 			return 0;	/* ok */
 		}
-		free(cart->image);
-		cart->image = NULL;
+		FreeImage(cart);
 		return CARTRIDGE_BAD_FORMAT;
 	}
 
 	/* if not full kilobytes, assume it is CART file */
-	if (fread(header, 1, 16, fp) < 16) {
+	if (len < 16) {
 		Log_print("Error reading cartridge.\n");
-		fclose(fp);
+		IMAGESTORE_Release(data);
 		return CARTRIDGE_BAD_FORMAT;
 	}
+	header = data;
 	if ((header[0] == 'C') &&
 		(header[1] == 'A') &&
 		(header[2] == 'R') &&
@@ -1786,33 +1826,34 @@ int CARTRIDGE_ReadImage(const char *filename, CARTRIDGE_image_t *cart)
 		if (type >= 1 && type < CARTRIDGE_TYPE_COUNT) {
 			int checksum;
 			int result;
-			len = CARTRIDGES[type].kb << 10;
-			cart->raw = FALSE;
-			cart->size = CARTRIDGES[type].kb;
-			/* alloc memory and read data */
-			cart->image = (UBYTE *) Util_malloc(len);
-			if (fread(cart->image, 1, len, fp) < len) {
+			if (len - 16 < CARTRIDGES[type].kb << 10) {
 				Log_print("Error reading cartridge.\n");
-				fclose(fp);
-				free(cart->image);
-				cart->image = NULL;
+				IMAGESTORE_Release(data);
 				return CARTRIDGE_TOO_FEW_DATA;
 			}
-			fclose(fp);
+			len = CARTRIDGES[type].kb << 10;
+			cart->raw = FALSE;
+			cart->size = CARTRIDGES[type].kb;
 			checksum = (header[8] << 24) |
 				(header[9] << 16) |
 				(header[10] << 8) |
 				header[11];
+			SetImage(cart, data + 16, len, shared);
 			cart->type = type;
 			result = checksum == CARTRIDGE_Checksum(cart->image, len) ? 0 : CARTRIDGE_BAD_CHECKSUM;
 			/*InitCartridge(cart);*/
 			return result;
 		}
 	}
-	fclose(fp);
+	IMAGESTORE_Release(data);
 	return CARTRIDGE_BAD_FORMAT;
 }
 
+int CARTRIDGE_ReadImage(const char *filename, CARTRIDGE_image_t *cart)
+{
+	return ReadImage(filename, cart, FALSE);
+}
+
 /* Loads a cartridge from FILENAME. Copies FILENAME to CART->FILENAME.
    If loading failed, sets CART->TYPE to CARTRIDGE_NONE and returns one of:
    * CARTRIDGE_CANT_OPEN if there was an error when opening file,
@@ -1829,7 +1870,7 @@ int CARTRIDGE_ReadImage(const char *filename, CARTRIDGE_image_t *cart)
      CARTRIDGE_SetType() or CARTRIDGE_SetTypeAutoReboot(). */
 static int InsertCartridge(const char *filename, CARTRIDGE_image_t *cart)
 {
-	int kb = CARTRIDGE_ReadImage(filename, cart);
+	int kb = ReadImage(filename, cart, TRUE);
 	if ((kb == CARTRIDGE_BAD_CHECKSUM) || (kb == 0)) {
 		InitCartridge(cart);
 	}
@@ -51,6 +51,7 @@
 #include "util.h"
 #if !defined(BASIC) && !defined(CURSES_BASIC)
 #include "colours.h"
+#include "rewind.h"
 #include "screen.h"
 #endif
 #ifdef NTSC_FILTER
@@ -326,6 +327,8 @@ int CFG_LoadConfig(const char *alternate_config_filename)
 			}
 			else if (Screen_ReadConfig(string, ptr)) {
 			}
+			else if (REWIND_ReadConfig(string, ptr)) {
+			}
 #endif
 #ifdef NTSC_FILTER
 			else if (FILTER_NTSC_ReadConfig(string, ptr)) {
@@ -473,6 +476,7 @@ int CFG_WriteConfig(void)
 	Colours_WriteConfig(fp);
 	ARTIFACT_WriteConfig(fp);
 	Screen_WriteConfig(fp);
+	REWIND_WriteConfig(fp);
 #endif
 #ifdef NTSC_FILTER
 	FILTER_NTSC_WriteConfig(fp);
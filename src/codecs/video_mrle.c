@@ -32,6 +32,8 @@
 
 static int reference_screen_size = 0;
 static UBYTE *reference_screen = NULL;
+/* Screen_TrackLines() stamp of reference_screen, or 0 if unknown. */
+static ULONG reference_stamp = 0;
 
 static int video_left_margin;
 static int video_top_margin;
@@ -281,9 +283,12 @@ static int compress_line_delta(UBYTE *buf, const UBYTE *ptr, UBYTE *ref, int *dy
    fills the output buffer with the MRLE encoded differences. It also updates
    the reference screen to hold the current screen.
 
+   Lines that have not changed since the stamp SINCE are known to match the
+   reference screen and are skipped; SINCE is 0 if that is not known.
+
    RETURNS: number of encoded bytes, which may be zero if identical to previous
    frame */
-static int create_interframe(UBYTE *buf, int bufsize, const UBYTE *source) {
+static int create_interframe(UBYTE *buf, int bufsize, const UBYTE *source, ULONG since) {
 	UBYTE *buf_start;
 	const UBYTE *ptr;
 	UBYTE *ref;
@@ -298,6 +303,11 @@ static int create_interframe(UBYTE *buf, int bufsize, const UBYTE *source) {
 	dy = 0;
 
 	for (y = (video_top_margin + video_height)-1; y >= video_top_margin; y--) {
+		if (since != 0 && !Screen_LineChanged(y, since)) {
+			/* same as a line without differences */
+			dy++;
+			continue;
+		}
 		ptr = source + (y * Screen_WIDTH) + video_left_margin;
 		ref = reference_screen + (y * Screen_WIDTH) + video_left_margin;
 
@@ -330,22 +340,39 @@ static int MRLE_Init(int width, int height, int left_margin, int top_margin)
 
 	reference_screen_size = Screen_WIDTH * Screen_HEIGHT;
 	reference_screen = (UBYTE *)Util_malloc(reference_screen_size);
+	reference_stamp = 0;
 
 	return size;
 }
 
 static int MRLE_CreateFrame(UBYTE *source, int keyframe, UBYTE *buf, int bufsize) {
 	int size;
+	int y;
+	ULONG stamp = 0;
+
+	/* Changed lines are only tracked for the emulated screen. */
+	if (source == (UBYTE *)Screen_atari)
+		stamp = Screen_TrackLines();
+	else
+		reference_stamp = 0;
 
 	if (keyframe) {
 		size = create_keyframe(buf, bufsize, source);
 	}
 	else {
-		size = create_interframe(buf, bufsize, source);
+		size = create_interframe(buf, bufsize, source, reference_stamp);
 	}
 
 	/* save new reference screen */
-	memcpy(reference_screen, source, Screen_HEIGHT * Screen_WIDTH);
+	if (reference_stamp == 0)
+		memcpy(reference_screen, source, Screen_HEIGHT * Screen_WIDTH);
+	else {
+		for (y = 0; y < Screen_HEIGHT; y++) {
+			if (Screen_LineChanged(y, reference_stamp))
+				memcpy(reference_screen + y * Screen_WIDTH, source + y * Screen_WIDTH, Screen_WIDTH);
+		}
+	}
+	reference_stamp = stamp;
 
 	return size;
 }
@@ -80,6 +80,8 @@ static int lrange, urange;
 static UBYTE pal[768];
 static UBYTE *prev_buf, *prev_buf_start;
 static int pstride;
+/* Screen_TrackLines() stamp of the previous frame, or 0 if unknown. */
+static ULONG prev_stamp;
 #ifdef HAVE_LIBZ
 static UBYTE *work_buf;
 static int zlib_init_ok;
@@ -162,6 +164,19 @@ static int motion_estimation(UBYTE *src, int sstride, UBYTE *prev, int pstride,
 	return bv;
 }
 
+/* Returns TRUE if any of the COUNT lines of the picture starting at line Y
+   changed since the previous frame. */
+static int RowChanged(int y, int count)
+{
+	y += video_top_margin;
+	while (count-- > 0) {
+		if (Screen_LineChanged(y, prev_stamp))
+			return TRUE;
+		y++;
+	}
+	return FALSE;
+}
+
 static int ZMBV_CreateFrame(UBYTE *source, int keyframe, UBYTE *buf, int bufsize)
 {
 	UBYTE *src;
@@ -172,6 +187,13 @@ static int ZMBV_CreateFrame(UBYTE *source, int keyframe, UBYTE *buf, int bufsize
 	int bw, bh;
 	int i, j;
 	int size;
+	ULONG stamp = 0;
+
+	/* Changed lines are only tracked for the emulated screen. */
+	if (source == (UBYTE *)Screen_atari)
+		stamp = Screen_TrackLines();
+	else
+		prev_stamp = 0;
 
 	fl = (keyframe ? 1 : 0);
 	*buf++ = fl;
@@ -224,6 +246,14 @@ static int ZMBV_CreateFrame(UBYTE *source, int keyframe, UBYTE *buf, int bufsize
 		/* for now just XOR'ing */
 		for(y = 0; y < video_height; y += ZMBV_BLOCK) {
 			bh2 = FFMIN(video_height - y, ZMBV_BLOCK);
+			if (prev_stamp != 0 && !RowChanged(y, bh2)) {
+				/* All blocks equal the previous frame: no motion, no data. */
+				mv += bw * 2;
+				mx = my = 0;
+				src += Screen_WIDTH * ZMBV_BLOCK;
+				prev += pstride * ZMBV_BLOCK;
+				continue;
+			}
 			for(x = 0; x < video_width; x += ZMBV_BLOCK, mv += 2) {
 				bw2 = FFMIN(video_width - x, ZMBV_BLOCK);
 
@@ -251,10 +281,12 @@ static int ZMBV_CreateFrame(UBYTE *source, int keyframe, UBYTE *buf, int bufsize
 	src = source + (Screen_WIDTH * video_top_margin) + video_left_margin;
 	prev = prev_buf_start;
 	for(i = 0; i < video_height; i++){
-		memcpy(prev, src, video_width);
+		if (prev_stamp == 0 || Screen_LineChanged(video_top_margin + i, prev_stamp))
+			memcpy(prev, src, video_width);
 		prev += pstride;
 		src += Screen_WIDTH;
 	}
+	prev_stamp = stamp;
 
 #ifdef HAVE_LIBZ
 	if (zlib_init_ok) {
@@ -349,6 +381,7 @@ static int ZMBV_Init(int width, int height, int left_margin, int top_margin)
 	prev_buf = (UBYTE *)Util_malloc(prev_size);
 	memset(prev_buf, 0, prev_size);
 	prev_buf_start = prev_buf + prev_offset;
+	prev_stamp = 0;
 
 #ifdef HAVE_LIBZ
 	if (FILE_EXPORT_compression_level > 0) {
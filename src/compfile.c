@@ -38,9 +38,9 @@
 
 /* GZ decompression ------------------------------------------------------ */
 
-/* Opens a GZIP compressed file and decompresses its contents to outfp.
-   Returns TRUE on success. */
-int CompFile_ExtractGZ(const char *infilename, FILE *outfp)
+/* Decompresses a GZIP compressed file to outfp, or to a buffer reallocated
+   in *outbuf if outfp is NULL. */
+static int extract_gz(const char *infilename, FILE *outfp, UBYTE **outbuf, ULONG *outlen)
 {
 #ifndef HAVE_LIBZ
 	Log_print("This executable cannot decompress ZLIB files");
@@ -48,19 +48,33 @@ int CompFile_ExtractGZ(const char *infilename, FILE *outfp)
 #else
 	/* TODO: replace gz* with low-level light-weight ZLIB functions. */
 	gzFile gzf = gzopen(infilename, "rb");
-	void *buf;
+	UBYTE *buf = NULL;
+	ULONG bufsize = 0;
 	int result;
 	if (gzf == NULL) {
 		Log_print("ZLIB could not open file %s", infilename);
 		return FALSE;
 	}
 #define UNCOMPRESS_BUFFER_SIZE 32768
-	buf = Util_malloc(UNCOMPRESS_BUFFER_SIZE);
+	if (outfp != NULL)
+		buf = (UBYTE *) Util_malloc(UNCOMPRESS_BUFFER_SIZE);
 	do {
-		result = gzread(gzf, buf, UNCOMPRESS_BUFFER_SIZE);
-		if (result > 0) {
-			if ((int) fwrite(buf, 1, result, outfp) != result)
-				result = -1;
+		if (outfp == NULL) {
+			/* read straight into the output buffer */
+			if (*outlen + UNCOMPRESS_BUFFER_SIZE > bufsize) {
+				bufsize = bufsize == 0 ? 8 * UNCOMPRESS_BUFFER_SIZE : bufsize * 2;
+				*outbuf = (UBYTE *) Util_realloc(*outbuf, bufsize);
+			}
+			result = gzread(gzf, *outbuf + *outlen, UNCOMPRESS_BUFFER_SIZE);
+			if (result > 0)
+				*outlen += result;
+		}
+		else {
+			result = gzread(gzf, buf, UNCOMPRESS_BUFFER_SIZE);
+			if (result > 0) {
+				if ((int) fwrite(buf, 1, result, outfp) != result)
+					result = -1;
+			}
 		}
 	} while (result == UNCOMPRESS_BUFFER_SIZE);
 	free(buf);
@@ -69,6 +83,25 @@ int CompFile_ExtractGZ(const char *infilename, FILE *outfp)
 #endif	/* HAVE_LIBZ */
 }
 
+/* Opens a GZIP compressed file and decompresses its contents to outfp.
+   Returns TRUE on success. */
+int CompFile_ExtractGZ(const char *infilename, FILE *outfp)
+{
+	return extract_gz(infilename, outfp, NULL, NULL);
+}
+
+int CompFile_ExtractGZToMem(const char *infilename, UBYTE **buf, ULONG *len)
+{
+	*buf = NULL;
+	*len = 0;
+	if (!extract_gz(infilename, NULL, buf, len)) {
+		free(*buf);
+		*buf = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
 
 /* DCM decompression ----------------------------------------------------- */
 
@@ -90,19 +123,36 @@ static int fload(void *buf, int size, FILE *fp)
 	return (int) fread(buf, 1, size, fp) == size;
 }
 
-static int fsave(void *buf, int size, FILE *fp)
-{
-	return (int) fwrite(buf, 1, size, fp) == size;
-}
-
 typedef struct {
 	FILE *fp;
+	/* used instead of fp if it is NULL */
+	UBYTE *buf;
+	ULONG len;
+	ULONG bufsize;
+	ULONG pos;
 	int sectorcount;
 	int sectorsize;
 	int current_sector;
 } ATR_Info;
 
-static int write_atr_header(const ATR_Info *pai)
+static int fsave(ATR_Info *pai, const void *buf, int size)
+{
+	if (pai->fp != NULL)
+		return (int) fwrite(buf, 1, size, pai->fp) == size;
+	if (pai->pos + size > pai->bufsize) {
+		pai->bufsize = pai->bufsize == 0 ? 0x10000 : pai->bufsize * 2;
+		if (pai->pos + size > pai->bufsize)
+			pai->bufsize = pai->pos + size;
+		pai->buf = (UBYTE *) Util_realloc(pai->buf, pai->bufsize);
+	}
+	memcpy(pai->buf + pai->pos, buf, size);
+	pai->pos += size;
+	if (pai->len < pai->pos)
+		pai->len = pai->pos;
+	return TRUE;
+}
+
+static int write_atr_header(ATR_Info *pai)
 {
 	int sectorcount;
 	int sectorsize;
@@ -122,12 +172,12 @@ static int write_atr_header(const ATR_Info *pai)
 	header.seccounthi = (UBYTE) (paras >> 8);
 	header.hiseccountlo = (UBYTE) (paras >> 16);
 	header.hiseccounthi = (UBYTE) (paras >> 24);
-	return fsave(&header, sizeof(header), pai->fp);
+	return fsave(pai, &header, sizeof(header));
 }
 
 static int write_atr_sector(ATR_Info *pai, UBYTE *buf)
 {
-	return fsave(buf, pai->current_sector++ <= 3 ? 128 : pai->sectorsize, pai->fp);
+	return fsave(pai, buf, pai->current_sector++ <= 3 ? 128 : pai->sectorsize);
 }
 
 static int pad_till_sector(ATR_Info *pai, int till_sector)
@@ -233,11 +283,11 @@ static int dcm_pass(FILE *infp, ATR_Info *pai)
 	}
 }
 
-int CompFile_DCMtoATR(FILE *infp, FILE *outfp)
+/* Converts a DCM image to ATR, written to the output set in pai. */
+static int dcm_to_atr(FILE *infp, ATR_Info *pai)
 {
 	int archive_type;
 	int archive_flags;
-	ATR_Info ai;
 	int pass_flags;
 	int last_sector;
 	archive_type = fgetc(infp);
@@ -252,32 +302,31 @@ int CompFile_DCMtoATR(FILE *infp, FILE *outfp)
 			Log_print("It seems that DCMs of a multi-file archive have been combined in wrong order");
 		return FALSE;
 	}
-	ai.fp = outfp;
-	ai.current_sector = 1;
+	pai->current_sector = 1;
 	switch ((archive_flags >> 5) & 3) {
 	case 0:
-		ai.sectorcount = 720;
-		ai.sectorsize = 128;
+		pai->sectorcount = 720;
+		pai->sectorsize = 128;
 		break;
 	case 1:
-		ai.sectorcount = 720;
-		ai.sectorsize = 256;
+		pai->sectorcount = 720;
+		pai->sectorsize = 256;
 		break;
 	case 2:
-		ai.sectorcount = 1040;
-		ai.sectorsize = 128;
+		pai->sectorcount = 1040;
+		pai->sectorsize = 128;
 		break;
 	default:
 		Log_print("Unrecognized density");
 		return FALSE;
 	}
-	if (!write_atr_header(&ai))
+	if (!write_atr_header(pai))
 		return FALSE;
 	pass_flags = archive_flags;
 	for (;;) {
 		/* pass */
 		int block_type;
-		if (!dcm_pass(infp, &ai))
+		if (!dcm_pass(infp, pai))
 			return FALSE;
 		if (pass_flags & 0x80)
 			break;
@@ -301,11 +350,35 @@ int CompFile_DCMtoATR(FILE *infp, FILE *outfp)
 		}
 		/* TODO: check pass number, this is tricky for >31 */
 	}
-	last_sector = ai.current_sector - 1;
-	if (last_sector <= ai.sectorcount)
-		return pad_till_sector(&ai, ai.sectorcount + 1);
+	last_sector = pai->current_sector - 1;
+	if (last_sector <= pai->sectorcount)
+		return pad_till_sector(pai, pai->sectorcount + 1);
 	/* more sectors written: update ATR header */
-	ai.sectorcount = last_sector;
-	Util_rewind(outfp);
-	return write_atr_header(&ai);
+	pai->sectorcount = last_sector;
+	if (pai->fp != NULL)
+		Util_rewind(pai->fp);
+	else
+		pai->pos = 0;
+	return write_atr_header(pai);
+}
+
+int CompFile_DCMtoATR(FILE *infp, FILE *outfp)
+{
+	ATR_Info ai;
+	memset(&ai, 0, sizeof(ai));
+	ai.fp = outfp;
+	return dcm_to_atr(infp, &ai);
+}
+
+int CompFile_DCMtoATRMem(FILE *infp, UBYTE **buf, ULONG *len)
+{
+	ATR_Info ai;
+	memset(&ai, 0, sizeof(ai));
+	if (!dcm_to_atr(infp, &ai)) {
+		free(ai.buf);
+		return FALSE;
+	}
+	*buf = ai.buf;
+	*len = ai.len;
+	return TRUE;
 }
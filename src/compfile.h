@@ -2,8 +2,14 @@
 #define COMPFILE_H_
 
 #include <stdio.h>  /* FILE */
+#include "atari.h"  /* UBYTE, ULONG */
 
 int CompFile_ExtractGZ(const char *infilename, FILE *outfp);
 int CompFile_DCMtoATR(FILE *infp, FILE *outfp);
 
+/* Like the above, but decompress to a buffer allocated with malloc(),
+   returned in *buf with its length in *len. */
+int CompFile_ExtractGZToMem(const char *infilename, UBYTE **buf, ULONG *len);
+int CompFile_DCMtoATRMem(FILE *infp, UBYTE **buf, ULONG *len);
+
 #endif /* COMPFILE_H_ */
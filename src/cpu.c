@@ -62,12 +62,19 @@
 #include "cpu.h"
 #ifdef ASAP /* external project, see http://asap.sf.net */
 #include "asap_internal.h"
+#define HWTRACE_EVENT(type, data)
+#define PERFSTAT_ENTER(counter)
+#define PERFSTAT_LEAVE()
 #else
 #include "antic.h"
 #include "atari.h"
 #include "esc.h"
+#include "hwtrace.h"
 #include "memory.h"
 #include "monitor.h"
+#include "perfstat.h"
+#include "pokey.h"
+#include "profiler.h"
 #ifndef BASIC
 #include "statesav.h"
 #ifndef __PLUS
@@ -134,6 +141,9 @@ UBYTE CPU_delayed_nmi;
 
 /* 6502 code fetching */
 #ifdef PC_PTR
+#ifdef PAGED_MEM
+#error PC_PTR cannot work with PAGED_MEM
+#endif
 #define GET_PC()            (PC - MEMORY_mem)
 #define SET_PC(newpc)       (PC = MEMORY_mem + (newpc))
 #define PHPC                { UWORD tmp = PC - MEMORY_mem; PHW(tmp); }
@@ -355,6 +365,7 @@ void CPU_PutStatus(void)
 #define UPDATE_GLOBAL_REGS
 #define UPDATE_LOCAL_REGS
 
+#define GET_PC()		CPU_regPC
 #define SET_PC(newpc)	(CPU_regPC = (newpc))
 #define PHPC			PHW(CPU_regPC)
 
@@ -373,6 +384,7 @@ void CPU_NMI(void)
 	if(CPU_delayed_nmi > 0)
 		CPU_GO(ANTIC_xpos_limit + CPU_delayed_nmi);
 
+	HWTRACE_EVENT(HWTRACE_NMI, CPU_regPC | (ULONG) ANTIC_NMIST << 16);
 	S = CPU_regS;
 	PHW(CPU_regPC);
 	PHPB0;
@@ -380,6 +392,9 @@ void CPU_NMI(void)
 	CPU_regPC = MEMORY_dGetWordAligned(0xfffa);
 	CPU_regS = S;
 	ANTIC_xpos += 7; /* handling an interrupt by 6502 takes 7 cycles */
+#ifdef PROFILER
+	PROFILER_cpu_cycles += 7;
+#endif
 	INC_RET_NESTING;
 }
 
@@ -396,6 +411,7 @@ void CPU_NMI(void)
 #define CPUCHECKIRQ \
 	if (CPU_IRQ && !(CPU_regP & CPU_I_FLAG) && ANTIC_xpos < ANTIC_xpos_limit) { \
 		CPUCHECKIRQ_SAVE_S; \
+		HWTRACE_EVENT(HWTRACE_IRQ, GET_PC() | (ULONG) (UBYTE) ~POKEY_IRQST << 16); \
 		PHPC; \
 		PHPB0; \
 		CPU_SetI; \
@@ -566,6 +582,10 @@ void CPU_GO(int limit)
 void CPU_GO(int limit)
 {
 #endif /* FALCON_CPUASM */
+#ifdef PROFILER
+	int start_xpos;
+	unsigned int start_wsync;
+#endif
 
 /*
    This used to be in the main loop but has been removed to improve
@@ -578,6 +598,9 @@ void CPU_GO(int limit)
    2. The timing of the IRQs are not that critical. */
 
 	if (ANTIC_wsync_halt) {
+#ifdef PROFILER
+		start_xpos = ANTIC_xpos;
+#endif
 
 #ifdef NEW_CYCLE_EXACT
 		if (ANTIC_DRAWING_SCREEN) {
@@ -608,8 +631,21 @@ void CPU_GO(int limit)
 #endif /* NEW_CYCLE_EXACT */
 
 		ANTIC_wsync_halt = 0;
+#ifdef PROFILER
+		PROFILER_WsyncSkip(start_xpos);
+#endif
 	}
+	PERFSTAT_ENTER(PERFSTAT_CPU);
 	ANTIC_xpos_limit = limit;			/* needed for WSYNC store inside ANTIC */
+#ifdef PROFILER
+	start_xpos = ANTIC_xpos;
+	start_wsync = PROFILER_wsync_cycles;
+#ifndef FALCON_CPUASM
+	/* Samples due since the CPU last ran fell in stolen or halted cycles. */
+	if (PROFILER_enabled)
+		PROFILER_Sample(CPU_regPC, CPU_regS, TRUE);
+#endif
+#endif /* PROFILER */
 
 	UPDATE_LOCAL_REGS;
 
@@ -677,6 +713,11 @@ void CPU_GO(int limit)
 		}
 #endif /* MONITOR_BREAK */
 
+#ifdef PROFILER
+		if (ANTIC_xpos >= PROFILER_sample_xpos)
+			PROFILER_Sample(GET_PC(), S, FALSE);
+#endif
+
 #if defined(WRAP_64K) && !defined(PC_PTR)
 		MEMORY_mem[0x10000] = MEMORY_mem[0];
 #endif
@@ -2454,7 +2495,15 @@ void CPU_GO(int limit)
 	}
 
 #endif /* FALCON_CPUASM */
+#ifdef PROFILER
+#ifndef FALCON_CPUASM
+	if (ANTIC_xpos >= PROFILER_sample_xpos)
+		PROFILER_Sample(GET_PC(), S, FALSE);
+#endif
+	PROFILER_cpu_cycles += ANTIC_xpos - start_xpos - (PROFILER_wsync_cycles - start_wsync);
+#endif
 	UPDATE_GLOBAL_REGS;
+	PERFSTAT_LEAVE();
 }
 
 void CPU_Reset(void)
@@ -2486,8 +2535,6 @@ void CPU_StateSave(UBYTE SaveVerbose)
 	StateSav_SaveUBYTE(&CPU_regY, 1);
 	StateSav_SaveUBYTE(&CPU_IRQ, 1);
 
-	MEMORY_StateSave(SaveVerbose);
-
 	STATESAV_TAG(pc);
 	StateSav_SaveUWORD(&CPU_regPC, 1);
 }
@@ -2504,7 +2551,9 @@ void CPU_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 	StateSav_ReadUBYTE(&CPU_regY, 1);
 	StateSav_ReadUBYTE(&CPU_IRQ, 1);
 
-	MEMORY_StateRead(SaveVerbose, StateVersion);
+	/* Since version 9 memory is saved in its own section. */
+	if (StateVersion < 9)
+		MEMORY_StateRead(SaveVerbose, StateVersion);
 
 	StateSav_ReadUWORD(&CPU_regPC, 1);
 }
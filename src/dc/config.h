@@ -332,6 +332,9 @@
 /* Define to use page-based attribute array. */
 #undef PAGED_ATTRIB
 
+/* Define to add the sampling profiler of the emulated 6502. */
+#define PROFILER 1
+
 /* Target: Sony PlayStation 2. */
 #undef PS2
 
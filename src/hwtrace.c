@@ -0,0 +1,323 @@
+/*
+ * hwtrace.c - binary trace of hardware events
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "antic.h"
+#include "atari.h"
+#include "hwtrace.h"
+#include "log.h"
+#include "util.h"
+
+/* On little-endian hosts this is the layout of the records in the file. */
+typedef struct {
+	UBYTE type;
+	UBYTE cycle;
+	UWORD line;
+	ULONG data;
+} record_t;
+
+int HWTRACE_enabled = FALSE;
+
+/* Size of the ring in KB, set with -hwtrace-buffer. */
+static int buffer_kb = 4096;
+static char start_filename[FILENAME_MAX];
+
+static FILE *trace_file = NULL;
+static int write_error;
+
+/* The ring holds ring_mask + 1 records, a power of two. Only the emulation
+   thread advances ring_write and only the writer thread advances ring_read;
+   both run freely and are taken modulo the ring size. */
+static record_t *ring = NULL;
+static unsigned int ring_mask;
+static volatile unsigned int ring_write;
+static volatile unsigned int ring_read;
+/* Value of ring_write at which the ring was last seen full. */
+static unsigned int write_limit;
+
+static pthread_t thread;
+static pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t thread_cond = PTHREAD_COND_INITIALIZER;	/* wakes the writer thread */
+static pthread_cond_t emu_cond = PTHREAD_COND_INITIALIZER;	/* wakes the emulation thread */
+static volatile int thread_quit;
+
+/* Records written per fwrite(). */
+#define CHUNK_RECORDS 4096
+
+static unsigned int LoadAcquire(volatile unsigned int *p)
+{
+#if defined(__ATOMIC_ACQUIRE)
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#elif defined(__GNUC__)
+	unsigned int v = *p;
+	__sync_synchronize();
+	return v;
+#else
+	return *p;
+#endif
+}
+
+static void StoreRelease(volatile unsigned int *p, unsigned int v)
+{
+#if defined(__ATOMIC_RELEASE)
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+#elif defined(__GNUC__)
+	__sync_synchronize();
+	*p = v;
+#else
+	*p = v;
+#endif
+}
+
+static void PutWord(UBYTE *p, unsigned int v)
+{
+	p[0] = (UBYTE) v;
+	p[1] = (UBYTE) (v >> 8);
+}
+
+#ifdef WORDS_BIGENDIAN
+static void PutLong(UBYTE *p, ULONG v)
+{
+	p[0] = (UBYTE) v;
+	p[1] = (UBYTE) (v >> 8);
+	p[2] = (UBYTE) (v >> 16);
+	p[3] = (UBYTE) (v >> 24);
+}
+#endif
+
+/* Writes out COUNT records starting at ring_read, which must not wrap. */
+static void WriteRecords(unsigned int count)
+{
+	record_t const *r = ring + (ring_read & ring_mask);
+#ifdef WORDS_BIGENDIAN
+	static UBYTE buffer[CHUNK_RECORDS * HWTRACE_RECORD_SIZE];
+	UBYTE *p = buffer;
+	unsigned int i;
+	for (i = 0; i < count; i++, r++, p += HWTRACE_RECORD_SIZE) {
+		p[0] = r->type;
+		p[1] = r->cycle;
+		PutWord(p + 2, r->line);
+		PutLong(p + 4, r->data);
+	}
+	r = (record_t const *) buffer;
+#endif
+	/* After an error the records are still consumed, so that the
+	   emulation never waits for a broken file. */
+	if (!write_error && fwrite(r, HWTRACE_RECORD_SIZE, count, trace_file) != count)
+		write_error = TRUE;
+}
+
+static void *WriterThread(void *arg)
+{
+	for (;;) {
+		unsigned int write = LoadAcquire(&ring_write);
+		if (ring_read == write) {
+			pthread_mutex_lock(&thread_mutex);
+			/* The emulation thread may be waiting for room in the ring. */
+			pthread_cond_signal(&emu_cond);
+			while (ring_read == ring_write && !thread_quit)
+				pthread_cond_wait(&thread_cond, &thread_mutex);
+			if (ring_read == ring_write) {
+				pthread_mutex_unlock(&thread_mutex);
+				break;
+			}
+			pthread_mutex_unlock(&thread_mutex);
+			continue;
+		}
+		do {
+			unsigned int count = write - ring_read;
+			unsigned int to_end = ring_mask + 1 - (ring_read & ring_mask);
+			if (count > to_end)
+				count = to_end;
+			if (count > CHUNK_RECORDS)
+				count = CHUNK_RECORDS;
+			WriteRecords(count);
+			StoreRelease(&ring_read, ring_read + count);
+		} while (ring_read != write);
+	}
+	return NULL;
+}
+
+/* Waits until the writer thread has made room in the ring. */
+static void WaitForRoom(void)
+{
+	write_limit = LoadAcquire(&ring_read) + ring_mask + 1;
+	if (ring_write != write_limit)
+		return;
+	pthread_mutex_lock(&thread_mutex);
+	pthread_cond_signal(&thread_cond);
+	while (ring_write - ring_read == ring_mask + 1)
+		pthread_cond_wait(&emu_cond, &thread_mutex);
+	pthread_mutex_unlock(&thread_mutex);
+	write_limit = ring_read + ring_mask + 1;
+}
+
+void HWTRACE_Event(int type, ULONG data)
+{
+	record_t *r;
+	if (ring_write == write_limit)
+		WaitForRoom();
+	r = ring + (ring_write & ring_mask);
+	r->type = (UBYTE) type;
+	r->cycle = (UBYTE) ANTIC_xpos;
+	r->line = (UWORD) ANTIC_ypos;
+	r->data = data;
+	StoreRelease(&ring_write, ring_write + 1);
+}
+
+void HWTRACE_Frame(void)
+{
+	if (!HWTRACE_enabled)
+		return;
+	HWTRACE_Event(HWTRACE_FRAME, (ULONG) Atari800_nframes);
+	/* Wake the writer thread only once a quarter of the ring is filled:
+	   waking it every frame costs more than the tracing itself when
+	   both threads share a CPU. */
+	if (ring_write - LoadAcquire(&ring_read) >= (ring_mask + 1) / 4) {
+		pthread_mutex_lock(&thread_mutex);
+		pthread_cond_signal(&thread_cond);
+		pthread_mutex_unlock(&thread_mutex);
+	}
+}
+
+int HWTRACE_Start(const char *filename)
+{
+	UBYTE header[HWTRACE_HEADER_SIZE];
+	unsigned int size;
+
+	HWTRACE_Stop();
+	trace_file = fopen(filename, "wb");
+	if (trace_file == NULL) {
+		Log_print("Cannot create hardware trace file %s", filename);
+		return FALSE;
+	}
+	memset(header, 0, sizeof(header));
+	memcpy(header, "A8HWTRC", 7);
+	header[7] = HWTRACE_VERSION;
+	PutWord(header + 8, Atari800_tv_mode);
+	PutWord(header + 10, Atari800_machine_type);
+	if (fwrite(header, 1, sizeof(header), trace_file) != sizeof(header)) {
+		Log_print("Error writing hardware trace file %s", filename);
+		fclose(trace_file);
+		trace_file = NULL;
+		return FALSE;
+	}
+
+	size = 1024 / sizeof(record_t);
+	while (size * sizeof(record_t) < (size_t) buffer_kb * 1024)
+		size <<= 1;
+	ring = (record_t *) Util_malloc(size * sizeof(record_t));
+	ring_mask = size - 1;
+	ring_write = ring_read = 0;
+	write_limit = size;
+	write_error = FALSE;
+	thread_quit = FALSE;
+	if (pthread_create(&thread, NULL, WriterThread, NULL) != 0) {
+		Log_print("Cannot create the hardware trace thread");
+		free(ring);
+		ring = NULL;
+		fclose(trace_file);
+		trace_file = NULL;
+		return FALSE;
+	}
+	HWTRACE_enabled = TRUE;
+	/* Stamp the records until the next frame starts. */
+	HWTRACE_Event(HWTRACE_FRAME, (ULONG) Atari800_nframes);
+	return TRUE;
+}
+
+void HWTRACE_Stop(void)
+{
+	if (!HWTRACE_enabled)
+		return;
+	HWTRACE_enabled = FALSE;
+	pthread_mutex_lock(&thread_mutex);
+	thread_quit = TRUE;
+	pthread_cond_signal(&thread_cond);
+	pthread_mutex_unlock(&thread_mutex);
+	pthread_join(thread, NULL);
+	if (fclose(trace_file) != 0)
+		write_error = TRUE;
+	trace_file = NULL;
+	if (write_error)
+		Log_print("Error writing hardware trace file");
+	free(ring);
+	ring = NULL;
+}
+
+int HWTRACE_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-hwtrace") == 0) {
+			if (i_a)
+				Util_strlcpy(start_filename, argv[++i], sizeof(start_filename));
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-hwtrace-buffer") == 0) {
+			if (i_a) {
+				buffer_kb = Util_sscandec(argv[++i]);
+				if (buffer_kb <= 0) {
+					Log_print("Invalid hardware trace buffer size");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-hwtrace <file>       Trace hardware events to a file");
+				Log_print("\t-hwtrace-buffer <kb>  Size of the hardware trace buffer");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	if (start_filename[0] != '\0')
+		return HWTRACE_Start(start_filename);
+	return TRUE;
+}
+
+void HWTRACE_Exit(void)
+{
+	HWTRACE_Stop();
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,77 @@
+#ifndef HWTRACE_H_
+#define HWTRACE_H_
+
+#include "atari.h"
+
+/* Binary trace of hardware events: every write handled by MEMORY_HwPutByte
+   (ANTIC, GTIA, POKEY, PIA and the cartridge and expansion registers), every
+   IRQ and NMI taken by the CPU and every SIO command frame.
+
+   The emulation thread appends fixed-size records to a ring buffer, which a
+   separate thread writes to the trace file, so tracing does not wait for
+   the disk. The emulation waits only if the ring is full.
+
+   The file starts with a header of HWTRACE_HEADER_SIZE bytes:
+     0  "A8HWTRC" and a format version byte (HWTRACE_VERSION)
+     8  scanlines per frame (312 for PAL, 262 for NTSC), 16-bit little-endian
+    10  machine type (Atari800_machine_type), 16-bit little-endian
+    12  reserved, zero
+   followed by records of HWTRACE_RECORD_SIZE bytes:
+     0  type, one of HWTRACE_FRAME...HWTRACE_SIO_PATCH
+     1  cycle within the scanline (ANTIC_xpos)
+     2  scanline (ANTIC_ypos), 16-bit little-endian
+     4  data depending on the type, 32-bit little-endian
+   A record's frame is given by the last HWTRACE_FRAME record before it. */
+
+#define HWTRACE_VERSION 1
+#define HWTRACE_HEADER_SIZE 16
+#define HWTRACE_RECORD_SIZE 8
+
+enum {
+	/* Start of a frame. Data: frame number (Atari800_nframes). */
+	HWTRACE_FRAME,
+	/* Hardware register write. Data: address | value << 16. */
+	HWTRACE_WRITE,
+	/* IRQ taken. Data: interrupted PC | pending POKEY IRQs (inverted
+	   IRQST) << 16. */
+	HWTRACE_IRQ,
+	/* NMI taken. Data: interrupted PC | NMIST << 16. */
+	HWTRACE_NMI,
+	/* Command frame sent over the serial port. Data: device | command << 8
+	   | aux1 << 16 | aux2 << 24. */
+	HWTRACE_SIO,
+	/* SIO call handled by the SIO patch. Data as for HWTRACE_SIO. */
+	HWTRACE_SIO_PATCH
+};
+
+#ifdef HWTRACE
+
+extern int HWTRACE_enabled;
+
+int HWTRACE_Initialise(int *argc, char *argv[]);
+void HWTRACE_Exit(void);
+
+/* Starts tracing to FILENAME. Returns FALSE if the file cannot be created. */
+int HWTRACE_Start(const char *filename);
+/* Writes out the remaining records and closes the trace file. */
+void HWTRACE_Stop(void);
+
+/* Appends a record of type TYPE, stamped with the current beam position. */
+void HWTRACE_Event(int type, ULONG data);
+/* Marks the start of a frame. Must be called once per frame, before
+   ANTIC_Frame(). */
+void HWTRACE_Frame(void);
+
+#define HWTRACE_EVENT(type, data) \
+	do { \
+		if (HWTRACE_enabled) \
+			HWTRACE_Event(type, data); \
+	} while (0)
+
+#else /* HWTRACE */
+
+#define HWTRACE_EVENT(type, data) do { } while (0)
+
+#endif /* HWTRACE */
+
+#endif /* HWTRACE_H_ */
@@ -0,0 +1,272 @@
+/*
+ * imagestore.c - read-only images shared by all emulated machines
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#include "atari.h"
+#include "crc32.h"
+#include "imagestore.h"
+#include "util.h"
+
+#if defined(HAVE_STAT) && defined(HAVE_SYS_STAT_H)
+#define FILE_STAMPS
+#endif
+
+/* A file whose contents are stored, identified by its size and modification
+   time when it was read. */
+typedef struct stored_name_t {
+	char *filename;
+#ifdef FILE_STAMPS
+	ULONG size;
+	time_t mtime;
+#endif
+	struct stored_name_t *next;
+} stored_name_t;
+
+typedef struct stored_image_t {
+	UBYTE *data;
+	ULONG len;
+	ULONG crc;
+	int refs;
+	stored_name_t *names;
+	struct stored_image_t *next;
+} stored_image_t;
+
+/* Stored images, the most recently used first. */
+static stored_image_t *images = NULL;
+
+/* Images no longer used by any machine are kept for the next mount until
+   they take more than this many bytes. Then the least recently used ones are
+   freed. */
+#define UNUSED_MAX (32 * 1024 * 1024)
+static ULONG unused_size = 0;
+
+#ifdef FILE_STAMPS
+static int GetStamp(const char *filename, ULONG *size, time_t *mtime)
+{
+	struct stat status;
+	if (stat(filename, &status) != 0)
+		return FALSE;
+	*size = (ULONG) status.st_size;
+	*mtime = status.st_mtime;
+	return TRUE;
+}
+#endif
+
+static void FreeImage(stored_image_t *img)
+{
+	while (img->names != NULL) {
+		stored_name_t *name = img->names;
+		img->names = name->next;
+		free(name->filename);
+		free(name);
+	}
+	free(img->data);
+	free(img);
+}
+
+/* Takes a reference to IMG and moves it to the front of the list. */
+static UBYTE *Use(stored_image_t *img, stored_image_t *prev)
+{
+	if (img->refs++ == 0)
+		unused_size -= img->len;
+	if (prev != NULL) {
+		prev->next = img->next;
+		img->next = images;
+		images = img;
+	}
+	return img->data;
+}
+
+/* Frees the least recently used images that are not used, until the rest
+   fits in UNUSED_MAX. */
+static void Trim(void)
+{
+	while (unused_size > UNUSED_MAX) {
+		stored_image_t *img;
+		stored_image_t *prev = NULL;
+		stored_image_t *lru = NULL;
+		stored_image_t *lru_prev = NULL;
+		for (img = images; img != NULL; prev = img, img = img->next)
+			if (img->refs == 0) {
+				lru = img;
+				lru_prev = prev;
+			}
+		if (lru_prev == NULL)
+			images = lru->next;
+		else
+			lru_prev->next = lru->next;
+		unused_size -= lru->len;
+		FreeImage(lru);
+	}
+}
+
+UBYTE *IMAGESTORE_Find(const char *filename, ULONG *len)
+{
+#ifdef FILE_STAMPS
+	stored_image_t *img;
+	stored_image_t *prev = NULL;
+	ULONG size;
+	time_t mtime;
+
+	if (!GetStamp(filename, &size, &mtime))
+		return NULL;
+	for (img = images; img != NULL; prev = img, img = img->next) {
+		stored_name_t *name;
+		for (name = img->names; name != NULL; name = name->next)
+			if (name->size == size && name->mtime == mtime && strcmp(name->filename, filename) == 0) {
+				*len = img->len;
+				return Use(img, prev);
+			}
+	}
+#endif /* FILE_STAMPS */
+	return NULL;
+}
+
+UBYTE *IMAGESTORE_Add(const char *filename, UBYTE *data, ULONG len)
+{
+	stored_image_t *img;
+	stored_image_t *prev = NULL;
+	ULONG crc = ~CRC32_Update(0xffffffff, data, len);
+	UBYTE *result = NULL;
+
+	for (img = images; img != NULL; prev = img, img = img->next)
+		if (img->crc == crc && img->len == len && memcmp(img->data, data, len) == 0) {
+			free(data);
+			result = Use(img, prev);
+			break;
+		}
+	if (result == NULL) {
+		img = (stored_image_t *) Util_malloc(sizeof(stored_image_t));
+		img->data = data;
+		img->len = len;
+		img->crc = crc;
+		img->refs = 1;
+		img->names = NULL;
+		img->next = images;
+		images = img;
+		result = data;
+	}
+
+#ifdef FILE_STAMPS
+	{
+		stored_name_t *name = (stored_name_t *) Util_malloc(sizeof(stored_name_t));
+		stored_image_t *other;
+
+		/* The file may have had other contents before */
+		for (other = images; other != NULL; other = other->next) {
+			stored_name_t **link = &other->names;
+			while (*link != NULL) {
+				if (strcmp((*link)->filename, filename) == 0) {
+					stored_name_t *old = *link;
+					*link = old->next;
+					free(old->filename);
+					free(old);
+				}
+				else
+					link = &(*link)->next;
+			}
+		}
+		if (GetStamp(filename, &name->size, &name->mtime)) {
+			name->filename = Util_strdup(filename);
+			name->next = images->names;
+			images->names = name;
+		}
+		else
+			free(name);
+	}
+#endif /* FILE_STAMPS */
+	return result;
+}
+
+UBYTE *IMAGESTORE_Load(const char *filename, ULONG *len)
+{
+	FILE *f;
+	UBYTE *data = IMAGESTORE_Find(filename, len);
+
+	if (data != NULL)
+		return data;
+	f = fopen(filename, "rb");
+	if (f == NULL)
+		return NULL;
+	*len = Util_flen(f);
+	Util_rewind(f);
+	/* allocate at least one byte, so empty files can be stored as well */
+	data = (UBYTE *) Util_malloc(*len + 1);
+	if (fread(data, 1, *len, f) != *len) {
+		fclose(f);
+		free(data);
+		return NULL;
+	}
+	fclose(f);
+	return IMAGESTORE_Add(filename, data, *len);
+}
+
+static stored_image_t *Lookup(const UBYTE *data)
+{
+	stored_image_t *img;
+	for (img = images; img != NULL; img = img->next)
+		if (data >= img->data && data <= img->data + img->len)
+			return img;
+	return NULL;
+}
+
+void IMAGESTORE_Release(const UBYTE *data)
+{
+	stored_image_t *img = Lookup(data);
+	if (img == NULL || img->refs == 0)
+		return;
+	if (--img->refs == 0) {
+		unused_size += img->len;
+		Trim();
+	}
+}
+
+ULONG IMAGESTORE_Checksum(const UBYTE *data)
+{
+	stored_image_t *img = Lookup(data);
+	return img == NULL ? 0 : img->crc;
+}
+
+void IMAGESTORE_Exit(void)
+{
+	while (images != NULL) {
+		stored_image_t *img = images;
+		images = img->next;
+		FreeImage(img);
+	}
+	unused_size = 0;
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,38 @@
+#ifndef IMAGESTORE_H_
+#define IMAGESTORE_H_
+
+#include "atari.h"  /* UBYTE, ULONG */
+
+/* Store of read-only disk and cartridge images, shared by all the machines
+   emulated in one process. Images are identified by the CRC32 and length of
+   their contents, so each one is kept in memory only once, however many
+   machines use it and under whatever file names.
+
+   The data returned by the functions below must not be modified, and must
+   be given back with IMAGESTORE_Release() when no longer used. */
+
+/* Returns the image stored for FILENAME and its length in *LEN, or NULL if
+   the file has not been stored or has been modified since then. */
+UBYTE *IMAGESTORE_Find(const char *filename, ULONG *len);
+
+/* Stores LEN bytes of DATA, allocated with malloc(), as the contents of
+   FILENAME. The store takes over DATA, which is freed right away if an image
+   with the same contents is already stored. Returns the stored image. */
+UBYTE *IMAGESTORE_Add(const char *filename, UBYTE *data, ULONG len);
+
+/* Returns the contents of FILENAME, read from the file only if they are not
+   stored yet, and their length in *LEN. Returns NULL if the file cannot be
+   read. */
+UBYTE *IMAGESTORE_Load(const char *filename, ULONG *len);
+
+/* Gives back an image (or a pointer into one) returned by the functions
+   above. */
+void IMAGESTORE_Release(const UBYTE *data);
+
+/* Returns the CRC32 of the stored image that DATA points into. */
+ULONG IMAGESTORE_Checksum(const UBYTE *data);
+
+/* Frees all stored images. */
+void IMAGESTORE_Exit(void);
+
+#endif /* IMAGESTORE_H_ */
@@ -95,6 +95,15 @@ static int mouse_pen_show_pointer = 0;
 static int mouse_last_right = 0;
 static int mouse_last_down = 0;
 
+static int last_key_code = AKEY_NONE;
+static int last_key_break = 0;
+static UBYTE last_stick[4] = {INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE};
+static int last_mouse_buttons = 0;
+static int bit5_5200 = 0;
+
+INPUT_frame_t INPUT_last_frame;
+INPUT_frame_t const *INPUT_replay = NULL;
+
 static const UBYTE mouse_amiga_codes[16] = {
 	0x00, 0x02, 0x0a, 0x08,
 	0x01, 0x03, 0x0b, 0x09,
@@ -422,16 +431,81 @@ static UBYTE mouse_step(void)
 	return r;
 }
 
+void INPUT_GetLatch(INPUT_latch_t *latch)
+{
+	latch->last_key_code = last_key_code;
+	latch->last_key_break = last_key_break;
+	latch->last_mouse_buttons = last_mouse_buttons;
+	latch->bit5_5200 = bit5_5200;
+	memcpy(latch->last_stick, last_stick, sizeof(last_stick));
+	latch->mouse_x = mouse_x;
+	latch->mouse_y = mouse_y;
+	latch->mouse_move_x = mouse_move_x;
+	latch->mouse_move_y = mouse_move_y;
+	latch->mouse_last_right = mouse_last_right;
+	latch->mouse_last_down = mouse_last_down;
+}
+
+void INPUT_SetLatch(INPUT_latch_t const *latch)
+{
+	last_key_code = latch->last_key_code;
+	last_key_break = latch->last_key_break;
+	last_mouse_buttons = latch->last_mouse_buttons;
+	bit5_5200 = latch->bit5_5200;
+	memcpy(last_stick, latch->last_stick, sizeof(last_stick));
+	mouse_x = latch->mouse_x;
+	mouse_y = latch->mouse_y;
+	mouse_move_x = latch->mouse_move_x;
+	mouse_move_y = latch->mouse_move_y;
+	mouse_last_right = latch->mouse_last_right;
+	mouse_last_down = latch->mouse_last_down;
+}
+
+/* Read the host controllers, or INPUT_replay, into INPUT_last_frame. */
+static int ReadPort(int num)
+{
+	int val = INPUT_replay != NULL ? INPUT_replay->port[num] : PLATFORM_PORT(num);
+	INPUT_last_frame.port[num] = val;
+	return val;
+}
+
+static int ReadTrig(int num)
+{
+	int val = INPUT_replay != NULL ? INPUT_replay->trig[num] : PLATFORM_TRIG(num);
+	INPUT_last_frame.trig[num] = val;
+	return val;
+}
+
+static int ReadPot(int num)
+{
+	int val = INPUT_replay != NULL ? INPUT_replay->pot[num] : Atari_POT(num);
+	INPUT_last_frame.pot[num] = val;
+	return val;
+}
+
 void INPUT_Frame(void)
 {
 	int i;
-	static int last_key_code = AKEY_NONE;
-	static int last_key_break = 0;
-	static UBYTE last_stick[4] = {INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE, INPUT_STICK_CENTRE};
-	static int last_mouse_buttons = 0;
 
 	scanline_counter = 10000;	/* do nothing in INPUT_Scanline() */
 
+	if (INPUT_replay != NULL) {
+		INPUT_key_code = INPUT_replay->key_code;
+		INPUT_key_shift = INPUT_replay->key_shift;
+		INPUT_key_consol = INPUT_replay->key_consol;
+		INPUT_mouse_delta_x = INPUT_replay->mouse_delta_x;
+		INPUT_mouse_delta_y = INPUT_replay->mouse_delta_y;
+		INPUT_mouse_buttons = INPUT_replay->mouse_buttons;
+	}
+	INPUT_last_frame.key_code = INPUT_key_code;
+	INPUT_last_frame.key_shift = INPUT_key_shift;
+	INPUT_last_frame.key_consol = INPUT_key_consol;
+	INPUT_last_frame.mouse_delta_x = INPUT_mouse_delta_x;
+	INPUT_last_frame.mouse_delta_y = INPUT_mouse_delta_y;
+	INPUT_last_frame.mouse_buttons = INPUT_mouse_buttons;
+	for (i = 0; i < 8; i++)
+		INPUT_last_frame.pot[i] = 228;
+
 	/* handle keyboard */
 
 	if (Atari800_keyboard_detached) {
@@ -505,7 +579,6 @@ void INPUT_Frame(void)
 		/* Bit 5 is different for each keypress because it is one
 		 * of the missing lines. */
 		if (Atari800_machine_type == Atari800_MACHINE_5200) {
-			static int bit5_5200 = 0;
 			if (bit5_5200) {
 				INPUT_key_code &= ~0x20;
 			}
@@ -541,7 +614,7 @@ void INPUT_Frame(void)
 		sscanf(gzbuf,"%d ",&i);
 	} else {
 #endif
-		i = PLATFORM_PORT(0);
+		i = ReadPort(0);
 #ifdef EVENT_RECORDING
 	}
 	if (recording) {
@@ -557,7 +630,7 @@ void INPUT_Frame(void)
 		sscanf(gzbuf,"%d ",&i);
 	} else {
 #endif
-		i = PLATFORM_PORT(1);
+		i = ReadPort(1);
 #ifdef EVENT_RECORDING
 	}
 	if (recording) {
@@ -602,7 +675,7 @@ void INPUT_Frame(void)
 
 		} else {
 #endif
-			TRIG_input[i] = PLATFORM_TRIG(i);
+			TRIG_input[i] = ReadTrig(i);
 #ifdef EVENT_RECORDING
 		}
 		if(recording){
@@ -622,10 +695,10 @@ void INPUT_Frame(void)
 	if (Atari800_machine_type != Atari800_MACHINE_5200) {
 		if(!INPUT_direct_mouse) {
 			for (i = 0; i < 4; i++)
-				POKEY_POT_input[i] = Atari_POT(i);
+				POKEY_POT_input[i] = ReadPot(i);
 			if (Atari800_machine_type != Atari800_MACHINE_XLXE) {
 				for (i = 4; i < 8; ++i)
-					POKEY_POT_input[i] = Atari_POT(i);
+					POKEY_POT_input[i] = ReadPot(i);
 			}
 		}
 	}
@@ -633,8 +706,8 @@ void INPUT_Frame(void)
 		for (i = 0; i < 4; i++) {
 #ifdef DREAMCAST
 			/* first get analog js data */
-			POKEY_POT_input[2 * i] = Atari_POT(2 * i);         /* x */
-			POKEY_POT_input[2 * i + 1] = Atari_POT(2 * i + 1); /* y */
+			POKEY_POT_input[2 * i] = ReadPot(2 * i);         /* x */
+			POKEY_POT_input[2 * i + 1] = ReadPot(2 * i + 1); /* y */
 			if (POKEY_POT_input[2 * i] != INPUT_joy_5200_center
 			 || POKEY_POT_input[2 * i + 1] != INPUT_joy_5200_center)
 				continue;
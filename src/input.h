@@ -76,6 +76,45 @@ extern int INPUT_direct_mouse;      /* When true, convert the mouse pointer
 													position directly into POKEY POT values */
 
 extern int INPUT_cx85;      /* emulate CX85 numeric keypad */
+
+/* Capture and replay -------------------------------------------------- */
+
+/* Host input read by INPUT_Frame() during one frame. */
+typedef struct INPUT_frame_t {
+	int key_code;
+	int key_shift;
+	int key_consol;
+	int port[2];		/* PLATFORM_PORT() values */
+	int trig[4];		/* PLATFORM_TRIG() values */
+	int pot[8];			/* Atari_POT() values */
+	int mouse_delta_x;
+	int mouse_delta_y;
+	int mouse_buttons;
+} INPUT_frame_t;
+
+/* Host input read by the last INPUT_Frame(). */
+extern INPUT_frame_t INPUT_last_frame;
+/* When not NULL, INPUT_Frame() reads the host input from here instead of
+   from the platform. */
+extern INPUT_frame_t const *INPUT_replay;
+
+/* State that INPUT_Frame() carries over from one frame to the next. It is
+   not part of a state save, so it has to be kept along with a saved state
+   for a replay from that state to be exact. */
+typedef struct INPUT_latch_t {
+	int last_key_code;
+	int last_key_break;
+	int last_mouse_buttons;
+	int bit5_5200;
+	UBYTE last_stick[4];
+	int mouse_x;
+	int mouse_y;
+	int mouse_move_x;
+	int mouse_move_y;
+	int mouse_last_right;
+	int mouse_last_down;
+} INPUT_latch_t;
+
 /* Functions ----------------------------------------------------------- */
 
 int INPUT_Initialise(int *argc, char *argv[]);
@@ -89,6 +128,8 @@ int INPUT_Recording(void);
 int INPUT_Playingback(void);
 void INPUT_RecordInt(int i);
 int INPUT_PlaybackInt(void);
+void INPUT_GetLatch(INPUT_latch_t *latch);
+void INPUT_SetLatch(INPUT_latch_t const *latch);
 
 #ifdef DREAMCAST
 extern int Atari_POT(int);
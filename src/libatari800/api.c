@@ -24,6 +24,7 @@
 */
 
 #include "config.h"
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,14 +42,19 @@
 #include "cpu.h"
 #include "platform.h"
 #include "memory.h"
+#include "movie.h"
+#include "perfstat.h"
+#include "rewind.h"
 #include "screen.h"
 #include "sio.h"
+#include "snapshot.h"
 #include "../sound.h"
 #include "util.h"
 #include "libatari800/main.h"
 #include "libatari800/cpu_crash.h"
 #include "libatari800/init.h"
 #include "libatari800/input.h"
+#include "libatari800/observation.h"
 #include "libatari800/video.h"
 #include "libatari800/sound.h"
 #include "libatari800/statesav.h"
@@ -151,10 +157,14 @@ char *unknown_error = "unknown error";
  * @returns text description of error
  */
 const char *libatari800_error_message() {
-	if ((libatari800_error_code < 0) || (libatari800_error_code > (sizeof(error_messages)))) {
+	return LIBATARI800_ErrorMessage(libatari800_error_code);
+}
+
+const char *LIBATARI800_ErrorMessage(int code) {
+	if ((code < 0) || (code >= (int)(sizeof(error_messages) / sizeof(error_messages[0])))) {
 		return unknown_error;
 	}
-	return error_messages[libatari800_error_code];
+	return error_messages[code];
 }
 
 
@@ -289,6 +299,10 @@ int libatari800_reboot_with_file(const char *filename)
  * Accessing memory through this pointer will not return hardware register
  * information, this provides access to the RAM only.
  *
+ * When built with --enable-pagedmem, extended RAM banks and cartridge banks
+ * are mapped without being copied here, so this block only shows the base
+ * 64k and not the bank currently visible to the CPU.
+ *
  * @returns pointer to the beginning of the 64k block of main memory
  */
 UBYTE *libatari800_get_main_memory_ptr()
@@ -451,14 +465,23 @@ int libatari800_get_frame_number() {
  * gets the current state of the emulator, locates the \a cpu_state_t structure
  * and the \a pc_state_t structure within it, and prints the values of interest.
  *
+ * The state must fit in STATESAV_MAX_SIZE bytes, which is enough for
+ * machines up to the 130XE. Larger machines are saved with \a
+ * libatari800_save_state.
+ *
  * @param state pointer to an already allocated \a emulator_state_t structure
+ *
+ * @retval FALSE if the state does not fit; \a state->tags.size is then 0
+ * @retval TRUE if successful
  */
-void libatari800_get_current_state(emulator_state_t *state)
+int libatari800_get_current_state(emulator_state_t *state)
 {
-	LIBATARI800_StateSave(state->state, &state->tags);
+	if (!LIBATARI800_StateSave(state->state, &state->tags))
+		return FALSE;
 	state->flags.selftest_enabled = MEMORY_selftest_enabled;
 	state->flags.nframes = (ULONG)Atari800_nframes;
 	state->flags.sample_residual = (ULONG)(0xffffffff * sample_residual);
+	return TRUE;
 }
 
 
@@ -472,13 +495,396 @@ void libatari800_get_current_state(emulator_state_t *state)
  * be returned to an invalid state and further emulation will fail.
  *
  * @param state pointer to an already allocated \a emulator_state_t structure
+ *
+ * @retval FALSE if \a state could not be read, e.g. because saving it failed
+ * @retval TRUE if successful
  */
-void libatari800_restore_state(emulator_state_t *state)
+int libatari800_restore_state(emulator_state_t *state)
 {
-	LIBATARI800_StateLoad(state->state);
+	if (!LIBATARI800_StateLoad(state->state))
+		return FALSE;
 	MEMORY_selftest_enabled = state->flags.selftest_enabled;
 	Atari800_nframes = state->flags.nframes;
 	sample_residual = (double)state->flags.sample_residual / (double)0xffffffff;
+	REWIND_Mark();
+	MOVIE_Mark();
+	return TRUE;
+}
+
+
+/** Compute the difference between two emulator states
+ *
+ * Create a delta snapshot holding only the parts of \a state that differ
+ * from \a base. Changes are detected in blocks of 256 bytes that line up
+ * with the pages of main memory, so a frame that modified a few RAM pages and
+ * some chip registers produces a delta of a few kilobytes instead of a full
+ * state. Applying the delta to \a base with \a libatari800_apply_state_delta
+ * reproduces \a state exactly. Both states are compared in full, so the cost
+ * does not depend on how little changed.
+ *
+ * Deltas are a single flat block of memory of \a libatari800_get_delta_size
+ * bytes and may be copied or stored as they are.
+ *
+ * @param base state the delta is relative to, or NULL to store all of \a state
+ * @param state state to encode
+ *
+ * @returns delta, to be released with \a libatari800_free_delta, or NULL if
+ * \a state or \a base holds no state because saving it failed
+ */
+atari800_delta_t *libatari800_get_state_delta(const emulator_state_t *base, const emulator_state_t *state)
+{
+	if (state->tags.size == 0 || (base != NULL && base->tags.size == 0))
+		return NULL;
+	return Snapshot_DeltaCreate((const UBYTE *)base, base == NULL ? 0 : LIBATARI800_STATE_LEN(base),
+	                            (const UBYTE *)state, LIBATARI800_STATE_LEN(state),
+	                            (ULONG)offsetof(emulator_state_t, state) + state->tags.base_ram);
+}
+
+
+/** Apply a delta to an emulator state
+ *
+ * Turn \a state, which must be the base state the delta was computed against,
+ * into the state the delta was computed from. The emulator itself is not
+ * changed; see \a libatari800_restore_state_chain.
+ *
+ * @param state state to update in place
+ * @param delta delta from \a libatari800_get_state_delta
+ *
+ * @retval FALSE if the result does not fit in an \a emulator_state_t or the
+ *         delta is corrupt; \a state is left unchanged
+ * @retval TRUE if successful
+ */
+int libatari800_apply_state_delta(emulator_state_t *state, const atari800_delta_t *delta)
+{
+	ULONG len;
+	return Snapshot_DeltaApply((UBYTE *)state, sizeof(emulator_state_t), &len, delta);
+}
+
+
+/** Restore the emulator from a base state and a chain of deltas
+ *
+ * Rebuild a full state by applying each delta of \a chain in order to a copy
+ * of \a base, and restore the emulator to it. Each delta must have been
+ * computed against the state produced by the previous one. \a base itself is
+ * not modified.
+ *
+ * @param base full state at the start of the chain
+ * @param chain array of deltas
+ * @param n number of deltas in \a chain
+ *
+ * @retval FALSE if the chain could not be applied or the state could not be
+ *         restored
+ * @retval TRUE if successful
+ */
+int libatari800_restore_state_chain(const emulator_state_t *base, atari800_delta_t * const *chain, int n)
+{
+	emulator_state_t *state;
+	int result;
+	int i;
+
+	state = (emulator_state_t *)Util_malloc(sizeof(emulator_state_t));
+	memcpy(state, base, LIBATARI800_STATE_LEN(base));
+	for (i = 0; i < n; i++) {
+		if (!libatari800_apply_state_delta(state, chain[i])) {
+			free(state);
+			return FALSE;
+		}
+	}
+	result = libatari800_restore_state(state);
+	free(state);
+	return result;
+}
+
+
+/** Return the size of a delta in bytes
+ *
+ * @param delta delta from \a libatari800_get_state_delta
+ *
+ * @returns number of bytes used by the delta
+ */
+int libatari800_get_delta_size(const atari800_delta_t *delta)
+{
+	return (int)Snapshot_DeltaSize(delta);
+}
+
+
+/** Free a delta
+ *
+ * @param delta delta from \a libatari800_get_state_delta
+ */
+void libatari800_free_delta(atari800_delta_t *delta)
+{
+	free(delta);
+}
+
+
+/** Save the state of the emulator into a new buffer
+ *
+ * Unlike \a libatari800_get_current_state, the state is not limited to the
+ * size of an \a emulator_state_t, so machines with extended memory or large
+ * cartridges can be saved. The buffer grows while the state is written.
+ *
+ * The state is a sequence of sections, one per subsystem, each of which is
+ * compressed with \a compression if that makes it smaller. A single
+ * section can be extracted with \a libatari800_get_state_section.
+ *
+ * @param compression one of the LIBATARI800_STATE_COMPRESS_* methods, or a
+ * method installed by \a libatari800_set_state_compressor
+ * @param len receives the length of the state in bytes
+ *
+ * @returns buffer to be freed with \a libatari800_free_state, or NULL if
+ * the state could not be saved
+ */
+UBYTE *libatari800_save_state(int compression, ULONG *len)
+{
+	UBYTE *buffer = NULL;
+	ULONG size = 0;
+
+	if (!StateSav_SaveAtariStateCompressed(&buffer, &size, len, compression)) {
+		free(buffer);
+		return NULL;
+	}
+	return buffer;
+}
+
+
+/** Restore a state saved by libatari800_save_state
+ *
+ * @param buffer the state
+ * @param len length of the state in bytes
+ *
+ * @retval FALSE if the state could not be read
+ * @retval TRUE if successful
+ */
+int libatari800_load_state(const UBYTE *buffer, ULONG len)
+{
+	if (!StateSav_ReadAtariStateFromMemory(buffer, len))
+		return FALSE;
+	REWIND_Mark();
+	MOVIE_Mark();
+	return TRUE;
+}
+
+
+/** Extract one section of a state saved by libatari800_save_state
+ *
+ * The other sections are skipped without being decompressed, so e.g. the
+ * memory of the machine can be examined cheaply. Sections are named by four
+ * characters: "MACH", "CART", "SIO ", "ANTC", "CPU ", "MEM ", "GTIA",
+ * "PIA ", "POKY", "XEP8", "PBI ", "MIO ", "BB  ", "XLD " and "LIB ". The
+ * data is in the format of the subsystem's state save code.
+ *
+ * @param buffer the state
+ * @param len length of the state in bytes
+ * @param id name of the section
+ * @param size receives the length of the section in bytes
+ *
+ * @returns buffer to be freed with \a libatari800_free_state, or NULL if
+ * there is no such section or it is corrupted
+ */
+UBYTE *libatari800_get_state_section(const UBYTE *buffer, ULONG len, const char *id, ULONG *size)
+{
+	return StateSav_ReadSection(buffer, len, id, size);
+}
+
+
+/** Free a buffer returned by libatari800_save_state or
+ * libatari800_get_state_section
+ *
+ * @param buffer the buffer
+ */
+void libatari800_free_state(UBYTE *buffer)
+{
+	free(buffer);
+}
+
+
+/** Install a state compressor
+ *
+ * Methods 1 and 2 are the built-in LZ compressor and zlib (if the library
+ * was built with it). Other compressors, e.g. zstd or LZ4, can be plugged in
+ * as methods 3 to 7, or can replace the built-in ones. A state can only be
+ * loaded if the compressors used to save it are installed.
+ *
+ * @param method number of the method
+ * @param compressor the functions of the compressor, copied; NULL to
+ * remove the method
+ *
+ * @retval FALSE if \a method is out of range
+ * @retval TRUE if successful
+ */
+int libatari800_set_state_compressor(int method, const state_compressor_t *compressor)
+{
+	StateSav_compressor_t c;
+
+	if (compressor == NULL)
+		return StateSav_SetCompressor(method, NULL);
+	c.bound = compressor->bound;
+	c.compress = compressor->compress;
+	c.decompress = compressor->decompress;
+	return StateSav_SetCompressor(method, &c);
+}
+
+
+/** Rewind the emulation to an earlier frame
+ *
+ * When the emulator was started with the \a -rewind option, it keeps a
+ * history of recent frames in memory: a snapshot every \a -rewind-interval
+ * frames plus the input of every frame. The emulator can be returned to the
+ * start of any frame in the history; the result is identical to the state it
+ * had when that frame was first emulated. The history after \a frame is
+ * discarded, and emulation continues from there with the next call to
+ * \a libatari800_next_frame.
+ *
+ * @param frame frame number as returned by \a libatari800_get_frame_number,
+ * no less than \a libatari800_rewind_oldest_frame
+ *
+ * @returns TRUE if successful, FALSE if the frame is not in the history
+ */
+int libatari800_rewind_to_frame(int frame)
+{
+	return REWIND_SeekFrame(frame);
+}
+
+
+/** Return the earliest frame that can be rewound to
+ *
+ * The history is limited to the memory given with the \a -rewind-budget
+ * option, so the oldest frames are dropped as emulation continues.
+ *
+ * @returns frame number, equal to the current frame if there is no history
+ */
+int libatari800_rewind_oldest_frame()
+{
+	return REWIND_OldestFrame();
+}
+
+
+/** Start recording an input movie
+ *
+ * The movie stores the current state of the emulator followed by the input
+ * of every frame emulated by \a libatari800_next_frame, along with disk
+ * changes and a hash of the machine after each frame. Playing it back
+ * reproduces the session exactly. A snapshot is embedded every
+ * \a -movie-index frames so playback can seek without starting over.
+ * Restoring a state while recording embeds the new state in the movie.
+ *
+ * @param filename path of the movie file to create
+ *
+ * @returns TRUE if successful
+ */
+int libatari800_movie_record(const char *filename)
+{
+	return MOVIE_Record(filename);
+}
+
+
+/** Start playing back an input movie
+ *
+ * The state stored in the movie is loaded by the next call to
+ * \a libatari800_next_frame, and from then on the input passed to
+ * \a libatari800_next_frame is ignored in favor of the recorded input. At
+ * the end of the movie, playback stops and the emulator continues with the
+ * input passed in.
+ *
+ * @param filename path of the movie file
+ *
+ * @returns TRUE if successful
+ */
+int libatari800_movie_play(const char *filename)
+{
+	return MOVIE_Play(filename);
+}
+
+
+/** Jump to a frame of the movie being played back
+ *
+ * The emulator is brought to the start of \a frame by loading the nearest
+ * embedded snapshot before it and replaying the input from there.
+ *
+ * @param frame frame number as returned by \a libatari800_get_frame_number
+ *
+ * @returns TRUE if successful, FALSE if no movie is playing or the movie
+ * does not contain the frame
+ */
+int libatari800_movie_seek(int frame)
+{
+	return MOVIE_Seek(frame);
+}
+
+
+/** Stop recording or playing back a movie
+ *
+ * A recording is only complete once it is stopped, which is also done by
+ * \a libatari800_exit.
+ */
+void libatari800_movie_stop()
+{
+	MOVIE_Stop();
+}
+
+
+/** Return the first frame at which playback diverged from the recording
+ *
+ * Every frame of a movie carries a hash of main memory and the CPU
+ * registers. During playback the hash is compared with the emulated
+ * machine after each frame.
+ *
+ * @returns frame number, or -1 if no desync has been detected
+ */
+int libatari800_movie_desync_frame()
+{
+	return MOVIE_desync_frame;
+}
+
+
+/** Start or stop the host time counters
+ *
+ * When enabled, the emulator measures the host time spent per frame in the
+ * CPU emulation, the ANTIC display emulation, the POKEY scanline processing,
+ * sound, the platform blit and video export. Enabling them clears their
+ * history. They can also be enabled with the \a -perfstats option.
+ *
+ * @param enable TRUE to start counting, FALSE to stop
+ */
+void libatari800_enable_perf_counters(int enable)
+{
+	if (enable)
+		PERFSTAT_Start();
+	else
+		PERFSTAT_Stop();
+}
+
+
+/** Return the host time counters
+ *
+ * Each counter gives the number of calls during the last frame and the
+ * minimum, average and 99th percentile of the host nanoseconds spent per
+ * frame over the last 512 frames. A counter excludes the time spent in
+ * the other counters it calls, so that the ANTIC counter does not include
+ * the CPU emulation. The last counter, named TOTAL, is the sum of the
+ * others.
+ *
+ * @param counters array receiving the counters
+ * @param max size of \a counters
+ *
+ * @returns number of counters stored, or 0 if the counters are not enabled
+ */
+int libatari800_get_perf_counters(perf_counter_t *counters, int max)
+{
+	int i;
+	if (!PERFSTAT_enabled)
+		return 0;
+	for (i = 0; i < PERFSTAT_COUNTERS && i < max; i++) {
+		PERFSTAT_stats_t stats;
+		PERFSTAT_GetStats(i, &stats);
+		counters[i].name = stats.name;
+		counters[i].calls = stats.calls;
+		counters[i].min_ns = stats.min_ns;
+		counters[i].avg_ns = stats.avg_ns;
+		counters[i].p99_ns = stats.p99_ns;
+	}
+	return i;
 }
 
 
@@ -491,6 +897,8 @@ void libatari800_restore_state(emulator_state_t *state)
  */
 void libatari800_exit() {
 	Atari800_Exit(0);
+	LIBATARI800_Observation_Exit();
+	LIBATARI800_Video_Exit();
 }
 
 /* Disk activity callback function pointer */
@@ -0,0 +1,680 @@
+/*
+ * benchmark.c - performance benchmark of the emulator core
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Runs a set of Atari programs, each stressing a different part of the
+   emulator, and reports the speed of each, the host time spent in each
+   part of the emulator and the peak memory use of the process. The host
+   time per part is measured on the first run of each workload with the
+   counters enabled, so it needs -repeat 2 or more. The results can be
+   written as JSON and compared with those of an earlier run, for example
+   of another build:
+
+     benchmark -json base.json
+     (rebuild)
+     benchmark -baseline base.json
+
+   The programs are built in, so no Atari software is needed. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define HAVE_PEAK_RSS
+#endif
+
+#include "libatari800.h"
+
+/* All programs use the OS for initialisation, so they run on the built-in
+   Altirra OS as well as on the Atari ROMs.
+
+   antic, gtia and dli share this subroutine:
+
+   fill     LDA #$00        ; fill $3800-$5FFF: players and screen
+            STA $80
+            LDA #$38
+            STA $81
+            LDY #0
+            LDX #$28
+   fill1    TYA
+            EOR $81
+            STA ($80),Y
+            INY
+            BNE fill1
+            INC $81
+            DEX
+            BNE fill1
+            LDA #$38
+            STA PMBASE
+            LDX #3          ; four quad-width players
+   fill2    LDA hpos,X
+            STA HPOSP0,X
+            LDA #3
+            STA SIZEP0,X
+            DEX
+            BPL fill2
+            LDA #3
+            STA GRACTL
+            RTS
+   hpos     .byte 64,100,136,172 */
+
+/* Wide playfield of ANTIC mode 4 text, with fine scrolling in both
+   directions on every line, and single-line players:
+
+            *= $2000
+   start    JSR fill
+            LDA #<dl
+            STA SDLSTL
+            LDA #>dl
+            STA SDLSTL+1
+            LDA #$3F
+            STA SDMCTL
+   frame    LDA RTCLOK+2
+   wait     CMP RTCLOK+2
+            BEQ wait
+            INC $82
+            LDA $82
+            STA HSCROL
+            LSR A
+            STA VSCROL
+            AND #7
+            BNE frame
+            LDX #0          ; coarse scroll every 16 frames
+   coarse   INC dl+4,X
+            INX
+            INX
+            INX
+            CPX #72
+            BNE coarse
+            JMP frame
+            *= $3000
+   dl       .byte $70,$70,$70
+            .byte $74,<($4000+64*i),>($4000+64*i)    ; i = 0..23
+            .byte $41,<dl,>dl */
+static const unsigned char antic_xex[] = {
+	0xff, 0xff, 0x00, 0x20, 0x6d, 0x20, 0x20, 0x36, 0x20, 0xa9, 0x00, 0x8d,
+	0x30, 0x02, 0xa9, 0x30, 0x8d, 0x31, 0x02, 0xa9, 0x3f, 0x8d, 0x2f, 0x02,
+	0xa5, 0x14, 0xc5, 0x14, 0xf0, 0xfc, 0xe6, 0x82, 0xa5, 0x82, 0x8d, 0x04,
+	0xd4, 0x4a, 0x8d, 0x05, 0xd4, 0x29, 0x07, 0xd0, 0xeb, 0xa2, 0x00, 0xfe,
+	0x04, 0x30, 0xe8, 0xe8, 0xe8, 0xe0, 0x48, 0xd0, 0xf6, 0x4c, 0x12, 0x20,
+	0xa9, 0x00, 0x85, 0x80, 0xa9, 0x38, 0x85, 0x81, 0xa0, 0x00, 0xa2, 0x28,
+	0x98, 0x45, 0x81, 0x91, 0x80, 0xc8, 0xd0, 0xf8, 0xe6, 0x81, 0xca, 0xd0,
+	0xf3, 0xa9, 0x38, 0x8d, 0x07, 0xd4, 0xa2, 0x03, 0xbd, 0x6a, 0x20, 0x9d,
+	0x00, 0xd0, 0xa9, 0x03, 0x9d, 0x08, 0xd0, 0xca, 0x10, 0xf2, 0xa9, 0x03,
+	0x8d, 0x1d, 0xd0, 0x60, 0x40, 0x64, 0x88, 0xac, 0x00, 0x30, 0x4d, 0x30,
+	0x70, 0x70, 0x70, 0x74, 0x00, 0x40, 0x74, 0x40, 0x40, 0x74, 0x80, 0x40,
+	0x74, 0xc0, 0x40, 0x74, 0x00, 0x41, 0x74, 0x40, 0x41, 0x74, 0x80, 0x41,
+	0x74, 0xc0, 0x41, 0x74, 0x00, 0x42, 0x74, 0x40, 0x42, 0x74, 0x80, 0x42,
+	0x74, 0xc0, 0x42, 0x74, 0x00, 0x43, 0x74, 0x40, 0x43, 0x74, 0x80, 0x43,
+	0x74, 0xc0, 0x43, 0x74, 0x00, 0x44, 0x74, 0x40, 0x44, 0x74, 0x80, 0x44,
+	0x74, 0xc0, 0x44, 0x74, 0x00, 0x45, 0x74, 0x40, 0x45, 0x74, 0x80, 0x45,
+	0x74, 0xc0, 0x45, 0x41, 0x00, 0x30, 0xe0, 0x02, 0xe1, 0x02, 0x00, 0x20
+};
+
+/* ANTIC mode F in the three GTIA modes, switching every frame, with all
+   nine colour registers changing:
+
+            *= $2000
+   start    JSR fill
+            LDA #<dl
+            STA SDLSTL
+            LDA #>dl
+            STA SDLSTL+1
+            LDA #$3E
+            STA SDMCTL
+   frame    LDA RTCLOK+2
+   wait     CMP RTCLOK+2
+            BEQ wait
+            INC $82
+            LDA $82
+            AND #3
+            TAX
+            LDA prior,X
+            STA GPRIOR
+            LDX #8
+   colors   INC PCOLR0,X
+            DEX
+            BPL colors
+            JMP frame
+   prior    .byte $40,$80,$C0,$80
+            *= $3000
+   dl       .byte $70,$70,$70,$4F,$00,$40
+            .byte $0F x 101
+            .byte $4F,$00,$50
+            .byte $0F x 89
+            .byte $41,<dl,>dl */
+static const unsigned char gtia_xex[] = {
+	0xff, 0xff, 0x00, 0x20, 0x6b, 0x20, 0x20, 0x34, 0x20, 0xa9, 0x00, 0x8d,
+	0x30, 0x02, 0xa9, 0x30, 0x8d, 0x31, 0x02, 0xa9, 0x3e, 0x8d, 0x2f, 0x02,
+	0xa5, 0x14, 0xc5, 0x14, 0xf0, 0xfc, 0xe6, 0x82, 0xa5, 0x82, 0x29, 0x03,
+	0xaa, 0xbd, 0x30, 0x20, 0x8d, 0x6f, 0x02, 0xa2, 0x08, 0xfe, 0xc0, 0x02,
+	0xca, 0x10, 0xfa, 0x4c, 0x12, 0x20, 0x40, 0x80, 0xc0, 0x80, 0xa9, 0x00,
+	0x85, 0x80, 0xa9, 0x38, 0x85, 0x81, 0xa0, 0x00, 0xa2, 0x28, 0x98, 0x45,
+	0x81, 0x91, 0x80, 0xc8, 0xd0, 0xf8, 0xe6, 0x81, 0xca, 0xd0, 0xf3, 0xa9,
+	0x38, 0x8d, 0x07, 0xd4, 0xa2, 0x03, 0xbd, 0x68, 0x20, 0x9d, 0x00, 0xd0,
+	0xa9, 0x03, 0x9d, 0x08, 0xd0, 0xca, 0x10, 0xf2, 0xa9, 0x03, 0x8d, 0x1d,
+	0xd0, 0x60, 0x40, 0x64, 0x88, 0xac, 0x00, 0x30, 0xc9, 0x30, 0x70, 0x70,
+	0x70, 0x4f, 0x00, 0x40, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x4f, 0x00, 0x50,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+	0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x41, 0x00, 0x30, 0xe0, 0x02, 0xe1, 0x02,
+	0x00, 0x20
+};
+
+/* A display list interrupt on every text line, each changing colours and
+   a player position on seven scanlines:
+
+            *= $2000
+   start    JSR fill
+            LDA #<dl
+            STA SDLSTL
+            LDA #>dl
+            STA SDLSTL+1
+            LDA #<dli
+            STA VDSLST
+            LDA #>dli
+            STA VDSLST+1
+            LDA #$3E
+            STA SDMCTL
+            LDA #$C0
+            STA NMIEN
+   frame    LDA RTCLOK+2
+   wait     CMP RTCLOK+2
+            BEQ wait
+            INC $82
+            JMP frame
+   dli      PHA
+            TXA
+            PHA
+            LDX #6
+   dli1     LDA VCOUNT
+            ADC $82
+            STA WSYNC
+            STA COLPF2
+            STA COLBK
+            STA HPOSP0
+            DEX
+            BPL dli1
+            PLA
+            TAX
+            PLA
+            RTI
+            *= $3000
+   dl       .byte $70,$70,$F0,$C2,$00,$40
+            .byte $82 x 23
+            .byte $41,<dl,>dl */
+static const unsigned char dli_xex[] = {
+	0xff, 0xff, 0x00, 0x20, 0x80, 0x20, 0x20, 0x49, 0x20, 0xa9, 0x00, 0x8d,
+	0x30, 0x02, 0xa9, 0x30, 0x8d, 0x31, 0x02, 0xa9, 0x2c, 0x8d, 0x00, 0x02,
+	0xa9, 0x20, 0x8d, 0x01, 0x02, 0xa9, 0x3e, 0x8d, 0x2f, 0x02, 0xa9, 0xc0,
+	0x8d, 0x0e, 0xd4, 0xa5, 0x14, 0xc5, 0x14, 0xf0, 0xfc, 0xe6, 0x82, 0x4c,
+	0x21, 0x20, 0x48, 0x8a, 0x48, 0xa2, 0x06, 0xad, 0x0b, 0xd4, 0x65, 0x82,
+	0x8d, 0x0a, 0xd4, 0x8d, 0x18, 0xd0, 0x8d, 0x1a, 0xd0, 0x8d, 0x00, 0xd0,
+	0xca, 0x10, 0xec, 0x68, 0xaa, 0x68, 0x40, 0xa9, 0x00, 0x85, 0x80, 0xa9,
+	0x38, 0x85, 0x81, 0xa0, 0x00, 0xa2, 0x28, 0x98, 0x45, 0x81, 0x91, 0x80,
+	0xc8, 0xd0, 0xf8, 0xe6, 0x81, 0xca, 0xd0, 0xf3, 0xa9, 0x38, 0x8d, 0x07,
+	0xd4, 0xa2, 0x03, 0xbd, 0x7d, 0x20, 0x9d, 0x00, 0xd0, 0xa9, 0x03, 0x9d,
+	0x08, 0xd0, 0xca, 0x10, 0xf2, 0xa9, 0x03, 0x8d, 0x1d, 0xd0, 0x60, 0x40,
+	0x64, 0x88, 0xac, 0x00, 0x30, 0x1f, 0x30, 0x70, 0x70, 0xf0, 0xc2, 0x00,
+	0x40, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82,
+	0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82,
+	0x41, 0x00, 0x30, 0xe0, 0x02, 0xe1, 0x02, 0x00, 0x20
+};
+
+/* Sample playback on both POKEYs of a stereo machine, writing the volume
+   of one channel every scanline, over two changing tones:
+
+            *= $2000
+   start    LDA #0
+            STA $D208       ; AUDCTL
+            STA $D218
+            LDA #3
+            STA $D20F       ; SKCTL
+            STA $D21F
+            LDA #$A6
+            STA $D203       ; AUDC2
+            STA $D213
+            LDA #$C4
+            STA $D205       ; AUDC3
+            STA $D215
+   loop     STA WSYNC
+            INC $82
+            LDA $82
+            AND #15
+            ORA #$10
+            STA $D201       ; AUDC1
+            EOR #$0F
+            STA $D211
+            LDA $82
+            BNE loop
+            INC $83
+            LDA $83
+            STA $D202       ; AUDF2
+            EOR #$55
+            STA $D212
+            LSR A
+            STA $D204       ; AUDF3
+            STA $D214
+            JMP loop */
+static const unsigned char pokey_xex[] = {
+	0xff, 0xff, 0x00, 0x20, 0x4c, 0x20, 0xa9, 0x00, 0x8d, 0x08, 0xd2, 0x8d,
+	0x18, 0xd2, 0xa9, 0x03, 0x8d, 0x0f, 0xd2, 0x8d, 0x1f, 0xd2, 0xa9, 0xa6,
+	0x8d, 0x03, 0xd2, 0x8d, 0x13, 0xd2, 0xa9, 0xc4, 0x8d, 0x05, 0xd2, 0x8d,
+	0x15, 0xd2, 0x8d, 0x0a, 0xd4, 0xe6, 0x82, 0xa5, 0x82, 0x29, 0x0f, 0x09,
+	0x10, 0x8d, 0x01, 0xd2, 0x49, 0x0f, 0x8d, 0x11, 0xd2, 0xa5, 0x82, 0xd0,
+	0xe9, 0xe6, 0x83, 0xa5, 0x83, 0x8d, 0x02, 0xd2, 0x49, 0x55, 0x8d, 0x12,
+	0xd2, 0x4a, 0x8d, 0x04, 0xd2, 0x8d, 0x14, 0xd2, 0x4c, 0x20, 0x20, 0xe0,
+	0x02, 0xe1, 0x02, 0x00, 0x20
+};
+
+/* Boot sector that reads the disk over and over through SIOV:
+
+            *= $0700
+            .byte 0,1
+            .word $0700,init
+   start    LDA #4
+            STA DAUX1
+            LDA #0
+            STA DAUX2
+   loop     LDA #$31
+            STA DDEVIC
+            LDA #1
+            STA DUNIT
+            LDA #$52        ; read sector
+            STA DCOMND
+            LDA #$40
+            STA DSTATS
+            LDA #<$4000
+            STA DBUFLO
+            LDA #>$4000
+            STA DBUFHI
+            LDA #7
+            STA DTIMLO
+            LDA #128
+            STA DBYTLO
+            LDA #0
+            STA DBYTHI
+            JSR SIOV
+            INC DAUX1
+            BNE next
+            INC DAUX2
+   next     LDA DAUX1
+            CMP #<721
+            BNE loop
+            LDA DAUX2
+            CMP #>721
+            BNE loop
+            JMP start
+   init     RTS */
+static const unsigned char sio_boot_sector[] = {
+	0x00, 0x01, 0x00, 0x07, 0x59, 0x07, 0xa9, 0x04, 0x8d, 0x0a, 0x03, 0xa9,
+	0x00, 0x8d, 0x0b, 0x03, 0xa9, 0x31, 0x8d, 0x00, 0x03, 0xa9, 0x01, 0x8d,
+	0x01, 0x03, 0xa9, 0x52, 0x8d, 0x02, 0x03, 0xa9, 0x40, 0x8d, 0x03, 0x03,
+	0xa9, 0x00, 0x8d, 0x04, 0x03, 0xa9, 0x40, 0x8d, 0x05, 0x03, 0xa9, 0x07,
+	0x8d, 0x06, 0x03, 0xa9, 0x80, 0x8d, 0x08, 0x03, 0xa9, 0x00, 0x8d, 0x09,
+	0x03, 0x20, 0x59, 0xe4, 0xee, 0x0a, 0x03, 0xd0, 0x03, 0xee, 0x0b, 0x03,
+	0xad, 0x0a, 0x03, 0xc9, 0xd1, 0xd0, 0xc1, 0xad, 0x0b, 0x03, 0xc9, 0x02,
+	0xd0, 0xba, 0x4c, 0x06, 0x07, 0x60
+};
+
+static const char basic_lst[] =
+	"10 FOR I=1 TO 500\n"
+	"20 X=SQR(I)*SIN(I)+EXP(I/500)+LOG(I)\n"
+	"30 NEXT I\n"
+	"40 GOTO 10\n";
+
+enum {
+	IMAGE_XEX,
+	IMAGE_LST,
+	IMAGE_BOOT_SECTOR	/* boot sector of a single density disk */
+};
+
+typedef struct {
+	const char *name;
+	const char *description;
+	int image_type;
+	const void *image;
+	int image_size;
+	char *args[4];
+} workload_t;
+
+static const workload_t workloads[] = {
+	{ "antic", "wide fine-scrolled text with players", IMAGE_XEX, antic_xex, sizeof(antic_xex), { NULL } },
+	{ "gtia", "GTIA modes 9, 10 and 11", IMAGE_XEX, gtia_xex, sizeof(gtia_xex), { NULL } },
+	{ "dli", "display list interrupt on every line", IMAGE_XEX, dli_xex, sizeof(dli_xex), { NULL } },
+	{ "pokey", "stereo POKEY sample playback", IMAGE_XEX, pokey_xex, sizeof(pokey_xex), { "-stereo", NULL } },
+	{ "sio", "disk reads through serial I/O", IMAGE_BOOT_SECTOR, sio_boot_sector, sizeof(sio_boot_sector), { "-nopatch", NULL } },
+	{ "basic", "BASIC floating point", IMAGE_LST, basic_lst, sizeof(basic_lst) - 1, { "-basic", NULL } }
+};
+
+#define N_WORKLOADS ((int) (sizeof(workloads) / sizeof(workloads[0])))
+#define MAX_COUNTERS 16
+
+typedef struct {
+	double seconds;		/* CPU time of the measured frames */
+	double ns_per_frame;
+	perf_counter_t counters[MAX_COUNTERS];
+	int n_counters;
+	/* Peak RSS of the whole process so far, not of this workload alone:
+	   it includes all workloads run before and never decreases. */
+	long process_peak_rss_kb;
+} result_t;
+
+static int frames = 3000;
+static int warmup_frames = 300;
+static int repeat = 3;
+static const char *machine_args[16];
+static int n_machine_args = 0;
+
+static int WriteImage(const workload_t *w, const char *filename)
+{
+	FILE *fp = fopen(filename, "wb");
+	int ok;
+	if (fp == NULL)
+		return 0;
+	if (w->image_type == IMAGE_BOOT_SECTOR) {
+		/* 720 sectors of 128 bytes */
+		static const unsigned char header[16] = { 0x96, 0x02, 0x80, 0x16, 0x80, 0x00 };
+		unsigned char sector[128];
+		int i;
+		ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header);
+		memset(sector, 0, sizeof(sector));
+		memcpy(sector, w->image, w->image_size);
+		for (i = 1; i <= 720 && ok; i++) {
+			ok = fwrite(sector, 1, sizeof(sector), fp) == sizeof(sector);
+			memset(sector, i, sizeof(sector));
+		}
+	}
+	else
+		ok = fwrite(w->image, 1, w->image_size, fp) == (size_t) w->image_size;
+	if (fclose(fp) != 0)
+		ok = 0;
+	return ok;
+}
+
+static long PeakRss(void)
+{
+#ifdef HAVE_PEAK_RSS
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024;
+#else
+		return usage.ru_maxrss;
+#endif
+#endif
+	return -1;
+}
+
+static int RunWorkload(const workload_t *w, const char *filename, result_t *result)
+{
+	char *argv[32];
+	int argc = 0;
+	input_template_t input;
+	int run;
+	int i;
+
+	argv[argc++] = "atari800";
+	for (i = 0; i < n_machine_args; i++)
+		argv[argc++] = (char *) machine_args[i];
+	for (i = 0; w->args[i] != NULL; i++)
+		argv[argc++] = w->args[i];
+	argv[argc++] = (char *) filename;
+	argv[argc] = NULL;
+
+	result->ns_per_frame = 0;
+	for (run = 0; run < repeat; run++) {
+		clock_t start;
+		double seconds;
+		if (!libatari800_init(argc, argv)) {
+			fprintf(stderr, "%s: cannot start the emulator: %s\n", w->name, libatari800_error_message());
+			return 0;
+		}
+		libatari800_clear_input_array(&input);
+		for (i = 0; i < warmup_frames; i++)
+			libatari800_next_frame(&input);
+		/* The counters cost a little, so they are only enabled on the
+		   first run and the speed is taken from the other runs. */
+		if (run == 0 && repeat > 1)
+			libatari800_enable_perf_counters(1);
+		start = clock();
+		for (i = 0; i < frames; i++) {
+			if (!libatari800_next_frame(&input)) {
+				fprintf(stderr, "%s: emulation stopped: %s\n", w->name, libatari800_error_message());
+				libatari800_enable_perf_counters(0);
+				return 0;
+			}
+		}
+		seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+		if (run == 0 && repeat > 1) {
+			result->n_counters = libatari800_get_perf_counters(result->counters, MAX_COUNTERS);
+			libatari800_enable_perf_counters(0);
+			continue;
+		}
+		/* the fastest run is the least disturbed */
+		if (result->ns_per_frame == 0 || seconds * 1e9 / frames < result->ns_per_frame) {
+			result->seconds = seconds;
+			result->ns_per_frame = seconds * 1e9 / frames;
+		}
+	}
+	result->process_peak_rss_kb = PeakRss();
+	return 1;
+}
+
+/* Reads the ns_per_frame of workload NAME from a JSON file written with
+   -json. Returns 0 if not found. */
+static double ReadBaseline(const char *filename, const char *name)
+{
+	FILE *fp = fopen(filename, "r");
+	char line[1024];
+	char key[64];
+	double value = 0;
+	if (fp == NULL)
+		return 0;
+	sprintf(key, "\"name\": \"%s\"", name);
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *p;
+		if (strstr(line, key) != NULL && (p = strstr(line, "\"ns_per_frame\": ")) != NULL) {
+			value = atof(p + 16);
+			break;
+		}
+	}
+	fclose(fp);
+	return value;
+}
+
+static void WriteJson(FILE *fp, const workload_t *w, const result_t *r, int last)
+{
+	int i;
+	fprintf(fp, "    {\"name\": \"%s\", \"frames\": %d, \"seconds\": %.4f, \"fps\": %.1f, \"ns_per_frame\": %.0f, \"process_peak_rss_kb\": %ld, \"subsystems_ns\": {",
+	        w->name, frames, r->seconds, frames / r->seconds, r->ns_per_frame, r->process_peak_rss_kb);
+	for (i = 0; i < r->n_counters; i++)
+		fprintf(fp, "%s\"%s\": %.0f", i == 0 ? "" : ", ", r->counters[i].name, r->counters[i].avg_ns);
+	fprintf(fp, "}}%s\n", last ? "" : ",");
+}
+
+static void Usage(const char *program)
+{
+	int i;
+	printf("Usage: %s [options] [workload...]\n", program);
+	printf("\t-frames <n>       Measure <n> frames (default %d)\n", frames);
+	printf("\t-warmup <n>       Run <n> frames before measuring (default %d)\n", warmup_frames);
+	printf("\t-repeat <n>       Take the best of <n> runs (default %d); the first\n", repeat);
+	printf("\t                  measures the host time per subsystem, so that\n");
+	printf("\t                  needs <n> of 2 or more\n");
+	printf("\t-json <file>      Write the results to <file>\n");
+	printf("\t-baseline <file>  Compare with results written with -json\n");
+	printf("\t-threshold <pct>  Fail if a workload is <pct> percent slower than\n");
+	printf("\t                  the baseline (default 5)\n");
+	printf("\t-machine <arg>    Pass <arg> to the emulator, e.g. -machine -ntsc\n");
+	printf("Workloads:\n");
+	for (i = 0; i < N_WORKLOADS; i++)
+		printf("\t%-8s %s\n", workloads[i].name, workloads[i].description);
+}
+
+int main(int argc, char **argv)
+{
+	const char *json_filename = NULL;
+	const char *baseline_filename = NULL;
+	double threshold = 5;
+	int selected[N_WORKLOADS];
+	int any_selected = 0;
+	int slower = 0;
+	const char *tmpdir;
+	FILE *json = NULL;
+	int last;
+	int i;
+
+	memset(selected, 0, sizeof(selected));
+	for (i = 1; i < argc; i++) {
+		int i_a = (i + 1 < argc);
+		if (strcmp(argv[i], "-frames") == 0 && i_a)
+			frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-warmup") == 0 && i_a)
+			warmup_frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-repeat") == 0 && i_a)
+			repeat = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-json") == 0 && i_a)
+			json_filename = argv[++i];
+		else if (strcmp(argv[i], "-baseline") == 0 && i_a)
+			baseline_filename = argv[++i];
+		else if (strcmp(argv[i], "-threshold") == 0 && i_a)
+			threshold = atof(argv[++i]);
+		else if (strcmp(argv[i], "-machine") == 0 && i_a && n_machine_args < 16)
+			machine_args[n_machine_args++] = argv[++i];
+		else if (argv[i][0] != '-') {
+			int j;
+			for (j = 0; j < N_WORKLOADS; j++) {
+				if (strcmp(argv[i], workloads[j].name) == 0)
+					break;
+			}
+			if (j == N_WORKLOADS) {
+				fprintf(stderr, "Unknown workload %s\n", argv[i]);
+				return 2;
+			}
+			selected[j] = any_selected = 1;
+		}
+		else {
+			Usage(argv[0]);
+			return 2;
+		}
+	}
+	if (frames <= 0 || warmup_frames < 0 || repeat <= 0) {
+		Usage(argv[0]);
+		return 2;
+	}
+	if (repeat < 2)
+		fprintf(stderr, "Warning: the host time per subsystem is only measured with -repeat 2 or more\n");
+	if (!any_selected) {
+		for (i = 0; i < N_WORKLOADS; i++)
+			selected[i] = 1;
+	}
+
+	if (json_filename != NULL) {
+		json = fopen(json_filename, "w");
+		if (json == NULL) {
+			perror(json_filename);
+			return 2;
+		}
+		fprintf(json, "{\n  \"frames\": %d,\n  \"repeat\": %d,\n  \"workloads\": [\n", frames, repeat);
+	}
+	tmpdir = getenv("TMPDIR");
+	if (tmpdir == NULL)
+		tmpdir = getenv("TEMP");
+	if (tmpdir == NULL)
+		tmpdir = ".";
+
+	printf("%-8s %9s %11s %9s  %s\n", "workload", "frames/s", "ns/frame", "proc peak", "host time per frame");
+	for (last = N_WORKLOADS - 1; !selected[last]; last--);
+	for (i = 0; i < N_WORKLOADS; i++) {
+		const workload_t *w = workloads + i;
+		char filename[FILENAME_MAX];
+		result_t result;
+		int ok;
+		int j;
+
+		if (!selected[i])
+			continue;
+		sprintf(filename, "%.*s/a8bench_%s.tmp", (int) (sizeof(filename) - 32), tmpdir, w->name);
+		if (!WriteImage(w, filename)) {
+			perror(filename);
+			return 2;
+		}
+		memset(&result, 0, sizeof(result));
+		ok = RunWorkload(w, filename, &result);
+		remove(filename);
+		if (!ok)
+			return 2;
+
+		printf("%-8s %9.1f %11.0f %9ld ", w->name, frames / result.seconds, result.ns_per_frame, result.process_peak_rss_kb);
+		/* the last counter is the total */
+		for (j = 0; j < result.n_counters - 1; j++) {
+			if (result.counters[j].avg_ns > 0)
+				printf(" %s %.0f%%", result.counters[j].name,
+				       100 * result.counters[j].avg_ns / result.counters[result.n_counters - 1].avg_ns);
+		}
+		printf("\n");
+		if (baseline_filename != NULL) {
+			double base = ReadBaseline(baseline_filename, w->name);
+			if (base > 0) {
+				double change = 100 * (result.ns_per_frame - base) / base;
+				printf("%-8s %33s %+.1f%% against %.0f ns/frame%s\n", "", "", change, base,
+				       change > threshold ? "  SLOWER" : "");
+				if (change > threshold)
+					slower = 1;
+			}
+			else
+				printf("%-8s %33s not in the baseline\n", "", "");
+		}
+		if (json != NULL)
+			WriteJson(json, w, &result, i == last);
+	}
+	libatari800_exit();
+
+	if (json != NULL) {
+		fprintf(json, "  ]\n}\n");
+		if (fclose(json) != 0) {
+			perror(json_filename);
+			return 2;
+		}
+	}
+	return slower;
+}
+
+/*
+vim:ts=4:sw=4:
+*/
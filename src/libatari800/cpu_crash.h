@@ -14,4 +14,6 @@ extern jmp_buf libatari800_cpu_crash;
 
 extern int libatari800_continue_on_brk;
 
+const char *LIBATARI800_ErrorMessage(int code);
+
 #endif /* LIBATARI800_API_H_ */
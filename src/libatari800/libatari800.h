@@ -119,7 +119,9 @@ typedef struct {
 } input_template_t;
 
 
-#define STATESAV_MAX_SIZE 210000
+/* Enough for machines up to the 130XE; save larger ones with
+   libatari800_save_state */
+#define STATESAV_MAX_SIZE 262144
 
 /* byte offsets into output_template.state array of groups of data
    to prevent the need for a full parsing of the save state data to
@@ -300,12 +302,118 @@ float libatari800_get_fps();
 
 int libatari800_get_frame_number();
 
-void libatari800_get_current_state(emulator_state_t *state);
+int libatari800_get_current_state(emulator_state_t *state);
 
-void libatari800_restore_state(emulator_state_t *state);
+int libatari800_restore_state(emulator_state_t *state);
+
+/* Incremental snapshots */
+typedef struct Snapshot_delta_t atari800_delta_t;
+
+atari800_delta_t *libatari800_get_state_delta(const emulator_state_t *base, const emulator_state_t *state);
+int libatari800_apply_state_delta(emulator_state_t *state, const atari800_delta_t *delta);
+int libatari800_restore_state_chain(const emulator_state_t *base, atari800_delta_t * const *chain, int n);
+int libatari800_get_delta_size(const atari800_delta_t *delta);
+void libatari800_free_delta(atari800_delta_t *delta);
+
+/* States of variable size */
+#define LIBATARI800_STATE_COMPRESS_NONE 0
+#define LIBATARI800_STATE_COMPRESS_LZ 1
+#define LIBATARI800_STATE_COMPRESS_ZLIB 2
+
+typedef struct {
+    ULONG (*bound)(ULONG len);
+    ULONG (*compress)(UBYTE *dest, ULONG dest_size, UBYTE const *src, ULONG len);
+    int (*decompress)(UBYTE *dest, ULONG len, UBYTE const *src, ULONG src_len);
+} state_compressor_t;
+
+UBYTE *libatari800_save_state(int compression, ULONG *len);
+int libatari800_load_state(const UBYTE *buffer, ULONG len);
+UBYTE *libatari800_get_state_section(const UBYTE *buffer, ULONG len, const char *id, ULONG *size);
+void libatari800_free_state(UBYTE *buffer);
+int libatari800_set_state_compressor(int method, const state_compressor_t *compressor);
+
+/* Rewind */
+int libatari800_rewind_to_frame(int frame);
+int libatari800_rewind_oldest_frame();
+
+/* Movies */
+int libatari800_movie_record(const char *filename);
+int libatari800_movie_play(const char *filename);
+int libatari800_movie_seek(int frame);
+void libatari800_movie_stop();
+int libatari800_movie_desync_frame();
+
+/* Host time counters */
+typedef struct {
+    const char *name;
+    unsigned long calls;
+    double min_ns;
+    double avg_ns;
+    double p99_ns;
+} perf_counter_t;
+
+void libatari800_enable_perf_counters(int enable);
+int libatari800_get_perf_counters(perf_counter_t *counters, int max);
+
+/* Frame and sound export into caller buffers */
+#define LIBATARI800_FRAME_GRAY8 1
+#define LIBATARI800_FRAME_RGB24 2
+#define LIBATARI800_FRAME_RGBA32 3
+
+typedef struct {
+    int format;
+    int x;
+    int y;
+    int width;
+    int height;
+    int downscale;
+    int pitch;
+    int num_buffers;
+    UBYTE *buffers[3];
+} frame_buffers_t;
+
+int libatari800_set_frame_buffers(const frame_buffers_t *config);
+int libatari800_lock_frame(int *frame_number);
+void libatari800_unlock_frame(int index);
+int libatari800_get_dropped_frames(void);
+int libatari800_set_sound_ring(UBYTE *ring, int size);
+unsigned long libatari800_get_sound_ring_position();
+
+/* Observations for agents */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+    int out_width;
+    int out_height;
+    int max_pool;
+    int stack;
+} observation_config_t;
+
+int libatari800_set_observation(const observation_config_t *settings);
+int libatari800_get_observation(UBYTE *dest);
+const UBYTE *libatari800_get_observation_frame(int age);
 
 void libatari800_exit();
 
+/* Machine save slots, swapped in and out of the single emulator core */
+typedef struct atari800_slot atari800_slot_t;
+
+atari800_slot_t *libatari800_slot_new(void);
+int libatari800_slot_init(atari800_slot_t *slot, int argc, char **argv);
+int libatari800_slot_next_frame(atari800_slot_t *slot, input_template_t *input);
+void libatari800_slot_continue_emulation_on_brk(atari800_slot_t *slot, int cont);
+const char *libatari800_slot_error_message(atari800_slot_t *slot);
+UBYTE *libatari800_slot_get_screen_ptr(atari800_slot_t *slot);
+UBYTE *libatari800_slot_get_sound_buffer(atari800_slot_t *slot);
+int libatari800_slot_get_sound_buffer_len(atari800_slot_t *slot);
+int libatari800_slot_get_frame_number(atari800_slot_t *slot);
+int libatari800_slot_get_current_state(atari800_slot_t *slot, emulator_state_t *state);
+int libatari800_slot_restore_state(atari800_slot_t *slot, emulator_state_t *state);
+int libatari800_slot_clone(atari800_slot_t *dest, atari800_slot_t *src);
+void libatari800_slot_free(atari800_slot_t *slot);
+
 /* Disk management functions */
 int libatari800_mount_disk(int drive_num, const char *filename, int read_only);
 void libatari800_unmount_disk(int drive_num);
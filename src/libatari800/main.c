@@ -33,6 +33,8 @@
 #include "akey.h"
 #include "afile.h"
 #include "../input.h"
+#include "movie.h"
+#include "rewind.h"
 #include "antic.h"
 #include "cpu.h"
 #include "platform.h"
@@ -56,7 +58,10 @@
 #include "antic.h"
 #include "devices.h"
 #include "gtia.h"
+#include "hwtrace.h"
+#include "perfstat.h"
 #include "pokey.h"
+#include "profiler.h"
 #ifdef PBI_BB
 #include "pbi_bb.h"
 #endif
@@ -114,9 +119,14 @@ void LIBATARI800_Frame(void)
 	case AKEY_UI:
 		PLATFORM_Exit(TRUE);  /* run monitor */
 		break;
+	case AKEY_REWIND:
+		REWIND_StepBack(3);
+		break;
 	default:
 		break;
 	}
+	MOVIE_Frame();
+	REWIND_Frame();
 
 #ifdef PBI_BB
 	PBI_BB_Frame(); /* just to make the menu key go up automatically */
@@ -125,15 +135,26 @@ void LIBATARI800_Frame(void)
 	VOTRAXSND_Frame(); /* for the Votrax */
 #endif
 	Devices_Frame();
+	SIO_Frame();
 	INPUT_Frame();
+#ifdef HWTRACE
+	HWTRACE_Frame();
+#endif
+#ifdef PROFILER
+	PROFILER_Frame();
+#endif
+	PERFSTAT_Frame();
 	GTIA_Frame();
 	ANTIC_Frame(TRUE);
 	INPUT_DrawMousePointer();
 	Screen_DrawAtariSpeed(Util_time());
+	Screen_DrawPerfStats(Util_time());
 	Screen_DrawDiskLED();
 	Screen_Draw1200LED();
 	POKEY_Frame();
+	PERFSTAT_ENTER(PERFSTAT_SOUND);
 	Sound_Update();
+	PERFSTAT_LEAVE();
 	Atari800_nframes++;
 }
 
@@ -0,0 +1,336 @@
+/*
+ * libatari800/observation.c - Atari800 as a library - observations for agents
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "blit.h"
+#include "colours.h"
+#include "screen.h"
+#include "util.h"
+#include "libatari800/libatari800.h"
+#include "libatari800/observation.h"
+
+/* Each frame the cropped screen is converted to luma, optionally max-pooled
+   with the previous frame, resized by area averaging and stored in a ring
+   of the last config.stack observations. */
+
+static observation_config_t config;
+static int enabled = FALSE;
+
+/* Luma of each palette entry, as (299 R + 587 G + 114 B) / 1000 rounded. */
+static UBYTE luma[256];
+static int palette[256];
+
+/* Luma of the cropped screen in the current and the previous frame. */
+static UBYTE *current = NULL;
+static UBYTE *previous = NULL;
+static int have_previous;
+
+/* The source pixels of each output column or row: FIRST[i] and the next
+   COUNT[i] - 1 pixels, weighted by WEIGHT[OFFSET[i]...]. */
+typedef struct {
+	int *first;
+	int *count;
+	int *offset;
+	UWORD *weight;
+} spans_t;
+static spans_t columns;
+static spans_t rows;
+
+/* The weighted sums of the source rows of one output row, for the even and
+   the odd columns. ODD follows EVEN in the same allocation. */
+static UWORD *even = NULL;
+static UWORD *odd;
+
+/* Index in EVEN of the sum of each column in columns.weight. */
+static int *column_index = NULL;
+
+/* 1 / (config.width * config.height). */
+static double reciprocal;
+
+/* config.stack observations; the newest is at NEWEST. */
+static UBYTE *ring = NULL;
+static int newest;
+static int filled;
+
+static void FreeSpans(spans_t *spans)
+{
+	free(spans->first);
+	free(spans->count);
+	free(spans->offset);
+	free(spans->weight);
+	memset(spans, 0, sizeof(*spans));
+}
+
+/* Computes the weights of area averaging SRC pixels to DEST pixels. In
+   units of 1/DEST source pixels, output pixel i covers [i * SRC,
+   (i + 1) * SRC) and source pixel j covers [j * DEST, (j + 1) * DEST), so
+   the overlaps are integers and the weights of each output pixel add up to
+   SRC. */
+static void MakeSpans(spans_t *spans, int src, int dest)
+{
+	int max_count = src / dest + 2;
+	int n = 0;
+	int i;
+
+	FreeSpans(spans);
+	spans->first = (int *) Util_malloc(dest * sizeof(int));
+	spans->count = (int *) Util_malloc(dest * sizeof(int));
+	spans->offset = (int *) Util_malloc(dest * sizeof(int));
+	spans->weight = (UWORD *) Util_malloc(dest * max_count * sizeof(UWORD));
+	for (i = 0; i < dest; i++) {
+		int start = i * src;
+		int end = start + src;
+		int j;
+		spans->first[i] = start / dest;
+		spans->offset[i] = n;
+		for (j = start / dest; j * dest < end; j++) {
+			int from = j * dest > start ? j * dest : start;
+			int to = (j + 1) * dest < end ? (j + 1) * dest : end;
+			spans->weight[n++] = (UWORD) (to - from);
+		}
+		spans->count[i] = n - spans->offset[i];
+	}
+}
+
+static void UpdatePalette(void)
+{
+	int i;
+	if (memcmp(palette, Colours_table, sizeof(palette)) == 0)
+		return;
+	memcpy(palette, Colours_table, sizeof(palette));
+	for (i = 0; i < 256; i++)
+		luma[i] = (UBYTE) ((299 * Colours_GetR(i) + 587 * Colours_GetG(i) + 114 * Colours_GetB(i) + 500) / 1000);
+}
+
+void LIBATARI800_Observation_Frame(void)
+{
+	UBYTE const *screen;
+	UBYTE *out;
+	UBYTE *swap;
+	ULONG total;
+	int out_size;
+	int x;
+	int y;
+
+	if (!enabled)
+		return;
+	UpdatePalette();
+
+	/* Luma, max-pooled with the previous frame. */
+	screen = (UBYTE const *) Screen_atari + config.y * Screen_WIDTH + config.x;
+	for (y = 0; y < config.height; y++) {
+		UBYTE *dest = current + y * config.width;
+		for (x = 0; x < config.width; x++)
+			dest[x] = luma[screen[x]];
+		screen += Screen_WIDTH;
+	}
+	if (config.max_pool) {
+		if (have_previous) {
+			swap = previous;
+			previous = current;
+			current = swap;
+			BLIT_Max8(current, previous, current, config.width * config.height);
+		}
+		else {
+			memcpy(previous, current, config.width * config.height);
+			have_previous = TRUE;
+		}
+	}
+
+	/* Sum the rows of each output row, then the columns. The row sums are at
+	   most config.height * 255, so they fit in 16 bits. */
+	newest = (newest + 1) % config.stack;
+	out_size = config.out_width * config.out_height;
+	out = ring + newest * out_size;
+	total = (ULONG) config.width * config.height;
+	for (y = 0; y < config.out_height; y++) {
+		UWORD const *w = rows.weight + rows.offset[y];
+		int i;
+		memset(even, 0, (config.width + 1) / 2 * 2 * sizeof(UWORD));
+		for (i = 0; i < rows.count[y]; i++)
+			BLIT_MulAddPairs8(even, odd, current + (rows.first[y] + i) * config.width, config.width, w[i]);
+		for (x = 0; x < config.out_width; x++) {
+			UWORD const *cw = columns.weight + columns.offset[x];
+			int const *index = column_index + columns.offset[x];
+			ULONG v = total / 2;
+			ULONG q;
+			for (i = 0; i < columns.count[x]; i++)
+				v += (ULONG) cw[i] * even[index[i]];
+			/* v / total, without a division. */
+			q = (ULONG) (v * reciprocal);
+			if (q * total > v)
+				q--;
+			else if ((q + 1) * total <= v)
+				q++;
+			*out++ = (UBYTE) q;
+		}
+	}
+
+	if (filled == 0) {
+		/* Start with a stack of the first observation. */
+		int i;
+		for (i = 0; i < config.stack; i++)
+			if (i != newest)
+				memcpy(ring + i * out_size, ring + newest * out_size, out_size);
+		filled = config.stack;
+	}
+}
+
+
+/** Compute observations for agents
+ *
+ * After each emulated frame, the screen is reduced to a small grayscale image
+ * and kept in a stack of the latest images, as commonly fed to reinforcement
+ * learning agents:
+ *
+ * - the area of the 384x240 screen given by x, y, width and height is taken
+ *   (the whole screen if width is 0);
+ * - each pixel is converted to its luma, 0.299 R + 0.587 G + 0.114 B, using
+ *   the current palette;
+ * - if max_pool is TRUE, each pixel is the maximum of this frame and the
+ *   previous one, which removes the flicker of objects drawn every other
+ *   frame;
+ * - the image is resized to out_width x out_height by area averaging, as done
+ *   by OpenCV's INTER_AREA, in exact integer arithmetic;
+ * - the result is rounded to 8 bits and stored as the newest of the last
+ *   stack images.
+ *
+ * Until \a stack frames have been emulated, the stack is padded with the
+ * first image.
+ *
+ * @param settings observation settings, or NULL to stop computing them
+ *
+ * @retval FALSE if the settings are invalid; observations are stopped
+ * @retval TRUE if successful
+ */
+int libatari800_set_observation(const observation_config_t *settings)
+{
+	int x;
+
+	enabled = FALSE;
+	if (settings == NULL)
+		return TRUE;
+	config = *settings;
+	if (config.width == 0) {
+		config.x = 0;
+		config.y = 0;
+		config.width = Screen_WIDTH;
+		config.height = Screen_HEIGHT;
+	}
+	if (config.x < 0 || config.y < 0 || config.width <= 0 || config.height <= 0
+	 || config.x + config.width > Screen_WIDTH || config.y + config.height > Screen_HEIGHT
+	 || config.out_width <= 0 || config.out_width > config.width
+	 || config.out_height <= 0 || config.out_height > config.height
+	 || config.stack < 1)
+		return FALSE;
+
+	current = (UBYTE *) Util_realloc(current, config.width * config.height);
+	previous = (UBYTE *) Util_realloc(previous, config.width * config.height);
+	even = (UWORD *) Util_realloc(even, (config.width + 1) / 2 * 2 * sizeof(UWORD));
+	odd = even + (config.width + 1) / 2;
+	ring = (UBYTE *) Util_realloc(ring, config.stack * config.out_width * config.out_height);
+	MakeSpans(&columns, config.width, config.out_width);
+	MakeSpans(&rows, config.height, config.out_height);
+	column_index = (int *) Util_realloc(column_index, (config.width / config.out_width + 2) * config.out_width * sizeof(int));
+	for (x = 0; x < config.out_width; x++) {
+		int i;
+		for (i = 0; i < columns.count[x]; i++) {
+			int col = columns.first[x] + i;
+			column_index[columns.offset[x] + i] = (col & 1 ? (config.width + 1) / 2 : 0) + (col >> 1);
+		}
+	}
+	reciprocal = 1.0 / ((double) config.width * config.height);
+	/* Force a rebuild. */
+	palette[0] = ~Colours_table[0];
+	have_previous = FALSE;
+	newest = 0;
+	filled = 0;
+	enabled = TRUE;
+	return TRUE;
+}
+
+
+/** Return the observation stack
+ *
+ * Copies the last \a stack observations into \a dest, oldest first, as
+ * stack x out_height x out_width bytes.
+ *
+ * @param dest buffer for the stack
+ *
+ * @retval FALSE if no observation has been computed yet
+ * @retval TRUE if successful
+ */
+int libatari800_get_observation(UBYTE *dest)
+{
+	int size = config.out_width * config.out_height;
+	int i;
+
+	if (!enabled || filled == 0)
+		return FALSE;
+	for (i = 1; i <= config.stack; i++) {
+		memcpy(dest, ring + (newest + i) % config.stack * size, size);
+		dest += size;
+	}
+	return TRUE;
+}
+
+
+/** Return one observation of the stack without copying
+ *
+ * The returned image is overwritten when \a stack more frames have been
+ * emulated.
+ *
+ * @param age 0 for the newest observation, up to stack - 1 for the oldest
+ *
+ * @returns pointer to out_height x out_width bytes, or NULL if \a age is out
+ * of range or no observation has been computed yet
+ */
+const UBYTE *libatari800_get_observation_frame(int age)
+{
+	if (!enabled || filled == 0 || age < 0 || age >= config.stack)
+		return NULL;
+	return ring + (newest - age + config.stack) % config.stack * config.out_width * config.out_height;
+}
+
+void LIBATARI800_Observation_Exit(void)
+{
+	enabled = FALSE;
+	free(current);
+	free(previous);
+	free(even);
+	free(column_index);
+	free(ring);
+	current = previous = ring = NULL;
+	even = NULL;
+	column_index = NULL;
+	FreeSpans(&columns);
+	FreeSpans(&rows);
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,10 @@
+#ifndef LIBATARI800_OBSERVATION_H_
+#define LIBATARI800_OBSERVATION_H_
+
+#include "config.h"
+
+/* Adds the current screen to the observation stack, if enabled. */
+void LIBATARI800_Observation_Frame(void);
+void LIBATARI800_Observation_Exit(void);
+
+#endif /* LIBATARI800_OBSERVATION_H_ */
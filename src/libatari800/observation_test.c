@@ -0,0 +1,214 @@
+/*
+ * libatari800/observation_test.c - checks the observations against plain loops
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* Fills the screen with random pixels, computes observations from it and
+   compares them with a plain computation: the luma of each pixel, the
+   maximum with the previous frame, and for each output pixel the sum of the
+   source pixels weighted by the area they share with it, rounded to the
+   nearest integer. This checks the max-pool and the area averaging kernels
+   for the usual 84x84 observation of the whole screen and for an odd sized
+   crop, with and without max-pooling.
+
+   Built and run by "make check". */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "colours.h"
+#include "screen.h"
+#include "libatari800.h"
+#include "observation.h"
+
+#define N_FRAMES 6
+#define MAX_STACK 4
+
+static UBYTE luma[Screen_HEIGHT * Screen_WIDTH];
+static UBYTE pooled[Screen_HEIGHT * Screen_WIDTH];
+static UBYTE previous[Screen_HEIGHT * Screen_WIDTH];
+static UBYTE want[MAX_STACK][Screen_HEIGHT * Screen_WIDTH];
+static UBYTE got[MAX_STACK * Screen_HEIGHT * Screen_WIDTH];
+
+static ULONG seed = 1;
+
+static ULONG Random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* Length of the overlap of output pixel I, covering [I * SRC, (I + 1) * SRC),
+   and source pixel J, covering [J * DEST, (J + 1) * DEST). */
+static ULONG Overlap(int i, int j, int src, int dest)
+{
+	int from = i * src > j * dest ? i * src : j * dest;
+	int to = (i + 1) * src < (j + 1) * dest ? (i + 1) * src : (j + 1) * dest;
+	return to > from ? (ULONG) (to - from) : 0;
+}
+
+/* Computes the observation of POOLED (width x height) into DEST. */
+static void Resize(UBYTE *dest, observation_config_t const *c)
+{
+	ULONG total = (ULONG) c->width * c->height;
+	int x;
+	int y;
+	for (y = 0; y < c->out_height; y++) {
+		for (x = 0; x < c->out_width; x++) {
+			ULONG sum = 0;
+			int i;
+			int j;
+			for (j = y * c->height / c->out_height; j < c->height && j * c->out_height < (y + 1) * c->height; j++) {
+				ULONG wy = Overlap(y, j, c->height, c->out_height);
+				for (i = x * c->width / c->out_width; i < c->width && i * c->out_width < (x + 1) * c->width; i++)
+					sum += wy * Overlap(x, i, c->width, c->out_width) * pooled[j * c->width + i];
+			}
+			/* Rounded half up, as the weights add up to TOTAL. */
+			dest[y * c->out_width + x] = (UBYTE) ((sum + total / 2) / total);
+		}
+	}
+}
+
+static int Test(char const *name, observation_config_t const *settings)
+{
+	observation_config_t c = *settings;
+	UBYTE *screen = libatari800_get_screen_ptr();
+	int out_size;
+	int frame;
+	int failed = FALSE;
+
+	if (!libatari800_set_observation(settings)) {
+		printf("%s: settings rejected\n", name);
+		return FALSE;
+	}
+	if (c.width == 0) {
+		c.x = 0;
+		c.y = 0;
+		c.width = Screen_WIDTH;
+		c.height = Screen_HEIGHT;
+	}
+	out_size = c.out_width * c.out_height;
+
+	for (frame = 0; frame < N_FRAMES && !failed; frame++) {
+		int x;
+		int y;
+		int i;
+
+		for (i = 0; i < Screen_HEIGHT * Screen_WIDTH; i++)
+			screen[i] = (UBYTE) (Random() >> 24);
+		LIBATARI800_Observation_Frame();
+
+		for (y = 0; y < c.height; y++) {
+			for (x = 0; x < c.width; x++) {
+				int colour = screen[(c.y + y) * Screen_WIDTH + c.x + x];
+				luma[y * c.width + x] = (UBYTE) ((299 * Colours_GetR(colour) + 587 * Colours_GetG(colour)
+				                                  + 114 * Colours_GetB(colour) + 500) / 1000);
+			}
+		}
+		for (i = 0; i < c.width * c.height; i++)
+			pooled[i] = c.max_pool && frame > 0 && previous[i] > luma[i] ? previous[i] : luma[i];
+		memcpy(previous, luma, c.width * c.height);
+
+		/* want[0] is the oldest observation. The stack starts filled with
+		   the first one. */
+		if (frame == 0) {
+			Resize(want[0], &c);
+			for (i = 1; i < c.stack; i++)
+				memcpy(want[i], want[0], out_size);
+		}
+		else {
+			for (i = 1; i < c.stack; i++)
+				memcpy(want[i - 1], want[i], out_size);
+			Resize(want[c.stack - 1], &c);
+		}
+
+		if (!libatari800_get_observation(got)) {
+			printf("%s: frame %d: no observation\n", name, frame);
+			failed = TRUE;
+			break;
+		}
+		for (i = 0; i < c.stack && !failed; i++) {
+			int k;
+			for (k = 0; k < out_size; k++) {
+				if (got[i * out_size + k] != want[i][k]) {
+					printf("%s: frame %d: observation %d differs at %d,%d: %d instead of %d\n",
+					       name, frame, i, k % c.out_width, k / c.out_width, got[i * out_size + k], want[i][k]);
+					failed = TRUE;
+					break;
+				}
+			}
+		}
+		if (!failed && memcmp(libatari800_get_observation_frame(0), want[c.stack - 1], out_size) != 0) {
+			printf("%s: frame %d: newest observation differs\n", name, frame);
+			failed = TRUE;
+		}
+	}
+	libatari800_set_observation(NULL);
+	if (!failed)
+		printf("%s: OK\n", name);
+	return !failed;
+}
+
+int main(void)
+{
+	static char *argv[] = { "atari800", NULL };
+	observation_config_t c;
+	int ok = TRUE;
+
+	if (!libatari800_init(1, argv)) {
+		printf("Cannot start the emulator: %s\n", libatari800_error_message());
+		return 1;
+	}
+
+	memset(&c, 0, sizeof(c));
+	c.out_width = 84;
+	c.out_height = 84;
+	c.max_pool = TRUE;
+	c.stack = 4;
+	ok &= Test("84x84 of the whole screen, max-pooled", &c);
+
+	c.max_pool = FALSE;
+	ok &= Test("84x84 of the whole screen", &c);
+
+	c.x = 13;
+	c.y = 7;
+	c.width = 333;
+	c.height = 197;
+	c.out_width = 83;
+	c.out_height = 61;
+	c.max_pool = TRUE;
+	c.stack = 3;
+	ok &= Test("83x61 of a 333x197 crop, max-pooled", &c);
+
+	c.out_width = 333;
+	c.out_height = 1;
+	c.max_pool = FALSE;
+	c.stack = 1;
+	ok &= Test("333x1 of a 333x197 crop", &c);
+
+	libatari800_exit();
+	return ok ? 0 : 1;
+}
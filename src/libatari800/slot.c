@@ -0,0 +1,423 @@
+/*
+ * libatari800/slot.c - Atari800 as a library - machine save slots
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Atari800 includes */
+#include "atari.h"
+#include "rewind.h"
+#include "screen.h"
+#include "sio.h"
+#include "util.h"
+#include "libatari800/cpu_crash.h"
+#include "libatari800/slot.h"
+#include "libatari800/sound.h"
+#include "libatari800/statesav.h"
+
+/* The emulator core keeps every chip's state in global variables, so only one
+   machine can be loaded into it at a time. A slot owns a parked copy of its
+   machine (saved with the state save code) plus its own screen buffer, and is
+   swapped into the core on demand. Swaps only happen when a different slot
+   is used, so driving a single slot costs nothing extra. */
+
+static atari800_slot_t *active_slot = NULL;
+
+/* Screen_atari as allocated by the plain libatari800_init, restored when the
+   loaded slot goes away. */
+static ULONG *default_screen = NULL;
+
+/* Save the loaded slot (if any) so that the core can be reused. Returns
+   FALSE, leaving the slot loaded, if its state does not fit. */
+static int Park(void)
+{
+	if (active_slot == NULL) {
+		if (default_screen == NULL)
+			default_screen = Screen_atari;
+		return TRUE;
+	}
+	if (!libatari800_get_current_state(&active_slot->state))
+		return FALSE;
+	/* Disk writes are kept out of the state, in the overlays of the drives */
+	active_slot->overlays = SIO_DetachOverlays();
+	active_slot->error_code = libatari800_error_code;
+	active_slot->continue_on_brk = libatari800_continue_on_brk;
+	active_slot->parked = TRUE;
+	active_slot = NULL;
+	return TRUE;
+}
+
+int LIBATARI800_Slot_Activate(atari800_slot_t *slot)
+{
+	if (slot == active_slot)
+		return TRUE;
+	if (!slot->initialised || !Park())
+		return FALSE;
+	Screen_atari = (ULONG *)slot->screen;
+	if (!libatari800_restore_state(&slot->state)) {
+		/* The core holds no valid machine now; SLOT keeps its state. */
+		Screen_atari = default_screen;
+		return FALSE;
+	}
+	SIO_AttachOverlays(slot->overlays);
+	slot->overlays = NULL;
+	/* The rewind history belongs to the machine that was parked */
+	REWIND_Reset();
+	libatari800_error_code = slot->error_code;
+	libatari800_continue_on_brk = slot->continue_on_brk;
+	slot->parked = FALSE;
+	active_slot = slot;
+	return TRUE;
+}
+
+int LIBATARI800_Slot_Frame(atari800_slot_t *slot, input_template_t *input)
+{
+	int status;
+
+	if (!LIBATARI800_Slot_Activate(slot))
+		return FALSE;
+	status = libatari800_next_frame(input);
+
+	/* The core's sound buffer is shared between all slots, keep a copy */
+	if (slot->sound_size < sound_hw_buffer_size) {
+		slot->sound = Util_realloc(slot->sound, sound_hw_buffer_size);
+		slot->sound_size = sound_hw_buffer_size;
+	}
+	if (sound_array_fill > 0)
+		memcpy(slot->sound, LIBATARI800_Sound_array, sound_array_fill);
+	slot->sound_len = sound_array_fill;
+	slot->error_code = libatari800_error_code;
+	slot->nframes = Atari800_nframes;
+	return status;
+}
+
+
+/** Create a new machine save slot
+ *
+ * A slot holds a complete emulated machine that can be swapped in and out of
+ * the emulator core. Any number of slots may exist in one process; each must
+ * be initialised with \a libatari800_slot_init before it can be used.
+ *
+ * The emulator core keeps the machine in global variables, so there is only
+ * one machine running at a time. Using a slot other than the one used last
+ * saves the loaded machine into its slot and restores the requested one, at
+ * the cost of a full state save and restore. Slots are not independent
+ * emulators: like the rest of libatari800, they must all be used from a
+ * single thread, and frames of different slots never run in parallel.
+ * A machine is parked in an \a emulator_state_t, so a slot can only be
+ * switched away from if its machine is not larger than a 130XE; otherwise
+ * using another slot fails.
+ *
+ * Machines in different slots may differ in anything the state save covers:
+ * machine type, memory size, OS, cartridge and mounted disks. Host side
+ * settings like the audio sample rate are shared by all slots.
+ *
+ * Disk and cartridge images are loaded once and shared by all the slots that
+ * use them, so switching to a slot with the same images does not read them
+ * again. With the \c -disk-overlay option, writable disks are shared as well:
+ * each slot keeps its own writes to them in memory, and the image files are
+ * never modified. These writes are not part of the saved state, but they
+ * follow the slot through switches and clones.
+ *
+ * The plain \a libatari800_* functions operate on whichever machine is loaded
+ * in the core, and should not be mixed with slots.
+ *
+ * @returns new slot
+ */
+atari800_slot_t *libatari800_slot_new(void)
+{
+	atari800_slot_t *slot;
+
+	slot = (atari800_slot_t *)Util_malloc(sizeof(atari800_slot_t));
+	memset(slot, 0, sizeof(atari800_slot_t));
+	slot->screen = (UBYTE *)Util_malloc(Screen_HEIGHT * Screen_WIDTH);
+	memset(slot->screen, 0, Screen_HEIGHT * Screen_WIDTH);
+	return slot;
+}
+
+
+/** Initialize emulator configuration of a slot
+ *
+ * Identical to \a libatari800_init, but the resulting machine is owned by
+ * \a slot.
+ *
+ * @param slot slot created by \a libatari800_slot_new
+ * @param argc number of arguments in @a argv, or -1 if \a argv contains a NULL
+ * terminated list.
+ * @param argv list of arguments.
+ *
+ * @retval FALSE if error in argument list, or if the loaded slot could not
+ * be parked
+ * @retval TRUE if successful
+ */
+int libatari800_slot_init(atari800_slot_t *slot, int argc, char **argv)
+{
+	int status;
+
+	if (slot != active_slot && !Park())
+		return FALSE;
+	/* Disk writes of the machine being replaced are discarded */
+	SIO_FreeOverlays(slot->overlays);
+	slot->overlays = NULL;
+	SIO_AttachOverlays(NULL);
+	Screen_atari = (ULONG *)slot->screen;
+	status = libatari800_init(argc, argv);
+	slot->error_code = libatari800_error_code;
+	slot->continue_on_brk = libatari800_continue_on_brk;
+	slot->nframes = Atari800_nframes;
+	slot->sound_len = 0;
+	slot->initialised = status;
+	slot->parked = FALSE;
+	active_slot = status ? slot : NULL;
+	if (!status)
+		Screen_atari = default_screen;
+	return status;
+}
+
+
+/** Perform one video frame's worth of emulation on a slot
+ *
+ * Identical to \a libatari800_next_frame, but runs the machine owned by
+ * \a slot.
+ *
+ * @param slot initialised slot
+ * @param input input template structure defining the user input for the frame
+ *
+ * @returns same values as \a libatari800_next_frame, or FALSE if \a slot has
+ * not been initialised or could not be loaded
+ */
+int libatari800_slot_next_frame(atari800_slot_t *slot, input_template_t *input)
+{
+	int status;
+
+	status = LIBATARI800_Slot_Frame(slot, input);
+	return status;
+}
+
+
+/** Set whether encountering a BRK instruction exits emulation of a slot.
+ *
+ * @param slot initialised slot
+ * @param cont see \a libatari800_continue_emulation_on_brk
+ */
+void libatari800_slot_continue_emulation_on_brk(atari800_slot_t *slot, int cont)
+{
+	slot->continue_on_brk = cont;
+	if (slot == active_slot)
+		libatari800_continue_on_brk = cont;
+}
+
+
+/** Get text description of latest error message of a slot
+ *
+ * @param slot initialised slot
+ *
+ * @returns text description of error
+ */
+const char *libatari800_slot_error_message(atari800_slot_t *slot)
+{
+	return LIBATARI800_ErrorMessage(slot->error_code);
+}
+
+
+/** Return pointer to screen data of a slot
+ *
+ * See \a libatari800_get_screen_ptr. The buffer belongs to the slot, so it
+ * stays valid while other slots are emulated.
+ *
+ * @param slot slot
+ *
+ * @returns pointer to the 92160 bytes of screen data
+ */
+UBYTE *libatari800_slot_get_screen_ptr(atari800_slot_t *slot)
+{
+	return slot->screen;
+}
+
+
+/** Return pointer to sound data of a slot
+ *
+ * See \a libatari800_get_sound_buffer. Holds the samples of the last frame
+ * emulated on \a slot.
+ *
+ * @param slot slot
+ *
+ * @returns pointer to the beginning of the sound sample buffer, or NULL if
+ * no frame has been emulated yet
+ */
+UBYTE *libatari800_slot_get_sound_buffer(atari800_slot_t *slot)
+{
+	return slot->sound;
+}
+
+
+/** Return the usable size of the sound buffer of a slot.
+ *
+ * @param slot slot
+ *
+ * @returns number of bytes of valid data in the sound buffer
+ */
+int libatari800_slot_get_sound_buffer_len(atari800_slot_t *slot)
+{
+	return (int)slot->sound_len;
+}
+
+
+/** Return the number of frames of emulation of a slot
+ *
+ * @param slot slot
+ *
+ * @returns see \a libatari800_get_frame_number
+ */
+int libatari800_slot_get_frame_number(atari800_slot_t *slot)
+{
+	return slot->nframes;
+}
+
+
+/** Save the state of a slot
+ *
+ * @param slot initialised slot
+ * @param state pointer to an already allocated \a emulator_state_t structure
+ *
+ * @retval FALSE if \a slot has not been initialised or its state does not fit
+ * @retval TRUE if successful
+ */
+int libatari800_slot_get_current_state(atari800_slot_t *slot, emulator_state_t *state)
+{
+	if (slot->parked) {
+		memcpy(state, &slot->state, LIBATARI800_STATE_LEN(&slot->state));
+		return TRUE;
+	}
+	if (slot == active_slot)
+		return libatari800_get_current_state(state);
+	return FALSE;
+}
+
+
+/** Restore the state of a slot
+ *
+ * @param slot initialised slot
+ * @param state pointer to a state from \a libatari800_slot_get_current_state
+ * or \a libatari800_get_current_state
+ *
+ * @retval FALSE if \a slot could not be loaded or \a state could not be read
+ * @retval TRUE if successful
+ */
+int libatari800_slot_restore_state(atari800_slot_t *slot, emulator_state_t *state)
+{
+	if (!LIBATARI800_Slot_Activate(slot) || !libatari800_restore_state(state))
+		return FALSE;
+	slot->nframes = Atari800_nframes;
+	return TRUE;
+}
+
+
+/** Copy the machine of a slot into another
+ *
+ * Makes \a dest an exact copy of the machine owned by \a src, including its
+ * screen, last sound samples and frame number, for example to explore several
+ * inputs from the same point. If \a src is loaded in the core its state is
+ * saved straight into \a dest; otherwise its parked state is copied with a
+ * single memcpy of the used part. \a src stays loaded, and \a dest is
+ * loaded when it is next used.
+ *
+ * @param dest slot created by \a libatari800_slot_new; any machine it
+ * owned is replaced
+ * @param src initialised slot
+ *
+ * @retval FALSE if \a src has not been initialised or its state does not
+ * fit; \a dest then owns no machine
+ * @retval TRUE if successful
+ */
+int libatari800_slot_clone(atari800_slot_t *dest, atari800_slot_t *src)
+{
+	if (!src->initialised)
+		return FALSE;
+	if (dest == src)
+		return TRUE;
+	if (dest == active_slot) {
+		/* Its machine is discarded, not parked. */
+		active_slot = NULL;
+		Screen_atari = default_screen;
+	}
+	SIO_FreeOverlays(dest->overlays);
+	if (src->parked) {
+		memcpy(&dest->state, &src->state, LIBATARI800_STATE_LEN(&src->state));
+		dest->overlays = SIO_CopyOverlays(src->overlays);
+	}
+	else {
+		SIO_overlays_t *overlays = SIO_DetachOverlays();
+		if (!libatari800_get_current_state(&dest->state)) {
+			SIO_AttachOverlays(overlays);
+			dest->overlays = NULL;
+			dest->initialised = FALSE;
+			dest->parked = FALSE;
+			return FALSE;
+		}
+		dest->overlays = SIO_CopyOverlays(overlays);
+		SIO_AttachOverlays(overlays);
+	}
+	memcpy(dest->screen, src->screen, Screen_HEIGHT * Screen_WIDTH);
+	if (src->sound_len > 0) {
+		if (dest->sound_size < src->sound_len) {
+			dest->sound = Util_realloc(dest->sound, src->sound_len);
+			dest->sound_size = src->sound_len;
+		}
+		memcpy(dest->sound, src->sound, src->sound_len);
+	}
+	dest->sound_len = src->sound_len;
+	dest->error_code = src->parked ? src->error_code : libatari800_error_code;
+	dest->continue_on_brk = src->parked ? src->continue_on_brk : libatari800_continue_on_brk;
+	dest->nframes = src->nframes;
+	dest->initialised = TRUE;
+	dest->parked = TRUE;
+	return TRUE;
+}
+
+
+/** Free a slot
+ *
+ * Releases the machine owned by \a slot. Resources shared by all slots are
+ * released by \a libatari800_exit.
+ *
+ * @param slot slot created by \a libatari800_slot_new
+ */
+void libatari800_slot_free(atari800_slot_t *slot)
+{
+	if (slot == NULL)
+		return;
+	if (slot == active_slot) {
+		active_slot = NULL;
+		Screen_atari = default_screen;
+	}
+	SIO_FreeOverlays(slot->overlays);
+	free(slot->sound);
+	free(slot->screen);
+	free(slot);
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,34 @@
+#ifndef LIBATARI800_SLOT_H_
+#define LIBATARI800_SLOT_H_
+
+#include "config.h"
+#include "atari.h"
+#include "sio.h"
+#include "libatari800/libatari800.h"
+
+/* An emulated machine that is not currently loaded into the emulator core
+   keeps its complete state here. Exactly one slot (or none, if the plain
+   libatari800_* API is being used) is loaded at any time. */
+struct atari800_slot {
+	emulator_state_t state;   /* machine state while the slot is parked */
+	int initialised;          /* libatari800_slot_init succeeded */
+	int parked;               /* state holds the machine, not the core */
+	UBYTE *screen;            /* per-machine Screen_atari buffer */
+	UBYTE *sound;             /* copy of the last frame's audio */
+	unsigned int sound_len;
+	unsigned int sound_size;
+	int error_code;
+	int continue_on_brk;
+	int nframes;
+	SIO_overlays_t *overlays; /* its disk writes while parked (see sio.h) */
+};
+
+/* Load SLOT into the emulator core, parking whichever slot is loaded.
+   Returns FALSE if SLOT has never been initialised, or if the loaded slot
+   cannot be parked or SLOT cannot be restored. */
+int LIBATARI800_Slot_Activate(atari800_slot_t *slot);
+
+/* Run one frame of SLOT. */
+int LIBATARI800_Slot_Frame(atari800_slot_t *slot, input_template_t *input);
+
+#endif /* LIBATARI800_SLOT_H_ */
@@ -27,6 +27,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #include "atari.h"
 #include "log.h"
@@ -34,6 +37,7 @@
 #include "init.h"
 #include "sound.h"
 #include "util.h"
+#include "libatari800/libatari800.h"
 
 UBYTE *LIBATARI800_Sound_array;
 
@@ -48,6 +52,17 @@ static double sample_diff;
 
 double sample_residual;
 
+/* Caller's sound ring and the number of bytes written to it, wrapping
+   around. */
+static UBYTE *ring = NULL;
+static unsigned int ring_size;
+static unsigned int ring_offset;
+static unsigned long ring_position;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 int PLATFORM_SoundSetup(Sound_setup_t *setup)
 {
 	double refresh_rate;
@@ -106,6 +121,88 @@ unsigned int PLATFORM_SoundAvailable(void)
 
 void PLATFORM_SoundWrite(UBYTE const *buffer, unsigned int size)
 {
-	memcpy(LIBATARI800_Sound_array, buffer, size);
-	sound_array_fill = size;
+	unsigned int offset;
+	unsigned int part;
+
+	if (ring == NULL) {
+		memcpy(LIBATARI800_Sound_array, buffer, size);
+		sound_array_fill = size;
+		return;
+	}
+	/* Only the newest samples fit in a small ring. */
+	if (size > ring_size) {
+		buffer += size - ring_size;
+		ring_position += size - ring_size;
+		ring_offset = (ring_offset + size - ring_size) % ring_size;
+		size = ring_size;
+	}
+	offset = ring_offset;
+	part = ring_size - offset;
+	if (part > size)
+		part = size;
+	memcpy(ring + offset, buffer, part);
+	memcpy(ring, buffer + part, size - part);
+	ring_offset = (offset + size) % ring_size;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&ring_mutex);
+#endif
+	ring_position += size;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&ring_mutex);
+#endif
+	sound_array_fill = 0;
+}
+
+
+/** Write sound samples into a caller ring buffer
+ *
+ * Instead of the sound buffer returned by \a libatari800_get_sound_buffer,
+ * which is overwritten every frame, the samples of each frame are appended to
+ * \a buffer, wrapping around at its end. While a ring is used,
+ * \a libatari800_get_sound_buffer_len returns 0.
+ *
+ * A consumer, possibly on another thread, remembers how many bytes it has
+ * read and compares that with \a libatari800_get_sound_ring_position; the
+ * bytes in between are at that position modulo \a size. If it falls behind by
+ * more than \a size bytes, the oldest samples are lost.
+ *
+ * Must be called from the thread that runs the emulation.
+ *
+ * @param buffer buffer for the samples, or NULL to use the sound buffer again
+ * @param size size of \a buffer in bytes, a multiple of the sample size times
+ * the number of channels
+ *
+ * @retval FALSE if \a size is invalid
+ * @retval TRUE if successful
+ */
+int libatari800_set_sound_ring(UBYTE *buffer, int size)
+{
+	if (buffer != NULL && (size <= 0 || size % (Sound_out.sample_size * Sound_out.channels) != 0))
+		return FALSE;
+	ring = buffer;
+	ring_size = size;
+	ring_offset = 0;
+	ring_position = 0;
+	return TRUE;
+}
+
+
+/** Return the number of bytes written to the sound ring
+ *
+ * May be called from any thread.
+ *
+ * @returns total number of bytes written since \a libatari800_set_sound_ring,
+ * wrapping around at the largest unsigned long
+ */
+unsigned long libatari800_get_sound_ring_position()
+{
+	unsigned long position;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&ring_mutex);
+#endif
+	position = ring_position;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&ring_mutex);
+#endif
+	return position;
 }
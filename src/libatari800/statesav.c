@@ -29,18 +29,41 @@
 #include "platform.h"
 #include "libatari800/statesav.h"
 #include "libatari800/init.h"
+#include "libatari800/sound.h"
+#include "memory.h"
 
-UBYTE *LIBATARI800_StateSav_buffer = NULL;
 statesav_tags_t *LIBATARI800_StateSav_tags = NULL;
 
 
-void LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags) {
-    LIBATARI800_StateSav_buffer = buffer;
-    LIBATARI800_StateSav_tags = tags;
-	StateSav_SaveAtariState(NULL, NULL, 0);
+/* Returns FALSE, with tags->size set to 0, if the state does not fit. */
+int LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags) {
+	int result;
+	LIBATARI800_StateSav_tags = tags;
+	result = StateSav_SaveAtariStateToMemory(buffer, STATESAV_MAX_SIZE, NULL);
+	LIBATARI800_StateSav_tags = NULL;
+	if (!result)
+		tags->size = 0;
+	return result;
 }
 
-void LIBATARI800_StateLoad(UBYTE *buffer) {
-    LIBATARI800_StateSav_buffer = buffer;
-	StateSav_ReadAtariState(NULL, NULL);
+int LIBATARI800_StateLoad(UBYTE *buffer) {
+	return StateSav_ReadAtariStateFromMemory(buffer, STATESAV_MAX_SIZE);
+}
+
+/* The flags kept outside the state by emulator_state_t, saved in a section
+   of their own in states of variable size. */
+void LIBATARI800_StateSaveFlags(void) {
+	int flags[3];
+	flags[0] = MEMORY_selftest_enabled;
+	flags[1] = Atari800_nframes;
+	flags[2] = (int)(0x7fffffff * sample_residual);
+	StateSav_SaveINT(flags, 3);
+}
+
+void LIBATARI800_StateReadFlags(void) {
+	int flags[3];
+	StateSav_ReadINT(flags, 3);
+	MEMORY_selftest_enabled = flags[0];
+	Atari800_nframes = flags[1];
+	sample_residual = (double)flags[2] / (double)0x7fffffff;
 }
@@ -1,6 +1,7 @@
 #ifndef LIBATARI800_STATESAV_H_
 #define LIBATARI800_STATESAV_H_
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 
@@ -9,10 +10,14 @@
 #include "../statesav.h"
 #include "libatari800/libatari800.h"
 
-extern UBYTE *LIBATARI800_StateSav_buffer;
 extern statesav_tags_t *LIBATARI800_StateSav_tags;
 
-void LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags);
-void LIBATARI800_StateLoad(UBYTE *buffer);
+/* Length of the used part of an emulator_state_t */
+#define LIBATARI800_STATE_LEN(s) ((ULONG)offsetof(emulator_state_t, state) + (s)->tags.size)
+
+int LIBATARI800_StateSave(UBYTE *buffer, statesav_tags_t *tags);
+int LIBATARI800_StateLoad(UBYTE *buffer);
+void LIBATARI800_StateSaveFlags(void);
+void LIBATARI800_StateReadFlags(void);
 
 #endif /* LIBATARI800_STATESAV_H_ */
@@ -0,0 +1,177 @@
+/*
+ * libatari800/statesav_test.c - checks the saved state and its tags
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* Runs a 130XE, the largest machine that fits in an emulator_state_t, and
+   checks that the tags of its state point at the CPU registers, the program
+   counter and the main memory, that restoring the state reproduces the
+   following frames exactly, and that sections unknown to this version are
+   skipped.
+
+   Built and run by "make check". */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "cpu.h"
+#include "memory.h"
+#include "screen.h"
+#include "libatari800.h"
+
+#define N_FRAMES 100
+
+static emulator_state_t state;
+static UBYTE ram[65536];
+static UBYTE screen[Screen_HEIGHT * Screen_WIDTH];
+
+static void RunFrames(int n)
+{
+	input_template_t input;
+	int i;
+
+	libatari800_clear_input_array(&input);
+	for (i = 0; i < n; i++) {
+		/* Keep some keys going, so that the frames differ. */
+		input.keychar = i % 20 < 10 ? 'A' + i % 26 : 0;
+		libatari800_next_frame(&input);
+	}
+}
+
+static int TestTags(void)
+{
+	cpu_state_t const *cpu;
+	UBYTE const *pc;
+	int ok = TRUE;
+
+	if (!libatari800_get_current_state(&state)) {
+		printf("tags: the state was not saved\n");
+		return FALSE;
+	}
+	printf("tags: size %lu, cpu %lu, pc %lu, base_ram %lu, base_ram_attrib %lu\n",
+	       (unsigned long)state.tags.size, (unsigned long)state.tags.cpu, (unsigned long)state.tags.pc,
+	       (unsigned long)state.tags.base_ram, (unsigned long)state.tags.base_ram_attrib);
+	if (state.tags.base_ram + 65536 > state.tags.size
+	 || memcmp(&state.state[state.tags.base_ram], libatari800_get_main_memory_ptr(), 65536) != 0) {
+		printf("tags: base_ram does not hold the main memory\n");
+		ok = FALSE;
+	}
+#ifndef PAGED_ATTRIB
+	if (state.tags.base_ram_attrib + 65536 > state.tags.size
+	 || memcmp(&state.state[state.tags.base_ram_attrib], MEMORY_attrib, 65536) != 0) {
+		printf("tags: base_ram_attrib does not hold the memory attributes\n");
+		ok = FALSE;
+	}
+#endif
+	cpu = (cpu_state_t const *)&state.state[state.tags.cpu];
+	pc = &state.state[state.tags.pc];
+	if (cpu->A != CPU_regA || cpu->S != CPU_regS || cpu->X != CPU_regX || cpu->Y != CPU_regY) {
+		printf("tags: cpu does not hold the registers\n");
+		ok = FALSE;
+	}
+	if ((pc[0] | (pc[1] << 8)) != CPU_regPC) {
+		printf("tags: pc holds %04x instead of %04x\n", pc[0] | (pc[1] << 8), CPU_regPC);
+		ok = FALSE;
+	}
+	if (ok)
+		printf("tags: OK\n");
+	return ok;
+}
+
+static int TestRestore(void)
+{
+	int frame;
+
+	if (!libatari800_get_current_state(&state)) {
+		printf("restore: the state was not saved\n");
+		return FALSE;
+	}
+	frame = libatari800_get_frame_number();
+	RunFrames(N_FRAMES);
+	memcpy(ram, libatari800_get_main_memory_ptr(), sizeof(ram));
+	memcpy(screen, libatari800_get_screen_ptr(), sizeof(screen));
+
+	if (!libatari800_restore_state(&state)) {
+		printf("restore: the state was not restored\n");
+		return FALSE;
+	}
+	if (libatari800_get_frame_number() != frame) {
+		printf("restore: frame %d instead of %d\n", libatari800_get_frame_number(), frame);
+		return FALSE;
+	}
+	RunFrames(N_FRAMES);
+	if (memcmp(ram, libatari800_get_main_memory_ptr(), sizeof(ram)) != 0
+	 || memcmp(screen, libatari800_get_screen_ptr(), sizeof(screen)) != 0) {
+		printf("restore: the machine differs %d frames after the restore\n", N_FRAMES);
+		return FALSE;
+	}
+	printf("restore: OK\n");
+	return TRUE;
+}
+
+/* Adds a section that no reader knows, compressed with a method that does
+   not exist, and checks that the state is still read. */
+static int TestUnknownSection(void)
+{
+	static const UBYTE unknown[] = {
+		'N', 'E', 'W', ' ', 7, 4, 0, 0, 0, 3, 0, 0, 0, 0x55, 0xaa, 0x55
+	};
+	UBYTE *buffer;
+	UBYTE *extended;
+	ULONG len;
+	int ok;
+
+	buffer = libatari800_save_state(LIBATARI800_STATE_COMPRESS_LZ, &len);
+	if (buffer == NULL) {
+		printf("unknown section: the state was not saved\n");
+		return FALSE;
+	}
+	/* The state ends with the 13 byte header of the "END " section. */
+	extended = (UBYTE *)malloc(len + sizeof(unknown));
+	memcpy(extended, buffer, len - 13);
+	memcpy(extended + len - 13, unknown, sizeof(unknown));
+	memcpy(extended + len - 13 + sizeof(unknown), buffer + len - 13, 13);
+	ok = libatari800_load_state(extended, len + sizeof(unknown));
+	free(extended);
+	libatari800_free_state(buffer);
+	printf(ok ? "unknown section: OK\n" : "unknown section: the state was not read\n");
+	return ok;
+}
+
+int main(void)
+{
+	static char *argv[] = { "atari800", "-xe", NULL };
+	int ok = TRUE;
+
+	if (!libatari800_init(2, argv)) {
+		printf("Cannot start the emulator: %s\n", libatari800_error_message());
+		return 1;
+	}
+	RunFrames(50);
+	ok &= TestTags();
+	ok &= TestRestore();
+	ok &= TestUnknownSection();
+	libatari800_exit();
+	return ok ? 0 : 1;
+}
@@ -23,14 +23,353 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include "config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
+#include "atari.h"
+#include "blit.h"
+#include "colours.h"
+#include "perfstat.h"
 #include "platform.h"
 #include "screen.h"
+#include "util.h"
+#include "libatari800/libatari800.h"
+#include "libatari800/observation.h"
 #include "libatari800/video.h"
 
-void PLATFORM_DisplayScreen(void){
+/* Frame export. Each frame is rendered into a caller's buffer that holds
+   neither the latest frame nor a frame locked by the caller, so with three
+   buffers the emulation never waits for the consumer. The mutex only guards
+   the choice of buffers, not the rendering. */
+
+static frame_buffers_t config;
+static int enabled = FALSE;
+static int out_width;
+static int out_height;
+static int bytes_per_pixel;
+
+/* Buffer with the latest complete frame, or -1. */
+static int latest = -1;
+static int locked[3];
+static int frame_number[3];
+static int dropped;
+
+/* Screen_TrackLines() stamp of each buffer's contents, 0 if unknown. */
+static ULONG stamp[3];
+
+/* The palette in the output format, rebuilt when Colours_table changes. */
+static int palette[256];
+static ULONG rgba[256];
+static UBYTE rgb[256][3];
+static UBYTE gray[256];
+
+/* Channel sums of a row of output pixels while downscaling. */
+static unsigned int *sums = NULL;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t frame_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK() pthread_mutex_lock(&frame_mutex)
+#define UNLOCK() pthread_mutex_unlock(&frame_mutex)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+/* Returns TRUE if the palette changed since the last call. */
+static int UpdatePalette(void)
+{
+	int i;
+	if (memcmp(palette, Colours_table, sizeof(palette)) == 0)
+		return FALSE;
+	memcpy(palette, Colours_table, sizeof(palette));
+	for (i = 0; i < 256; i++) {
+		UBYTE pixel[4];
+		pixel[0] = rgb[i][0] = Colours_GetR(i);
+		pixel[1] = rgb[i][1] = Colours_GetG(i);
+		pixel[2] = rgb[i][2] = Colours_GetB(i);
+		pixel[3] = 0xff;
+		/* In memory order, whatever the host's byte order. */
+		memcpy(&rgba[i], pixel, 4);
+		gray[i] = (UBYTE) ((299 * pixel[0] + 587 * pixel[1] + 114 * pixel[2] + 500) / 1000);
+	}
+	return TRUE;
+}
+
+/* Renders Screen_atari rows SRC_Y to SRC_Y + config.downscale - 1 as one row
+   of output pixels at DEST. */
+static void RenderRow(UBYTE *dest, int src_y)
+{
+	UBYTE const *src = (UBYTE const *) Screen_atari + src_y * Screen_WIDTH + config.x;
+	int n = config.downscale;
+	int x;
+
+	if (n == 1) {
+		switch (config.format) {
+		case LIBATARI800_FRAME_GRAY8:
+			for (x = 0; x < out_width; x++)
+				dest[x] = gray[src[x]];
+			break;
+		case LIBATARI800_FRAME_RGB24:
+			for (x = 0; x < out_width; x++) {
+				dest[0] = rgb[src[x]][0];
+				dest[1] = rgb[src[x]][1];
+				dest[2] = rgb[src[x]][2];
+				dest += 3;
+			}
+			break;
+		default:
+			if (((size_t) dest & 3) == 0)
+				BLIT_Expand32((ULONG *) dest, src, out_width, rgba);
+			else
+				for (x = 0; x < out_width; x++)
+					memcpy(dest + 4 * x, &rgba[src[x]], 4);
+			break;
+		}
+	}
+	else {
+		/* Average each N x N block. */
+		int channels = config.format == LIBATARI800_FRAME_GRAY8 ? 1 : 3;
+		int size = out_width * channels;
+		int area = n * n;
+		int i;
+		int j;
+		memset(sums, 0, size * sizeof(*sums));
+		for (i = 0; i < n; i++) {
+			UBYTE const *s = src + i * Screen_WIDTH;
+			unsigned int *sum = sums;
+			for (x = 0; x < out_width; x++) {
+				for (j = 0; j < n; j++) {
+					if (channels == 1)
+						sum[0] += gray[s[j]];
+					else {
+						sum[0] += rgb[s[j]][0];
+						sum[1] += rgb[s[j]][1];
+						sum[2] += rgb[s[j]][2];
+					}
+				}
+				s += n;
+				sum += channels;
+			}
+		}
+		for (x = 0; x < out_width; x++) {
+			for (j = 0; j < channels; j++)
+				*dest++ = (UBYTE) ((sums[x * channels + j] + area / 2) / area);
+			if (config.format == LIBATARI800_FRAME_RGBA32)
+				*dest++ = 0xff;
+		}
+	}
+}
+
+/* Renders the screen into buffer INDEX, skipping the rows that did not
+   change since it was last rendered there. */
+static void Render(int index)
+{
+	UBYTE *dest = config.buffers[index];
+	ULONG since;
+	ULONG now = Screen_TrackLines();
+	int y;
+	int i;
+
+	if (UpdatePalette())
+		memset(stamp, 0, sizeof(stamp));
+	since = stamp[index];
+	for (y = 0; y < out_height; y++) {
+		int src_y = config.y + y * config.downscale;
+		for (i = 0; i < config.downscale; i++)
+			if (since == 0 || Screen_LineChanged(src_y + i, since))
+				break;
+		if (i < config.downscale)
+			RenderRow(dest, src_y);
+		dest += config.pitch;
+	}
+	stamp[index] = now;
+}
+
+void PLATFORM_DisplayScreen(void)
+{
+	int index;
+
+	LIBATARI800_Observation_Frame();
+	if (!enabled)
+		return;
+	LOCK();
+	for (index = 0; index < config.num_buffers; index++)
+		if (index != latest && !locked[index])
+			break;
+	if (index == config.num_buffers) {
+		/* The only buffer not locked holds the latest frame, which is
+		   replaced. */
+		if (latest >= 0 && !locked[latest]) {
+			index = latest;
+			latest = -1;
+		}
+		else {
+			dropped++;
+			UNLOCK();
+			return;
+		}
+	}
+	UNLOCK();
+
+	PERFSTAT_ENTER(PERFSTAT_BLIT);
+	Render(index);
+	PERFSTAT_LEAVE();
+
+	LOCK();
+	frame_number[index] = Atari800_nframes;
+	latest = index;
+	UNLOCK();
+}
+
+
+/** Render frames into caller buffers
+ *
+ * After each emulated frame, the screen is converted to the chosen format and
+ * written to one of the buffers given in \a buffers, so it need not be read
+ * and converted from \a libatari800_get_screen_ptr. With two or three
+ * buffers another thread can read a frame, locked with
+ * \a libatari800_lock_frame, while the next frames are emulated. With three
+ * buffers no frame is dropped while one is locked.
+ *
+ * The fields of \a buffers are:
+ *
+ * - format: LIBATARI800_FRAME_GRAY8 (1 byte per pixel),
+ *   LIBATARI800_FRAME_RGB24 (3 bytes in R, G, B order) or
+ *   LIBATARI800_FRAME_RGBA32 (4 bytes in R, G, B, A order)
+ * - x, y, width, height: area of the 384x240 screen to render; if width is 0
+ *   the whole screen is rendered
+ * - downscale: 1 (or 0) for the full resolution, or N to average each N x N block of
+ *   pixels into one
+ * - pitch: bytes from one row of a buffer to the next, or 0 for
+ *   width / downscale pixels
+ * - num_buffers, buffers: 1 to 3 buffers of height / downscale * pitch bytes
+ *
+ * Must be called from the thread that runs the emulation.
+ *
+ * @param buffers buffers and format, or NULL to stop rendering
+ *
+ * @retval FALSE if the configuration is invalid; rendering is stopped
+ * @retval TRUE if successful
+ */
+int libatari800_set_frame_buffers(const frame_buffers_t *buffers)
+{
+	int i;
+
+	LOCK();
+	enabled = FALSE;
+	latest = -1;
+	memset(locked, 0, sizeof(locked));
+	memset(stamp, 0, sizeof(stamp));
+	dropped = 0;
+	UNLOCK();
+	if (buffers == NULL)
+		return TRUE;
+
+	config = *buffers;
+	if (config.width == 0) {
+		config.x = 0;
+		config.y = 0;
+		config.width = Screen_WIDTH;
+		config.height = Screen_HEIGHT;
+	}
+	if (config.downscale == 0)
+		config.downscale = 1;
+	switch (config.format) {
+	case LIBATARI800_FRAME_GRAY8:
+		bytes_per_pixel = 1;
+		break;
+	case LIBATARI800_FRAME_RGB24:
+		bytes_per_pixel = 3;
+		break;
+	case LIBATARI800_FRAME_RGBA32:
+		bytes_per_pixel = 4;
+		break;
+	default:
+		return FALSE;
+	}
+	if (config.downscale < 1 || config.downscale > 16
+	 || config.x < 0 || config.y < 0
+	 || config.width < config.downscale || config.height < config.downscale
+	 || config.x + config.width > Screen_WIDTH || config.y + config.height > Screen_HEIGHT
+	 || config.num_buffers < 1 || config.num_buffers > 3)
+		return FALSE;
+	out_width = config.width / config.downscale;
+	out_height = config.height / config.downscale;
+	if (config.pitch == 0)
+		config.pitch = out_width * bytes_per_pixel;
+	else if (config.pitch < out_width * bytes_per_pixel)
+		return FALSE;
+	for (i = 0; i < config.num_buffers; i++)
+		if (config.buffers[i] == NULL)
+			return FALSE;
+
+	if (config.downscale > 1)
+		sums = (unsigned int *) Util_realloc(sums, out_width * 3 * sizeof(*sums));
+	/* Force a rebuild. */
+	palette[0] = ~Colours_table[0];
+	enabled = TRUE;
+	return TRUE;
+}
+
+
+/** Lock the latest frame rendered into the caller buffers
+ *
+ * The locked buffer is not written until it is unlocked with
+ * \a libatari800_unlock_frame. May be called from any thread. A buffer can be
+ * locked more than once, and must then be unlocked as many times.
+ *
+ * @param number if not NULL, receives the number of the frame (as
+ * returned by \a libatari800_get_frame_number) held by the buffer
+ *
+ * @returns the index of the buffer in \a frame_buffers_t, or -1 if no frame
+ * has been rendered yet
+ */
+int libatari800_lock_frame(int *number)
+{
+	int index;
+
+	LOCK();
+	index = latest;
+	if (index >= 0) {
+		locked[index]++;
+		if (number != NULL)
+			*number = frame_number[index];
+	}
+	UNLOCK();
+	return index;
+}
+
+
+/** Unlock a buffer locked with \a libatari800_lock_frame
+ *
+ * @param index the index returned by \a libatari800_lock_frame
+ */
+void libatari800_unlock_frame(int index)
+{
+	LOCK();
+	if (index >= 0 && index < 3 && locked[index] > 0)
+		locked[index]--;
+	UNLOCK();
+}
+
+
+/** Return the number of frames not rendered because all buffers were locked
+ *
+ * @returns number of frames dropped since \a libatari800_set_frame_buffers
+ */
+int libatari800_get_dropped_frames(void)
+{
+	int count;
+
+	LOCK();
+	count = dropped;
+	UNLOCK();
+	return count;
 }
 
 int LIBATARI800_Video_Initialise(int *argc, char *argv[]) {
@@ -38,4 +377,7 @@ int LIBATARI800_Video_Initialise(int *argc, char *argv[]) {
 }
 
 void LIBATARI800_Video_Exit(void) {
+	libatari800_set_frame_buffers(NULL);
+	free(sums);
+	sums = NULL;
 }
@@ -34,6 +34,7 @@
 #include "roms/altirra_5200_os.h"
 #include "esc.h"
 #include "gtia.h"
+#include "hwtrace.h"
 #include "log.h"
 #include "memory.h"
 #include "pbi.h"
@@ -74,6 +75,23 @@ map_save save_map[2] = {
 
 #endif /* PAGED_ATTRIB */
 
+#ifdef PAGED_MEM
+
+UBYTE *MEMORY_readpage[256];
+UBYTE *MEMORY_writepage[256];
+
+/* Writes to the pages of a mapped ROM bank end up here, so that they don't
+   modify the ROM image. */
+static UBYTE rom_write_sink[256];
+
+/* Bank of extended memory mapped at 0x4000-0x7fff for the CPU (0 = base RAM). */
+static int xe_cpu_bank = 0;
+
+/* TRUE if MapRAM is mapped at 0x5000-0x57ff. */
+static int mapram_enabled = FALSE;
+
+#endif /* PAGED_MEM */
+
 UBYTE MEMORY_basic[8192];
 UBYTE MEMORY_os[16384];
 UBYTE MEMORY_xegame[8192];
@@ -151,6 +169,106 @@ static void alloc_mosaic_memory(void){
 	}
 }
 
+#ifdef PAGED_MEM
+
+/* Maps pages FIRST..LAST to READ and WRITE, or to rom_write_sink if WRITE
+   is NULL. */
+static void map_pages(int first, int last, UBYTE *read, UBYTE *write)
+{
+	int i;
+	for (i = first; i <= last; i++) {
+		MEMORY_readpage[i] = read;
+		MEMORY_writepage[i] = write != NULL ? write : rom_write_sink;
+		read += 0x100;
+		if (write != NULL)
+			write += 0x100;
+	}
+}
+
+/* Maps pages FIRST..LAST back to MEMORY_mem. */
+static void map_flat(int first, int last)
+{
+	map_pages(first, last, MEMORY_mem + (first << 8), MEMORY_mem + (first << 8));
+}
+
+/* Returns TRUE if page PAGE is RAM. */
+static int page_is_ram(int page)
+{
+#ifndef PAGED_ATTRIB
+	return MEMORY_attrib[page << 8] == MEMORY_RAM;
+#else
+	return MEMORY_writemap[page] == NULL;
+#endif
+}
+
+#endif /* PAGED_MEM */
+
+/* Returns a pointer to the 16 KB of XE bank BANK (0 = base RAM) which is
+   not mapped for the CPU. */
+static UBYTE *xe_bank_ptr(int bank)
+{
+#ifdef PAGED_MEM
+	if (bank == 0)
+		return MEMORY_mem + 0x4000;
+#endif
+	return atarixe_memory + (bank << 14);
+}
+
+#ifdef PAGED_MEM
+
+/* Returns a pointer to the RAM that the CPU sees in 0x4000-0x7fff of an
+   XL/XE, not counting Self Test and MapRAM. */
+static UBYTE *xe_window_ptr(void)
+{
+	return MEMORY_ram_size > 64 ? xe_bank_ptr(xe_cpu_bank) : MEMORY_mem + 0x4000;
+}
+
+/* Maps the XE bank, Self Test ROM and MapRAM in 0x4000-0x7fff of an XL/XE. */
+static void map_xe_window(void)
+{
+	UBYTE *ram = xe_window_ptr();
+	map_pages(0x40, 0x7f, ram, ram);
+	if (MEMORY_selftest_enabled)
+		map_pages(0x50, 0x57, MEMORY_os + 0x1000, NULL);
+	else if (mapram_enabled)
+		map_pages(0x50, 0x57, mapram_memory, mapram_memory);
+}
+
+/* Brings MEMORY_mem and the buffers of hidden memory to what they would
+   hold in the flat memory model: the content of all mapped pages is copied
+   to MEMORY_mem, after saving the memory they hide. */
+static void flatten_pages(void)
+{
+	int i;
+	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
+		if (MEMORY_ram_size > 64 && xe_cpu_bank != 0)
+			memcpy(atarixe_memory, MEMORY_mem + 0x4000, 0x4000);
+		if ((MEMORY_selftest_enabled || mapram_enabled) && MEMORY_ram_size > 20)
+			memcpy(under_atarixl_os + 0x1000, xe_window_ptr() + 0x1000, 0x800);
+	}
+	for (i = 0; i < 256; i++)
+		if (MEMORY_readpage[i] != MEMORY_mem + (i << 8))
+			memcpy(MEMORY_mem + (i << 8), MEMORY_readpage[i], 0x100);
+}
+
+/* The reverse of flatten_pages(): moves the content of MEMORY_mem to the
+   mapped RAM pages, and the hidden memory back to where it's mapped. */
+static void unflatten_pages(void)
+{
+	int i;
+	for (i = 0; i < 256; i++)
+		if (MEMORY_readpage[i] != MEMORY_mem + (i << 8) && MEMORY_writepage[i] == MEMORY_readpage[i])
+			memcpy(MEMORY_readpage[i], MEMORY_mem + (i << 8), 0x100);
+	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
+		if (MEMORY_ram_size > 64 && xe_cpu_bank != 0)
+			memcpy(MEMORY_mem + 0x4000, atarixe_memory, 0x4000);
+		if ((MEMORY_selftest_enabled || mapram_enabled) && MEMORY_ram_size > 20)
+			memcpy(xe_window_ptr() + 0x1000, under_atarixl_os + 0x1000, 0x800);
+	}
+}
+
+#endif /* PAGED_MEM */
+
 static void AllocXEMemory(void)
 {
 	if (MEMORY_ram_size > 64) {
@@ -203,6 +321,11 @@ void MEMORY_InitialiseMachine(void)
 	ANTIC_xe_ptr = NULL;
 	cart809F_enabled = FALSE;
 	MEMORY_cartA0BF_enabled = FALSE;
+#ifdef PAGED_MEM
+	map_flat(0x00, 0xff);
+	xe_cpu_bank = 0;
+	mapram_enabled = FALSE;
+#endif
 	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
 		GTIA_TRIG[3] = 0;
 		if (GTIA_GRACTL & 4)
@@ -279,7 +402,8 @@ void MEMORY_InitialiseMachine(void)
 			int const hole_start = base_ram > hole_end ? hole_end : base_ram;
 			ESC_PatchOS();
 			MEMORY_dFillMem(0x0000, 0x00, hole_start);
-			MEMORY_SetRAM(0x0000, hole_start - 1);
+			if (hole_start > 0)
+				MEMORY_SetRAM(0x0000, hole_start - 1);
 			if (hole_start < hole_end) {
 				MEMORY_dFillMem(hole_start, 0xff, hole_end - hole_start);
 				MEMORY_SetROM(hole_start, hole_end - 1);
@@ -333,6 +457,10 @@ void MEMORY_InitialiseMachine(void)
 	alloc_mosaic_memory();
 	axlon_curbank = 0;
 	mosaic_curbank = 0x3f;
+#ifdef PAGED_MEM
+	if (axlon_ram != NULL)
+		map_pages(0x40, 0x7f, axlon_ram, axlon_ram);
+#endif
 	AllocMapRAM();
 	Atari800_Coldstart();
 }
@@ -344,6 +472,11 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 	int temp;
 	UBYTE byte;
 
+#ifdef PAGED_MEM
+	/* Save the memory as in the flat memory model. */
+	flatten_pages();
+#endif
+
 	/* Axlon/Mosaic for 400/800 */
 	if (Atari800_machine_type == Atari800_MACHINE_800) {
 		StateSav_SaveINT(&MEMORY_axlon_num_banks, 1);
@@ -435,13 +568,16 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 			StateSav_SaveUBYTE( mapram_memory, 0x800 );
 		}
 	}
+#ifdef PAGED_MEM
+	unflatten_pages();
+#endif
 }
 
 void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 {
 	int base_ram_kb;
 	int num_xe_banks;
-	UBYTE portb;
+	UBYTE portb = PIA_PORTB | PIA_PORTB_mask;
 
 	/* Axlon/Mosaic for 400/800 */
 	if (Atari800_machine_type == Atari800_MACHINE_800 && StateVersion >= 5) {
@@ -657,10 +793,10 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 		if (StateVersion >= 7 && (MEMORY_ram_size == 128 || MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP)) {
 			switch (portb & 0x30) {
 			case 0x20:	/* ANTIC: base, CPU: extended */
-				ANTIC_xe_ptr = atarixe_memory;
+				ANTIC_xe_ptr = xe_bank_ptr(0);
 				break;
 			case 0x10:	/* ANTIC: extended, CPU: base */
-				ANTIC_xe_ptr = atarixe_memory + (MEMORY_xe_bank << 14);
+				ANTIC_xe_ptr = xe_bank_ptr(MEMORY_xe_bank);
 				break;
 			default:	/* ANTIC same as CPU */
 				ANTIC_xe_ptr = NULL;
@@ -682,6 +818,25 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 			StateSav_ReadUBYTE(mapram_memory, 0x800);
 		}
 	}
+
+#ifdef PAGED_MEM
+	/* Map the banks selected in the state, and move the memory read in the
+	   flat memory model to them. */
+	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
+		xe_cpu_bank = MEMORY_ram_size > 64 && (portb & 0x10) == 0 ? MEMORY_xe_bank : 0;
+		mapram_enabled = mapram_memory != NULL && MEMORY_ram_size > 20 && (portb & 0xb1) == 0x30;
+		map_xe_window();
+	}
+	else if (Atari800_machine_type == Atari800_MACHINE_800) {
+		if (axlon_ram != NULL)
+			map_pages(0x40, 0x7f, axlon_ram + axlon_curbank * 0x4000, axlon_ram + axlon_curbank * 0x4000);
+		if (mosaic_ram != NULL && mosaic_curbank < mosaic_current_num_banks)
+			map_pages(0xc0, 0xcf, mosaic_ram + mosaic_curbank * 0x1000, mosaic_ram + mosaic_curbank * 0x1000);
+		else
+			map_flat(0xc0, 0xcf);
+	}
+	unflatten_pages();
+#endif
 }
 
 #endif /* BASIC */
@@ -703,6 +858,74 @@ void MEMORY_CopyToMem(const UBYTE *from, UWORD to, int size)
 	}
 }
 
+#ifdef PAGED_MEM
+
+void MEMORY_PagedCopyFromMem(UWORD from, UBYTE *to, int size)
+{
+	while (size > 0) {
+		int n = 0x100 - (from & 0xff);
+		if (n > size)
+			n = size;
+		memcpy(to, MEMORY_readpage[from >> 8] + (from & 0xff), n);
+		to += n;
+		from = (UWORD) (from + n);
+		size -= n;
+	}
+}
+
+void MEMORY_PagedCopyToMem(const UBYTE *from, UWORD to, int size)
+{
+	while (size > 0) {
+		int n = 0x100 - (to & 0xff);
+		if (n > size)
+			n = size;
+		memcpy(MEMORY_writepage[to >> 8] + (to & 0xff), from, n);
+		from += n;
+		to = (UWORD) (to + n);
+		size -= n;
+	}
+}
+
+void MEMORY_PagedFillMem(UWORD addr1, UBYTE value, int length)
+{
+	while (length > 0) {
+		int n = 0x100 - (addr1 & 0xff);
+		if (n > length)
+			n = length;
+		memset(MEMORY_writepage[addr1 >> 8] + (addr1 & 0xff), value, n);
+		addr1 = (UWORD) (addr1 + n);
+		length -= n;
+	}
+}
+
+void MEMORY_CopyFromCart(UWORD addr1, UWORD addr2, UBYTE *src)
+{
+	int i;
+	for (i = addr1 >> 8; i <= addr2 >> 8; i++) {
+		MEMORY_readpage[i] = src;
+		MEMORY_writepage[i] = page_is_ram(i) ? src : rom_write_sink;
+		src += 0x100;
+	}
+}
+
+void MEMORY_CopyToCart(UWORD addr1, UWORD addr2, UBYTE *dst)
+{
+	int i;
+	for (i = addr1 >> 8; i <= addr2 >> 8; i++) {
+		if (MEMORY_readpage[i] != dst)
+			memcpy(dst, MEMORY_readpage[i], 0x100);
+		dst += 0x100;
+	}
+}
+
+void MEMORY_FillCart(UWORD addr1, UWORD addr2, UBYTE value)
+{
+	map_flat(addr1 >> 8, addr2 >> 8);
+	memset(MEMORY_mem + addr1, value, addr2 - addr1 + 1);
+}
+
+#endif /* PAGED_MEM */
+
 
 /* Returns NULL if both builtin BASIC and XEGS game are disabled.
    Otherwise returns a pointer to an 8KB array containing either
@@ -727,6 +950,30 @@ static UBYTE const * builtin_cart(UBYTE portb)
 	return NULL;
 }
 
+/* Disables Self Test ROM in 0x5000-0x57ff, also in XE bank ANTIC_BANK
+   accessed by ANTIC. */
+static void disable_selftest(int antic_bank)
+{
+	MEMORY_selftest_enabled = FALSE;
+	if (MEMORY_ram_size > 20) {
+#ifdef PAGED_MEM
+		map_xe_window();
+#else
+		memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+#endif
+		if (ANTIC_xe_ptr != NULL)
+			/* Also disable Self Test from XE bank accessed by ANTIC. */
+			memcpy(xe_bank_ptr(antic_bank) + 0x1000, antic_bank_under_selftest, 0x800);
+		MEMORY_SetRAM(0x5000, 0x57ff);
+	}
+	else {
+#ifdef PAGED_MEM
+		map_xe_window();
+#endif
+		MEMORY_dFillMem(0x5000, 0xff, 0x800);
+	}
+}
+
 /* Note: this function is only for XL/XE! */
 void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 {
@@ -743,8 +990,13 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 
 	if (mapram_selected && !new_mapram_selected) {
 		/* Restore RAM hidden by MapRAM. */
+#ifdef PAGED_MEM
+		mapram_enabled = FALSE;
+		map_xe_window();
+#else
 		memcpy(mapram_memory, MEMORY_mem + 0x5000, 0x800);
 		memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+#endif
 	}
 
 	/* Switch XE memory bank in 0x4000-0x7fff */
@@ -783,22 +1035,20 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		if (MEMORY_selftest_enabled
 		    && (cpu_bank != new_cpu_bank
 		        || antic_bank != new_antic_bank
-		        || (MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP && (byte & 0x20) == 0))) {
-			/* Disable Self Test ROM */
-			memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-			if (ANTIC_xe_ptr != NULL)
-				/* Also disable Self Test from XE bank accessed by ANTIC. */
-				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
-			MEMORY_SetRAM(0x5000, 0x57ff);
-			MEMORY_selftest_enabled = FALSE;
-		}
+		        || (MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP && (byte & 0x20) == 0)))
+			disable_selftest(antic_bank);
 		if (cpu_bank != new_cpu_bank) {
+#ifdef PAGED_MEM
+			xe_cpu_bank = new_cpu_bank;
+			map_xe_window();
+#else
 			memcpy(atarixe_memory + (cpu_bank << 14), MEMORY_mem + 0x4000, 0x4000);
 			memcpy(MEMORY_mem + 0x4000, atarixe_memory + (new_cpu_bank << 14), 0x4000);
+#endif
 		}
 
 		if (MEMORY_ram_size == 128 || MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP)
-			ANTIC_xe_ptr = new_antic_bank == new_cpu_bank ? NULL : atarixe_memory + (new_antic_bank << 14);
+			ANTIC_xe_ptr = new_antic_bank == new_cpu_bank ? NULL : xe_bank_ptr(new_antic_bank);
 
 		MEMORY_xe_bank = bank;
 		antic_bank = new_antic_bank;
@@ -830,18 +1080,8 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 				MEMORY_dFillMem(0xd800, 0xff, 0x2800);
 			}
 			/* When OS ROM is disabled we also have to disable Self Test - Jindroush */
-			if (MEMORY_selftest_enabled) {
-				if (MEMORY_ram_size > 20) {
-					memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-					if (ANTIC_xe_ptr != NULL)
-						/* Also disable Self Test from XE bank accessed by ANTIC. */
-						memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
-					MEMORY_SetRAM(0x5000, 0x57ff);
-				}
-				else
-					MEMORY_dFillMem(0x5000, 0xff, 0x800);
-				MEMORY_selftest_enabled = FALSE;
-			}
+			if (MEMORY_selftest_enabled)
+				disable_selftest(antic_bank);
 		}
 	}
 
@@ -869,19 +1109,9 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 
 	/* Enable/disable Self Test ROM in 0x5000-0x57ff */
 	if (byte & 0x80) {
-		if (MEMORY_selftest_enabled) {
+		if (MEMORY_selftest_enabled)
 			/* Disable Self Test ROM */
-			if (MEMORY_ram_size > 20) {
-				memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-				if (ANTIC_xe_ptr != NULL)
-					/* Also disable Self Test from XE bank accessed by ANTIC. */
-					memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
-				MEMORY_SetRAM(0x5000, 0x57ff);
-			}
-			else
-				MEMORY_dFillMem(0x5000, 0xff, 0x800);
-			MEMORY_selftest_enabled = FALSE;
-		}
+			disable_selftest(antic_bank);
 	}
 	else {
 		/* We can enable Self Test only if the OS ROM is enabled */
@@ -892,22 +1122,34 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		&& !((byte & 0x10) == 0 && MEMORY_ram_size == 1088)) {
 			/* Enable Self Test ROM */
 			if (MEMORY_ram_size > 20) {
+#ifndef PAGED_MEM
 				memcpy(under_atarixl_os + 0x1000, MEMORY_mem + 0x5000, 0x800);
+#endif
 				if (ANTIC_xe_ptr != NULL)
 					/* Also backup RAM under Self Test from XE bank accessed by ANTIC. */
-					memcpy(antic_bank_under_selftest, atarixe_memory + (antic_bank << 14) + 0x1000, 0x800);
+					memcpy(antic_bank_under_selftest, xe_bank_ptr(antic_bank) + 0x1000, 0x800);
 				MEMORY_SetROM(0x5000, 0x57ff);
 			}
+#ifndef PAGED_MEM
 			memcpy(MEMORY_mem + 0x5000, MEMORY_os + 0x1000, 0x800);
+#endif
 			if (ANTIC_xe_ptr != NULL)
 				/* Also enable Self Test in the XE bank accessed by ANTIC. */
-				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, MEMORY_os + 0x1000, 0x800);
+				memcpy(xe_bank_ptr(antic_bank) + 0x1000, MEMORY_os + 0x1000, 0x800);
 			MEMORY_selftest_enabled = TRUE;
+#ifdef PAGED_MEM
+			map_xe_window();
+#endif
 		}
 		else if (!mapram_selected && new_mapram_selected) {
 			/* Enable MapRAM */
+#ifdef PAGED_MEM
+			mapram_enabled = TRUE;
+			map_xe_window();
+#else
 			memcpy(under_atarixl_os + 0x1000, MEMORY_mem + 0x5000, 0x800);
 			memcpy(MEMORY_mem + 0x5000, mapram_memory, 0x800);
+#endif
 		}
 	}
 }
@@ -931,19 +1173,31 @@ static void MosaicPutByte(UWORD addr, UBYTE byte)
 	if (newbank == mosaic_curbank || (newbank >= mosaic_current_num_banks && mosaic_curbank >= mosaic_current_num_banks)) return; /*same bank or rom -> rom*/
 	if (newbank >= mosaic_current_num_banks && mosaic_curbank < mosaic_current_num_banks) {
 		/*ram ->rom*/
+#ifdef PAGED_MEM
+		map_flat(0xc0, 0xcf);
+#else
 		memcpy(mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000,0x1000);
+#endif
 		MEMORY_dFillMem(0xc000, 0xff, 0x1000);
 		MEMORY_SetROM(0xc000, 0xcfff);
 	}
 	else if (newbank < mosaic_current_num_banks && mosaic_curbank >= mosaic_current_num_banks) {
 		/*rom->ram*/
+#ifdef PAGED_MEM
+		map_pages(0xc0, 0xcf, mosaic_ram + newbank*0x1000, mosaic_ram + newbank*0x1000);
+#else
 		memcpy(MEMORY_mem + 0xc000, mosaic_ram+newbank*0x1000,0x1000);
+#endif
 		MEMORY_SetRAM(0xc000, 0xcfff);
 	}
 	else {
 		/*ram -> ram*/
+#ifdef PAGED_MEM
+		map_pages(0xc0, 0xcf, mosaic_ram + newbank*0x1000, mosaic_ram + newbank*0x1000);
+#else
 		memcpy(mosaic_ram + mosaic_curbank*0x1000, MEMORY_mem + 0xc000, 0x1000);
 		memcpy(MEMORY_mem + 0xc000, mosaic_ram + newbank*0x1000, 0x1000);
+#endif
 		MEMORY_SetRAM(0xc000, 0xcfff);
 	}
 	mosaic_curbank = newbank;
@@ -954,7 +1208,7 @@ static UBYTE MosaicGetByte(UWORD addr, int no_side_effects)
 #ifdef DEBUG
 	Log_print("MosaicGetByte%4X",addr);
 #endif
-	return MEMORY_mem[addr];
+	return MEMORY_dGetByte(addr);
 }
 
 /* Axlon banking scheme: writing <n> to 0xcfc0-0xcfff selects a bank.  The Axlon
@@ -972,15 +1226,19 @@ static void AxlonPutByte(UWORD addr, UBYTE byte)
 {
 	int newbank;
 	/*Write-through to RAM if it is the page 0x0f shadow*/
-	if ((addr&0xff00) == 0x0f00) MEMORY_mem[addr] = byte;
+	if ((addr&0xff00) == 0x0f00) MEMORY_dPutByte(addr, byte);
 	if ((addr&0xff) < 0xc0) return; /*0xffc0-0xffff and 0x0fc0-0x0fff only*/
 #ifdef DEBUG
 	Log_print("AxlonPutByte:%4X:%2X", addr, byte);
 #endif
 	newbank = (byte&axlon_current_bankmask);
 	if (newbank == axlon_curbank) return;
+#ifdef PAGED_MEM
+	map_pages(0x40, 0x7f, axlon_ram + newbank*0x4000, axlon_ram + newbank*0x4000);
+#else
 	memcpy(axlon_ram + axlon_curbank*0x4000, MEMORY_mem + 0x4000, 0x4000);
 	memcpy(MEMORY_mem + 0x4000, axlon_ram + newbank*0x4000, 0x4000);
+#endif
 	axlon_curbank = newbank;
 }
 
@@ -989,12 +1247,15 @@ static UBYTE AxlonGetByte(UWORD addr, int no_side_effects)
 #ifdef DEBUG
 	Log_print("AxlonGetByte%4X",addr);
 #endif
-	return MEMORY_mem[addr];
+	return MEMORY_dGetByte(addr);
 }
 
 void MEMORY_Cart809fDisable(void)
 {
 	if (cart809F_enabled) {
+#ifdef PAGED_MEM
+		map_flat(0x80, 0x9f);
+#endif
 		if (MEMORY_ram_size > 32) {
 			memcpy(MEMORY_mem + 0x8000, under_cart809F, 0x2000);
 			MEMORY_SetRAM(0x8000, 0x9fff);
@@ -1022,6 +1283,9 @@ void MEMORY_CartA0bfDisable(void)
 		/* No BASIC if not XL/XE or bit 1 of PORTB set */
 		/* or accessing extended 576K or 1088K memory */
 		UBYTE const *builtin = builtin_cart(PIA_PORTB | PIA_PORTB_mask);
+#ifdef PAGED_MEM
+		map_flat(0xa0, 0xbf);
+#endif
 		if (builtin == NULL) { /* switch RAM in */
 			if (MEMORY_ram_size > 40) {
 				memcpy(MEMORY_mem + 0xa000, under_cartA0BF, 0x2000);
@@ -1065,7 +1329,6 @@ void MEMORY_GetCharset(UBYTE *cs)
 	memcpy(cs + 0x300, ROM_altirra_5200_os + 0x300, 0x100); /* lowercase letters */
 }
 
-#ifndef PAGED_MEM
 UBYTE MEMORY_HwGetByte(UWORD addr, int no_side_effects)
 {
 	UBYTE byte = 0xff;
@@ -1149,6 +1412,7 @@ UBYTE MEMORY_HwGetByte(UWORD addr, int no_side_effects)
 
 void MEMORY_HwPutByte(UWORD addr, UBYTE byte)
 {
+	HWTRACE_EVENT(HWTRACE_WRITE, addr | (ULONG) byte << 16);
 	switch (addr & 0xff00) {
 	case 0x4f00:
 	case 0x8f00:
@@ -1224,4 +1488,3 @@ void MEMORY_HwPutByte(UWORD addr, UBYTE byte)
 		break;
 	}
 }
-#endif /* PAGED_MEM */
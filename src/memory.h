@@ -6,6 +6,42 @@
 
 #include "atari.h"
 
+#ifdef PAGED_MEM
+
+/* Paged memory: each 256-byte page of the CPU address space is read from
+   MEMORY_readpage[page] and written to MEMORY_writepage[page]. Pages point
+   into MEMORY_mem unless a bank is mapped there: switching an XE, Axlon or
+   Mosaic bank, Self Test, MapRAM or a cartridge bank only repoints pages,
+   instead of copying the bank in and out of MEMORY_mem. */
+extern UBYTE *MEMORY_readpage[256];
+extern UBYTE *MEMORY_writepage[256];
+
+static inline UBYTE MEMORY_PagedGetByte(UWORD addr)
+{
+	return MEMORY_readpage[addr >> 8][addr & 0xff];
+}
+
+static inline void MEMORY_PagedPutByte(UWORD addr, UBYTE byte)
+{
+	MEMORY_writepage[addr >> 8][addr & 0xff] = byte;
+}
+
+#define MEMORY_dGetByte(x)				MEMORY_PagedGetByte((UWORD) (x))
+#define MEMORY_dPutByte(x, y)			MEMORY_PagedPutByte((UWORD) (x), (UBYTE) (y))
+#define MEMORY_dGetWord(x)				(MEMORY_dGetByte(x) + (MEMORY_dGetByte((x) + 1) << 8))
+#define MEMORY_dPutWord(x, y)			(MEMORY_dPutByte(x, y), MEMORY_dPutByte((x) + 1, (y) >> 8))
+#define MEMORY_dGetWordAligned(x)		MEMORY_dGetWord(x)
+#define MEMORY_dPutWordAligned(x, y)	MEMORY_dPutWord(x, y)
+
+#define MEMORY_dCopyFromMem(from, to, size)	MEMORY_PagedCopyFromMem(from, to, size)
+#define MEMORY_dCopyToMem(from, to, size)		MEMORY_PagedCopyToMem(from, to, size)
+#define MEMORY_dFillMem(addr1, value, length)	MEMORY_PagedFillMem(addr1, value, length)
+void MEMORY_PagedCopyFromMem(UWORD from, UBYTE *to, int size);
+void MEMORY_PagedCopyToMem(const UBYTE *from, UWORD to, int size);
+void MEMORY_PagedFillMem(UWORD addr1, UBYTE value, int length);
+
+#else /* PAGED_MEM */
+
 #define MEMORY_dGetByte(x)				(MEMORY_mem[x])
 #define MEMORY_dPutByte(x, y)			(MEMORY_mem[x] = y)
 
@@ -35,6 +71,8 @@
 #define MEMORY_dCopyToMem(from, to, size)		memcpy(MEMORY_mem + (to), from, size)
 #define MEMORY_dFillMem(addr1, value, length)	memset(MEMORY_mem + (addr1), value, length)
 
+#endif /* PAGED_MEM */
+
 extern UBYTE MEMORY_mem[65536 + 2];
 
 /* RAM size in kilobytes.
@@ -55,10 +93,10 @@ extern int MEMORY_ram_size;
 extern UBYTE MEMORY_attrib[65536];
 /* Reads a byte from ADDR. Can potentially have side effects, when reading
    from hardware area. */
-#define MEMORY_GetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, FALSE) : MEMORY_mem[addr])
+#define MEMORY_GetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, FALSE) : MEMORY_dGetByte(addr))
 /* Reads a byte from ADDR, but without any side effects. */
-#define MEMORY_SafeGetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) MEMORY_mem[addr] = byte; else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
+#define MEMORY_SafeGetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, TRUE) : MEMORY_dGetByte(addr))
+#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) MEMORY_dPutByte(addr, byte); else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
 #define MEMORY_SetRAM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_RAM, (addr2) - (addr1) + 1)
 #define MEMORY_SetROM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_ROM, (addr2) - (addr1) + 1)
 #define MEMORY_SetHARDWARE(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_HARDWARE, (addr2) - (addr1) + 1)
@@ -73,10 +111,10 @@ extern MEMORY_wrfunc MEMORY_writemap[256];
 void MEMORY_ROM_PutByte(UWORD addr, UBYTE byte);
 /* Reads a byte from ADDR. Can potentially have side effects, when reading
    from hardware area. */
-#define MEMORY_GetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, FALSE) : MEMORY_mem[addr])
+#define MEMORY_GetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, FALSE) : MEMORY_dGetByte(addr))
 /* Reads a byte from ADDR, but without any side effects. */
-#define MEMORY_SafeGetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : (MEMORY_mem[addr] = byte))
+#define MEMORY_SafeGetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, TRUE) : MEMORY_dGetByte(addr))
+#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : (MEMORY_dPutByte(addr, byte), 0))
 #define MEMORY_SetRAM(addr1, addr2) do { \
 		int i; \
 		for (i = (addr1) >> 8; i <= (addr2) >> 8; i++) { \
@@ -116,8 +154,19 @@ void MEMORY_Cart809fDisable(void);
 void MEMORY_Cart809fEnable(void);
 void MEMORY_CartA0bfDisable(void);
 void MEMORY_CartA0bfEnable(void);
+#ifdef PAGED_MEM
+/* Maps the cartridge bank at SRC into pages ADDR1..ADDR2, writable if
+   they are RAM. */
+void MEMORY_CopyFromCart(UWORD addr1, UWORD addr2, UBYTE *src);
+/* Stores the cartridge RAM at ADDR1..ADDR2 in DST, if not mapped there. */
+void MEMORY_CopyToCart(UWORD addr1, UWORD addr2, UBYTE *dst);
+/* Fills ADDR1..ADDR2, where no cartridge bank is connected, with VALUE. */
+void MEMORY_FillCart(UWORD addr1, UWORD addr2, UBYTE value);
+#else
 #define MEMORY_CopyFromCart(addr1, addr2, src) memcpy(MEMORY_mem + (addr1), src, (addr2) - (addr1) + 1)
 #define MEMORY_CopyToCart(addr1, addr2, dst) memcpy(dst, MEMORY_mem + (addr1), (addr2) - (addr1) + 1)
+#define MEMORY_FillCart(addr1, addr2, value) memset(MEMORY_mem + (addr1), value, (addr2) - (addr1) + 1)
+#endif
 void MEMORY_GetCharset(UBYTE *cs);
 
 /* Mosaic and Axlon 400/800 RAM extensions */
@@ -128,12 +177,10 @@ extern int MEMORY_axlon_num_banks;
 /* Controls presence of MapRAM memory modification for XL/XE mode. */
 extern int MEMORY_enable_mapram;
 
-#ifndef PAGED_MEM
 /* Reads a byte from the specified special address (not RAM or ROM). */
 UBYTE MEMORY_HwGetByte(UWORD addr, int safe);
 
 /* Stores a byte at the specified special address (not RAM or ROM). */
 void MEMORY_HwPutByte(UWORD addr, UBYTE byte);
-#endif /* PAGED_MEM */
 
 #endif /* MEMORY_H_ */
@@ -493,6 +493,11 @@ static const char *find_label_name(UWORD addr, int is_write)
 	return NULL;
 }
 
+const char *MONITOR_LabelName(UWORD addr)
+{
+	return find_label_name(addr, FALSE);
+}
+
 static symtable_rec *find_user_label(const char *name)
 {
 	int i;
@@ -3365,10 +3370,12 @@ static void print_fp_dbl(unsigned char *fp)
 static void mem_to_fp(void)
 {
 	UWORD addr;
+	UBYTE fp[6];
 
 	if(!get_hex(&addr)) addr = 0xd4; /* FR0 */
 
-	print_fp_dbl(&MEMORY_mem[addr]);
+	MEMORY_dCopyFromMem(addr, fp, 6);
+	print_fp_dbl(fp);
 }
 
 /* Read 2 to 6 hex bytes from command line, interpret
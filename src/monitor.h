@@ -10,6 +10,8 @@ int MONITOR_Run(void);
 
 #ifdef MONITOR_HINTS
 void MONITOR_PreloadLabelFile(char *filename);
+/* Returns the label defined for ADDR, or NULL. */
+const char *MONITOR_LabelName(UWORD addr);
 #endif
 
 #ifdef MONITOR_TRACE
@@ -0,0 +1,749 @@
+/*
+ * movie.c - recording and playback of input movies
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "antic.h"
+#include "atari.h"
+#include "cpu.h"
+#include "input.h"
+#include "log.h"
+#include "memory.h"
+#include "movie.h"
+#include "sio.h"
+#include "statesav.h"
+#include "util.h"
+
+/* File layout. All numbers are 32-bit little-endian.
+     header: "A8MOVIE\0", version, offset of the index chunk (0 if the
+             recording was not finished), number of frames
+   followed by chunks of a type byte, the payload length and the payload:
+     'S' snapshot: frame, flags, INPUT_latch_t, compression, length of the
+                   state, state save data (zlib-compressed if compression
+                   is 1)
+     'F' frame:    hash, mask of input fields that changed since the
+                   previous frame (or since the last snapshot), the
+                   changed fields
+     'D' disk:     drive number (0-based), SIO_UnitStatus, filename
+     'I' index:    count, then frame and file offset of every snapshot
+   The input of a frame is stored before the frame is emulated; its hash
+   covers the machine at the end of the frame. */
+#define MAGIC "A8MOVIE"
+#define FORMAT_VERSION 1
+#define HEADER_SIZE 20
+
+#define CHUNK_SNAPSHOT 'S'
+#define CHUNK_FRAME 'F'
+#define CHUNK_DISK 'D'
+#define CHUNK_INDEX 'I'
+
+/* Snapshot flags */
+#define SNAPSHOT_RESYNC 1			/* must be loaded during playback */
+#define SNAPSHOT_HEADER_SIZE (4 * (4 + LATCH_FIELDS))
+
+/* Bit of the frame mask set when the hash is not valid */
+#define FRAME_NO_HASH 0x80000000
+
+#define INPUT_FIELDS 20
+#define LATCH_FIELDS 14
+
+int MOVIE_index_interval = 3600;
+int MOVIE_verify = FALSE;
+int MOVIE_desync_frame = -1;
+
+static enum {
+	MODE_OFF,
+	MODE_RECORD,
+	MODE_PLAY
+} mode = MODE_OFF;
+
+static FILE *movie_file = NULL;
+static int n_frames;
+
+/* Input that frame masks are relative to */
+static INPUT_frame_t prev_input;
+/* Input of the frame being played back */
+static INPUT_frame_t replay_input;
+
+/* Recording: INPUT_last_frame holds the input of the previous frame, still
+   to be written. Playback: expected_hash is to be compared with the machine
+   at the end of the previous frame. */
+static int frame_pending = FALSE;
+static int hash_valid;
+static ULONG expected_hash;
+
+static int mark = FALSE;
+static int last_snapshot_frame;
+
+/* Seek index */
+static ULONG *index_frame = NULL;
+static ULONG *index_offset = NULL;
+static int index_len = 0;
+static int index_size = 0;
+
+/* Drives as last written to the recording */
+static SIO_UnitStatus disk_status[SIO_MAX_DRIVES];
+static char disk_filename[SIO_MAX_DRIVES][FILENAME_MAX];
+
+static UBYTE *state_buf = NULL;
+static ULONG state_size = 0;
+#ifdef HAVE_LIBZ
+static UBYTE *comp_buf = NULL;
+static ULONG comp_size = 0;
+#endif
+
+/* Set from the command line, acted upon at the first frame */
+static char record_filename[FILENAME_MAX] = "";
+static char play_filename[FILENAME_MAX] = "";
+static int seek_frame = -1;
+
+static void PutULONG(ULONG value)
+{
+	putc(value & 0xff, movie_file);
+	putc((value >> 8) & 0xff, movie_file);
+	putc((value >> 16) & 0xff, movie_file);
+	putc((value >> 24) & 0xff, movie_file);
+}
+
+static ULONG GetULONG(void)
+{
+	ULONG value = getc(movie_file) & 0xff;
+	value |= (getc(movie_file) & 0xff) << 8;
+	value |= (ULONG) (getc(movie_file) & 0xff) << 16;
+	value |= (ULONG) (getc(movie_file) & 0xff) << 24;
+	return value;
+}
+
+static int *Field(INPUT_frame_t *input, int i)
+{
+	if (i < 3)
+		return i == 0 ? &input->key_code : i == 1 ? &input->key_shift : &input->key_consol;
+	if (i < 5)
+		return &input->port[i - 3];
+	if (i < 9)
+		return &input->trig[i - 5];
+	if (i < 17)
+		return &input->pot[i - 9];
+	return i == 17 ? &input->mouse_delta_x : i == 18 ? &input->mouse_delta_y : &input->mouse_buttons;
+}
+
+static void PutLatch(INPUT_latch_t const *latch)
+{
+	int i;
+	PutULONG((ULONG) latch->last_key_code);
+	PutULONG((ULONG) latch->last_key_break);
+	PutULONG((ULONG) latch->last_mouse_buttons);
+	PutULONG((ULONG) latch->bit5_5200);
+	for (i = 0; i < 4; i++)
+		PutULONG(latch->last_stick[i]);
+	PutULONG((ULONG) latch->mouse_x);
+	PutULONG((ULONG) latch->mouse_y);
+	PutULONG((ULONG) latch->mouse_move_x);
+	PutULONG((ULONG) latch->mouse_move_y);
+	PutULONG((ULONG) latch->mouse_last_right);
+	PutULONG((ULONG) latch->mouse_last_down);
+}
+
+static void GetLatch(INPUT_latch_t *latch)
+{
+	int i;
+	latch->last_key_code = (SLONG) GetULONG();
+	latch->last_key_break = (SLONG) GetULONG();
+	latch->last_mouse_buttons = (SLONG) GetULONG();
+	latch->bit5_5200 = (SLONG) GetULONG();
+	for (i = 0; i < 4; i++)
+		latch->last_stick[i] = (UBYTE) GetULONG();
+	latch->mouse_x = (SLONG) GetULONG();
+	latch->mouse_y = (SLONG) GetULONG();
+	latch->mouse_move_x = (SLONG) GetULONG();
+	latch->mouse_move_y = (SLONG) GetULONG();
+	latch->mouse_last_right = (SLONG) GetULONG();
+	latch->mouse_last_down = (SLONG) GetULONG();
+}
+
+/* Hash of main memory and the CPU registers. */
+static ULONG Hash(void)
+{
+	ULONG h = 2166136261U;
+	int i;
+	for (i = 0; i < 65536; i += 4) {
+		ULONG w = MEMORY_dGetByte(i) | (MEMORY_dGetByte(i + 1) << 8)
+		        | ((ULONG) MEMORY_dGetByte(i + 2) << 16) | ((ULONG) MEMORY_dGetByte(i + 3) << 24);
+		h = ((h ^ w) * 16777619U) & 0xffffffff;
+	}
+	h = ((h ^ CPU_regPC) * 16777619U) & 0xffffffff;
+	h = ((h ^ (CPU_regA | (CPU_regX << 8) | ((ULONG) CPU_regY << 16) | ((ULONG) CPU_regS << 24))) * 16777619U) & 0xffffffff;
+	return h;
+}
+
+static void AddIndex(ULONG frame, ULONG offset)
+{
+	if (index_len == index_size) {
+		index_size = index_size == 0 ? 64 : 2 * index_size;
+		index_frame = (ULONG *) Util_realloc(index_frame, index_size * sizeof(ULONG));
+		index_offset = (ULONG *) Util_realloc(index_offset, index_size * sizeof(ULONG));
+	}
+	index_frame[index_len] = frame;
+	index_offset[index_len] = offset;
+	index_len++;
+}
+
+static int WriteSnapshot(int flags)
+{
+	INPUT_latch_t latch;
+	UBYTE *data;
+	ULONG offset = (ULONG) ftell(movie_file);
+	ULONG len;
+	ULONG data_len;
+	int compression = 0;
+
+	if (!StateSav_SaveAtariStateToBuffer(&state_buf, &state_size, &len))
+		return FALSE;
+	data = state_buf;
+	data_len = len;
+#ifdef HAVE_LIBZ
+	{
+		uLongf comp_len = compressBound(len);
+		if (comp_size < comp_len) {
+			comp_buf = (UBYTE *) Util_realloc(comp_buf, comp_len);
+			comp_size = comp_len;
+		}
+		if (compress2(comp_buf, &comp_len, state_buf, len, Z_BEST_SPEED) == Z_OK) {
+			data = comp_buf;
+			data_len = comp_len;
+			compression = 1;
+		}
+	}
+#endif
+	INPUT_GetLatch(&latch);
+	putc(CHUNK_SNAPSHOT, movie_file);
+	PutULONG(SNAPSHOT_HEADER_SIZE + data_len);
+	PutULONG(Atari800_nframes);
+	PutULONG(flags);
+	PutLatch(&latch);
+	PutULONG(compression);
+	PutULONG(len);
+	fwrite(data, 1, data_len, movie_file);
+
+	AddIndex(Atari800_nframes, offset);
+	memset(&prev_input, 0, sizeof(prev_input));
+	last_snapshot_frame = Atari800_nframes;
+	return TRUE;
+}
+
+/* Reads the payload of a snapshot chunk of LEN bytes. The state is loaded
+   if the snapshot requires it or if LOAD is TRUE, otherwise skipped. */
+static int ReadSnapshot(ULONG len, int load)
+{
+	INPUT_latch_t latch;
+	ULONG frame = GetULONG();
+	ULONG flags = GetULONG();
+	ULONG data_len = len - SNAPSHOT_HEADER_SIZE;
+	ULONG state_len;
+	int compression;
+
+	memset(&prev_input, 0, sizeof(prev_input));
+	if (!load && !(flags & SNAPSHOT_RESYNC))
+		return fseek(movie_file, len - 8, SEEK_CUR) == 0;
+
+	GetLatch(&latch);
+	compression = (int) GetULONG();
+	state_len = GetULONG();
+	if (len < SNAPSHOT_HEADER_SIZE || state_len > STATESAV_MAX_BUFFER_SIZE)
+		return FALSE;
+	if (state_size < state_len) {
+		state_buf = (UBYTE *) Util_realloc(state_buf, state_len);
+		state_size = state_len;
+	}
+	if (compression == 0) {
+		if (data_len != state_len || fread(state_buf, 1, state_len, movie_file) != state_len)
+			return FALSE;
+	}
+#ifdef HAVE_LIBZ
+	else if (compression == 1) {
+		uLongf dest_len = state_len;
+		if (comp_size < data_len) {
+			comp_buf = (UBYTE *) Util_realloc(comp_buf, data_len);
+			comp_size = data_len;
+		}
+		if (fread(comp_buf, 1, data_len, movie_file) != data_len
+		    || uncompress(state_buf, &dest_len, comp_buf, data_len) != Z_OK
+		    || dest_len != state_len)
+			return FALSE;
+	}
+#endif
+	else {
+		Log_print("Movie snapshot uses an unsupported compression");
+		return FALSE;
+	}
+	if (!StateSav_ReadAtariStateFromMemory(state_buf, state_len))
+		return FALSE;
+	INPUT_SetLatch(&latch);
+	Atari800_nframes = (int) frame;
+	frame_pending = FALSE;
+	return TRUE;
+}
+
+/* Writes the input of the frame just emulated. */
+static void WriteFrame(void)
+{
+	ULONG mask = 0;
+	int n = 0;
+	int i;
+
+	for (i = 0; i < INPUT_FIELDS; i++) {
+		if (*Field(&INPUT_last_frame, i) != *Field(&prev_input, i)) {
+			mask |= 1 << i;
+			n++;
+		}
+	}
+	/* If the machine was changed after the frame, its hash is not known. */
+	if (mark)
+		mask |= FRAME_NO_HASH;
+	putc(CHUNK_FRAME, movie_file);
+	PutULONG(8 + 4 * n);
+	PutULONG(mark ? 0 : Hash());
+	PutULONG(mask);
+	for (i = 0; i < INPUT_FIELDS; i++) {
+		if (mask & (1 << i))
+			PutULONG((ULONG) *Field(&INPUT_last_frame, i));
+	}
+	prev_input = INPUT_last_frame;
+	n_frames++;
+}
+
+static void WriteDiskChanges(void)
+{
+	int i;
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		if (SIO_drive_status[i] != disk_status[i] || strcmp(SIO_filename[i], disk_filename[i]) != 0) {
+			size_t len = strlen(SIO_filename[i]);
+			putc(CHUNK_DISK, movie_file);
+			PutULONG(2 + len);
+			putc(i, movie_file);
+			putc(SIO_drive_status[i], movie_file);
+			fwrite(SIO_filename[i], 1, len, movie_file);
+			disk_status[i] = SIO_drive_status[i];
+			strcpy(disk_filename[i], SIO_filename[i]);
+		}
+	}
+}
+
+static void ReadDiskChange(ULONG len)
+{
+	char filename[FILENAME_MAX];
+	int drive = getc(movie_file);
+	int status = getc(movie_file);
+	ULONG name_len = len - 2;
+
+	if (name_len >= FILENAME_MAX) {
+		fseek(movie_file, name_len, SEEK_CUR);
+		return;
+	}
+	if (fread(filename, 1, name_len, movie_file) != name_len || drive < 0 || drive >= SIO_MAX_DRIVES)
+		return;
+	filename[name_len] = '\0';
+	switch (status) {
+	case SIO_OFF:
+		SIO_DisableDrive(drive + 1);
+		break;
+	case SIO_NO_DISK:
+		SIO_Dismount(drive + 1);
+		break;
+	default:
+		if (!SIO_Mount(drive + 1, filename, status == SIO_READ_ONLY))
+			Log_print("Movie: cannot mount %s in D%d:", filename, drive + 1);
+		break;
+	}
+}
+
+/* Reads the chunks up to and including the next frame into replay_input.
+   Returns FALSE at the end of the movie. */
+static int ReadFrame(void)
+{
+	for (;;) {
+		int type = getc(movie_file);
+		ULONG len;
+		if (type == EOF || type == CHUNK_INDEX)
+			return FALSE;
+		len = GetULONG();
+		if (feof(movie_file))
+			return FALSE;
+		switch (type) {
+		case CHUNK_FRAME:
+			{
+				ULONG mask;
+				int i;
+				expected_hash = GetULONG();
+				mask = GetULONG();
+				replay_input = prev_input;
+				for (i = 0; i < INPUT_FIELDS; i++) {
+					if (mask & (1 << i))
+						*Field(&replay_input, i) = (SLONG) GetULONG();
+				}
+				hash_valid = !(mask & FRAME_NO_HASH);
+				prev_input = replay_input;
+				return !feof(movie_file);
+			}
+		case CHUNK_SNAPSHOT:
+			if (!ReadSnapshot(len, FALSE)) {
+				Log_print("Movie: cannot read the snapshot");
+				return FALSE;
+			}
+			break;
+		case CHUNK_DISK:
+			ReadDiskChange(len);
+			break;
+		default:
+			fseek(movie_file, len, SEEK_CUR);
+			break;
+		}
+	}
+}
+
+/* Checks the previous frame and sets up the input of the next one. */
+static int PlayFrame(void)
+{
+	if (frame_pending && hash_valid && MOVIE_desync_frame < 0 && Hash() != expected_hash) {
+		MOVIE_desync_frame = Atari800_nframes - 1;
+		Log_print("Movie desync at frame %d", MOVIE_desync_frame);
+	}
+	if (!ReadFrame())
+		return FALSE;
+	INPUT_replay = &replay_input;
+	frame_pending = TRUE;
+	return TRUE;
+}
+
+static void EndOfMovie(void)
+{
+	if (MOVIE_desync_frame >= 0)
+		Log_print("Movie ended, desynced at frame %d", MOVIE_desync_frame);
+	else
+		Log_print("Movie ended, %d frames played back", n_frames);
+	MOVIE_Stop();
+	if (MOVIE_verify) {
+		Atari800_ErrExit();
+		exit(MOVIE_desync_frame >= 0 ? 1 : 0);
+	}
+}
+
+/* Builds the index of a recording that was not finished. */
+static void ScanIndex(void)
+{
+	ULONG offset = HEADER_SIZE;
+	fseek(movie_file, HEADER_SIZE, SEEK_SET);
+	for (;;) {
+		int type = getc(movie_file);
+		ULONG len = GetULONG();
+		if (type == EOF || type == CHUNK_INDEX || feof(movie_file))
+			break;
+		if (type == CHUNK_SNAPSHOT)
+			AddIndex(GetULONG(), offset);
+		else if (type == CHUNK_FRAME)
+			n_frames++;
+		offset += 5 + len;
+		if (fseek(movie_file, offset, SEEK_SET) != 0)
+			break;
+	}
+}
+
+static int ReadIndex(ULONG offset)
+{
+	ULONG count;
+	ULONG i;
+	if (fseek(movie_file, offset, SEEK_SET) != 0 || getc(movie_file) != CHUNK_INDEX)
+		return FALSE;
+	GetULONG();
+	count = GetULONG();
+	for (i = 0; i < count && !feof(movie_file); i++) {
+		ULONG frame = GetULONG();
+		AddIndex(frame, GetULONG());
+	}
+	return !feof(movie_file);
+}
+
+int MOVIE_Record(const char *filename)
+{
+	int i;
+
+	MOVIE_Stop();
+	movie_file = fopen(filename, "wb");
+	if (movie_file == NULL) {
+		Log_print("Cannot create movie file %s", filename);
+		return FALSE;
+	}
+	fwrite(MAGIC, 1, 8, movie_file);
+	PutULONG(FORMAT_VERSION);
+	PutULONG(0);
+	PutULONG(0);
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		disk_status[i] = SIO_drive_status[i];
+		strcpy(disk_filename[i], SIO_filename[i]);
+	}
+	mode = MODE_RECORD;
+	n_frames = 0;
+	index_len = 0;
+	frame_pending = FALSE;
+	mark = FALSE;
+	if (!WriteSnapshot(SNAPSHOT_RESYNC)) {
+		Log_print("Cannot save the machine state into the movie");
+		MOVIE_Stop();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+int MOVIE_Play(const char *filename)
+{
+	char magic[8];
+	ULONG offset;
+
+	MOVIE_Stop();
+	movie_file = fopen(filename, "rb");
+	if (movie_file == NULL) {
+		Log_print("Cannot open movie file %s", filename);
+		return FALSE;
+	}
+	if (fread(magic, 1, 8, movie_file) != 8 || memcmp(magic, MAGIC, 8) != 0) {
+		Log_print("%s is not a movie file", filename);
+		fclose(movie_file);
+		movie_file = NULL;
+		return FALSE;
+	}
+	if (GetULONG() != FORMAT_VERSION) {
+		Log_print("Movie file %s has an unsupported version", filename);
+		fclose(movie_file);
+		movie_file = NULL;
+		return FALSE;
+	}
+	offset = GetULONG();
+	n_frames = (int) GetULONG();
+	index_len = 0;
+	if (offset == 0 || !ReadIndex(offset)) {
+		index_len = 0;
+		n_frames = 0;
+		ScanIndex();
+	}
+	clearerr(movie_file);
+	fseek(movie_file, HEADER_SIZE, SEEK_SET);
+	mode = MODE_PLAY;
+	frame_pending = FALSE;
+	MOVIE_desync_frame = -1;
+	return TRUE;
+}
+
+int MOVIE_Seek(int frame)
+{
+	int i;
+
+	if (mode != MODE_PLAY || index_len == 0)
+		return FALSE;
+	for (i = index_len - 1; i > 0 && index_frame[i] > (ULONG) frame; i--)
+		;
+	if (index_frame[i] > (ULONG) frame)
+		return FALSE;
+	clearerr(movie_file);
+	if (fseek(movie_file, index_offset[i], SEEK_SET) != 0 || getc(movie_file) != CHUNK_SNAPSHOT
+	    || !ReadSnapshot(GetULONG(), TRUE)) {
+		Log_print("Movie: cannot read the snapshot");
+		MOVIE_Stop();
+		return FALSE;
+	}
+	while (Atari800_nframes < frame) {
+		if (!PlayFrame()) {
+			MOVIE_Stop();
+			return FALSE;
+		}
+		Atari800_ReplayFrame();
+	}
+	return TRUE;
+}
+
+void MOVIE_Stop(void)
+{
+	if (mode == MODE_RECORD) {
+		ULONG offset;
+		int i;
+		if (frame_pending)
+			WriteFrame();
+		offset = (ULONG) ftell(movie_file);
+		putc(CHUNK_INDEX, movie_file);
+		PutULONG(4 + 8 * index_len);
+		PutULONG(index_len);
+		for (i = 0; i < index_len; i++) {
+			PutULONG(index_frame[i]);
+			PutULONG(index_offset[i]);
+		}
+		fseek(movie_file, 12, SEEK_SET);
+		PutULONG(offset);
+		PutULONG(n_frames);
+		if (ferror(movie_file))
+			Log_print("Error writing the movie file");
+	}
+	else if (mode == MODE_PLAY)
+		INPUT_replay = NULL;
+	if (movie_file != NULL) {
+		fclose(movie_file);
+		movie_file = NULL;
+	}
+	mode = MODE_OFF;
+	frame_pending = FALSE;
+}
+
+void MOVIE_Frame(void)
+{
+	if (record_filename[0] != '\0') {
+		MOVIE_Record(record_filename);
+		record_filename[0] = '\0';
+	}
+	else if (play_filename[0] != '\0') {
+		if (MOVIE_Play(play_filename) && seek_frame >= 0)
+			MOVIE_Seek(seek_frame);
+		play_filename[0] = '\0';
+	}
+
+	if (mode == MODE_RECORD) {
+		if (frame_pending)
+			WriteFrame();
+		WriteDiskChanges();
+		if (mark)
+			WriteSnapshot(SNAPSHOT_RESYNC);
+		else if (Atari800_nframes - last_snapshot_frame >= MOVIE_index_interval)
+			WriteSnapshot(0);
+		frame_pending = TRUE;
+		if (ferror(movie_file)) {
+			Log_print("Error writing the movie file, recording stopped");
+			MOVIE_Stop();
+		}
+	}
+	else if (mode == MODE_PLAY) {
+		if (!PlayFrame())
+			EndOfMovie();
+	}
+	mark = FALSE;
+}
+
+void MOVIE_Mark(void)
+{
+	mark = TRUE;
+}
+
+int MOVIE_Recording(void)
+{
+	return mode == MODE_RECORD;
+}
+
+int MOVIE_Playing(void)
+{
+	return mode == MODE_PLAY;
+}
+
+int MOVIE_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-movie-record") == 0) {
+			if (i_a)
+				Util_strlcpy(record_filename, argv[++i], sizeof(record_filename));
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-movie-play") == 0 || strcmp(argv[i], "-movie-verify") == 0) {
+			if (i_a) {
+				if (strcmp(argv[i], "-movie-verify") == 0) {
+					MOVIE_verify = TRUE;
+					ANTIC_compute_only = TRUE;
+					Atari800_turbo = TRUE;
+					Atari800_turbo_speed = 0;
+				}
+				Util_strlcpy(play_filename, argv[++i], sizeof(play_filename));
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-movie-seek") == 0) {
+			if (i_a)
+				seek_frame = Util_sscandec(argv[++i]);
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-movie-index") == 0) {
+			if (i_a) {
+				MOVIE_index_interval = Util_sscandec(argv[++i]);
+				if (MOVIE_index_interval <= 0) {
+					Log_print("Invalid movie index interval");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-movie-record <file>  Record input movie");
+				Log_print("\t-movie-play <file>    Play back input movie");
+				Log_print("\t-movie-verify <file>  Play back movie at full speed and exit,");
+				Log_print("\t                      with exit code 1 if it desynced");
+				Log_print("\t-movie-seek <frame>   Start movie playback at frame <frame>");
+				Log_print("\t-movie-index <n>      Frames between movie seek snapshots");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
+
+void MOVIE_Exit(void)
+{
+	MOVIE_Stop();
+	free(index_frame);
+	free(index_offset);
+	free(state_buf);
+	index_frame = index_offset = NULL;
+	index_size = index_len = 0;
+	state_buf = NULL;
+	state_size = 0;
+#ifdef HAVE_LIBZ
+	free(comp_buf);
+	comp_buf = NULL;
+	comp_size = 0;
+#endif
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,50 @@
+#ifndef MOVIE_H_
+#define MOVIE_H_
+
+#include "atari.h"
+
+/* Input movies: a starting state plus the host input of every frame, which
+   replays the session exactly. Every MOVIE_index_interval frames a snapshot
+   is embedded so that playback can seek without emulating from the start,
+   and every frame carries a hash of the machine to detect desyncs. */
+
+/* Frames between two snapshots of the seek index. */
+extern int MOVIE_index_interval;
+
+/* TRUE while playing back with -movie-verify: no display, full speed, and
+   the emulator exits at the end with status 1 if the movie desynced. */
+extern int MOVIE_verify;
+
+/* First frame whose hash did not match during playback, or -1. */
+extern int MOVIE_desync_frame;
+
+int MOVIE_Initialise(int *argc, char *argv[]);
+void MOVIE_Exit(void);
+
+/* Records or plays back the current frame. Must be called once per frame,
+   before INPUT_Frame(). */
+void MOVIE_Frame(void);
+
+/* Must be called whenever the machine state is changed other than by
+   running frames (reset, UI, state load); the recording then embeds the
+   state, which playback loads at this point. */
+void MOVIE_Mark(void);
+
+/* Starts recording to FILENAME from the current state. */
+int MOVIE_Record(const char *filename);
+
+/* Starts playing back FILENAME. The starting state is loaded by the next
+   MOVIE_Frame(). */
+int MOVIE_Play(const char *filename);
+
+/* While playing back, brings the machine to the start of frame FRAME,
+   starting from the nearest snapshot before it. */
+int MOVIE_Seek(int frame);
+
+/* Stops recording or playback. */
+void MOVIE_Stop(void);
+
+int MOVIE_Recording(void);
+int MOVIE_Playing(void);
+
+#endif /* MOVIE_H_ */
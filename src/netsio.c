@@ -5,6 +5,9 @@
 * queues complete packets to emulator
 *
 */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for sendmmsg, recvmmsg */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,10 +17,15 @@
 #include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <time.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#define NETSIO_EVENTFD
+#define NETSIO_MMSG
+#endif
 #include "netsio.h"
 #include "log.h"
 #include "pia.h" /* For toggling PROC & INT */
@@ -26,7 +34,6 @@
 #ifdef DEBUG
 static char *buf_to_hex(const uint8_t *buf, size_t offset, size_t len);
 #endif /* DEBUG */
-static void send_block_to_fujinet(const uint8_t *block, size_t len);
 
 /* Flag to know when netsio is enabled */
 volatile int netsio_enabled = 0;
@@ -53,8 +60,66 @@ static volatile int netsio_netstream_is_active = 0;
 volatile int netsio_ca1_state = 1;
 volatile int netsio_cb1_state = 1;
 
-/* FIFO pipe: fds0: FujiNet->emulator */
-int fds0[2];
+/*
+ * Receive queue: FujiNet->emulator.
+ * A single producer (fujinet_rx_thread), single consumer (emulator) ring.
+ * The indexes run freely and are masked on access; rx_tail is written only
+ * by the receive thread and rx_head only by the emulator, so while the ring
+ * is neither empty nor full no side takes a lock or makes a system call.
+ * Each byte carries its arrival time for the latency counters.
+ */
+#define RX_RING_SIZE 65536 /* as much as a Linux pipe held */
+#define RX_MASK (RX_RING_SIZE - 1)
+static uint8_t rx_ring[RX_RING_SIZE];
+static uint32_t rx_stamps[RX_RING_SIZE]; /* microseconds, wrapping */
+static volatile unsigned int rx_head = 0;
+static volatile unsigned int rx_tail = 0;
+
+/*
+ * Wakes a side blocked on an empty or a full ring: an eventfd on Linux,
+ * a pipe elsewhere. It is only written to when the other side waits.
+ */
+typedef struct rx_waker {
+    int fd[2]; /* read and write ends, the same eventfd on Linux */
+    volatile int waiting;
+} rx_waker;
+static rx_waker rx_data_waker = { { -1, -1 }, 0 };  /* emulator waits for data */
+static rx_waker rx_space_waker = { { -1, -1 }, 0 }; /* rx thread waits for room */
+
+/* Receive queue counters, see netsio_get_rx_stats() */
+static volatile unsigned int rx_stat_max_depth = 0;
+static volatile unsigned long rx_stat_full_waits = 0;
+static unsigned long rx_stat_bytes = 0;
+static double rx_stat_latency_sum = 0.0;
+static uint32_t rx_stat_latency_max = 0;
+
+/*
+ * Transmit queue: emulator->FujiNet.
+ * The emulator's messages wait here for netsio_send_pending(), called once
+ * a frame and before waiting for a sync response, and then go out together,
+ * with one system call on Linux. Data bytes and blocks queued one after
+ * another are merged into one DATA_BLOCK. The receive thread sends its
+ * replies right away.
+ */
+#define TX_QUEUE_LEN 16
+#define TX_DATA_MAX 512
+static uint8_t tx_packets[TX_QUEUE_LEN][TX_DATA_MAX + 2];
+static size_t tx_lengths[TX_QUEUE_LEN];
+static int tx_count = 0;
+static int tx_data_open = 0; /* the last packet is a DATA_BLOCK taking more data */
+
+/* Packets received at once with recvmmsg() */
+#define RX_BATCH 16
+
+/* Datagram counters, see netsio_get_io_stats() */
+static unsigned long stat_packets_sent = 0;
+static unsigned long stat_send_calls = 0;
+static volatile unsigned long stat_packets_received = 0;
+static volatile unsigned long stat_recv_calls = 0;
+static unsigned long stat_transfers = 0;           /* command frames */
+static unsigned long stat_transfer_start = 0;      /* packets when the last one began */
+static unsigned long stat_transfer_packets = 0;    /* packets of the finished transfers */
+static unsigned long stat_last_transfer_packets = 0;
 
 /* UDP socket for NetSIO and return address holder */
 static int sockfd = -1;
@@ -108,20 +173,130 @@ char *buf_to_hex(const uint8_t *buf, size_t offset, size_t len) {
 }
 #endif
 
+/* Ring index accesses ordering the accesses to the ring */
+static unsigned int load_acquire(volatile unsigned int *p)
+{
+#if defined(__ATOMIC_ACQUIRE)
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    unsigned int v = *p;
+    __sync_synchronize();
+    return v;
+#endif
+}
+
+static void store_release(volatile unsigned int *p, unsigned int v)
+{
+#if defined(__ATOMIC_RELEASE)
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#else
+    __sync_synchronize();
+    *p = v;
+#endif
+}
+
+/* Orders a store before a following load (index vs. waiting flag) */
+static void full_barrier(void)
+{
+#if defined(__ATOMIC_SEQ_CST)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+    __sync_synchronize();
+#endif
+}
+
+static uint32_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000u + (uint32_t)(ts.tv_nsec / 1000);
+}
+
+static int rx_waker_open(rx_waker *w)
+{
+    if (w->fd[0] >= 0)
+        return 0;
+#ifdef NETSIO_EVENTFD
+    w->fd[0] = w->fd[1] = eventfd(0, 0);
+    return w->fd[0] < 0 ? -1 : 0;
+#else
+    return pipe(w->fd);
+#endif
+}
+
+/* Called after moving an index, wakes the other side if it waits for that */
+static void rx_waker_signal(rx_waker *w)
+{
+    full_barrier();
+    if (w->waiting)
+    {
+#ifdef NETSIO_EVENTFD
+        uint64_t one = 1;
+#else
+        uint8_t one = 1;
+#endif
+        while (write(w->fd[1], &one, sizeof(one)) < 0 && errno == EINTR)
+            ;
+    }
+}
+
+/* Blocks while *index, moved by the other side, still equals value */
+static void rx_wait(rx_waker *w, volatile unsigned int *index, unsigned int value)
+{
+    uint64_t count;
+    ssize_t n;
+
+    while (load_acquire(index) == value)
+    {
+        w->waiting = 1;
+        full_barrier();
+        if (load_acquire(index) != value)
+        {
+            w->waiting = 0;
+            break;
+        }
+        /* eventfd reads the counter, a pipe drains up to 8 pending wakeups */
+        do
+            n = read(w->fd[0], &count, sizeof(count));
+        while (n < 0 && errno == EINTR);
+        w->waiting = 0;
+        if (n <= 0)
+            break;
+    }
+}
+
 /* write data to emulator FIFO (fujinet_rx_thread) */
 static void enqueue_to_emulator(const uint8_t *pkt, size_t len) {
-    ssize_t n;
+    uint32_t now = monotonic_us();
+    unsigned int tail = rx_tail;
+    unsigned int head;
+    unsigned int depth;
+    size_t room, n, i;
+
     while (len > 0)
     {
-        n = write(fds0[1], pkt, len);
-        if (n < 0)
+        head = load_acquire(&rx_head);
+        room = RX_RING_SIZE - (tail - head);
+        if (room == 0)
         {
-            if (errno == EINTR) continue;
-#ifdef DEBUG
-            Log_print("netsio: write to emulator FIFO");
-#endif
-            /*exit(1);*/
+            /* the emulator is not reading; wait for it like a full pipe did */
+            rx_stat_full_waits++;
+            rx_wait(&rx_space_waker, &rx_head, head);
+            continue;
         }
+        n = len < room ? len : room;
+        for (i = 0; i < n; i++)
+        {
+            rx_ring[(tail + i) & RX_MASK] = pkt[i];
+            rx_stamps[(tail + i) & RX_MASK] = now;
+        }
+        tail += n;
+        store_release(&rx_tail, tail);
+        rx_waker_signal(&rx_data_waker);
+
+        depth = tail - head;
+        if (depth > rx_stat_max_depth)
+            rx_stat_max_depth = depth;
         pkt += n;
         len -= n;
     }
@@ -210,21 +385,147 @@ static void send_to_fujinet(const uint8_t *pkt, size_t len) {
 #endif
 }
 
-/* Send up to 512 bytes as a DATA_BLOCK packet */
-static void send_block_to_fujinet(const uint8_t *block, size_t len) {
-    uint8_t packet[512 + 2];
+/* Finish the DATA_BLOCK being merged; a single byte goes as a DATA_BYTE */
+static void tx_close_data(void) {
+    uint8_t *pkt;
+    size_t *len;
+
+    if (!tx_data_open)
+        return;
+    pkt = tx_packets[tx_count - 1];
+    len = &tx_lengths[tx_count - 1];
+    if (*len == 2)
+        pkt[0] = NETSIO_DATA_BYTE;
+    else
+        /* Pad the end with a junk byte or FN-PC won't accept the packet */
+        pkt[(*len)++] = 0xFF;
+    tx_data_open = 0;
+}
+
+/* Start a packet in the transmit queue, sending the queue if it is full */
+static uint8_t *tx_new_packet(size_t len) {
+    tx_close_data();
+    if (tx_count == TX_QUEUE_LEN)
+        netsio_send_pending();
+    tx_lengths[tx_count] = len;
+    return tx_packets[tx_count++];
+}
+
+/* queue a packet for FujiNet (emulator) */
+static void queue_to_fujinet(const uint8_t *pkt, size_t len) {
+    memcpy(tx_new_packet(len), pkt, len);
+}
+
+/* queue data for FujiNet, merged with the data queued just before (emulator) */
+static void queue_data_to_fujinet(const uint8_t *data, size_t len) {
+    size_t n;
+
+    while (len > 0)
+    {
+        if (!tx_data_open || tx_lengths[tx_count - 1] == 1 + TX_DATA_MAX)
+        {
+            tx_new_packet(1)[0] = NETSIO_DATA_BLOCK;
+            tx_data_open = 1;
+        }
+        n = 1 + TX_DATA_MAX - tx_lengths[tx_count - 1];
+        if (n > len)
+            n = len;
+        memcpy(tx_packets[tx_count - 1] + tx_lengths[tx_count - 1], data, n);
+        tx_lengths[tx_count - 1] += n;
+        data += n;
+        len -= n;
+    }
+}
+
+/* Send the transmit queue to FujiNet */
+void netsio_send_pending(void) {
+#ifdef NETSIO_MMSG
+    struct mmsghdr msgs[TX_QUEUE_LEN];
+    struct iovec iovs[TX_QUEUE_LEN];
+    int flags = 0;
+    int sent = 0;
+    int n;
+#endif
+    int i;
+
+    tx_close_data();
+    if (tx_count == 0)
+        return;
+    if (!fujinet_known || fujinet_addr.ss_family != AF_INET)
+    {
+#ifdef DEBUG
+        Log_print("netsio: can't send %d queued packets, no address", tx_count);
+#endif
+        tx_count = 0;
+        return;
+    }
+    stat_packets_sent += tx_count;
+
+#ifdef NETSIO_MMSG
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < tx_count; i++)
+    {
+        iovs[i].iov_base = tx_packets[i];
+        iovs[i].iov_len = tx_lengths[i];
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &fujinet_addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+    while (sent < tx_count)
+    {
+        n = sendmmsg(sockfd, msgs + sent, tx_count - sent, flags);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+#ifdef DEBUG
+            Log_print("netsio: sendmmsg failed: %d", errno);
+#endif
+            break;
+        }
+        stat_send_calls++;
+        sent += n;
+    }
+#else
+    for (i = 0; i < tx_count; i++)
+    {
+        send_to_fujinet(tx_packets[i], tx_lengths[i]);
+        stat_send_calls++;
+    }
+#endif /* NETSIO_MMSG */
+    tx_count = 0;
+}
+
+void netsio_get_io_stats(netsio_io_stats *stats)
+{
+    stats->packets_sent = stat_packets_sent;
+    stats->send_calls = stat_send_calls;
+    stats->packets_received = stat_packets_received;
+    stats->recv_calls = stat_recv_calls;
+    stats->transfers = stat_transfers > 0 ? stat_transfers - 1 : 0;
+    stats->packets_per_transfer = stats->transfers > 0 ? (double)stat_transfer_packets / stats->transfers : 0.0;
+    stats->last_transfer_packets = stat_last_transfer_packets;
+}
 
-    if (len == 0 || len > 512) return;  /* sanity check */
-    packet[0] = NETSIO_DATA_BLOCK;
-    memcpy(&packet[1], block, len);
-    /* Pad the end with a junk byte or FN-PC won't accept the packet */
-    packet[1 + len] = 0xFF;
-    send_to_fujinet(packet, len + 2);
+void netsio_reset_io_stats(void)
+{
+    stat_packets_sent = 0;
+    stat_send_calls = 0;
+    stat_packets_received = 0;
+    stat_recv_calls = 0;
+    stat_transfers = 0;
+    stat_transfer_start = 0;
+    stat_transfer_packets = 0;
+    stat_last_transfer_packets = 0;
 }
 
 /* Initialize NetSIO:
 *   - connect to FujiNet socket
-*   - create FIFO
+*   - set up the receive queue
 *   - spawn the thread
 */
 int netsio_init(uint16_t port) {
@@ -241,17 +542,15 @@ int netsio_init(uint16_t port) {
         return 0;
     }
 
-    /* create emulator <-> netsio FIFOs */
-    if (pipe(fds0) < 0)
+    /* create the receive queue wakeups; kept open across restarts */
+    if (rx_waker_open(&rx_data_waker) < 0 || rx_waker_open(&rx_space_waker) < 0)
     {
 #ifdef DEBUG
-        Log_print("netsio: pipe creation error");
+        Log_print("netsio: receive queue wakeup creation error");
 #endif
         return -1;
     }
 
-    /* fcntl(fds0[0], F_SETFL, O_NONBLOCK); */
-
     /* connect socket to FujiNet */
     sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0)
@@ -361,30 +660,49 @@ void netsio_wait_for_sync(void)
 
 /* Return number of bytes waiting from FujiNet to emulator */
 int netsio_available(void) {
-    int avail = 0;
-    if (fds0[0] >= 0)
-    {
-        if (ioctl(fds0[0], FIONREAD, &avail) < 0)
-        {
-#ifdef DEBUG
-            Log_print("netsio_avail: ioctl error");
-#endif
-            return -1;
-        }
-    }
-    return avail;
+    return (int)(load_acquire(&rx_tail) - rx_head);
+}
+
+void netsio_get_rx_stats(netsio_rx_stats *stats)
+{
+    stats->depth = netsio_available();
+    stats->max_depth = rx_stat_max_depth;
+    stats->bytes = rx_stat_bytes;
+    stats->full_waits = rx_stat_full_waits;
+    stats->latency_avg = rx_stat_bytes ? rx_stat_latency_sum / rx_stat_bytes / 1e6 : 0.0;
+    stats->latency_max = rx_stat_latency_max / 1e6;
+}
+
+void netsio_reset_rx_stats(void)
+{
+    rx_stat_max_depth = netsio_available();
+    rx_stat_full_waits = 0;
+    rx_stat_bytes = 0;
+    rx_stat_latency_sum = 0.0;
+    rx_stat_latency_max = 0;
 }
 
 /* COMMAND ON */
 int netsio_cmd_on(void)
 {
     uint8_t p;
+    unsigned long packets;
     p = NETSIO_COMMAND_ON;
 #ifdef DEBUG
     Log_print("netsio: CMD ON");
 #endif
+    /* a new transfer begins, count the packets of the last one */
+    packets = stat_packets_sent + tx_count + stat_packets_received;
+    if (stat_transfers > 0)
+    {
+        stat_last_transfer_packets = packets - stat_transfer_start;
+        stat_transfer_packets += stat_last_transfer_packets;
+    }
+    stat_transfers++;
+    stat_transfer_start = packets;
+
     netsio_cmd_state = 1;
-    send_to_fujinet(&p, 1);
+    queue_to_fujinet(&p, 1);
     return 0;
 }
 
@@ -396,7 +714,7 @@ int netsio_cmd_off(void)
 #ifdef DEBUG
     Log_print("netsio: CMD OFF");
 #endif
-    send_to_fujinet(&p, 1);
+    queue_to_fujinet(&p, 1);
     return 0;
 }
 
@@ -413,7 +731,8 @@ int netsio_cmd_off_sync(void)
 #ifdef DEBUG
     Log_print("netsio: CMD OFF SYNC");
 #endif
-    send_to_fujinet(p, sizeof(p));
+    queue_to_fujinet(p, sizeof(p));
+    netsio_send_pending();
     return 0;
 }
 
@@ -443,7 +762,7 @@ int netsio_motor_on(void)
 #ifdef DEBUG
     Log_print("netsio: MOTOR ON");
 #endif
-    send_to_fujinet(&p, 1);
+    queue_to_fujinet(&p, 1);
     return 0;
 }
 
@@ -455,7 +774,7 @@ int netsio_motor_off(void)
 #ifdef DEBUG
     Log_print("netsio: MOTOR OFF");
 #endif
-    send_to_fujinet(&p, 1);
+    queue_to_fujinet(&p, 1);
     return 0;
 }
 
@@ -518,19 +837,17 @@ int netsio_netstream_active(void)
 
 /* The emulator calls this to send a data byte out to FujiNet */
 int netsio_send_byte(uint8_t b) {
-    uint8_t pkt[2];
-    pkt[0] = NETSIO_DATA_BYTE;
-    pkt[1] = b;
 #ifdef DEBUG
     Log_print("netsio: send byte: %02X", b);
 #endif
-    send_to_fujinet(pkt, 2);
+    queue_data_to_fujinet(&b, 1);
     return 0;
 }
 
 /* The emulator calls this to send a data block out to FujiNet */
 int netsio_send_block(const uint8_t *block, ssize_t len) {
-    send_block_to_fujinet(block, len);
+    if (len <= 0 || len > 512) return 0;  /* sanity check */
+    queue_data_to_fujinet(block, len);
 #ifdef DEBUG
     Log_print("netsio: send block, %i bytes:\n  %s", len, buf_to_hex(block, 0, len));
 #endif
@@ -551,23 +868,39 @@ int netsio_send_byte_sync(uint8_t b)
 #ifdef DEBUG
     Log_print("netsio: send byte: 0x%02X sync: %d", b, netsio_sync_num);
 #endif
-    send_to_fujinet(p, sizeof(p));
+    queue_to_fujinet(p, sizeof(p));
+    netsio_send_pending();
     return 0;
 }
 
 /* The emulator calls this to receive a data byte from FujiNet */
 int netsio_recv_byte(uint8_t *b) {
-    ssize_t n = read(fds0[0], b, 1);
-    if (n < 0)
+    unsigned int head = rx_head;
+    unsigned int tail;
+    uint32_t latency;
+
+    if (rx_data_waker.fd[0] < 0)
+        return -1; /* not initialized */
+    rx_wait(&rx_data_waker, &rx_tail, head);
+    tail = load_acquire(&rx_tail);
+    if (tail == head)
     {
-        if (errno == EINTR) return netsio_recv_byte(b);
 #ifdef DEBUG
-        Log_print("netsio: read from rx FIFO");
+        Log_print("netsio: wait for rx FIFO");
 #endif
         return -1;
     }
-    if (n == 0)
-        return -1; /* FIFO closed? */
+    *b = rx_ring[head & RX_MASK];
+    latency = monotonic_us() - rx_stamps[head & RX_MASK];
+    store_release(&rx_head, ++head);
+    /* a full ring is refilled in bulk, not byte by byte */
+    if (tail - head <= RX_RING_SIZE / 2)
+        rx_waker_signal(&rx_space_waker);
+
+    rx_stat_bytes++;
+    rx_stat_latency_sum += latency;
+    if (latency > rx_stat_latency_max)
+        rx_stat_latency_max = latency;
 #ifdef DEBUG2
     Log_print("netsio: read to emu: %02X", (unsigned)*b);
 #endif
@@ -583,7 +916,8 @@ int netsio_cold_reset(void) {
     netsio_netstream_pending_enable = 0;
     netsio_netstream_fuji_enabled = 0;
     netsio_netstream_recalc();
-    send_to_fujinet(&pkt, 1);
+    queue_to_fujinet(&pkt, 1);
+    netsio_send_pending();
     return 0;
 }
 
@@ -596,7 +930,8 @@ int netsio_warm_reset(void) {
     netsio_netstream_pending_enable = 0;
     netsio_netstream_fuji_enabled = 0;
     netsio_netstream_recalc();
-    send_to_fujinet(&pkt, 1);
+    queue_to_fujinet(&pkt, 1);
+    netsio_send_pending();
     return 0;
 }
 
@@ -605,18 +940,61 @@ void netsio_test_cmd(void)
 {
     uint8_t p[6] = { 0x70, 0xE8, 0x00, 0x00, 0x59 }; /* Send fujidev get adapter config request */
     netsio_cmd_on(); /* Turn on CMD */
-    send_block_to_fujinet(p, sizeof(p));
+    netsio_send_block(p, sizeof(p));
     netsio_cmd_off_sync(); /* Turn off CMD */
 }
 
 /* Thread: receive from FujiNet socket (one packet == one command) */
 static void *fujinet_rx_thread(void *arg) {
+#ifdef NETSIO_MMSG
+    /* Take all the packets waiting, up to RX_BATCH, with one system call */
+    static uint8_t bufs[RX_BATCH][4096];
+    static struct sockaddr_storage addrs[RX_BATCH];
+    struct mmsghdr msgs[RX_BATCH];
+    struct iovec iovs[RX_BATCH];
+    int batch_len = 0;
+    int batch_pos = 0;
+    int i;
+    uint8_t *buf;
+#else
     uint8_t buf[4096];
+#endif
     uint8_t cmd;
     ssize_t n;
 
     for (;;)
     {
+#ifdef NETSIO_MMSG
+        if (batch_pos == batch_len)
+        {
+            for (i = 0; i < RX_BATCH; i++)
+            {
+                iovs[i].iov_base = bufs[i];
+                iovs[i].iov_len = sizeof(bufs[i]);
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_name = &addrs[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            }
+            batch_pos = 0;
+            batch_len = recvmmsg(sockfd, msgs, RX_BATCH, MSG_WAITFORONE, NULL);
+            if (batch_len <= 0)
+            {
+                batch_len = 0;
+#ifdef DEBUG
+                Log_print("netsio: recvmmsg");
+#endif
+                continue;
+            }
+            stat_recv_calls++;
+        }
+        buf = bufs[batch_pos];
+        n = msgs[batch_pos].msg_len;
+        /* replies go to the sender of the last packet */
+        memcpy(&fujinet_addr, &addrs[batch_pos], msgs[batch_pos].msg_hdr.msg_namelen);
+        batch_pos++;
+#else
         /* 
          * Always initialize with full sockaddr_storage size for receiving
          * This works on both Linux and macOS - we need full size for first connect
@@ -640,6 +1018,8 @@ static void *fujinet_rx_thread(void *arg) {
                              0,
                              (struct sockaddr *)&fujinet_addr,
                              &fujinet_addr_len);
+        stat_recv_calls++;
+#endif /* NETSIO_MMSG */
 
         if (n <= 0)
         {
@@ -649,6 +1029,7 @@ static void *fujinet_rx_thread(void *arg) {
             continue;
         }
         fujinet_known = 1;
+        stat_packets_received++;
         
         /* Update the address length to the correct size for future sends */
         if (fujinet_addr.ss_family == AF_INET) {
@@ -888,6 +1269,8 @@ void netsio_shutdown(void) {
     Log_print("netsio: shutting down...");
 #endif
 
+    netsio_send_pending();
+
     /* Send disconnect notification to FujiNet-PC (if connected) */
     if (netsio_enabled) {
         uint8_t pkt = NETSIO_DEVICE_DISCONNECTED;
@@ -906,15 +1289,24 @@ void netsio_shutdown(void) {
         sockfd = -1;
     }
 
-    /* Close FIFO pipes */
-    if (fds0[0] >= 0) {
-        close(fds0[0]);
-        fds0[0] = -1;
-    }
-    if (fds0[1] >= 0) {
-        close(fds0[1]);
-        fds0[1] = -1;
+#ifdef DEBUG
+    {
+        netsio_rx_stats stats;
+        netsio_io_stats io;
+        netsio_get_rx_stats(&stats);
+        netsio_get_io_stats(&io);
+        Log_print("netsio: rx %lu bytes, max depth %u, %lu full waits, latency avg %.1f us max %.1f us",
+            stats.bytes, stats.max_depth, stats.full_waits,
+            stats.latency_avg * 1e6, stats.latency_max * 1e6);
+        Log_print("netsio: %lu packets sent in %lu calls, %lu received in %lu calls, %.1f packets per transfer",
+            io.packets_sent, io.send_calls, io.packets_received, io.recv_calls,
+            io.packets_per_transfer);
     }
+#endif
+
+    /* Drop unread bytes, releasing the receive thread if it waits for room */
+    store_release(&rx_head, load_acquire(&rx_tail));
+    rx_waker_signal(&rx_space_waker);
 
     /* Reset global state variables */
     netsio_enabled = 0;
@@ -62,9 +62,34 @@ extern volatile int netsio_sync_wait;
 extern int netsio_cmd_state;
 extern volatile int netsio_next_write_size;
 
-/* FIFO pipes: fds0: FujiNet->emulator (POSIX only; not used on Windows) */
+/* Receive queue counters, FujiNet->emulator (POSIX only) */
 #ifndef HAVE_WINDOWS_H
-extern int fds0[2];
+typedef struct netsio_rx_stats {
+    unsigned int depth;         /* bytes waiting now */
+    unsigned int max_depth;     /* most bytes ever waiting */
+    unsigned long bytes;        /* bytes read by the emulator */
+    unsigned long full_waits;   /* times the receive thread waited for room */
+    double latency_avg;         /* seconds from arrival to read, per byte */
+    double latency_max;
+} netsio_rx_stats;
+
+void netsio_get_rx_stats(netsio_rx_stats *stats);
+void netsio_reset_rx_stats(void);
+
+/* Datagram counters (POSIX only). A transfer runs from one command frame
+   to the next. */
+typedef struct netsio_io_stats {
+    unsigned long packets_sent;     /* by the emulator */
+    unsigned long send_calls;       /* system calls sending them */
+    unsigned long packets_received;
+    unsigned long recv_calls;       /* system calls receiving them */
+    unsigned long transfers;        /* finished transfers */
+    double packets_per_transfer;    /* sent and received, on average */
+    unsigned long last_transfer_packets;
+} netsio_io_stats;
+
+void netsio_get_io_stats(netsio_io_stats *stats);
+void netsio_reset_io_stats(void);
 #endif
 
 /* Initialize NetSIO subsystem, connecting to FujiNet-PC at host:port. */
@@ -82,8 +107,14 @@ int netsio_send_block(const uint8_t *block, ssize_t len);
 
 int netsio_send_byte_sync(uint8_t b);
 
-/* Dequeue one byte received from FujiNet-PC. */
-/* Returns 0 on success, -1 if FIFO is empty. */
+/* The functions sending to FujiNet-PC queue their messages (except on
+   Windows, where they are sent right away). Data bytes and blocks following
+   each other are merged into one packet. The queue is sent by this function,
+   called once a frame, and by the functions that wait for a sync response. */
+void netsio_send_pending(void);
+
+/* Dequeue one byte received from FujiNet-PC, waiting for it if none is queued. */
+/* Returns 0 on success, -1 on error. */
 int netsio_recv_byte(uint8_t *b);
 
 int netsio_cmd_on(void);
@@ -348,6 +348,11 @@ void netsio_flush_fifo(void)
     LeaveCriticalSection(&fifo_cs);
 }
 
+void netsio_send_pending(void)
+{
+    /* Messages are sent right away */
+}
+
 int netsio_cmd_on(void)
 {
     uint8_t p = NETSIO_COMMAND_ON;
@@ -24,24 +24,40 @@
 
 #include "pal_blending.h"
 
+#include <string.h>
+
 #include "artifact.h"
 #include "atari.h"
+#include "blit.h"
 #include "colours.h"
 #include "colours_pal.h"
 #include "platform.h"
 #include "screen.h"
+#include "util.h"
 
 #if SUPPORTS_CHANGE_VIDEOMODE
 #include "videomode.h"
 #endif /* SUPPORTS_CHANGE_VIDEOMODE */
 
 static union {
-	UWORD bpp16[2][256];	/* 16-bit palette */
+	UWORD bpp16[2][256];	/* 16-bit palette, padded by bpp32 for BLIT_Expand16() */
 	ULONG bpp32[2][256];	/* 32-bit palette */
 } palette;
 
 static ULONG shift_mask;
 
+/* Work rows of the blitters. A row may start one column left of the
+   displayed area; the padding is needed by BLIT_Gather16(). */
+static UBYTE mixed_row[Screen_WIDTH + 2];
+static union {
+	UWORD bpp16[2][Screen_WIDTH + 4];
+	ULONG bpp32[2][Screen_WIDTH + 2];
+} blend_row;
+
+/* Source columns shown by the pixels of a scaled row. */
+static int *scale_index = NULL;
+static int scale_index_size = 0;
+
 void PAL_BLENDING_UpdateLookup(void)
 {
 	if (ARTIFACT_mode == ARTIFACT_PAL_BLEND) {
@@ -98,112 +114,90 @@ void PAL_BLENDING_UpdateLookup(void)
 	}
 }
 
+/* Blends the source rows SRC and SRC_PREV over SIZE pixels into
+   blend_row.bpp16[0]. */
+static void BlendRow16(UBYTE const *src, UBYTE const *src_prev, int size, int start_odd)
+{
+	/* Make the previous line's pixels have the same Y component as the
+	   current line's pixels. */
+	BLIT_MixLuma(mixed_row, src_prev, src, size);
+	BLIT_Expand16(blend_row.bpp16[1], mixed_row, size, palette.bpp16[start_odd ^ 1]);
+	BLIT_Expand16(blend_row.bpp16[0], src, size, palette.bpp16[start_odd]);
+	/* Since both lines have the same Y component, computing averages of
+	   even U/V and odd U/V is equal to computing averages of even and odd
+	   RGB components. */
+	BLIT_Average16(blend_row.bpp16[0], blend_row.bpp16[0], blend_row.bpp16[1], size, (UWORD)shift_mask);
+}
+
+static void BlendRow32(UBYTE const *src, UBYTE const *src_prev, int size, int start_odd)
+{
+	BLIT_MixLuma(mixed_row, src_prev, src, size);
+	BLIT_Expand32(blend_row.bpp32[1], mixed_row, size, palette.bpp32[start_odd ^ 1]);
+	BLIT_Expand32(blend_row.bpp32[0], src, size, palette.bpp32[start_odd]);
+	BLIT_Average32(blend_row.bpp32[0], blend_row.bpp32[0], blend_row.bpp32[1], size, shift_mask);
+}
+
 void PAL_BLENDING_Blit16(ULONG *dest, UBYTE *src, int pitch, int width, int height, int start_odd)
 {
-	register ULONG quad, quad_prev;
-	register UBYTE c;
-	register int pos;
 	UBYTE *src_prev = src;
-	int odd_prev = start_odd ^ 1;
 	int width_32;
 	if (width & 0x01)
 		width_32 = width + 1;
 	else
 		width_32 = width;
 	while (height > 0) {
-		pos = width_32;
-		do {
-			pos--;
-			c = src[pos];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp16[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)] << 16;
-			quad = palette.bpp16[start_odd][c] << 16;
-			pos--;
-			c = src[pos];
-			quad_prev |= palette.bpp16[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)];
-			quad |= palette.bpp16[start_odd][c];
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos >> 1] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos >> 1] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-		} while (pos > 0);
+		BlendRow16(src, src_prev, width_32, start_odd);
+		memcpy(dest, blend_row.bpp16[0], width_32 * sizeof(UWORD));
 		src_prev = src;
 		src += Screen_WIDTH;
 		dest += pitch;
 		height--;
 		start_odd ^= 1;
-		odd_prev ^= 1;
 	}
 }
 
 void PAL_BLENDING_Blit32(ULONG *dest, UBYTE *src, int pitch, int width, int height, int start_odd)
 {
-	register ULONG quad, quad_prev;
-	register UBYTE c;
-	register int pos;
 	UBYTE *src_prev = src;
-	int odd_prev = start_odd ^ 1;
 	while (height > 0) {
-		pos = width;
-		do {
-			pos--;
-			c = src[pos];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp32[odd_prev][(src_prev[pos] & 0xf0) | (c & 0x0f)];
-			quad = palette.bpp32[start_odd][c];
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-		} while (pos > 0);
+		BlendRow32(src, src_prev, width, start_odd);
+		memcpy(dest, blend_row.bpp32[0], width * sizeof(ULONG));
 		src_prev = src;
 		src += Screen_WIDTH;
 		dest += pitch;
 		height--;
 		start_odd ^= 1;
-		odd_prev ^= 1;
 	}
 }
 
+/* Fills scale_index for a row of SIZE pixels; see BLIT_ScaleIndex(). */
+static int ScaleIndex(int size, int width, int dx, int *row_width)
+{
+	if (size > scale_index_size) {
+		scale_index = (int *)Util_realloc(scale_index, size * sizeof(int));
+		scale_index_size = size;
+	}
+	return BLIT_ScaleIndex(scale_index, size, width, dx, row_width);
+}
+
 void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd)
 {
-	register ULONG quad, quad_prev;
-	register int x;
 	int y = 0x10000;
-	int w1 = dest_width / 2 - 1;
-	int w = width << 16;
-	int h = height << 16;
-	int pos;
-	register int dx = w / dest_width;
-	int dy = h / dest_height;
-	int init_x = (width << 16) - 0x4000;
+	int w1 = dest_width & ~1;
+	int dx = (width << 16) / dest_width;
+	int dy = (height << 16) / dest_height;
 	UBYTE *src_prev = src;
-	int odd_prev = start_odd ^ 1;
-
-	UBYTE c;
+	int row_width;
+	int first = ScaleIndex(w1, width, dx, &row_width);
+	int blended = FALSE;
 
 	while (dest_height > 0) {
-		x = init_x;
-		pos = w1;
-		while (pos >= 0) {
-			c = src[x >> 16];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp16[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)] << 16;
-			quad = palette.bpp16[start_odd][c] << 16;
-			x -= dx;
-			c = src[x >> 16];
-			quad_prev |= palette.bpp16[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)];
-			quad |= palette.bpp16[start_odd][c];
-			x -= dx;
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-			pos--;
+		/* A source row is blended once, however many times it is shown. */
+		if (!blended) {
+			BlendRow16(src + first, src_prev + first, row_width, start_odd);
+			blended = TRUE;
 		}
+		BLIT_Gather16((UWORD *)dest, blend_row.bpp16[0], scale_index, w1);
 		dest += pitch;
 		y -= dy;
 		--dest_height;
@@ -212,44 +206,27 @@ void PAL_BLENDING_BlitScaled16(ULONG *dest, UBYTE *src, int pitch, int width, in
 			src_prev = src;
 			src += Screen_WIDTH;
 			start_odd ^= 1;
-			odd_prev ^= 1;
+			blended = FALSE;
 		}
 	}
 }
 
 void PAL_BLENDING_BlitScaled32(ULONG *dest, UBYTE *src, int pitch, int width, int height, int dest_width, int dest_height, int start_odd)
 {
-	register ULONG quad, quad_prev;
-	register int x;
 	int y = 0x10000;
-	int w1 = dest_width - 1;
-	int w = width << 16;
-	int h = height << 16;
-	int pos;
-	register int dx = w / dest_width;
-	int dy = h / dest_height;
-	int init_x = w - 0x4000;
+	int dx = (width << 16) / dest_width;
+	int dy = (height << 16) / dest_height;
 	UBYTE *src_prev = src;
-	int odd_prev = start_odd ^ 1;
-
-	UBYTE c;
+	int row_width;
+	int first = ScaleIndex(dest_width, width, dx, &row_width);
+	int blended = FALSE;
 
 	while (dest_height > 0) {
-		x = init_x;
-		pos = w1;
-		while (pos >= 0) {
-			c = src[x >> 16];
-			/* Make QUAD_PREV have the same Y component as the current line's pixel. */
-			quad_prev = palette.bpp32[odd_prev][(src_prev[x >> 16] & 0xf0) | (c & 0x0f)];
-			quad = palette.bpp32[start_odd][c];
-			x -= dx;
-			/* Since QUAD_PREV and QUAD have the same Y component, computing
-			   averages of even U/V and odd U/V is equal to computing averages
-			   of even and odd RGB components. */
-			/* dest[pos] = ((quad+quad_prev) & shift_mask)/2; */
-			dest[pos] = (quad & quad_prev) + (((quad ^ quad_prev) & shift_mask) >> 1);
-			pos--;
+		if (!blended) {
+			BlendRow32(src + first, src_prev + first, row_width, start_odd);
+			blended = TRUE;
 		}
+		BLIT_Gather32(dest, blend_row.bpp32[0], scale_index, dest_width);
 		dest += pitch;
 		y -= dy;
 		--dest_height;
@@ -258,7 +235,7 @@ void PAL_BLENDING_BlitScaled32(ULONG *dest, UBYTE *src, int pitch, int width, in
 			src_prev = src;
 			src += Screen_WIDTH;
 			start_odd ^= 1;
-			odd_prev ^= 1;
+			blended = FALSE;
 		}
 	}
 }
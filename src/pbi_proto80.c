@@ -136,13 +136,13 @@ UBYTE PBI_PROTO80_GetPixels(int scanline, int column)
 	if (row  >= PROTO80_ROWS) {
 		return 0;
 	}
-	character = MEMORY_mem[0x9800 + row*80 + column];
+	character = MEMORY_dGetByte(0x9800 + row*80 + column);
 	invert = 0x00;
 	if (character & 0x80) {
 		invert = 0xff;
 		character &= 0x7f;
 	}
-	font_data = MEMORY_mem[0xe000 + character*8 + line];
+	font_data = MEMORY_dGetByte(0xe000 + character*8 + line);
 	font_data ^= invert;
 	return font_data;
 }
@@ -0,0 +1,267 @@
+/*
+ * perfstat.c - host time spent in the parts of the emulator
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <math.h>
+#include <string.h>
+
+#include "atari.h"
+#include "log.h"
+#include "perfstat.h"
+#ifndef BASIC
+#include "screen.h"
+#endif
+#include "util.h"
+
+int PERFSTAT_enabled = FALSE;
+
+static const char *names[PERFSTAT_COUNTERS] = {
+	"CPU", "ANTIC", "POKEY", "SOUND", "BLIT", "EXPORT", "TOTAL"
+};
+
+/* Parts can nest: ANTIC runs the CPU, the CPU may run the monitor... */
+#define MAX_DEPTH 8
+static int stack[MAX_DEPTH];
+static int depth;
+static ULONG last_ticks;
+
+/* Ticks and calls of the current frame. */
+static ULONG frame_ticks[PERFSTAT_COUNTERS];
+static ULONG frame_calls[PERFSTAT_COUNTERS];
+static ULONG last_calls[PERFSTAT_COUNTERS];
+
+/* Ticks of the last PERFSTAT_HISTORY frames. */
+static ULONG history[PERFSTAT_COUNTERS][PERFSTAT_HISTORY];
+static int history_pos;
+static int history_len;
+
+static double ns_per_tick;
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+
+/* The time stamp counter is much cheaper to read than the system clock,
+   which matters for CPU_GO(), entered a few times per scanline. Its rate
+   is measured against Util_time(). Only differences are used, so the low
+   32 bits suffice as long as a frame takes less than a second. */
+#define CALIBRATE_TICKS
+
+static double calibrate_time;
+static double calibrate_frame_time;
+static double calibrate_ticks;
+static ULONG calibrate_last;
+
+static ULONG Ticks(void)
+{
+	return (ULONG) __builtin_ia32_rdtsc();
+}
+
+#else /* defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) */
+
+/* Microseconds, wrapping around. */
+static ULONG Ticks(void)
+{
+	return (ULONG) fmod(Util_time() * 1e6, 4294967296.0);
+}
+
+#endif /* defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) */
+
+void PERFSTAT_Enter(int counter)
+{
+	ULONG now = Ticks();
+	if (depth > 0 && depth <= MAX_DEPTH)
+		frame_ticks[stack[depth - 1]] += now - last_ticks;
+	if (depth < MAX_DEPTH)
+		stack[depth] = counter;
+	depth++;
+	frame_calls[counter]++;
+	last_ticks = now;
+}
+
+void PERFSTAT_Leave(void)
+{
+	ULONG now = Ticks();
+	if (depth == 0)
+		return;
+	depth--;
+	if (depth < MAX_DEPTH)
+		frame_ticks[stack[depth]] += now - last_ticks;
+	last_ticks = now;
+}
+
+void PERFSTAT_Frame(void)
+{
+	ULONG total = 0;
+	int i;
+
+	if (!PERFSTAT_enabled)
+		return;
+	/* A CPU crash in libatari800 leaves CPU_GO() with longjmp(). */
+	depth = 0;
+
+	for (i = 0; i < PERFSTAT_TOTAL; i++) {
+		history[i][history_pos] = frame_ticks[i];
+		total += frame_ticks[i];
+		last_calls[i] = frame_calls[i];
+		frame_ticks[i] = 0;
+		frame_calls[i] = 0;
+	}
+	history[PERFSTAT_TOTAL][history_pos] = total;
+	history_pos = (history_pos + 1) % PERFSTAT_HISTORY;
+	if (history_len < PERFSTAT_HISTORY)
+		history_len++;
+
+#ifdef CALIBRATE_TICKS
+	{
+		ULONG now = Ticks();
+		double time = Util_time();
+		if (time - calibrate_frame_time > 0.5) {
+			/* The emulation was paused and the ticks may have wrapped. */
+			calibrate_time = time;
+			calibrate_ticks = 0;
+		}
+		else {
+			calibrate_ticks += (ULONG) (now - calibrate_last);
+			if (time - calibrate_time >= 1.0 && calibrate_ticks > 0) {
+				ns_per_tick = (time - calibrate_time) * 1e9 / calibrate_ticks;
+				calibrate_time = time;
+				calibrate_ticks = 0;
+			}
+		}
+		calibrate_frame_time = time;
+		calibrate_last = now;
+	}
+#endif
+}
+
+/* Returns the 99th percentile of the N values. */
+static ULONG Percentile99(ULONG const *values, int n)
+{
+	/* The largest values, in decreasing order. */
+	ULONG top[PERFSTAT_HISTORY / 100 + 2];
+	int count = n - (99 * (n - 1)) / 100;
+	int filled = 0;
+	int i;
+	for (i = 0; i < n; i++) {
+		ULONG v = values[i];
+		int j;
+		if (filled == count) {
+			if (v <= top[count - 1])
+				continue;
+			filled--;
+		}
+		for (j = filled; j > 0 && top[j - 1] < v; j--)
+			top[j] = top[j - 1];
+		top[j] = v;
+		filled++;
+	}
+	return top[count - 1];
+}
+
+void PERFSTAT_GetStats(int counter, PERFSTAT_stats_t *stats)
+{
+	ULONG const *values = history[counter];
+	ULONG min;
+	double sum = 0;
+	int i;
+
+	stats->name = names[counter];
+	if (counter == PERFSTAT_TOTAL) {
+		stats->calls = 0;
+		for (i = 0; i < PERFSTAT_TOTAL; i++)
+			stats->calls += last_calls[i];
+	}
+	else
+		stats->calls = last_calls[counter];
+	if (history_len == 0) {
+		stats->min_ns = stats->avg_ns = stats->p99_ns = 0;
+		return;
+	}
+	/* The order does not matter, so the oldest entries need not be found. */
+	min = values[0];
+	for (i = 0; i < history_len; i++) {
+		if (values[i] < min)
+			min = values[i];
+		sum += values[i];
+	}
+	stats->min_ns = min * ns_per_tick;
+	stats->avg_ns = sum / history_len * ns_per_tick;
+	stats->p99_ns = Percentile99(values, history_len) * ns_per_tick;
+}
+
+void PERFSTAT_Start(void)
+{
+	memset(frame_ticks, 0, sizeof(frame_ticks));
+	memset(frame_calls, 0, sizeof(frame_calls));
+	memset(last_calls, 0, sizeof(last_calls));
+	history_pos = 0;
+	history_len = 0;
+	depth = 0;
+#ifdef CALIBRATE_TICKS
+	if (ns_per_tick == 0) {
+		/* A first estimate, refined every second while running. */
+		double start = Util_time();
+		ULONG start_ticks = Ticks();
+		double time;
+		do
+			time = Util_time();
+		while (time - start < 0.01);
+		ns_per_tick = (time - start) * 1e9 / (ULONG) (Ticks() - start_ticks);
+	}
+	calibrate_time = calibrate_frame_time = Util_time();
+	calibrate_ticks = 0;
+	calibrate_last = Ticks();
+#else
+	ns_per_tick = 1000;
+#endif
+	PERFSTAT_enabled = TRUE;
+}
+
+void PERFSTAT_Stop(void)
+{
+	PERFSTAT_enabled = FALSE;
+}
+
+int PERFSTAT_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		if (strcmp(argv[i], "-perfstats") == 0) {
+#ifndef BASIC
+			Screen_show_perf_stats = TRUE;
+#endif
+			PERFSTAT_Start();
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0)
+				Log_print("\t-perfstats       Show host time spent in each part of the emulator");
+			argv[j++] = argv[i];
+		}
+	}
+	*argc = j;
+	return TRUE;
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,65 @@
+#ifndef PERFSTAT_H_
+#define PERFSTAT_H_
+
+#include "atari.h"
+
+/* Host time spent in the main parts of the emulator. Each counter
+   accumulates the time spent in its part, excluding the time spent in
+   other counted parts called from it (so ANTIC does not include the CPU
+   emulation and POKEY scanlines that ANTIC_Frame() runs), and the number
+   of calls. The totals of the last PERFSTAT_HISTORY frames are kept. */
+
+enum {
+	PERFSTAT_CPU,		/* CPU_GO() */
+	PERFSTAT_ANTIC,		/* ANTIC_Frame(): display list, drawing, PMG DMA */
+	PERFSTAT_POKEY,		/* POKEY_Scanline() */
+	PERFSTAT_SOUND,		/* Sound_Update() */
+	PERFSTAT_BLIT,		/* PLATFORM_DisplayScreen() */
+	PERFSTAT_EXPORT,	/* File_Export_WriteVideo() */
+	PERFSTAT_TOTAL,		/* sum of the above; cannot be entered */
+	PERFSTAT_COUNTERS
+};
+
+#define PERFSTAT_HISTORY 512
+
+typedef struct {
+	const char *name;
+	ULONG calls;		/* calls in the last frame */
+	double min_ns;		/* host nanoseconds per frame over the history */
+	double avg_ns;
+	double p99_ns;
+} PERFSTAT_stats_t;
+
+/* TRUE while counting. */
+extern int PERFSTAT_enabled;
+
+int PERFSTAT_Initialise(int *argc, char *argv[]);
+
+/* Starts counting with an empty history. Must not be called from within
+   a counted part. */
+void PERFSTAT_Start(void);
+void PERFSTAT_Stop(void);
+
+/* Marks the entry to and the exit from the part COUNTER. */
+void PERFSTAT_Enter(int counter);
+void PERFSTAT_Leave(void);
+
+/* Must be called once per frame, outside the counted parts. */
+void PERFSTAT_Frame(void);
+
+/* Fills STATS with the statistics of COUNTER. */
+void PERFSTAT_GetStats(int counter, PERFSTAT_stats_t *stats);
+
+#define PERFSTAT_ENTER(counter) \
+	do { \
+		if (PERFSTAT_enabled) \
+			PERFSTAT_Enter(counter); \
+	} while (0)
+
+#define PERFSTAT_LEAVE() \
+	do { \
+		if (PERFSTAT_enabled) \
+			PERFSTAT_Leave(); \
+	} while (0)
+
+#endif /* PERFSTAT_H_ */
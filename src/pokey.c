@@ -49,6 +49,7 @@
 #include "log.h"
 #include "input.h"
 #include "pbi.h"
+#include "perfstat.h"
 #ifdef NETSIO
 #include "netsio.h"
 #endif
@@ -506,7 +507,7 @@ void POKEY_Frame(void)
  ** for most applications                                                 **
  ***************************************************************************/
 
-void POKEY_Scanline(void)
+static void Scanline(void)
 {
 #ifdef POKEYREC
     POKEYREC_Recorder();
@@ -642,6 +643,13 @@ void POKEY_Scanline(void)
 #endif /* NETSIO */
 }
 
+void POKEY_Scanline(void)
+{
+	PERFSTAT_ENTER(PERFSTAT_POKEY);
+	Scanline();
+	PERFSTAT_LEAVE();
+}
+
 /*****************************************************************************/
 /* Module:  Update_Counter()                                                 */
 /* Purpose: To process the latest control values stored in the AUDF, AUDC,   */
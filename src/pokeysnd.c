@@ -45,6 +45,10 @@
 #include "antic.h"
 #include "gtia.h"
 #include "util.h"
+#ifdef SOUND_THREAD
+#include <pthread.h>
+#include "log.h"
+#endif
 
 #ifdef WORDS_UNALIGNED_OK
 #  define READ_U32(x)     (*(ULONG *) (x))
@@ -144,6 +148,7 @@ int mz_clear_regs = 0;
 
 int POKEYSND_enable_new_pokey = TRUE;
 int POKEYSND_bienias_fix = TRUE;  /* when TRUE, high frequencies get emulated: better sound but slower */
+int POKEYSND_resampler = POKEYSND_RESAMPLER_DOUBLE;
 #if defined(__PLUS) && !defined(_WX_)
 #define BIENIAS_FIX (g_Sound.nBieniasFix)
 #else
@@ -171,11 +176,13 @@ static void Update_consol_sound_rf(int set);
 static void null_consol_sound(int set) {}
 void (*POKEYSND_UpdateConsol_ptr)(int set) = null_consol_sound;
 int POKEYSND_console_sound_enabled = 1;
+int POKEYSND_speaker = 0;
 #endif
 
 UBYTE *POKEYSND_process_buffer = NULL;
 unsigned int POKEYSND_process_buffer_length;
 unsigned int POKEYSND_process_buffer_fill;
+UBYTE *POKEYSND_frame_buffer = NULL;
 static unsigned int prev_update_tick;
 
 static void Generate_sync_rf(unsigned int num_ticks);
@@ -235,6 +242,9 @@ static int pokeysnd_init_rf(ULONG freq17, int playback_freq,
 
 int POKEYSND_DoInit(void)
 {
+#ifdef SOUND_THREAD
+	POKEYSND_StopThread();
+#endif
 #ifdef AUDIO_RECORDING
 	File_Export_StopRecording();
 #endif
@@ -258,6 +268,9 @@ int POKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
 #endif
 )
 {
+#ifdef SOUND_THREAD
+	POKEYSND_StopThread();
+#endif
 	snd_freq17 = freq17;
 	POKEYSND_playback_freq = playback_freq;
 	POKEYSND_num_pokeys = num_pokeys;
@@ -308,18 +321,239 @@ static void Update_synchronized_sound(void)
 	prev_update_tick = ANTIC_CPU_CLOCK;
 }
 
+#ifdef SOUND_THREAD
+int POKEYSND_thread_enabled = FALSE;
+
+/* The emulation thread passes register writes to the synthesis thread through
+   a single-producer single-consumer ring. queue_write is only written by the
+   emulation thread and queue_read only by the synthesis thread, so the ring
+   itself needs no lock; the mutex and conditions only put either thread to
+   sleep when it has nothing to do. */
+enum {
+	EVENT_CONSOL = 0x100,	/* val = GTIA_speaker */
+	EVENT_FRAME = 0x101,	/* end of a frame */
+	QUEUE_SIZE = 8192		/* must be a power of 2 */
+};
+typedef struct {
+	unsigned int tick;		/* ANTIC_CPU_CLOCK of the write */
+	UWORD addr;				/* POKEY register, or EVENT_* */
+	UBYTE val;
+	UBYTE chip;
+	UBYTE gain;
+} event_t;
+static event_t queue[QUEUE_SIZE];
+static volatile unsigned int queue_write;
+static volatile unsigned int queue_read;
+
+static pthread_t thread;
+static pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t thread_cond = PTHREAD_COND_INITIALIZER;	/* wakes the synthesis thread */
+static pthread_cond_t emu_cond = PTHREAD_COND_INITIALIZER;	/* wakes the emulation thread */
+static int thread_running = FALSE;
+static volatile int thread_quit;
+
+/* Tick up to which the synthesis thread has produced sound. */
+static unsigned int thread_tick;
+/* Samples of the last two finished frames. Frame N is stored in
+   frame_buffers[N % 2], which the synthesis thread swaps with
+   POKEYSND_process_buffer at the end of the frame. */
+static UBYTE *frame_buffers[2];
+static unsigned int frame_fill[2];
+static volatile unsigned int frames_done;
+static unsigned int frames_queued;
+
+/* Accesses to the ring indexes that order the accesses to the ring. */
+static unsigned int LoadAcquire(volatile unsigned int *p)
+{
+#if defined(__ATOMIC_ACQUIRE)
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#elif defined(__GNUC__)
+	unsigned int v = *p;
+	__sync_synchronize();
+	return v;
+#else
+	return *p;
+#endif
+}
+
+static void StoreRelease(volatile unsigned int *p, unsigned int v)
+{
+#if defined(__ATOMIC_RELEASE)
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+#elif defined(__GNUC__)
+	__sync_synchronize();
+	*p = v;
+#else
+	*p = v;
+#endif
+}
+
+static void ProcessEvent(event_t const *e)
+{
+	POKEYSND_GenerateSync(e->tick - thread_tick);
+	thread_tick = e->tick;
+	switch (e->addr) {
+	case EVENT_FRAME:
+		{
+			unsigned int slot = frames_done % 2;
+			UBYTE *buffer = frame_buffers[slot];
+			frame_buffers[slot] = POKEYSND_process_buffer;
+			frame_fill[slot] = POKEYSND_process_buffer_fill;
+			POKEYSND_process_buffer = buffer;
+			POKEYSND_process_buffer_fill = 0;
+		}
+		StoreRelease(&frames_done, frames_done + 1);
+		pthread_mutex_lock(&thread_mutex);
+		pthread_cond_signal(&emu_cond);
+		pthread_mutex_unlock(&thread_mutex);
+		break;
+#ifdef CONSOLE_SOUND
+	case EVENT_CONSOL:
+		POKEYSND_speaker = e->val;
+		POKEYSND_UpdateConsol_ptr(1);
+		break;
+#endif
+	default:
+		POKEYSND_Update_ptr(e->addr, e->val, e->chip, e->gain);
+		break;
+	}
+}
+
+static void *SynthesisThread(void *arg)
+{
+	for (;;) {
+		unsigned int write = LoadAcquire(&queue_write);
+		if (queue_read == write) {
+			pthread_mutex_lock(&thread_mutex);
+			/* The emulation thread may be waiting for room in the queue. */
+			pthread_cond_signal(&emu_cond);
+			while (queue_read == queue_write && !thread_quit)
+				pthread_cond_wait(&thread_cond, &thread_mutex);
+			if (queue_read == queue_write) {
+				pthread_mutex_unlock(&thread_mutex);
+				break;
+			}
+			pthread_mutex_unlock(&thread_mutex);
+			continue;
+		}
+		do {
+			ProcessEvent(&queue[queue_read % QUEUE_SIZE]);
+			StoreRelease(&queue_read, queue_read + 1);
+		} while (queue_read != write);
+	}
+	return NULL;
+}
+
+static void QueueEvent(UWORD addr, UBYTE val, UBYTE chip, UBYTE gain)
+{
+	event_t *e;
+	if (queue_write - LoadAcquire(&queue_read) == QUEUE_SIZE) {
+		pthread_mutex_lock(&thread_mutex);
+		pthread_cond_signal(&thread_cond);
+		while (queue_write - queue_read == QUEUE_SIZE)
+			pthread_cond_wait(&emu_cond, &thread_mutex);
+		pthread_mutex_unlock(&thread_mutex);
+	}
+	e = &queue[queue_write % QUEUE_SIZE];
+	e->tick = ANTIC_CPU_CLOCK;
+	e->addr = addr;
+	e->val = val;
+	e->chip = chip;
+	e->gain = gain;
+	StoreRelease(&queue_write, queue_write + 1);
+}
+
+static void StartThread(void)
+{
+	int i;
+	for (i = 0; i < 2; i++) {
+		frame_buffers[i] = (UBYTE *)Util_malloc(POKEYSND_process_buffer_length);
+		frame_fill[i] = 0;
+	}
+	queue_write = queue_read = 0;
+	frames_done = frames_queued = 0;
+	thread_quit = FALSE;
+	thread_tick = prev_update_tick;
+	if (pthread_create(&thread, NULL, SynthesisThread, NULL) != 0) {
+		Log_print("Cannot create the sound synthesis thread");
+		POKEYSND_thread_enabled = FALSE;
+		for (i = 0; i < 2; i++)
+			free(frame_buffers[i]);
+		return;
+	}
+	thread_running = TRUE;
+}
+
+void POKEYSND_StopThread(void)
+{
+	int i;
+	if (!thread_running)
+		return;
+	pthread_mutex_lock(&thread_mutex);
+	thread_quit = TRUE;
+	pthread_cond_signal(&thread_cond);
+	pthread_mutex_unlock(&thread_mutex);
+	pthread_join(thread, NULL);
+	thread_running = FALSE;
+	/* The samples of the last finished frame are dropped; the ones of the
+	   current frame stay in POKEYSND_process_buffer. */
+	prev_update_tick = thread_tick;
+	for (i = 0; i < 2; i++) {
+		free(frame_buffers[i]);
+		frame_buffers[i] = NULL;
+	}
+	POKEYSND_frame_buffer = POKEYSND_process_buffer;
+}
+
+/* Queues the end of the frame and collects the previous one. */
+static int UpdateThreaded(void)
+{
+	unsigned int slot;
+	QueueEvent(EVENT_FRAME, 0, 0, 0);
+	pthread_mutex_lock(&thread_mutex);
+	pthread_cond_signal(&thread_cond);
+	if (++frames_queued == 1) {
+		/* No frame has been finished yet. */
+		pthread_mutex_unlock(&thread_mutex);
+		return 0;
+	}
+	while (LoadAcquire(&frames_done) < frames_queued - 1)
+		pthread_cond_wait(&emu_cond, &thread_mutex);
+	pthread_mutex_unlock(&thread_mutex);
+	slot = (frames_queued - 2) % 2;
+	POKEYSND_frame_buffer = frame_buffers[slot];
+	return frame_fill[slot] / ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1);
+}
+#endif /* SOUND_THREAD */
+
 int POKEYSND_UpdateProcessBuffer(void)
 {
 	int sndn;
-	Update_synchronized_sound();
-	sndn = POKEYSND_process_buffer_fill / ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1);
-	POKEYSND_process_buffer_fill = 0;
+#ifdef SOUND_THREAD
+	if (thread_running && !(POKEYSND_thread_enabled && POKEYSND_enable_new_pokey))
+		POKEYSND_StopThread();
+	if (thread_running)
+		sndn = UpdateThreaded();
+	else
+#endif /* SOUND_THREAD */
+	{
+		Update_synchronized_sound();
+		sndn = POKEYSND_process_buffer_fill / ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1);
+		POKEYSND_process_buffer_fill = 0;
+		POKEYSND_frame_buffer = POKEYSND_process_buffer;
+#ifdef SOUND_THREAD
+		/* The low fidelity engine reads the POKEY registers directly and
+		   cannot run in a separate thread. */
+		if (POKEYSND_thread_enabled && POKEYSND_enable_new_pokey)
+			StartThread();
+#endif /* SOUND_THREAD */
+	}
 
 #if defined(PBI_XLD) || defined (VOICEBOX)
-	VOTRAXSND_Process(POKEYSND_process_buffer, sndn);
+	VOTRAXSND_Process(POKEYSND_frame_buffer, sndn);
 #endif
 #if defined(AUDIO_RECORDING)
-	File_Export_WriteAudio((const unsigned char *)POKEYSND_process_buffer, sndn);
+	File_Export_WriteAudio((const unsigned char *)POKEYSND_frame_buffer, sndn);
 #endif
 	return sndn;
 }
@@ -395,6 +629,12 @@ static int pokeysnd_init_rf(ULONG freq17, int playback_freq,
 
 void POKEYSND_Update(UWORD addr, UBYTE val, UBYTE chip, UBYTE gain)
 {
+#ifdef SOUND_THREAD
+	if (thread_running) {
+		QueueEvent(addr, val, chip, gain);
+		return;
+	}
+#endif
     Update_synchronized_sound();
 	POKEYSND_Update_ptr(addr, val, chip, gain);
 }
@@ -1097,15 +1337,24 @@ void POKEYSND_UpdateConsol(int set)
 {
 	if (!POKEYSND_console_sound_enabled)
 		return;
-	if (set)
+#ifdef SOUND_THREAD
+	if (thread_running) {
+		if (set)
+			QueueEvent(EVENT_CONSOL, (UBYTE)GTIA_speaker, 0, 0);
+		return;
+	}
+#endif
+	if (set) {
 		Update_synchronized_sound();
+		POKEYSND_speaker = GTIA_speaker;
+	}
 	POKEYSND_UpdateConsol_ptr(set);
 }
 
 static void Update_consol_sound_rf(int set)
 {
 	if (set)
-		speaker = CONSOLE_VOL * GTIA_speaker;
+		speaker = CONSOLE_VOL * POKEYSND_speaker;
 }
 #endif /* CONSOLE_SOUND */
 
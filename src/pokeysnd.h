@@ -87,7 +87,15 @@ extern int POKEYSND_volume;
 extern int POKEYSND_enable_new_pokey;
 extern int POKEYSND_stereo_enabled;
 extern int POKEYSND_console_sound_enabled;
+/* State of the console speaker as seen by the sound engines. Follows
+   GTIA_speaker at every POKEYSND_UpdateConsol(). */
+extern int POKEYSND_speaker;
 extern int POKEYSND_bienias_fix;
+/* Resampler of the high fidelity engine: the double precision reference,
+   or a single precision one using vector instructions, which is faster. */
+#define POKEYSND_RESAMPLER_DOUBLE 0
+#define POKEYSND_RESAMPLER_FLOAT 1
+extern int POKEYSND_resampler;
 
 extern void (*POKEYSND_Process_ptr)(void *sndbuffer, int sndn);
 extern void (*POKEYSND_Update_ptr)(UWORD addr, UBYTE val, UBYTE chip, UBYTE gain);
@@ -114,7 +122,24 @@ extern UBYTE *POKEYSND_process_buffer;
 extern unsigned int POKEYSND_process_buffer_length;
 extern unsigned int POKEYSND_process_buffer_fill;
 extern void (*POKEYSND_GenerateSync)(unsigned int num_ticks);
+/* Brings the sound emulation up to the current CPU tick and returns the number
+   of samples produced since the previous call. The samples are stored in
+   POKEYSND_frame_buffer. */
 int POKEYSND_UpdateProcessBuffer(void);
+extern UBYTE *POKEYSND_frame_buffer;
+
+#ifdef SOUND_THREAD
+/* When TRUE and the high fidelity engine is used, POKEYSND_UpdateProcessBuffer()
+   moves the synthesis to a separate thread. POKEYSND_Update() and
+   POKEYSND_UpdateConsol() then only queue the register writes with their CPU
+   tick, and the thread runs the synthesis and resampling while the next frame
+   is emulated. Each POKEYSND_UpdateProcessBuffer() returns the samples of the
+   previous frame, which adds one frame of latency. */
+extern int POKEYSND_thread_enabled;
+/* Waits until the synthesis thread has processed all queued writes and stops
+   it. Does nothing if the thread is not running. */
+void POKEYSND_StopThread(void);
+#endif /* SOUND_THREAD */
 
 #ifdef __cplusplus
 }
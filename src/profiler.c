@@ -0,0 +1,388 @@
+/*
+ * profiler.c - sampling profiler for the emulated 6502
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "antic.h"
+#include "atari.h"
+#include "log.h"
+#include "memory.h"
+#include "monitor.h"
+#include "profiler.h"
+#include "util.h"
+
+int PROFILER_enabled = FALSE;
+int PROFILER_sample_xpos = INT_MAX;
+unsigned int PROFILER_next_sample;
+unsigned int PROFILER_cpu_cycles = 0;
+unsigned int PROFILER_wsync_cycles = 0;
+
+/* Machine cycles between two samples. A prime, so that the samples do not
+   follow the scanlines. */
+static int period = 997;
+/* Size of the PC ranges the samples are attributed to, a power of two. */
+static int range_size = 16;
+
+static char stacks_name[FILENAME_MAX];
+static char frames_name[FILENAME_MAX];
+static FILE *stacks_file = NULL;
+static FILE *frames_file = NULL;
+
+/* Machine cycles of the last WSYNC halt. */
+static unsigned int wsync_start;
+static unsigned int wsync_end;
+
+/* Counters at the start of the current frame. */
+static unsigned int frame_clock;
+static unsigned int frame_cpu;
+static unsigned int frame_wsync;
+static int frame_valid;
+
+#define MAX_DEPTH 32
+
+enum {
+	TAG_CPU,
+	TAG_DMA,
+	TAG_WSYNC
+};
+
+/* A distinct call stack and the number of samples taken in it. addr[] holds
+   the called subroutines, outermost first, followed by the PC range. */
+typedef struct {
+	unsigned long samples;
+	UWORD depth;
+	UWORD tag;
+	UWORD addr[MAX_DEPTH + 1];
+} callstack_t;
+
+static callstack_t *stacks = NULL;
+static unsigned int stacks_mask;
+static unsigned int stacks_count;
+
+/* Converts an ANTIC_xpos in the current scanline to a machine cycle. */
+static unsigned int Clock(int xpos)
+{
+#ifdef NEW_CYCLE_EXACT
+	if (ANTIC_DRAWING_SCREEN)
+		return ANTIC_screenline_cpu_clock + ANTIC_cpu2antic_ptr[xpos];
+#endif
+	return ANTIC_screenline_cpu_clock + xpos;
+}
+
+/* Returns the ANTIC_xpos at which the next sample is due, or INT_MAX if it
+   is not due before the end of the current scanline. */
+static int SampleXpos(void)
+{
+	int cycle = (int) (PROFILER_next_sample - ANTIC_screenline_cpu_clock);
+#ifdef NEW_CYCLE_EXACT
+	if (ANTIC_DRAWING_SCREEN && cycle >= 0) {
+		if (cycle > ANTIC_LINE_C)
+			return INT_MAX;
+		return ANTIC_antic2cpu_ptr[cycle];
+	}
+#endif
+	return cycle;
+}
+
+static unsigned int Hash(const UWORD *addr, int n, int tag)
+{
+	unsigned int h = 2166136261U ^ tag;
+	int i;
+	for (i = 0; i < n; i++)
+		h = (h ^ addr[i]) * 16777619U;
+	return h;
+}
+
+static void GrowStacks(void)
+{
+	callstack_t *old = stacks;
+	unsigned int old_size = old == NULL ? 0 : stacks_mask + 1;
+	unsigned int size = old == NULL ? 1024 : old_size * 2;
+	unsigned int i;
+	stacks = (callstack_t *) Util_malloc(size * sizeof(callstack_t));
+	memset(stacks, 0, size * sizeof(callstack_t));
+	stacks_mask = size - 1;
+	for (i = 0; i < old_size; i++) {
+		if (old[i].samples != 0) {
+			unsigned int j = Hash(old[i].addr, old[i].depth, old[i].tag) & stacks_mask;
+			while (stacks[j].samples != 0)
+				j = (j + 1) & stacks_mask;
+			stacks[j] = old[i];
+		}
+	}
+	free(old);
+}
+
+static void AddSample(const UWORD *addr, int n, int tag)
+{
+	unsigned int i;
+	if (stacks_count >= (stacks_mask + 1) / 2)
+		GrowStacks();
+	for (i = Hash(addr, n, tag) & stacks_mask; stacks[i].samples != 0; i = (i + 1) & stacks_mask) {
+		if (stacks[i].depth == n && stacks[i].tag == tag
+		 && memcmp(stacks[i].addr, addr, n * sizeof(UWORD)) == 0) {
+			stacks[i].samples++;
+			return;
+		}
+	}
+	stacks[i].samples = 1;
+	stacks[i].depth = n;
+	stacks[i].tag = tag;
+	memcpy(stacks[i].addr, addr, n * sizeof(UWORD));
+	stacks_count++;
+}
+
+/* Finds the return addresses pushed by JSR instructions on the 6502 stack
+   above S and stores the called subroutines in ADDR, outermost first.
+   Other bytes on the stack are skipped; a byte pair that happens to point
+   after a JSR opcode is taken as a return address. */
+static int FindCallers(UBYTE s, UWORD *addr)
+{
+	UWORD found[MAX_DEPTH];
+	int n = 0;
+	int i;
+	int p;
+	for (p = s + 1; p < 0xff && n < MAX_DEPTH; p++) {
+		UWORD ret = MEMORY_dGetByte(0x100 + p) | (MEMORY_dGetByte(0x101 + p) << 8);
+		UWORD jsr = (UWORD) (ret - 2);
+		if (MEMORY_dGetByte(jsr) == 0x20) {
+			found[n++] = MEMORY_dGetByte((UWORD) (jsr + 1)) | (MEMORY_dGetByte((UWORD) (jsr + 2)) << 8);
+			p++;
+		}
+	}
+	for (i = 0; i < n; i++)
+		addr[i] = found[n - 1 - i];
+	return n;
+}
+
+void PROFILER_Sample(UWORD pc, UBYTE s, int in_gap)
+{
+	unsigned int now = Clock(ANTIC_xpos);
+	while ((int) (PROFILER_next_sample - now) <= 0) {
+		if (stacks_file != NULL) {
+			UWORD addr[MAX_DEPTH + 1];
+			int n = FindCallers(s, addr);
+			int tag = TAG_CPU;
+			if ((int) (PROFILER_next_sample - wsync_start) >= 0 && (int) (PROFILER_next_sample - wsync_end) < 0)
+				tag = TAG_WSYNC;
+			else if (in_gap)
+				tag = TAG_DMA;
+#ifdef NEW_CYCLE_EXACT
+			else if (ANTIC_DRAWING_SCREEN) {
+				/* A cycle stolen by ANTIC maps to the next CPU cycle. */
+				int cycle = (int) (PROFILER_next_sample - ANTIC_screenline_cpu_clock);
+				if (cycle >= 0 && cycle < ANTIC_LINE_C
+				 && ANTIC_cpu2antic_ptr[ANTIC_antic2cpu_ptr[cycle]] != cycle)
+					tag = TAG_DMA;
+			}
+#endif
+			addr[n++] = pc & ~(range_size - 1);
+			AddSample(addr, n, tag);
+		}
+		PROFILER_next_sample += period;
+	}
+	PROFILER_sample_xpos = SampleXpos();
+}
+
+void PROFILER_WsyncSkip(int from_xpos)
+{
+	PROFILER_wsync_cycles += ANTIC_xpos - from_xpos;
+	if (PROFILER_enabled) {
+		/* Keep the previous interval if a sample in it is still pending. */
+		if ((int) (PROFILER_next_sample - wsync_end) >= 0)
+			wsync_start = Clock(from_xpos);
+		wsync_end = Clock(ANTIC_xpos);
+	}
+}
+
+void PROFILER_Frame(void)
+{
+	unsigned int clock;
+	if (frames_file == NULL)
+		return;
+	clock = ANTIC_CPU_CLOCK;
+	if (frame_valid) {
+		unsigned int total = clock - frame_clock;
+		unsigned int cpu = PROFILER_cpu_cycles - frame_cpu;
+		unsigned int wsync = PROFILER_wsync_cycles - frame_wsync;
+		fprintf(frames_file, "%d,%u,%u,%d,%u\n", Atari800_nframes - 1, total, cpu,
+		        (int) (total - cpu - wsync), wsync);
+	}
+	frame_clock = clock;
+	frame_cpu = PROFILER_cpu_cycles;
+	frame_wsync = PROFILER_wsync_cycles;
+	frame_valid = TRUE;
+}
+
+static void WriteName(UWORD addr)
+{
+#ifdef MONITOR_HINTS
+	const char *name = MONITOR_LabelName(addr);
+	if (name != NULL) {
+		fputs(name, stacks_file);
+		return;
+	}
+#endif
+	fprintf(stacks_file, "$%04X", addr);
+}
+
+static void WriteStacks(void)
+{
+	static const char *tag_names[] = { "", ";[DMA]", ";[WSYNC]" };
+	unsigned int i;
+	int j;
+	for (i = 0; i <= stacks_mask; i++) {
+		const callstack_t *st = &stacks[i];
+		if (st->samples == 0)
+			continue;
+		for (j = 0; j < st->depth - 1; j++) {
+			WriteName(st->addr[j]);
+			fputc(';', stacks_file);
+		}
+		if (range_size == 1)
+			WriteName(st->addr[j]);
+		else
+			fprintf(stacks_file, "$%04X-$%04X", st->addr[j], st->addr[j] + range_size - 1);
+		fprintf(stacks_file, "%s %lu\n", tag_names[st->tag], st->samples * period);
+	}
+}
+
+int PROFILER_Start(const char *stacks_filename, const char *frames_filename)
+{
+	PROFILER_Stop();
+	if (stacks_filename != NULL) {
+		stacks_file = fopen(stacks_filename, "w");
+		if (stacks_file == NULL) {
+			Log_print("Cannot create profile file %s", stacks_filename);
+			return FALSE;
+		}
+		GrowStacks();
+		stacks_count = 0;
+	}
+	if (frames_filename != NULL) {
+		frames_file = fopen(frames_filename, "w");
+		if (frames_file == NULL) {
+			Log_print("Cannot create profile file %s", frames_filename);
+			PROFILER_Stop();
+			return FALSE;
+		}
+		fprintf(frames_file, "frame,total,cpu,dma,wsync\n");
+		frame_valid = FALSE;
+	}
+	PROFILER_next_sample = ANTIC_CPU_CLOCK + period;
+	wsync_start = wsync_end = PROFILER_next_sample;
+	PROFILER_enabled = stacks_file != NULL;
+	PROFILER_sample_xpos = INT_MAX;
+	return TRUE;
+}
+
+void PROFILER_Stop(void)
+{
+	PROFILER_enabled = FALSE;
+	PROFILER_sample_xpos = INT_MAX;
+	if (stacks_file != NULL) {
+		WriteStacks();
+		fclose(stacks_file);
+		stacks_file = NULL;
+	}
+	free(stacks);
+	stacks = NULL;
+	if (frames_file != NULL) {
+		fclose(frames_file);
+		frames_file = NULL;
+	}
+}
+
+int PROFILER_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-profile") == 0) {
+			if (i_a)
+				Util_strlcpy(stacks_name, argv[++i], sizeof(stacks_name));
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-profile-frames") == 0) {
+			if (i_a)
+				Util_strlcpy(frames_name, argv[++i], sizeof(frames_name));
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-profile-period") == 0) {
+			if (i_a) {
+				period = Util_sscandec(argv[++i]);
+				if (period <= 0) {
+					Log_print("Invalid profile sampling period");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-profile-range") == 0) {
+			if (i_a) {
+				range_size = Util_sscandec(argv[++i]);
+				if (range_size <= 0 || range_size > 0x10000 || (range_size & (range_size - 1)) != 0) {
+					Log_print("Invalid profile range size");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-profile <file>        Write 6502 call stack samples for flame graphs");
+				Log_print("\t-profile-frames <file> Write the cycle budget of every frame");
+				Log_print("\t-profile-period <n>    Sample every <n> cycles");
+				Log_print("\t-profile-range <n>     Size of the sampled PC ranges");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	if (stacks_name[0] != '\0' || frames_name[0] != '\0')
+		return PROFILER_Start(stacks_name[0] != '\0' ? stacks_name : NULL,
+		                      frames_name[0] != '\0' ? frames_name : NULL);
+	return TRUE;
+}
+
+void PROFILER_Exit(void)
+{
+	PROFILER_Stop();
+}
+
+/*
+vim:ts=4:sw=4:
+*/
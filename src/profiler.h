@@ -0,0 +1,57 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "atari.h"
+
+/* Sampling profiler for the emulated 6502. Every PROFILER_period machine
+   cycles, the instruction being executed and the JSR call stack found on
+   the 6502 stack are recorded. The samples are written as collapsed stacks
+   ("caller;callee;range cycles" lines) for flame graph tools. Samples taken
+   while ANTIC steals the cycle or while the CPU waits for WSYNC end in a
+   [DMA] or [WSYNC] frame below the code that was stalled.
+
+   Independently of the sampling, the cycles of each frame are split into
+   those executed by the CPU, those stolen by ANTIC and those spent halted
+   on WSYNC, and can be written as one CSV line per frame. */
+
+#ifdef PROFILER
+
+/* TRUE while sampling. */
+extern int PROFILER_enabled;
+
+/* ANTIC_xpos at which the CPU emulation takes the next sample. Updated by
+   PROFILER_Sample() and set to INT_MAX when sampling starts or stops. */
+extern int PROFILER_sample_xpos;
+
+/* Machine cycle (ANTIC_CPU_CLOCK) at which the next sample is due. */
+extern unsigned int PROFILER_next_sample;
+
+/* Cycles executed by the CPU and cycles halted by WSYNC since the start of
+   the emulation. They wrap around. */
+extern unsigned int PROFILER_cpu_cycles;
+extern unsigned int PROFILER_wsync_cycles;
+
+int PROFILER_Initialise(int *argc, char *argv[]);
+void PROFILER_Exit(void);
+
+/* Starts sampling into STACKS_FILENAME and writing the cycle budget of each
+   frame to FRAMES_FILENAME. Either may be NULL. */
+int PROFILER_Start(const char *stacks_filename, const char *frames_filename);
+/* Writes out the samples and closes the files. */
+void PROFILER_Stop(void);
+
+/* Takes the samples that are due, with the CPU at PC and its stack pointer
+   at S, and updates PROFILER_sample_xpos. IN_GAP is TRUE when the CPU has
+   not run since the previous call. */
+void PROFILER_Sample(UWORD pc, UBYTE s, int in_gap);
+
+/* Records that WSYNC moved ANTIC_xpos from FROM_XPOS to the current
+   position. */
+void PROFILER_WsyncSkip(int from_xpos);
+
+/* Must be called once per frame, before ANTIC_Frame(). */
+void PROFILER_Frame(void);
+
+#endif /* PROFILER */
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,382 @@
+/*
+ * rewind.c - in-memory history of the emulation for rewinding
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "input.h"
+#include "log.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "statesav.h"
+#include "util.h"
+
+int REWIND_enabled = FALSE;
+int REWIND_interval = 30;
+int REWIND_budget = 16384;
+
+/* One snapshot and the input of the frames that follow it. */
+typedef struct {
+	int frame;					/* Atari800_nframes at the snapshot */
+	Snapshot_delta_t *delta;	/* against the previous entry; the oldest
+								   entry holds the complete state */
+	INPUT_latch_t latch;
+	INPUT_frame_t *inputs;		/* input of frames frame, frame + 1, ... */
+	int n_inputs;
+	int n_alloc;
+} entry_t;
+
+/* The history is a ring of entries, oldest first. */
+static entry_t *entries = NULL;
+static int n_entries = 0;
+static int first_entry = 0;
+static int ring_size = 0;
+
+static ULONG memory_used = 0;
+
+/* State of the newest entry, and a scratch buffer of the same size. */
+static UBYTE *cur_state = NULL;
+static ULONG cur_len = 0;
+static UBYTE *tmp_state = NULL;
+static ULONG state_size = 0;
+
+/* INPUT_last_frame holds the input of the previous frame, still to be
+   stored in the newest entry. */
+static int input_pending = FALSE;
+/* Take a snapshot at the next REWIND_Frame(). */
+static int force_snapshot = FALSE;
+
+static entry_t *Entry(int i)
+{
+	return &entries[(first_entry + i) % ring_size];
+}
+
+static ULONG EntrySize(entry_t const *e)
+{
+	return sizeof(entry_t) + Snapshot_DeltaSize(e->delta) + e->n_alloc * sizeof(INPUT_frame_t);
+}
+
+static void FreeEntry(entry_t *e)
+{
+	memory_used -= EntrySize(e);
+	free(e->delta);
+	free(e->inputs);
+}
+
+static void GrowRing(void)
+{
+	int new_size = ring_size == 0 ? 64 : 2 * ring_size;
+	entry_t *new_entries = (entry_t *) Util_malloc(new_size * sizeof(entry_t));
+	int i;
+	for (i = 0; i < n_entries; i++)
+		new_entries[i] = *Entry(i);
+	free(entries);
+	entries = new_entries;
+	first_entry = 0;
+	ring_size = new_size;
+}
+
+/* Saves the machine state into tmp_state, growing the buffers as needed. */
+static int SaveState(ULONG *len)
+{
+	ULONG size = state_size;
+	if (!StateSav_SaveAtariStateToBuffer(&tmp_state, &size, len))
+		return FALSE;
+	if (size != state_size) {
+		cur_state = (UBYTE *) Util_realloc(cur_state, size);
+		state_size = size;
+	}
+	return TRUE;
+}
+
+/* Rebuilds the state of entry I into tmp_state. */
+static ULONG BuildState(int i)
+{
+	ULONG len = 0;
+	int j;
+	for (j = 0; j <= i; j++)
+		Snapshot_DeltaApply(tmp_state, state_size, &len, Entry(j)->delta);
+	return len;
+}
+
+/* Drops the oldest entries until the history fits in REWIND_budget. The
+   entry that becomes the oldest is rebased to hold the complete state. */
+static void Evict(void)
+{
+	while (n_entries > 1 && memory_used > (ULONG) REWIND_budget * 1024) {
+		entry_t *e = Entry(1);
+		ULONG len = BuildState(1);
+		memory_used -= Snapshot_DeltaSize(e->delta);
+		free(e->delta);
+		e->delta = Snapshot_DeltaCreate(NULL, 0, tmp_state, len, 0);
+		memory_used += Snapshot_DeltaSize(e->delta);
+		FreeEntry(Entry(0));
+		first_entry = (first_entry + 1) % ring_size;
+		n_entries--;
+	}
+}
+
+static int TakeSnapshot(void)
+{
+	entry_t *e;
+	UBYTE *swap;
+	ULONG len;
+
+	if (!SaveState(&len))
+		return FALSE;
+	if (n_entries == ring_size)
+		GrowRing();
+	e = Entry(n_entries++);
+	e->frame = Atari800_nframes;
+	e->delta = Snapshot_DeltaCreate(n_entries > 1 ? cur_state : NULL, cur_len, tmp_state, len, 0);
+	INPUT_GetLatch(&e->latch);
+	e->n_alloc = REWIND_interval;
+	e->n_inputs = 0;
+	e->inputs = (INPUT_frame_t *) Util_malloc(e->n_alloc * sizeof(INPUT_frame_t));
+	memory_used += EntrySize(e);
+
+	swap = cur_state;
+	cur_state = tmp_state;
+	tmp_state = swap;
+	cur_len = len;
+
+	Evict();
+	return TRUE;
+}
+
+/* Stores the input of the previous frame. */
+static void FlushInput(void)
+{
+	if (input_pending && n_entries > 0) {
+		entry_t *e = Entry(n_entries - 1);
+		if (e->n_inputs < e->n_alloc)
+			e->inputs[e->n_inputs++] = INPUT_last_frame;
+	}
+	input_pending = FALSE;
+}
+
+int REWIND_ReadConfig(char *string, char *ptr)
+{
+	if (strcmp(string, "REWIND") == 0) {
+		int value = Util_sscanbool(ptr);
+		if (value < 0)
+			return FALSE;
+		REWIND_enabled = value;
+	}
+	else if (strcmp(string, "REWIND_INTERVAL") == 0) {
+		int value = Util_sscandec(ptr);
+		if (value <= 0)
+			return FALSE;
+		REWIND_interval = value;
+	}
+	else if (strcmp(string, "REWIND_BUDGET") == 0) {
+		int value = Util_sscandec(ptr);
+		if (value <= 0)
+			return FALSE;
+		REWIND_budget = value;
+	}
+	else return FALSE;
+	return TRUE;
+}
+
+void REWIND_WriteConfig(FILE *fp)
+{
+	fprintf(fp, "REWIND=%d\n", REWIND_enabled);
+	fprintf(fp, "REWIND_INTERVAL=%d\n", REWIND_interval);
+	fprintf(fp, "REWIND_BUDGET=%d\n", REWIND_budget);
+}
+
+int REWIND_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-rewind") == 0)
+			REWIND_enabled = TRUE;
+		else if (strcmp(argv[i], "-norewind") == 0)
+			REWIND_enabled = FALSE;
+		else if (strcmp(argv[i], "-rewind-interval") == 0) {
+			if (i_a) {
+				REWIND_interval = Util_sscandec(argv[++i]);
+				if (REWIND_interval <= 0) {
+					Log_print("Invalid rewind interval");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-rewind-budget") == 0) {
+			if (i_a) {
+				REWIND_budget = Util_sscandec(argv[++i]);
+				if (REWIND_budget <= 0) {
+					Log_print("Invalid rewind budget");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-rewind          Record history for rewinding");
+				Log_print("\t-norewind        Do not record history for rewinding");
+				Log_print("\t-rewind-interval <n>  Frames between rewind snapshots");
+				Log_print("\t-rewind-budget <kb>   Memory used for rewind history");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
+
+void REWIND_Exit(void)
+{
+	REWIND_Reset();
+	free(entries);
+	free(cur_state);
+	free(tmp_state);
+	entries = NULL;
+	cur_state = tmp_state = NULL;
+	ring_size = 0;
+	state_size = 0;
+}
+
+void REWIND_Frame(void)
+{
+	if (!REWIND_enabled) {
+		if (n_entries > 0)
+			REWIND_Reset();
+		return;
+	}
+	FlushInput();
+	if (n_entries > 0) {
+		entry_t *e = Entry(n_entries - 1);
+		/* The history must lead up to this frame. */
+		if (e->frame + e->n_inputs != Atari800_nframes)
+			REWIND_Reset();
+		else if (e->n_inputs >= e->n_alloc)
+			force_snapshot = TRUE;
+	}
+	if (n_entries == 0 || force_snapshot) {
+		if (!TakeSnapshot()) {
+			Log_print("Rewind: cannot save the machine state, rewind disabled");
+			REWIND_enabled = FALSE;
+			REWIND_Reset();
+			return;
+		}
+	}
+	force_snapshot = FALSE;
+	input_pending = TRUE;
+}
+
+void REWIND_Mark(void)
+{
+	force_snapshot = TRUE;
+}
+
+void REWIND_Reset(void)
+{
+	while (n_entries > 0)
+		FreeEntry(Entry(--n_entries));
+	first_entry = 0;
+	cur_len = 0;
+	input_pending = FALSE;
+	force_snapshot = FALSE;
+}
+
+int REWIND_SeekFrame(int frame)
+{
+	entry_t *e;
+	INPUT_frame_t const *replay;
+	ULONG len;
+	int i;
+
+	FlushInput();
+	if (n_entries == 0)
+		return FALSE;
+	e = Entry(n_entries - 1);
+	if (frame < Entry(0)->frame || frame > e->frame + e->n_inputs)
+		return FALSE;
+
+	/* Find the last snapshot at or before FRAME and drop the ones after. */
+	for (i = n_entries - 1; Entry(i)->frame > frame; i--)
+		;
+	while (n_entries > i + 1)
+		FreeEntry(Entry(--n_entries));
+	e = Entry(i);
+
+	len = BuildState(i);
+	if (!StateSav_ReadAtariStateFromMemory(tmp_state, len)) {
+		REWIND_Reset();
+		return FALSE;
+	}
+	memcpy(cur_state, tmp_state, len);
+	cur_len = len;
+	INPUT_SetLatch(&e->latch);
+	Atari800_nframes = e->frame;
+
+	/* Replay the input up to FRAME. */
+	replay = INPUT_replay;
+	for (i = 0; Atari800_nframes < frame; i++) {
+		INPUT_replay = &e->inputs[i];
+		Atari800_ReplayFrame();
+	}
+	INPUT_replay = replay;
+	e->n_inputs = i;
+	return TRUE;
+}
+
+int REWIND_StepBack(int frames)
+{
+	int frame = Atari800_nframes - frames;
+	if (n_entries == 0)
+		return FALSE;
+	if (frame < Entry(0)->frame)
+		frame = Entry(0)->frame;
+	return REWIND_SeekFrame(frame);
+}
+
+int REWIND_OldestFrame(void)
+{
+	return n_entries > 0 ? Entry(0)->frame : Atari800_nframes;
+}
+
+ULONG REWIND_MemoryUsed(void)
+{
+	return memory_used;
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,52 @@
+#ifndef REWIND_H_
+#define REWIND_H_
+
+#include <stdio.h>
+#include "atari.h"
+
+/* Rewind keeps a history of the last few seconds or minutes of emulation in
+   memory: a snapshot of the machine state every REWIND_interval frames
+   (stored as a delta against the previous snapshot) plus the host input of
+   every frame in between. Any frame in the history can be restored exactly by
+   loading the snapshot that precedes it and replaying the recorded input. */
+
+extern int REWIND_enabled;
+/* Number of frames between two snapshots. */
+extern int REWIND_interval;
+/* Maximum memory used for the history, in kilobytes. The oldest snapshots are
+   dropped when the history would grow beyond it. */
+extern int REWIND_budget;
+
+int REWIND_ReadConfig(char *string, char *ptr);
+void REWIND_WriteConfig(FILE *fp);
+int REWIND_Initialise(int *argc, char *argv[]);
+void REWIND_Exit(void);
+
+/* Records the current frame. Must be called once per frame, before
+   INPUT_Frame(). */
+void REWIND_Frame(void);
+
+/* Makes the next REWIND_Frame() take a snapshot. Must be called whenever the
+   machine state is changed other than by running frames, e.g. on reset or
+   after loading a state. */
+void REWIND_Mark(void);
+
+/* Discards the whole history. */
+void REWIND_Reset(void);
+
+/* Brings the machine to the state it had at the start of frame FRAME, which
+   must lie between REWIND_OldestFrame() and Atari800_nframes. The history
+   after FRAME is discarded. Returns FALSE if FRAME is not in the history. */
+int REWIND_SeekFrame(int frame);
+
+/* Goes back FRAMES frames, or as far as the history allows. Returns FALSE if
+   there is no history. */
+int REWIND_StepBack(int frames);
+
+/* Returns the earliest frame that can be restored. */
+int REWIND_OldestFrame(void);
+
+/* Returns the memory used by the history in bytes. */
+ULONG REWIND_MemoryUsed(void);
+
+#endif /* REWIND_H_ */
@@ -34,6 +34,7 @@
 #include "cassette.h"
 #include "colours.h"
 #include "log.h"
+#include "perfstat.h"
 #include "pia.h"
 #include "screen.h"
 #include "sio.h"
@@ -52,6 +53,12 @@ ULONG *Screen_atari1 = NULL;
 ULONG *Screen_atari2 = NULL;
 #endif
 
+ULONG Screen_line_stamp[Screen_HEIGHT];
+/* Copy of Screen_atari at the last Screen_TrackLines() call. */
+static UBYTE *tracked_screen = NULL;
+static ULONG track_stamp = 0;
+static int track_all_lines = TRUE;
+
 /* The area that can been seen is Screen_visible_x1 <= x < Screen_visible_x2,
    Screen_visible_y1 <= y < Screen_visible_y2.
    Full Atari screen is 336x240. Screen_WIDTH is 384 only because
@@ -68,6 +75,7 @@ int Screen_show_atari_speed = FALSE;
 int Screen_show_disk_led = TRUE;
 int Screen_show_sector_counter = FALSE;
 int Screen_show_1200_leds = TRUE;
+int Screen_show_perf_stats = FALSE;
 
 #ifdef SCREENSHOTS
 #ifdef HAVE_LIBPNG
@@ -778,6 +786,43 @@ static UBYTE *SmallFont_DrawString(UBYTE *screen, const char *s, UBYTE color1, U
 	return screen;
 }
 
+void Screen_DrawPerfStats(double cur_time)
+{
+	if (Screen_show_perf_stats && PERFSTAT_enabled) {
+		/* Microseconds per frame: minimum, average and 99th percentile. */
+		static int values[PERFSTAT_COUNTERS][3];
+		static const char *names[PERFSTAT_COUNTERS];
+		static double last_time = 0;
+		static int valid = FALSE;
+		UBYTE *screen;
+		int i;
+		if (!valid || (cur_time - last_time) >= 0.5) {
+			for (i = 0; i < PERFSTAT_COUNTERS; i++) {
+				PERFSTAT_stats_t stats;
+				PERFSTAT_GetStats(i, &stats);
+				names[i] = stats.name;
+				values[i][0] = (int) (stats.min_ns / 1000);
+				values[i][1] = (int) (stats.avg_ns / 1000);
+				values[i][2] = (int) (stats.p99_ns / 1000);
+			}
+			last_time = cur_time;
+			valid = TRUE;
+		}
+		/* above the speed meter */
+		screen = (UBYTE *) Screen_atari + Screen_visible_x1
+		         + (Screen_visible_y2 - (PERFSTAT_COUNTERS + 2) * SMALLFONT_HEIGHT) * Screen_WIDTH;
+		SmallFont_DrawString(screen, "USEC     MIN   AVG   P99", 0x0c, 0x00);
+		for (i = 0; i < PERFSTAT_COUNTERS; i++) {
+			screen += SMALLFONT_HEIGHT * Screen_WIDTH;
+			SmallFont_DrawString(screen, "                        ", 0x0c, 0x00);
+			SmallFont_DrawString(screen, names[i], 0x0c, 0x00);
+			SmallFont_DrawInt(screen + 11 * SMALLFONT_WIDTH, values[i][0], 0x0c, 0x00);
+			SmallFont_DrawInt(screen + 17 * SMALLFONT_WIDTH, values[i][1], 0x0c, 0x00);
+			SmallFont_DrawInt(screen + 23 * SMALLFONT_WIDTH, values[i][2], 0x0c, 0x00);
+		}
+	}
+}
+
 #if defined(AUDIO_RECORDING) || defined(VIDEO_RECORDING)
 void Screen_DrawMultimediaStats(void)
 {
@@ -921,4 +966,35 @@ void Screen_EntireDirty(void)
 	if (Screen_dirty)
 		memset(Screen_dirty, 1, Screen_WIDTH * Screen_HEIGHT / 8);
 #endif /* DIRTYRECT */
+	track_all_lines = TRUE;
+}
+
+ULONG Screen_TrackLines(void)
+{
+	UBYTE const *screen = (UBYTE const *) Screen_atari;
+	UBYTE *copy;
+	int changed = FALSE;
+	int y;
+
+	if (tracked_screen == NULL) {
+		tracked_screen = (UBYTE *) Util_malloc(Screen_HEIGHT * Screen_WIDTH);
+		track_all_lines = TRUE;
+	}
+	copy = tracked_screen;
+	/* The stamp is only advanced when something changed, so that a
+	   consumer polling an idle screen sees the same stamp. */
+	for (y = 0; y < Screen_HEIGHT; y++) {
+		if (track_all_lines || memcmp(copy, screen, Screen_WIDTH) != 0) {
+			if (!changed) {
+				changed = TRUE;
+				track_stamp++;
+			}
+			memcpy(copy, screen, Screen_WIDTH);
+			Screen_line_stamp[y] = track_stamp;
+		}
+		copy += Screen_WIDTH;
+		screen += Screen_WIDTH;
+	}
+	track_all_lines = FALSE;
+	return track_stamp;
 }
@@ -44,11 +44,13 @@ extern int Screen_show_disk_led;
 extern int Screen_show_sector_counter;
 extern int Screen_show_1200_leds;
 extern int Screen_show_multimedia_stats;
+extern int Screen_show_perf_stats;
 
 int Screen_Initialise(int *argc, char *argv[]);
 int Screen_ReadConfig(char *string, char *ptr);
 void Screen_WriteConfig(FILE *fp);
 void Screen_DrawAtariSpeed(double);
+void Screen_DrawPerfStats(double);
 void Screen_DrawDiskLED(void);
 void Screen_Draw1200LED(void);
 void Screen_DrawMultimediaStats(void);
@@ -56,6 +58,17 @@ void Screen_FindScreenshotFilename(char *buffer, unsigned bufsize);
 int Screen_SaveScreenshot(const char *filename, int interlaced);
 void Screen_SaveNextScreenshot(int interlaced);
 void Screen_EntireDirty(void);
+
+/* Per-scanline change tracking for the blitters and video codecs.
+   Screen_TrackLines() compares Screen_atari with its contents at the
+   previous call and gives each changed line a new stamp in
+   Screen_line_stamp[]. It returns the current stamp, which is never 0. A
+   consumer remembers the stamp returned when it last used the screen (0 if
+   it never did, or if its output must be redrawn entirely) and needs to
+   redraw only the lines for which Screen_LineChanged() is TRUE. */
+extern ULONG Screen_line_stamp[Screen_HEIGHT];
+ULONG Screen_TrackLines(void);
+#define Screen_LineChanged(y, since) (Screen_line_stamp[y] > (since))
 void Screen_SetStatusText(const char* text, int duration);
 void Screen_DrawStatusText(void);
 
@@ -131,6 +131,7 @@ static int KBD_BREAK = SDLK_F7;
 static int KBD_MON = SDLK_F8;
 static int KBD_EXIT = SDLK_F9;
 static int KBD_SSHOT = SDLK_F10;
+static int KBD_REWIND = SDLK_F11;
 static int KBD_TURBO = SDLK_F12;
 
 /* Each emulated joystick can take its input from host keyboard, an
@@ -789,6 +790,8 @@ int SDL_INPUT_ReadConfig(char *option, char *parameters)
 		return SDLKeyBind(&KBD_SSHOT, parameters);
 	else if (strcmp(option, KEY_SDL"TURBO_KEY") == 0)
 		return SDLKeyBind(&KBD_TURBO, parameters);
+	else if (strcmp(option, KEY_SDL"REWIND_KEY") == 0)
+		return SDLKeyBind(&KBD_REWIND, parameters);
 	else
 		return FALSE;
 }
@@ -831,6 +834,7 @@ void SDL_INPUT_WriteConfig(FILE *fp)
 	fprintf(fp, KEY_SDL"EXIT_KEY=%d\n", KBD_EXIT);
 	fprintf(fp, KEY_SDL"SSHOT_KEY=%d\n", KBD_SSHOT);
 	fprintf(fp, KEY_SDL"TURBO_KEY=%d\n", KBD_TURBO);
+	fprintf(fp, KEY_SDL"REWIND_KEY=%d\n", KBD_REWIND);
 
 	write_real_js_configs(fp);
 }
@@ -1471,6 +1475,10 @@ int PLATFORM_Keyboard(void)
 		key_pressed = 0;
 		return AKEY_TURBO;
 	}
+	if (lastkey == KBD_REWIND && !UI_is_active) {
+		/* not cleared, so that rewinding continues while the key is held */
+		return AKEY_REWIND;
+	}
 	if (UI_alt_function != -1) {
 		key_pressed = 0;
 		return AKEY_UI;
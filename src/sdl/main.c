@@ -40,6 +40,7 @@
 #include "../input.h"
 #include "log.h"
 #include "monitor.h"
+#include "perfstat.h"
 #include "platform.h"
 #ifdef SOUND
 #include "../pokeysnd.h"
@@ -202,8 +203,11 @@ int main(int argc, char **argv)
 #endif
 		SDL_INPUT_Mouse();
 		Atari800_Frame();
-		if (Atari800_display_screen)
+		if (Atari800_display_screen) {
+			PERFSTAT_ENTER(PERFSTAT_BLIT);
 			PLATFORM_DisplayScreen();
+			PERFSTAT_LEAVE();
+		}
 	}
 }
 
@@ -15,7 +15,7 @@ typedef struct SDL_PALETTE_tab_t {
 extern SDL_PALETTE_tab_t const SDL_PALETTE_tab[VIDEOMODE_MODE_SIZE];
 
 typedef union SDL_PALETTE_buffer_t {
-	Uint16 bpp16[256];	/* 16-bit palette */
+	Uint16 bpp16[256];	/* 16-bit palette, padded by bpp32 for BLIT_Expand16() */
 	Uint32 bpp32[256];	/* 32-bit palette */
 	
 } SDL_PALETTE_buffer_t;
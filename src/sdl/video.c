@@ -28,6 +28,7 @@
 #include "bit3.h"
 #include "artifact.h"
 #include "atari.h"
+#include "blit.h"
 #include "colours.h"
 #include "config.h"
 #include "filter_ntsc.h"
@@ -580,57 +581,22 @@ void SDL_VIDEO_BlitNormal8(Uint32 *dest, Uint8 *src, int pitch, int width, int h
 
 void SDL_VIDEO_BlitNormal16(Uint32 *dest, Uint8 *src, int pitch, int width, int height, Uint16 *palette16)
 {
-	register Uint32 quad;
-	register Uint32 *start32 = dest;
-	register Uint8 c;
-	register int pos;
-	int width_32;
-	if (width & 0x01)
-		width_32 = width + 1;
-	else
-		width_32 = width;
+	/* An odd width is rounded up to fill the last 32-bit word. */
+	int width_32 = (width + 1) & ~1;
 	while (height > 0) {
-		pos = width_32;
-		do {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			pos--;
-			c = src[pos];
-			quad = palette16[c];
-			pos--;
-			c = src[pos];
-			quad += palette16[c] << 16;
-#else
-			pos--;
-			c = src[pos];
-			quad = palette16[c] << 16;
-			pos--;
-			c = src[pos];
-			quad += palette16[c];
-#endif
-			start32[pos >> 1] = quad;
-		} while (pos > 0);
+		BLIT_Expand16((UWORD *)dest, src, width_32, palette16);
 		src += Screen_WIDTH;
-		start32 += pitch;
+		dest += pitch;
 		height--;
 	}
 }
 
 void SDL_VIDEO_BlitNormal32(Uint32 *dest, Uint8 *src, int pitch, int width, int height, Uint32 *palette32)
 {
-	register Uint32 quad;
-	register Uint32 *start32 = dest;
-	register Uint8 c;
-	register int pos;
 	while (height > 0) {
-		pos = width;
-		do {
-			pos--;
-			c = src[pos];
-			quad = palette32[c];
-			start32[pos] = quad;
-		} while (pos > 0);
+		BLIT_Expand32((ULONG *)dest, src, width, (ULONG *)palette32);
 		src += Screen_WIDTH;
-		start32 += pitch;
+		dest += pitch;
 		height--;
 	}
 }
@@ -194,6 +194,13 @@ static GLuint screen_pbo;
 
 /* Data for the screen texture. not used when PBOs are used. */
 static GLvoid *screen_texture = NULL;
+/* Screen_TrackLines() stamp of the Atari screen in the display texture, or
+   0 if the texture must be redrawn entirely. */
+static ULONG shown_stamp = 0;
+/* Rows of the display texture changed by the last blit are
+   upload_top <= y < upload_bottom. */
+static int upload_top;
+static int upload_bottom;
 
 /* 16- and 32-bit ARGB textures, both of size 1x2, used for displaying scanlines.
    They contain a transparent black pixel above an opaque black pixel. */
@@ -334,6 +341,7 @@ static void CleanGlContext(void)
 /* Sets up the initial parameters of all used textures and the PBO. */
 static void InitGlTextures(void)
 {
+	shown_stamp = 0;
 	/* Texture for the display surface. */
 	gl.BindTexture(GL_TEXTURE_2D, textures[0]);
 	gl.TexImage2D(GL_TEXTURE_2D, 0, pixel_formats[SDL_VIDEO_GL_pixel_format].internal_format, 1024, 512, 0,
@@ -379,6 +387,7 @@ void SDL_VIDEO_GL_MapRGB(void *dest, int const *palette, int size)
 /* Calculate the palette in the 32-bit BGRA format, or 16-bit BGR 5-6-5 format. */
 static void UpdatePaletteLookup(VIDEOMODE_MODE_t mode)
 {
+	shown_stamp = 0;
 	SDL_VIDEO_UpdatePaletteLookup(mode, bpp_32);
 }
 
@@ -497,6 +506,7 @@ static void SetGlDisplayList(void)
 static void CleanDisplayTexture(void)
 {
 	GLvoid *ptr;
+	shown_stamp = 0;
 	gl.BindTexture(GL_TEXTURE_2D, textures[0]);
 	if (SDL_VIDEO_GL_pbo) {
 		gl.BindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, screen_pbo);
@@ -1039,15 +1049,30 @@ int SDL_VIDEO_GL_SupportsVideomode(VIDEOMODE_MODE_t mode, int stretch, int rotat
 static void DisplayNormal(GLvoid *dest)
 {
 	Uint8 *screen = (Uint8 *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
+	int pitch;
+	int y;
+	ULONG since = shown_stamp;
+	shown_stamp = Screen_TrackLines();
 	if (bpp_32)
-		SDL_VIDEO_BlitNormal32((Uint32*)dest, screen, VIDEOMODE_actual_width, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp32);
-	else {
-		int pitch;
-		if (VIDEOMODE_actual_width & 0x01)
-			pitch = VIDEOMODE_actual_width / 2 + 1;
-		else
-			pitch = VIDEOMODE_actual_width / 2;
-		SDL_VIDEO_BlitNormal16((Uint32*)dest, screen, pitch, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp16);
+		pitch = VIDEOMODE_actual_width;
+	else if (VIDEOMODE_actual_width & 0x01)
+		pitch = VIDEOMODE_actual_width / 2 + 1;
+	else
+		pitch = VIDEOMODE_actual_width / 2;
+	/* Only the changed lines are redrawn and uploaded. */
+	upload_top = VIDEOMODE_src_height;
+	upload_bottom = 0;
+	for (y = 0; y < VIDEOMODE_src_height; y++) {
+		if (Screen_LineChanged(VIDEOMODE_src_offset_top + y, since)) {
+			if (bpp_32)
+				SDL_VIDEO_BlitNormal32((Uint32*)dest + pitch * y, screen, pitch, VIDEOMODE_src_width, 1, SDL_PALETTE_buffer.bpp32);
+			else
+				SDL_VIDEO_BlitNormal16((Uint32*)dest + pitch * y, screen, pitch, VIDEOMODE_src_width, 1, SDL_PALETTE_buffer.bpp16);
+			if (y < upload_top)
+				upload_top = y;
+			upload_bottom = y + 1;
+		}
+		screen += Screen_WIDTH;
 	}
 }
 
@@ -1155,6 +1180,28 @@ static void DisplayBIT3(GLvoid *dest)
 #endif
 
 
+/* Blits the screen to screen_texture and uploads the rows that changed. */
+static void BlitAndUpload(void)
+{
+	int row_size;
+	upload_top = 0;
+	upload_bottom = VIDEOMODE_src_height;
+	(*blit_funcs[SDL_VIDEO_current_display_mode])(screen_texture);
+	if (blit_funcs[SDL_VIDEO_current_display_mode] != &DisplayNormal)
+		/* Other blits don't track lines. */
+		shown_stamp = 0;
+	if (upload_top >= upload_bottom)
+		return;
+	if (bpp_32)
+		row_size = VIDEOMODE_actual_width * 4;
+	else
+		/* Rows are padded to 4 bytes, the default GL_UNPACK_ALIGNMENT. */
+		row_size = (VIDEOMODE_actual_width + 1) / 2 * 4;
+	gl.TexSubImage2D(GL_TEXTURE_2D, 0, 0, upload_top, VIDEOMODE_actual_width, upload_bottom - upload_top,
+	                 pixel_formats[SDL_VIDEO_GL_pixel_format].format, pixel_formats[SDL_VIDEO_GL_pixel_format].type,
+	                 (Uint8 *)screen_texture + row_size * upload_top);
+}
+
 void SDL_VIDEO_GL_DisplayScreen(void)
 {
 #if SDL2
@@ -1166,10 +1213,7 @@ void SDL_VIDEO_GL_DisplayScreen(void)
 	gl.Uniform1i(our_texture, 0);
 	gl.ActiveTexture(GL_TEXTURE0);
 	gl.BindTexture(GL_TEXTURE_2D, textures[0]);
-	(*blit_funcs[SDL_VIDEO_current_display_mode])(screen_texture);
-	gl.TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VIDEOMODE_actual_width, VIDEOMODE_src_height,
-		pixel_formats[SDL_VIDEO_GL_pixel_format].format, pixel_formats[SDL_VIDEO_GL_pixel_format].type,
-		screen_texture);
+	BlitAndUpload();
 
 	gl.BindVertexArray(vaos[0]);
 	float sx = 1.0f, sy = 1.0f;
@@ -1223,18 +1267,16 @@ void SDL_VIDEO_GL_DisplayScreen(void)
 		GLvoid *ptr;
 		gl.BindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, screen_pbo);
 		ptr = gl.MapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+		/* The mapped buffer's contents are undefined. */
+		shown_stamp = 0;
 		(*blit_funcs[SDL_VIDEO_current_display_mode])(ptr);
 		gl.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB);
 		gl.TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VIDEOMODE_actual_width, VIDEOMODE_src_height,
 		                 pixel_formats[SDL_VIDEO_GL_pixel_format].format, pixel_formats[SDL_VIDEO_GL_pixel_format].type,
 		                 NULL);
 		gl.BindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
-	} else {
-		(*blit_funcs[SDL_VIDEO_current_display_mode])(screen_texture);
-		gl.TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VIDEOMODE_actual_width, VIDEOMODE_src_height,
-		                 pixel_formats[SDL_VIDEO_GL_pixel_format].format, pixel_formats[SDL_VIDEO_GL_pixel_format].type,
-		                 screen_texture);
-	}
+	} else
+		BlitAndUpload();
 	gl.CallList(screen_dlist);
 	SDL_GL_SwapBuffers();
 #endif /* SDL2 */
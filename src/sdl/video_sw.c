@@ -34,6 +34,7 @@
 #include "bit3.h"
 #include "artifact.h"
 #include "atari.h"
+#include "blit.h"
 #include "colours.h"
 #include "config.h"
 #include "filter_ntsc.h"
@@ -57,6 +58,14 @@ static int fullscreen = 1;
 
 int SDL_VIDEO_SW_bpp = 0;
 
+/* Screen_TrackLines() stamp of the Atari screen shown on SDL_VIDEO_screen,
+   or 0 if the surface must be redrawn entirely. */
+static ULONG shown_stamp = 0;
+/* Rows of SDL_VIDEO_screen changed by the last blit are
+   update_top <= y < update_bottom. */
+static int update_top;
+static int update_bottom;
+
 static void DisplayWithoutScaling(void);
 static void DisplayWithScaling(void);
 static void DisplayRotated(void);
@@ -158,6 +167,7 @@ void SDL_VIDEO_SW_MapRGB(void *dest, int const *palette, int size)
 
 static void UpdatePaletteLookup(VIDEOMODE_MODE_t mode)
 {
+	shown_stamp = 0;
 	if (SDL_VIDEO_screen->format->BitsPerPixel == 8)
 		Set8BitPalette(mode);
 	else
@@ -317,6 +327,7 @@ void SDL_VIDEO_SW_SetVideoMode(VIDEOMODE_resolution_t const *res, int windowed,
 		SDL_FillRect(SDL_VIDEO_screen, NULL, 0);
 #endif /* SDL2 */
 	SDL_ShowCursor(SDL_DISABLE);	/* hide mouse cursor */
+	shown_stamp = 0;
 
 	if (mode == VIDEOMODE_MODE_NORMAL) {
 		if (rotate90)
@@ -420,7 +431,7 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 	Uint32* pBuf = (Uint32*)(pBuffer)+pitch/sizeof(Uint32);
 	Uint32* sBuf = (Uint32*)(pBuffer);
 	Uint32* tBuf = (Uint32*)(pBuffer)+pitch*2/sizeof(Uint32);
-	int w, h;
+	int h;
 	static int prev_scanLinesPct;
 
 	pitch = pitch * 2 / (int)sizeof(Uint32);
@@ -457,13 +468,7 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 	if (SDL_VIDEO_interpolate_scanlines) {
 		scanLinesPct = (100-scanLinesPct) * 32 / 200;
 		for (h = 0; h < height-1; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 pixel2 = tBuf[w];
-				Uint32 a = ((((pixel & 0x07e0f81f)+(pixel2 & 0x07e0f81f)) * scanLinesPct) & 0xfc1f03e0) >> 5;
-				Uint32 b = ((((pixel >> 5) & 0x07c0f83f)+((pixel2 >> 5) & 0x07c0f83f)) * scanLinesPct) & 0xf81f07e0;
-				pBuf[w] = a | b;
-			}
+			BLIT_Scanline565((ULONG *)pBuf, (ULONG *)sBuf, (ULONG *)tBuf, width, scanLinesPct);
 			sBuf += pitch;
 			tBuf += pitch;
 			pBuf += pitch;
@@ -471,12 +476,7 @@ static void scanLines_16(void* pBuffer, int width, int height, int pitch, int sc
 	} else {
 		scanLinesPct = (100-scanLinesPct) * 32 / 100;
 		for (h = 0; h < height; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 a = (((pixel & 0x07e0f81f) * scanLinesPct) & 0xfc1f03e0) >> 5;
-				Uint32 b = (((pixel >> 5) & 0x07c0f83f) * scanLinesPct) & 0xf81f07e0;
-				pBuf[w] = a | b;
-			}
+			BLIT_Scanline565((ULONG *)pBuf, (ULONG *)sBuf, NULL, width, scanLinesPct);
 			sBuf += pitch;
 			pBuf += pitch;
 		}
@@ -491,7 +491,7 @@ static void scanLines_32(void* pBuffer, int width, int height, int pitch, int sc
 	Uint32* pBuf = (Uint32*)(pBuffer)+pitch/sizeof(Uint32);
 	Uint32* sBuf = (Uint32*)(pBuffer);
 	Uint32* tBuf = (Uint32*)(pBuffer)+pitch*2/sizeof(Uint32);
-	int w, h;
+	int h;
 	static int prev_scanLinesPct;
 
 	pitch = pitch * 2 / (int)sizeof(Uint32);
@@ -527,13 +527,7 @@ static void scanLines_32(void* pBuffer, int width, int height, int pitch, int sc
 	if (SDL_VIDEO_interpolate_scanlines) {
 		scanLinesPct = (100-scanLinesPct) * 256 / 200;
 		for (h = 0; h < height-1; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 pixel2 = tBuf[w];
-				Uint32 a = ((((pixel & 0x00ff00ff)+(pixel2 & 0x00ff00ff)) * scanLinesPct) & 0xff00ff00) >> 8;
-				Uint32 b = ((((pixel & 0x0000ff00)+(pixel2 & 0x0000ff00)) >> 8) * scanLinesPct) & 0x0000ff00;
-				pBuf[w] = a | b;
-			}
+			BLIT_ScanlineARGB((ULONG *)pBuf, (ULONG *)sBuf, (ULONG *)tBuf, width, scanLinesPct);
 			sBuf += pitch;
 			tBuf += pitch;
 			pBuf += pitch;
@@ -541,12 +535,7 @@ static void scanLines_32(void* pBuffer, int width, int height, int pitch, int sc
 	} else {
 		scanLinesPct = (100-scanLinesPct) * 256 / 100;
 		for (h = 0; h < height; h++) {
-			for (w = 0; w < width; w++) {
-				Uint32 pixel = sBuf[w];
-				Uint32 a = (((pixel & 0x00ff00ff) * scanLinesPct) & 0xff00ff00) >> 8;
-				Uint32 b = (((pixel & 0x0000ff00) >> 8) * scanLinesPct) & 0x0000ff00;
-				pBuf[w] = a | b;
-			}
+			BLIT_ScanlineARGB((ULONG *)pBuf, (ULONG *)sBuf, NULL, width, scanLinesPct);
 			sBuf += pitch;
 			pBuf += pitch;
 		}
@@ -737,26 +726,86 @@ static void DisplayRotated(void)
 	}
 }
 
+/* Starts a blit that redraws only the changed lines of Screen_atari.
+   Returns the stamp of the lines already shown. */
+static ULONG StartTrackedBlit(void)
+{
+	ULONG since = shown_stamp;
+#if !SDL2
+	/* The back buffer of a double-buffered surface holds an older frame. */
+	if (SDL_VIDEO_screen->flags & SDL_DOUBLEBUF)
+		since = 0;
+#endif
+	shown_stamp = Screen_TrackLines();
+	update_top = SDL_VIDEO_screen->h;
+	update_bottom = 0;
+	return since;
+}
+
+/* Records that row Y of SDL_VIDEO_screen was redrawn. */
+static void UpdateRow(int y)
+{
+	if (y < update_top)
+		update_top = y;
+	if (y >= update_bottom)
+		update_bottom = y + 1;
+}
+
 static void DisplayWithoutScaling(void)
 {
 	int pitch4 = SDL_VIDEO_screen->pitch / 4;
 	UBYTE *screen = (UBYTE *)Screen_atari + Screen_WIDTH * VIDEOMODE_src_offset_top + VIDEOMODE_src_offset_left;
 	Uint8 *pixels = (Uint8 *) SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * VIDEOMODE_dest_offset_top;
+	ULONG since = StartTrackedBlit();
+	int y;
 	switch (SDL_VIDEO_screen->format->BitsPerPixel) {
 	/* Possible values are 8, 16 and 32, as checked earlier in the
 	 * PLATFORM_SetVideoMode() function. */
 	case 8:
 		pixels += VIDEOMODE_dest_offset_left;
-		SDL_VIDEO_BlitNormal8((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height);
 		break;
 	case 16:
 		pixels += VIDEOMODE_dest_offset_left * 2;
-		SDL_VIDEO_BlitNormal16((Uint32*)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp16);
 		break;
 	default: /* SDL_VIDEO_screen->format->BitsPerPixel == 32 */
 		pixels += VIDEOMODE_dest_offset_left * 4;
-		SDL_VIDEO_BlitNormal32((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, VIDEOMODE_src_height, SDL_PALETTE_buffer.bpp32);
 	}
+	for (y = 0; y < VIDEOMODE_src_height; y++) {
+		if (Screen_LineChanged(VIDEOMODE_src_offset_top + y, since)) {
+			switch (SDL_VIDEO_screen->format->BitsPerPixel) {
+			case 8:
+				SDL_VIDEO_BlitNormal8((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, 1);
+				break;
+			case 16:
+				SDL_VIDEO_BlitNormal16((Uint32*)pixels, screen, pitch4, VIDEOMODE_src_width, 1, SDL_PALETTE_buffer.bpp16);
+				break;
+			default:
+				SDL_VIDEO_BlitNormal32((Uint32 *)pixels, screen, pitch4, VIDEOMODE_src_width, 1, SDL_PALETTE_buffer.bpp32);
+			}
+			UpdateRow(VIDEOMODE_dest_offset_top + y);
+		}
+		screen += Screen_WIDTH;
+		pixels += SDL_VIDEO_screen->pitch;
+	}
+}
+
+/* Source columns shown by the pixels of a scaled row. */
+static int *scale_index = NULL;
+static int scale_index_size = 0;
+/* The source row being scaled, converted to the screen format. It may start
+   one column left of the displayed area. */
+static union {
+	UWORD bpp16[Screen_WIDTH + 4];
+	ULONG bpp32[Screen_WIDTH + 2];
+} scale_row;
+
+static int ScaleIndex(int size, int dx, int *width)
+{
+	if (size > scale_index_size) {
+		scale_index = (int *)Util_realloc(scale_index, size * sizeof(int));
+		scale_index_size = size;
+	}
+	return BLIT_ScaleIndex(scale_index, size, VIDEOMODE_src_width, dx, width);
 }
 
 static void DisplayWithScaling(void)
@@ -776,8 +825,10 @@ static void DisplayWithScaling(void)
 	int pitch4 = SDL_VIDEO_screen->pitch / 4;
 	int dy = h / VIDEOMODE_dest_height;
 	int init_x = (VIDEOMODE_src_width << 16) - 0x4000;
-
-	Uint8 c;
+	int first;
+	int row_width;
+	int row = -1;
+	ULONG since = StartTrackedBlit();
 
 	i = VIDEOMODE_dest_height;
 
@@ -788,33 +839,36 @@ static void DisplayWithScaling(void)
 		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left / 4;
 		w1 = VIDEOMODE_dest_width / 4 - 1;
 		while (i > 0) {
-			x = init_x;
-			pos = w1;
-			yy = Screen_WIDTH * (y >> 16);
-			while (pos >= 0) {
+			if (Screen_LineChanged(VIDEOMODE_src_offset_top + (y >> 16), since)) {
+				UpdateRow(VIDEOMODE_dest_offset_top + VIDEOMODE_dest_height - i);
+				x = init_x;
+				pos = w1;
+				yy = Screen_WIDTH * (y >> 16);
+				while (pos >= 0) {
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				quad = (screen[yy + (x >> 16)] << 0);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 8);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 16);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 24);
-				x -= dx;
+					quad = (screen[yy + (x >> 16)] << 0);
+					x -= dx;
+					quad += (screen[yy + (x >> 16)] << 8);
+					x -= dx;
+					quad += (screen[yy + (x >> 16)] << 16);
+					x -= dx;
+					quad += (screen[yy + (x >> 16)] << 24);
+					x -= dx;
 #else
-				quad = (screen[yy + (x >> 16)] << 24);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 16);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 8);
-				x -= dx;
-				quad += (screen[yy + (x >> 16)] << 0);
-				x -= dx;
+					quad = (screen[yy + (x >> 16)] << 24);
+					x -= dx;
+					quad += (screen[yy + (x >> 16)] << 16);
+					x -= dx;
+					quad += (screen[yy + (x >> 16)] << 8);
+					x -= dx;
+					quad += (screen[yy + (x >> 16)] << 0);
+					x -= dx;
 #endif
 
-				pixels[pos] = quad;
-				pos--;
+					pixels[pos] = quad;
+					pos--;
 
+				}
 			}
 			pixels += pitch4;
 			y += dy;
@@ -823,30 +877,17 @@ static void DisplayWithScaling(void)
 		break;
 	case 16:
 		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left / 2;
-		w1 = VIDEOMODE_dest_width / 2 - 1;
+		/* Only whole 32-bit words are filled. */
+		w1 = VIDEOMODE_dest_width & ~1;
+		first = ScaleIndex(w1, dx, &row_width);
 		while (i > 0) {
-			x = init_x;
-			pos = w1;
-			yy = Screen_WIDTH * (y >> 16);
-			while (pos >= 0) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				c = screen[yy + (x >> 16)];
-				quad = SDL_PALETTE_buffer.bpp16[c];
-				x -= dx;
-				c = screen[yy + (x >> 16)];
-				quad += SDL_PALETTE_buffer.bpp16[c] << 16;
-				x -= dx;
-#else
-				c = screen[yy + (x >> 16)];
-				quad = SDL_PALETTE_buffer.bpp16[c] << 16;
-				x -= dx;
-				c = screen[yy + (x >> 16)];
-				quad += SDL_PALETTE_buffer.bpp16[c];
-				x -= dx;
-#endif
-
-				pixels[pos] = quad;
-				pos--;
+			if (Screen_LineChanged(VIDEOMODE_src_offset_top + (y >> 16), since)) {
+				if (y >> 16 != row) {
+					row = y >> 16;
+					BLIT_Expand16(scale_row.bpp16, screen + Screen_WIDTH * row + first, row_width, SDL_PALETTE_buffer.bpp16);
+				}
+				BLIT_Gather16((UWORD *)pixels, scale_row.bpp16, scale_index, w1);
+				UpdateRow(VIDEOMODE_dest_offset_top + VIDEOMODE_dest_height - i);
 			}
 			pixels += pitch4;
 			y += dy;
@@ -855,18 +896,16 @@ static void DisplayWithScaling(void)
 		break;
 	default:
 		pixels += pitch4 * VIDEOMODE_dest_offset_top + VIDEOMODE_dest_offset_left;
-		w1 = VIDEOMODE_dest_width - 1;
 		/* SDL_VIDEO_screen->format->BitsPerPixel = 32 */
+		first = ScaleIndex(VIDEOMODE_dest_width, dx, &row_width);
 		while (i > 0) {
-			x = init_x;
-			pos = w1;
-			yy = Screen_WIDTH * (y >> 16);
-			while (pos >= 0) {
-				c = screen[yy + (x >> 16)];
-				quad = SDL_PALETTE_buffer.bpp32[c];
-				x -= dx;
-				pixels[pos] = quad;
-				pos--;
+			if (Screen_LineChanged(VIDEOMODE_src_offset_top + (y >> 16), since)) {
+				if (y >> 16 != row) {
+					row = y >> 16;
+					BLIT_Expand32(scale_row.bpp32, screen + Screen_WIDTH * row + first, row_width, (ULONG *)SDL_PALETTE_buffer.bpp32);
+				}
+				BLIT_Gather32((ULONG *)pixels, scale_row.bpp32, scale_index, VIDEOMODE_dest_width);
+				UpdateRow(VIDEOMODE_dest_offset_top + VIDEOMODE_dest_height - i);
 			}
 			pixels += pitch4;
 			y += dy;
@@ -919,8 +958,19 @@ void SDL_VIDEO_SW_DisplayScreen(void)
 	if (!SDL_VIDEO_texture || !SDL_VIDEO_renderer || !SDL_VIDEO_screen) {
 		return;
 	}
+	update_top = 0;
+	update_bottom = SDL_VIDEO_screen->h;
 	(*blit_funcs[SDL_VIDEO_current_display_mode])();
-	SDL_UpdateTexture(SDL_VIDEO_texture, NULL, SDL_VIDEO_screen->pixels, SDL_VIDEO_screen->pitch);
+	/* The texture keeps its contents, so only the rows changed by the
+	   blit are uploaded. */
+	if (update_top < update_bottom) {
+		SDL_Rect rect;
+		rect.x = 0;
+		rect.y = update_top;
+		rect.w = SDL_VIDEO_screen->w;
+		rect.h = update_bottom - update_top;
+		SDL_UpdateTexture(SDL_VIDEO_texture, &rect, (Uint8 *)SDL_VIDEO_screen->pixels + SDL_VIDEO_screen->pitch * update_top, SDL_VIDEO_screen->pitch);
+	}
 	SDL_RenderClear(SDL_VIDEO_renderer);
 	SDL_RenderCopy(SDL_VIDEO_renderer, SDL_VIDEO_texture, NULL, NULL);
 	SDL_RenderPresent(SDL_VIDEO_renderer);
@@ -38,6 +38,8 @@
 #include "compfile.h"
 #include "cpu.h"
 #include "esc.h"
+#include "hwtrace.h"
+#include "imagestore.h"
 #include "log.h"
 #include "memory.h"
 #include "platform.h"
@@ -79,7 +81,35 @@ static int image_type[SIO_MAX_DRIVES];
 extern void (*disk_activity_callback)(int drive, int operation);
 #endif
 
+/* Contents of the mounted disk images. Images that aren't compressed are
+   mapped from their files if the system supports it. Other images are read
+   to memory - compressed images are decompressed there, not to temporary
+   files. Images that aren't written back to their files are shared with
+   other machines through the image store. */
+static UBYTE *image[SIO_MAX_DRIVES] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+static ULONG image_length[SIO_MAX_DRIVES];
+static int image_mapped[SIO_MAX_DRIVES];
+static int image_shared[SIO_MAX_DRIVES];
+/* Blocks of a shared image modified by this machine (see SIO_disk_overlay),
+   NULL until the image is first written. */
+#define OVERLAY_BLOCK_SIZE 128
+#define OVERLAY_BLOCKS(length) (((length) + OVERLAY_BLOCK_SIZE - 1) / OVERLAY_BLOCK_SIZE)
+static UBYTE **overlay[SIO_MAX_DRIVES] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+int SIO_disk_overlay = FALSE;
+/* Position in image[] for ReadImage() and WriteImage(). */
+static ULONG image_pos[SIO_MAX_DRIVES];
+/* Part of image[] modified since it was last written back to the file
+   (nothing if dirty_start >= dirty_end). */
+static ULONG dirty_start[SIO_MAX_DRIVES];
+static ULONG dirty_end[SIO_MAX_DRIVES];
+/* Written images that weren't synced to the disk yet. */
+static int needs_sync[SIO_MAX_DRIVES];
+/* The file of a writable image, NULL for read-only images. */
 static FILE *disk[SIO_MAX_DRIVES] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+/* Number of seconds after which modified images are written back and synced
+   to the disk, 0 to write them back only when they are unmounted. */
+int SIO_sync_interval = 0;
+static int sync_counter = 0;
 static int sectorcount[SIO_MAX_DRIVES];
 static int sectorsize[SIO_MAX_DRIVES];
 /* these two are used by the 1450XLD parallel disk device */
@@ -161,8 +191,6 @@ static void *additional_info[SIO_MAX_DRIVES];
 SIO_UnitStatus SIO_drive_status[SIO_MAX_DRIVES];
 char SIO_filename[SIO_MAX_DRIVES][FILENAME_MAX];
 
-Util_tmpbufdef(static, sio_tmpbuf[SIO_MAX_DRIVES])
-
 int SIO_last_op;
 int SIO_last_op_time = 0;
 int SIO_last_drive;
@@ -192,6 +220,38 @@ int ignore_header_writeprotect = FALSE;
 int SIO_Initialise(int *argc, char *argv[])
 {
 	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-disk-sync") == 0) {
+			if (i_a) {
+				SIO_sync_interval = Util_sscandec(argv[++i]);
+				if (SIO_sync_interval < 0) {
+					Log_print("Invalid disk sync interval");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-disk-overlay") == 0)
+			SIO_disk_overlay = TRUE;
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-disk-sync <n>   Write modified disk images back every <n> seconds");
+				Log_print("\t-disk-overlay    Keep writes to disk images in memory, not in the files");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
 	for (i = 0; i < SIO_MAX_DRIVES; i++) {
 		strcpy(SIO_filename[i], "Off");
 		SIO_drive_status[i] = SIO_OFF;
@@ -203,7 +263,7 @@ int SIO_Initialise(int *argc, char *argv[])
 	return TRUE;
 }
 
-/* umount disks so temporary files are deleted */
+/* umount disks so modified images are written back */
 void SIO_Exit(void)
 {
 	int i;
@@ -211,11 +271,50 @@ void SIO_Exit(void)
 		SIO_Dismount(i);
 }
 
+/* Frees an image being mounted, and closes its file if it's still open. */
+static void FreeImage(FILE *f, UBYTE *data, ULONG length, int mapped, int shared)
+{
+	if (data != NULL) {
+		if (shared)
+			IMAGESTORE_Release(data);
+		else if (mapped)
+			Util_munmap(data, length);
+		else
+			free(data);
+	}
+	if (f != NULL)
+		fclose(f);
+}
+
+static void FreeOverlay(UBYTE **blocks, ULONG length)
+{
+	ULONG i;
+	if (blocks == NULL)
+		return;
+	for (i = 0; i < OVERLAY_BLOCKS(length); i++)
+		free(blocks[i]);
+	free(blocks);
+}
+
+/* Copies size bytes at offset of an image being mounted to buf.
+   Returns FALSE if the image is too short. */
+static int ImageRead(const UBYTE *data, ULONG length, ULONG offset, void *buf, int size)
+{
+	if (offset > length || length - offset < (ULONG) size)
+		return FALSE;
+	memcpy(buf, data + offset, size);
+	return TRUE;
+}
+
 int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 {
 	FILE *f = NULL;
 	SIO_UnitStatus status = SIO_READ_WRITE;
 	struct AFILE_ATR_Header header;
+	UBYTE *data = NULL;
+	ULONG length = 0;
+	int mapped = FALSE;
+	int shared = FALSE;
 
 	/* avoid overruns in SIO_filename[] */
 	if (strlen(filename) >= FILENAME_MAX)
@@ -224,81 +323,94 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 	/* release previous disk */
 	SIO_Dismount(diskno);
 
-	/* open file */
-	if (!b_open_readonly)
-		f = Util_fopen(filename, "rb+", sio_tmpbuf[diskno - 1]);
+	/* open file - images that won't be written back to it are shared,
+	   and may be in the image store already */
+	if (!b_open_readonly && !SIO_disk_overlay)
+		f = fopen(filename, "rb+");
 	if (f == NULL) {
-		f = Util_fopen(filename, "rb", sio_tmpbuf[diskno - 1]);
-		if (f == NULL)
-			return FALSE;
-		status = SIO_READ_ONLY;
-	}
-
-	/* read header */
-	if (fread(&header, 1, sizeof(struct AFILE_ATR_Header), f) != sizeof(struct AFILE_ATR_Header)) {
-		fclose(f);
-		return FALSE;
-	}
-
-	/* detect compressed image and uncompress */
-	switch (header.magic1) {
-	case 0xf9:
-	case 0xfa:
-		/* DCM */
-		{
-			FILE *f2 = Util_tmpopen(sio_tmpbuf[diskno - 1]);
-			if (f2 == NULL)
-				return FALSE;
-			Util_rewind(f);
-			if (!CompFile_DCMtoATR(f, f2)) {
-				Util_fclose(f2, sio_tmpbuf[diskno - 1]);
-				fclose(f);
+		shared = TRUE;
+		if (b_open_readonly || !SIO_disk_overlay)
+			status = SIO_READ_ONLY;
+		data = IMAGESTORE_Find(filename, &length);
+		if (data == NULL) {
+			f = fopen(filename, "rb");
+			if (f == NULL)
 				return FALSE;
-			}
-			fclose(f);
-			f = f2;
 		}
-		Util_rewind(f);
+	}
+
+	if (data == NULL) {
+		/* read header */
 		if (fread(&header, 1, sizeof(struct AFILE_ATR_Header), f) != sizeof(struct AFILE_ATR_Header)) {
-			Util_fclose(f, sio_tmpbuf[diskno - 1]);
+			fclose(f);
 			return FALSE;
 		}
-		status = SIO_READ_ONLY;
-		/* XXX: status = b_open_readonly ? SIO_READ_ONLY : SIO_READ_WRITE; */
-		break;
-	case 0x1f:
-		if (header.magic2 == 0x8b) {
-			/* ATZ/ATR.GZ, XFZ/XFD.GZ */
-			fclose(f);
-			f = Util_tmpopen(sio_tmpbuf[diskno - 1]);
-			if (f == NULL)
-				return FALSE;
-			if (!CompFile_ExtractGZ(filename, f)) {
-				Util_fclose(f, sio_tmpbuf[diskno - 1]);
-				return FALSE;
+
+		/* detect compressed image and uncompress it to memory */
+		if (header.magic1 == 0xf9 || header.magic1 == 0xfa
+		 || (header.magic1 == 0x1f && header.magic2 == 0x8b)) {
+			/* compressed images are never written back, so they are
+			   shared, and writable only through the overlay */
+			if (!SIO_disk_overlay)
+				status = SIO_READ_ONLY;
+			if (!shared) {
+				shared = TRUE;
+				data = IMAGESTORE_Find(filename, &length);
 			}
-			Util_rewind(f);
-			if (fread(&header, 1, sizeof(struct AFILE_ATR_Header), f) != sizeof(struct AFILE_ATR_Header)) {
-				Util_fclose(f, sio_tmpbuf[diskno - 1]);
-				return FALSE;
+			if (data == NULL) {
+				int ok;
+				if (header.magic1 == 0x1f) {
+					/* ATZ/ATR.GZ, XFZ/XFD.GZ */
+					ok = CompFile_ExtractGZToMem(filename, &data, &length);
+				}
+				else {
+					/* DCM */
+					Util_rewind(f);
+					ok = CompFile_DCMtoATRMem(f, &data, &length);
+				}
+				if (!ok) {
+					fclose(f);
+					return FALSE;
+				}
+				data = IMAGESTORE_Add(filename, data, length);
 			}
-			status = SIO_READ_ONLY;
-			/* XXX: status = b_open_readonly ? SIO_READ_ONLY : SIO_READ_WRITE; */
+			fclose(f);
+			f = NULL;
 		}
-		break;
-	default:
-		break;
+		else {
+			/* not compressed: map the file, or read it to memory */
+			length = Util_flen(f);
+			if (!shared)
+				data = (UBYTE *) Util_mmap(f, length, status == SIO_READ_WRITE);
+			if (data != NULL)
+				mapped = TRUE;
+			else {
+				data = (UBYTE *) Util_malloc(length);
+				Util_rewind(f);
+				if (fread(data, 1, length, f) != length) {
+					free(data);
+					fclose(f);
+					return FALSE;
+				}
+				if (shared)
+					data = IMAGESTORE_Add(filename, data, length);
+			}
+		}
+	}
+	if (!ImageRead(data, length, 0, &header, sizeof(struct AFILE_ATR_Header))) {
+		FreeImage(f, data, length, mapped, shared);
+		return FALSE;
 	}
 
 	boot_sectors_type[diskno - 1] = BOOT_SECTORS_LOGICAL;
 
 	if (header.magic1 == AFILE_ATR_MAGIC1 && header.magic2 == AFILE_ATR_MAGIC2) {
-		/* ATR (may be temporary from DCM or ATR/ATR.GZ) */
+		/* ATR (may be decompressed from DCM or ATR/ATR.GZ) */
 		image_type[diskno - 1] = IMAGE_TYPE_ATR;
 
 		sectorsize[diskno - 1] = (header.secsizehi << 8) + header.secsizelo;
 		if (sectorsize[diskno - 1] != 128 && sectorsize[diskno - 1] != 256) {
-			Util_fclose(f, sio_tmpbuf[diskno - 1]);
+			FreeImage(f, data, length, mapped, shared);
 			return FALSE;
 		}
 
@@ -324,9 +436,8 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 				   a non-zero byte in bytes 0x190-0x30f of the ATR file */
 				UBYTE buffer[0x180];
 				int i;
-				fseek(f, 0x190, SEEK_SET);
-				if (fread(buffer, 1, 0x180, f) != 0x180) {
-					Util_fclose(f, sio_tmpbuf[diskno - 1]);
+				if (!ImageRead(data, length, 0x190, buffer, 0x180)) {
+					FreeImage(f, data, length, mapped, shared);
 					return FALSE;
 				}
 				boot_sectors_type[diskno - 1] = BOOT_SECTORS_SIO2PC;
@@ -341,7 +452,7 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 	}
 	else if (header.magic1 == 'A' && header.magic2 == 'T' && header.seccountlo == '8' &&
 		 header.seccounthi == 'X') {
-		int file_length = Util_flen(f);
+		int file_length = (int) length;
 		vapi_additional_info_t *info;
 		vapi_file_header_t fileheader;
 		vapi_track_header_t trackheader;
@@ -349,27 +460,20 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 
 		/* .atx is read only for now */
 #ifndef VAPI_WRITE_ENABLE
-		if (!b_open_readonly) {
-			fclose(f);
-			f = Util_fopen(filename, "rb", sio_tmpbuf[diskno - 1]);
-			if (f == NULL)
-				return FALSE;
-			status = SIO_READ_ONLY;
-		}
+		status = SIO_READ_ONLY;
 #endif
 		
 		image_type[diskno - 1] = IMAGE_TYPE_VAPI;
 		sectorsize[diskno - 1] = 128;
 		sectorcount[diskno - 1] = 720;
-		fseek(f,0,SEEK_SET);
-		if (fread(&fileheader,1,sizeof(fileheader),f) != sizeof(fileheader)) {
-			Util_fclose(f, sio_tmpbuf[diskno - 1]);
+		if (!ImageRead(data, length, 0, &fileheader, sizeof(fileheader))) {
+			FreeImage(f, data, length, mapped, shared);
 			Log_print("VAPI: Bad File Header");
 			return(FALSE);
 			}
 		trackoffset = VAPI_32(fileheader.startdata);	
 		if (trackoffset > file_length) {
-			Util_fclose(f, sio_tmpbuf[diskno - 1]);
+			FreeImage(f, data, length, mapped, shared);
 			Log_print("VAPI: Bad Track Offset");
 			return(FALSE);
 			}
@@ -382,9 +486,8 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 			ULONG next;
 			UWORD tracktype;
 
-			fseek(f,trackoffset,SEEK_SET);
-			if (fread(&trackheader,1,sizeof(trackheader),f) != sizeof(trackheader)) {
-				Util_fclose(f, sio_tmpbuf[diskno - 1]);
+			if (!ImageRead(data, length, trackoffset, &trackheader, sizeof(trackheader))) {
+				FreeImage(f, data, length, mapped, shared);
 				Log_print("VAPI: Bad Track Header");
 				return(FALSE);
 				}
@@ -413,11 +516,10 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 			UWORD tracktype;
 			int j;
 
-			fseek(f,trackoffset,SEEK_SET);
-			if (fread(&trackheader,1,sizeof(trackheader),f) != sizeof(trackheader)) {
+			if (!ImageRead(data, length, trackoffset, &trackheader, sizeof(trackheader))) {
 				free(info->sectors);
 				free(info);
-				Util_fclose(f, sio_tmpbuf[diskno - 1]);
+				FreeImage(f, data, length, mapped, shared);
 				Log_print("VAPI: Bad Track Header while reading sectors");
 				return(FALSE);
 				}
@@ -433,33 +535,34 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 				if (seclistdata > file_length) {
 					free(info->sectors);
 					free(info);
-					Util_fclose(f, sio_tmpbuf[diskno - 1]);
+					FreeImage(f, data, length, mapped, shared);
 					Log_print("VAPI: Bad Sector List Offset");
 					return(FALSE);
 					}
-				fseek(f,seclistdata,SEEK_SET);
-				if (fread(&sectorlist,1,sizeof(sectorlist),f) != sizeof(sectorlist)) {
+				if (!ImageRead(data, length, seclistdata, &sectorlist, sizeof(sectorlist))) {
 					free(info->sectors);
 					free(info);
-					Util_fclose(f, sio_tmpbuf[diskno - 1]);
+					FreeImage(f, data, length, mapped, shared);
 					Log_print("VAPI: Bad Sector List");
 					return(FALSE);
 					}
+				seclistdata += sizeof(sectorlist);
 #ifdef DEBUG_VAPI
 				Log_print("Size sec list %x type %d",VAPI_32(sectorlist.sizelist),sectorlist.type);
 #endif
 				for (j=0;j<sectorcnt;j++) {
 					double percent_rot;
 
-					if (fread(&sectorheader,1,sizeof(sectorheader),f) != sizeof(sectorheader)) {
+					if (!ImageRead(data, length, seclistdata, &sectorheader, sizeof(sectorheader))) {
 						free(info->sectors);
 						free(info);
-						Util_fclose(f, sio_tmpbuf[diskno - 1]);
+						FreeImage(f, data, length, mapped, shared);
 						Log_print("VAPI: Bad Sector Header");
 						return(FALSE);
 						}
+					seclistdata += sizeof(sectorheader);
 					if (sectorheader.sectornum > 18)  {
-						Util_fclose(f, sio_tmpbuf[diskno - 1]);
+						FreeImage(f, data, length, mapped, shared);
 						Log_print("VAPI: Bad Sector Index: Track %d Sec Num %d Index %d",
 								trackheader.tracknum,j,sectorheader.sectornum);
 						return(FALSE);
@@ -474,7 +577,7 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 					if (sector->sec_count > MAX_VAPI_PHANTOM_SEC) {
 						free(info->sectors);
 						free(info);
-						Util_fclose(f, sio_tmpbuf[diskno - 1]);
+						FreeImage(f, data, length, mapped, shared);
 						Log_print("VAPI: Too many Phantom Sectors");
 						return(FALSE);
 						}
@@ -496,20 +599,14 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 		}			
 	}
 	else {
-		int file_length = Util_flen(f);
+		int file_length = (int) length;
 		/* check for PRO */
 		if ((file_length-16)%(128+12) == 0 &&
 				(header.magic1*256 + header.magic2 == (file_length-16)/(128+12)) &&
 				header.seccountlo == 'P') {
 			pro_additional_info_t *info;
 			/* .pro is read only for now */
-			if (!b_open_readonly) {
-				fclose(f);
-				f = Util_fopen(filename, "rb", sio_tmpbuf[diskno - 1]);
-				if (f == NULL)
-					return FALSE;
-				status = SIO_READ_ONLY;
-			}
+			status = SIO_READ_ONLY;
 			image_type[diskno - 1] = IMAGE_TYPE_PRO;
 			sectorsize[diskno - 1] = 128;
 			if (file_length >= 1040*(128+12)+16) {
@@ -528,7 +625,7 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 			info->max_sector = (file_length-16)/(128+12);
 		}
 		else {
-			/* XFD (may be temporary from XFZ/XFD.GZ) */
+			/* XFD (may be decompressed from XFZ/XFD.GZ) */
 
 			image_type[diskno - 1] = IMAGE_TYPE_XFD;
 
@@ -558,15 +655,86 @@ int SIO_Mount(int diskno, const char *filename, int b_open_readonly)
 	SIO_format_sectorcount[diskno - 1] = sectorcount[diskno - 1];
 	strcpy(SIO_filename[diskno - 1], filename);
 	SIO_drive_status[diskno - 1] = status;
+	/* keep the file open only to write the image back */
+	if (f != NULL && (status != SIO_READ_WRITE || shared)) {
+		fclose(f);
+		f = NULL;
+	}
 	disk[diskno - 1] = f;
+	image[diskno - 1] = data;
+	image_length[diskno - 1] = length;
+	image_mapped[diskno - 1] = mapped;
+	image_shared[diskno - 1] = shared;
+	image_pos[diskno - 1] = 0;
+	dirty_start[diskno - 1] = length;
+	dirty_end[diskno - 1] = 0;
 	return TRUE;
 }
 
+/* Writes the modified part of an image back to its file. If sync is TRUE,
+   also makes sure the image is stored on the disk. */
+static void FlushImage(int unit, int sync)
+{
+	if (dirty_start[unit] < dirty_end[unit]) {
+		/* mapped images are written back by the system */
+		if (!image_mapped[unit] && disk[unit] != NULL) {
+			fseek(disk[unit], dirty_start[unit], SEEK_SET);
+			if (fwrite(image[unit] + dirty_start[unit], 1, dirty_end[unit] - dirty_start[unit], disk[unit]) < dirty_end[unit] - dirty_start[unit])
+				Log_print("Error writing disk image %s", SIO_filename[unit]);
+			fflush(disk[unit]);
+		}
+		dirty_start[unit] = image_length[unit];
+		dirty_end[unit] = 0;
+		needs_sync[unit] = TRUE;
+	}
+	if (sync && needs_sync[unit]) {
+		if (image_mapped[unit] ? !Util_msync(image[unit], image_length[unit]) : disk[unit] != NULL && !Util_fsync(disk[unit]))
+			Log_print("Error syncing disk image %s", SIO_filename[unit]);
+		needs_sync[unit] = FALSE;
+	}
+}
+
+void SIO_FlushDisks(int sync)
+{
+	int i;
+	for (i = 0; i < SIO_MAX_DRIVES; i++)
+		if (image[i] != NULL)
+			FlushImage(i, sync);
+	sync_counter = 0;
+}
+
+void SIO_Frame(void)
+{
+	int i;
+	if (SIO_sync_interval <= 0)
+		return;
+	for (i = 0; i < SIO_MAX_DRIVES; i++)
+		if (dirty_start[i] < dirty_end[i] || needs_sync[i])
+			break;
+	if (i == SIO_MAX_DRIVES)
+		return;
+	if (++sync_counter >= SIO_sync_interval * (Atari800_tv_mode == Atari800_TV_PAL ? Atari800_FPS_PAL : Atari800_FPS_NTSC))
+		SIO_FlushDisks(TRUE);
+}
+
 void SIO_Dismount(int diskno)
 {
-	if (disk[diskno - 1] != NULL) {
-		Util_fclose(disk[diskno - 1], sio_tmpbuf[diskno - 1]);
-		disk[diskno - 1] = NULL;
+	if (image[diskno - 1] != NULL) {
+		FlushImage(diskno - 1, FALSE);
+		FreeOverlay(overlay[diskno - 1], image_length[diskno - 1]);
+		overlay[diskno - 1] = NULL;
+		if (image_shared[diskno - 1])
+			IMAGESTORE_Release(image[diskno - 1]);
+		else if (image_mapped[diskno - 1])
+			Util_munmap(image[diskno - 1], image_length[diskno - 1]);
+		else
+			free(image[diskno - 1]);
+		image[diskno - 1] = NULL;
+		needs_sync[diskno - 1] = FALSE;
+		if (disk[diskno - 1] != NULL) {
+			fclose(disk[diskno - 1]);
+			disk[diskno - 1] = NULL;
+		}
 		SIO_drive_status[diskno - 1] = SIO_NO_DISK;
 		strcpy(SIO_filename[diskno - 1], "Empty");
 		if (image_type[diskno - 1] == IMAGE_TYPE_PRO) {
@@ -587,6 +755,87 @@ void SIO_DisableDrive(int diskno)
 	strcpy(SIO_filename[diskno - 1], "Off");
 }
 
+struct SIO_overlays_t {
+	UBYTE **blocks[SIO_MAX_DRIVES];
+	/* identify the image each overlay belongs to */
+	ULONG length[SIO_MAX_DRIVES];
+	ULONG crc[SIO_MAX_DRIVES];
+};
+
+SIO_overlays_t *SIO_DetachOverlays(void)
+{
+	SIO_overlays_t *overlays = NULL;
+	int i;
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		if (overlay[i] == NULL)
+			continue;
+		if (overlays == NULL) {
+			overlays = (SIO_overlays_t *) Util_malloc(sizeof(SIO_overlays_t));
+			memset(overlays, 0, sizeof(SIO_overlays_t));
+		}
+		overlays->blocks[i] = overlay[i];
+		overlays->length[i] = image_length[i];
+		overlays->crc[i] = IMAGESTORE_Checksum(image[i]);
+		overlay[i] = NULL;
+	}
+	return overlays;
+}
+
+void SIO_AttachOverlays(SIO_overlays_t *overlays)
+{
+	int i;
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		if (image[i] != NULL) {
+			FreeOverlay(overlay[i], image_length[i]);
+			overlay[i] = NULL;
+		}
+		if (overlays == NULL || overlays->blocks[i] == NULL)
+			continue;
+		if (image[i] != NULL && image_shared[i] && image_length[i] == overlays->length[i]
+		 && IMAGESTORE_Checksum(image[i]) == overlays->crc[i])
+			overlay[i] = overlays->blocks[i];
+		else
+			FreeOverlay(overlays->blocks[i], overlays->length[i]);
+	}
+	free(overlays);
+}
+
+SIO_overlays_t *SIO_CopyOverlays(const SIO_overlays_t *overlays)
+{
+	SIO_overlays_t *copy;
+	int i;
+	if (overlays == NULL)
+		return NULL;
+	copy = (SIO_overlays_t *) Util_malloc(sizeof(SIO_overlays_t));
+	memcpy(copy, overlays, sizeof(SIO_overlays_t));
+	for (i = 0; i < SIO_MAX_DRIVES; i++) {
+		ULONG blocks = OVERLAY_BLOCKS(overlays->length[i]);
+		ULONG j;
+		if (overlays->blocks[i] == NULL)
+			continue;
+		copy->blocks[i] = (UBYTE **) Util_malloc(blocks * sizeof(UBYTE *));
+		for (j = 0; j < blocks; j++) {
+			if (overlays->blocks[i][j] == NULL)
+				copy->blocks[i][j] = NULL;
+			else {
+				copy->blocks[i][j] = (UBYTE *) Util_malloc(OVERLAY_BLOCK_SIZE);
+				memcpy(copy->blocks[i][j], overlays->blocks[i][j], OVERLAY_BLOCK_SIZE);
+			}
+		}
+	}
+	return copy;
+}
+
+void SIO_FreeOverlays(SIO_overlays_t *overlays)
+{
+	int i;
+	if (overlays == NULL)
+		return;
+	for (i = 0; i < SIO_MAX_DRIVES; i++)
+		FreeOverlay(overlays->blocks[i], overlays->length[i]);
+	free(overlays);
+}
+
 void SIO_SizeOfSector(UBYTE unit, int sector, int *sz, ULONG *ofs)
 {
 	int size;
@@ -648,8 +897,90 @@ static int SeekSector(int unit, int sector)
 	SIO_last_sector = sector;
 	snprintf(SIO_status, sizeof(SIO_status), "%d: %d", unit + 1, sector);
 	SIO_SizeOfSector((UBYTE) unit, sector, &size, &offset);
-	fseek(disk[unit], offset, SEEK_SET);
+	image_pos[unit] = offset;
+
+	return size;
+}
 
+/* Copies size bytes at the current position of the image to buffer and
+   advances the position. Returns the number of bytes copied, which is less
+   than size at the end of the image. */
+static int ReadImage(int unit, UBYTE *buffer, int size)
+{
+	ULONG pos = image_pos[unit];
+	if (pos >= image_length[unit])
+		return 0;
+	if ((ULONG) size > image_length[unit] - pos)
+		size = (int) (image_length[unit] - pos);
+	if (overlay[unit] == NULL)
+		memcpy(buffer, image[unit] + pos, size);
+	else {
+		/* take the blocks modified by this machine from the overlay */
+		int done = 0;
+		while (done < size) {
+			ULONG block = (pos + done) / OVERLAY_BLOCK_SIZE;
+			int offset = (int) ((pos + done) % OVERLAY_BLOCK_SIZE);
+			int n = OVERLAY_BLOCK_SIZE - offset;
+			if (n > size - done)
+				n = size - done;
+			if (overlay[unit][block] != NULL)
+				memcpy(buffer + done, overlay[unit][block] + offset, n);
+			else
+				memcpy(buffer + done, image[unit] + pos + done, n);
+			done += n;
+		}
+	}
+	image_pos[unit] = pos + size;
+	return size;
+}
+
+/* Copies buffer to the overlay of a shared image, copying the blocks that
+   are written for the first time from the image. */
+static void WriteOverlay(int unit, ULONG pos, const UBYTE *buffer, int size)
+{
+	int done = 0;
+	if (overlay[unit] == NULL) {
+		ULONG blocks = OVERLAY_BLOCKS(image_length[unit]);
+		overlay[unit] = (UBYTE **) Util_malloc(blocks * sizeof(UBYTE *));
+		memset(overlay[unit], 0, blocks * sizeof(UBYTE *));
+	}
+	while (done < size) {
+		ULONG block = (pos + done) / OVERLAY_BLOCK_SIZE;
+		int offset = (int) ((pos + done) % OVERLAY_BLOCK_SIZE);
+		int n = OVERLAY_BLOCK_SIZE - offset;
+		if (n > size - done)
+			n = size - done;
+		if (overlay[unit][block] == NULL) {
+			ULONG start = block * OVERLAY_BLOCK_SIZE;
+			ULONG len = image_length[unit] - start;
+			if (len > OVERLAY_BLOCK_SIZE)
+				len = OVERLAY_BLOCK_SIZE;
+			overlay[unit][block] = (UBYTE *) Util_malloc(OVERLAY_BLOCK_SIZE);
+			memcpy(overlay[unit][block], image[unit] + start, len);
+		}
+		memcpy(overlay[unit][block] + offset, buffer + done, n);
+		done += n;
+	}
+}
+
+/* Like ReadImage(), but copies buffer to the image. */
+static int WriteImage(int unit, const UBYTE *buffer, int size)
+{
+	ULONG pos = image_pos[unit];
+	if (pos >= image_length[unit])
+		return 0;
+	if ((ULONG) size > image_length[unit] - pos)
+		size = (int) (image_length[unit] - pos);
+	image_pos[unit] = pos + size;
+	if (image_shared[unit]) {
+		WriteOverlay(unit, pos, buffer, size);
+		return size;
+	}
+	memcpy(image[unit] + pos, buffer, size);
+	if (dirty_start[unit] > pos)
+		dirty_start[unit] = pos;
+	if (dirty_end[unit] < pos + size)
+		dirty_end[unit] = pos + size;
 	return size;
 }
 
@@ -663,7 +994,7 @@ int SIO_ReadSector(int unit, int sector, UBYTE *buffer)
 	io_success[unit] = -1;
 	if (SIO_drive_status[unit] == SIO_OFF)
 		return 0;
-	if (disk[unit] == NULL)
+	if (image[unit] == NULL)
 		return 'N';
 	if (sector <= 0 || sector > sectorcount[unit])
 		return 'E';
@@ -683,7 +1014,7 @@ int SIO_ReadSector(int unit, int sector, UBYTE *buffer)
 		unsigned char *count;
 		info = (pro_additional_info_t *)additional_info[unit];
 		count = info->count;
-		if (fread(buffer, 1, 12, disk[unit]) < 12) {
+		if (ReadImage(unit, buffer, 12) < 12) {
 			Log_print("Error in header of .pro image: sector:%d", sector);
 			return 'E';
 		}
@@ -703,7 +1034,7 @@ int SIO_ReadSector(int unit, int sector, UBYTE *buffer)
 				}
 				size = SeekSector(unit, sector);
 				/* read sector header */
-				if (fread(buffer, 1, 12, disk[unit]) < 12) {
+				if (ReadImage(unit, buffer, 12) < 12) {
 					Log_print("Error in header2 of .pro image: sector:%d dupnum:%d", sector, dupnum);
 					return 'E';
 				}
@@ -711,7 +1042,7 @@ int SIO_ReadSector(int unit, int sector, UBYTE *buffer)
 		}
 		/* bad sector */
 		if (buffer[1] != 0xff) {
-			if (fread(buffer, 1, size, disk[unit]) < size) {
+			if (ReadImage(unit, buffer, size) < size) {
 				Log_print("Error in bad sector of .pro image: sector:%d", sector);
 			}
 			io_success[unit] = sector;
@@ -803,13 +1134,13 @@ int SIO_ReadSector(int unit, int sector, UBYTE *buffer)
 		if (secinfo->sec_count > 1)
 			Log_print("duplicate sector:%d dupnum:%d delay:%d",sector, secindex,info->vapi_delay_time);
 #endif
-		fseek(disk[unit],secinfo->sec_offset[secindex],SEEK_SET);
+		image_pos[unit] = secinfo->sec_offset[secindex];
 		info->sec_stat_buff[0] = 0x8 | ((secinfo->sec_status[secindex] == 0xFF) ? 0 : 0x04);
 		info->sec_stat_buff[1] = secinfo->sec_status[secindex];
 		info->sec_stat_buff[2] = 0xe0;
 		info->sec_stat_buff[3] = 0;
 		if (secinfo->sec_status[secindex] != 0xFF) {
-			if (fread(buffer, 1, size, disk[unit]) < size) {
+			if (ReadImage(unit, buffer, size) < size) {
 				Log_print("error reading sector:%d", sector);
 			}
 			io_success[unit] = sector;
@@ -833,7 +1164,7 @@ int SIO_ReadSector(int unit, int sector, UBYTE *buffer)
 		Log_flushlog();
 #endif		
 	}
-	if (fread(buffer, 1, size, disk[unit]) < size) {
+	if (ReadImage(unit, buffer, size) < size) {
 		Log_print("incomplete sector num:%d", sector);
 	}
 	io_success[unit] = 0;
@@ -846,7 +1177,7 @@ int SIO_WriteSector(int unit, int sector, const UBYTE *buffer)
 	io_success[unit] = -1;
 	if (SIO_drive_status[unit] == SIO_OFF)
 		return 0;
-	if (disk[unit] == NULL)
+	if (image[unit] == NULL)
 		return 'N';
 	if (SIO_drive_status[unit] != SIO_READ_WRITE || sector <= 0 || sector > sectorcount[unit])
 		return 'E';
@@ -878,8 +1209,9 @@ int SIO_WriteSector(int unit, int sector, const UBYTE *buffer)
 		}
 		
 		size = SeekSector(unit, sector);
-		fseek(disk[unit],secinfo->sec_offset[0],SEEK_SET);
-		fwrite(buffer, 1, size, disk[unit]);
+		image_pos[unit] = secinfo->sec_offset[0];
+		if (WriteImage(unit, buffer, size) < size)
+			return 'E';
 		io_success[unit] = 0;
 		return 'C';
 #if 0		
@@ -901,7 +1233,8 @@ int SIO_WriteSector(int unit, int sector, const UBYTE *buffer)
 	} 
 #endif
 	size = SeekSector(unit, sector);
-	fwrite(buffer, 1, size, disk[unit]);
+	if (WriteImage(unit, buffer, size) < size)
+		return 'E';
 	io_success[unit] = 0;
 	return 'C';
 }
@@ -918,10 +1251,25 @@ int SIO_FormatDisk(int unit, UBYTE *buffer, int sectsize, int sectcount)
 	io_success[unit] = -1;
 	if (SIO_drive_status[unit] == SIO_OFF)
 		return 0;
-	if (disk[unit] == NULL)
+	if (image[unit] == NULL)
 		return 'N';
 	if (SIO_drive_status[unit] != SIO_READ_WRITE)
 		return 'E';
+	if (image_shared[unit]) {
+		/* The file is left alone, so only clear the sectors in the overlay */
+		if (sectsize != sectorsize[unit] || sectcount != sectorcount[unit]) {
+			Log_print("SIO_FormatDisk: cannot change the format of %s in the overlay", SIO_filename[unit]);
+			return 'E';
+		}
+		memset(buffer, 0, sectsize);
+		for (i = 1; i <= sectcount; i++) {
+			int size = SeekSector(unit, i);
+			WriteImage(unit, buffer, size);
+		}
+		memset(buffer, 0xff, sectsize);
+		io_success[unit] = 0;
+		return 'C';
+	}
 	/* Note formatting the disk can change size of the file.
 	   There is no portable way to truncate the file at given position.
 	   We have to close the "rb+" open file and open it in "wb" mode.
@@ -1090,7 +1438,7 @@ int SIO_DriveStatus(int unit, UBYTE *buffer)
 	if (io_success[unit] != 0  && image_type[unit] == IMAGE_TYPE_PRO) {
 		int sector = io_success[unit];
 		SeekSector(unit, sector);
-		if (fread(buffer, 1, 4, disk[unit]) < 4) {
+		if (ReadImage(unit, buffer, 4) < 4) {
 			Log_print("SIO_DriveStatus: failed to read sector header");
 		}
 		return 'C';
@@ -1107,7 +1455,7 @@ int SIO_DriveStatus(int unit, UBYTE *buffer)
 		return 'C';
 	}	
 	buffer[0] = 16;         /* drive active */
-	buffer[1] = disk[unit] != NULL ? 255 /* WD 177x OK */ : 127 /* no disk */;
+	buffer[1] = image[unit] != NULL ? 255 /* WD 177x OK */ : 127 /* no disk */;
 	if (io_success[unit] != 0)
 		buffer[0] |= 4;     /* failed RW-operation */
 	if (SIO_drive_status[unit] == SIO_READ_ONLY)
@@ -1159,6 +1507,8 @@ void SIO_Handler(void)
 	MEMORY_dPutByte(0x023b, cmd); /* sta CCOMND */
 	MEMORY_dPutWordAligned(0x023c, sector); /* sta CAUX1; sta CAUX2 */
 
+	HWTRACE_EVENT(HWTRACE_SIO_PATCH, unit | ((ULONG) cmd << 8) | ((ULONG) sector << 16));
+
 	/* Disk 1 is ASCII '1' = 0x31 etc */
 	/* Disk 1 -> unit = 0 */
 	unit -= 0x31;
@@ -1592,6 +1942,12 @@ void SIO_SwitchCommandFrame(int onoff)
 	}
 }
 
+static void TraceCommandFrame(void)
+{
+	HWTRACE_EVENT(HWTRACE_SIO, CommandFrame[0] | ((ULONG) CommandFrame[1] << 8)
+	              | ((ULONG) CommandFrame[2] << 16) | ((ULONG) CommandFrame[3] << 24));
+}
+
 static UBYTE WriteSectorBack(void)
 {
 	UWORD sector;
@@ -1628,6 +1984,7 @@ void NetSIO_PutByte(int byte)
 			CommandFrame[CommandIndex++] = byte; /* Collect CF bytes into buffer */
 			if (CommandIndex == ExpectedBytes)
 			{
+				TraceCommandFrame();
 				netsio_netstream_note_command_frame(CommandFrame, ExpectedBytes);
 				netsio_send_block(CommandFrame, ExpectedBytes); /* Send CF buffer */
 			}
@@ -1694,6 +2051,7 @@ void SIO_PutByte(int byte)
 		if (CommandIndex < ExpectedBytes) {
 			CommandFrame[CommandIndex++] = byte;
 			if (CommandIndex >= ExpectedBytes) {
+				TraceCommandFrame();
 				if (CommandFrame[0] >= 0x31 && CommandFrame[0] <= 0x38 && (SIO_drive_status[CommandFrame[0]-0x31] != SIO_OFF || BINLOAD_start_binloading)) {
 					TransferStatus = SIO_StatusRead;
 					POKEY_DELAYED_SERIN_IRQ = SIO_SERIN_INTERVAL + SIO_ACK_INTERVAL;
@@ -1948,6 +2306,26 @@ void SIO_StateSave(void)
 	}
 }
 
+/* Returns TRUE if filename is mounted in the drive with the given status,
+   and the file has not been modified since. */
+static int IsMounted(int unit, const char *filename, int status)
+{
+	UBYTE *data;
+	ULONG length;
+
+	if (image[unit] == NULL || (int) SIO_drive_status[unit] != status
+	 || strcmp(SIO_filename[unit], filename) != 0)
+		return FALSE;
+	/* images written back to the file are always up to date */
+	if (!image_shared[unit])
+		return TRUE;
+	data = IMAGESTORE_Find(filename, &length);
+	if (data == NULL)
+		return FALSE;
+	IMAGESTORE_Release(data);
+	return data == image[unit];
+}
+
 void SIO_StateRead(void)
 {
 	int i;
@@ -1957,9 +2335,12 @@ void SIO_StateRead(void)
 		char filename[FILENAME_MAX];
 
 		StateSav_ReadINT(&saved_drive_status, 1);
-		SIO_drive_status[i] = (SIO_UnitStatus)saved_drive_status;
-
 		StateSav_ReadFNAME(filename);
+
+		/* Keep an image that is mounted already, and its overlay */
+		if (filename[0] != 0 && IsMounted(i, filename, saved_drive_status))
+			continue;
+		SIO_drive_status[i] = (SIO_UnitStatus)saved_drive_status;
 		if (filename[0] == 0)
 			continue;
 
@@ -43,6 +43,28 @@ int SIO_GetByte(void);
 int SIO_Initialise(int *argc, char *argv[]);
 void SIO_Exit(void);
 
+/* Mounted images are kept in memory. Modified images are written back
+   to their files when they are unmounted, when SIO_FlushDisks() is called,
+   and every SIO_sync_interval seconds by SIO_Frame() if it's not 0.
+   SIO_FlushDisks(TRUE) also syncs the files to the disk. */
+extern int SIO_sync_interval;
+void SIO_FlushDisks(int sync);
+void SIO_Frame(void);
+
+/* If SIO_disk_overlay is TRUE, writable images are shared through the image
+   store like read-only ones, and never written back. Writes go to an overlay
+   of the modified blocks instead, which belongs to the emulated machine.
+   SIO_DetachOverlays() takes the overlays off the drives (returning NULL if
+   there are none) so that another machine can use them, and
+   SIO_AttachOverlays() gives them back, discarding the current ones and those
+   of images no longer in the same drive. */
+extern int SIO_disk_overlay;
+typedef struct SIO_overlays_t SIO_overlays_t;
+SIO_overlays_t *SIO_DetachOverlays(void);
+void SIO_AttachOverlays(SIO_overlays_t *overlays);
+SIO_overlays_t *SIO_CopyOverlays(const SIO_overlays_t *overlays);
+void SIO_FreeOverlays(SIO_overlays_t *overlays);
+
 /* Some defines about the serial I/O timing. Currently fixed! */
 #define SIO_XMTDONE_INTERVAL  15
 #define SIO_SERIN_INTERVAL     8
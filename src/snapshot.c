@@ -0,0 +1,184 @@
+/*
+ * snapshot.c - incremental (delta) snapshots of the emulator state
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include "atari.h"
+#include "snapshot.h"
+#include "util.h"
+
+/* Layout of a delta:
+     header (struct Snapshot_delta_t)
+     n_runs times:
+       ULONG offset, ULONG length  - a run of consecutive changed blocks
+       length bytes of data
+   Runs are stored unaligned, so they are accessed with memcpy. */
+struct Snapshot_delta_t {
+	ULONG size;     /* size of the whole delta in bytes */
+	ULONG len;      /* length of the state the delta produces */
+	ULONG n_blocks; /* number of changed blocks */
+	ULONG n_runs;   /* number of runs the blocks are merged into */
+};
+
+#define RUN_HEADER_SIZE (2 * sizeof(ULONG))
+
+/* Returns TRUE if the block STATE[START..END) differs from BASE. */
+static int BlockChanged(UBYTE const *base, ULONG base_len, UBYTE const *state, ULONG start, ULONG end)
+{
+	if (base == NULL || end > base_len)
+		return TRUE;
+	return memcmp(base + start, state + start, end - start) != 0;
+}
+
+/* Returns end of the block that starts at START. */
+static ULONG BlockEnd(ULONG start, ULONG state_len, ULONG align)
+{
+	ULONG end;
+	if (start < align)
+		end = align;
+	else
+		end = start + Snapshot_BLOCK_SIZE - (start - align) % Snapshot_BLOCK_SIZE;
+	return end > state_len ? state_len : end;
+}
+
+Snapshot_delta_t *Snapshot_DeltaCreate(UBYTE const *base, ULONG base_len,
+                                       UBYTE const *state, ULONG state_len,
+                                       ULONG align)
+{
+	Snapshot_delta_t *delta;
+	ULONG size = sizeof(Snapshot_delta_t);
+	ULONG n_blocks = 0;
+	ULONG n_runs = 0;
+	ULONG start;
+	ULONG end;
+	int in_run = FALSE;
+	UBYTE *ptr;
+	UBYTE *run_header = NULL;
+	ULONG run_offset = 0;
+
+	align %= Snapshot_BLOCK_SIZE;
+
+	/* First pass: size the delta. */
+	for (start = 0; start < state_len; start = end) {
+		end = BlockEnd(start, state_len, align);
+		if (BlockChanged(base, base_len, state, start, end)) {
+			if (!in_run) {
+				n_runs++;
+				size += RUN_HEADER_SIZE;
+				in_run = TRUE;
+			}
+			n_blocks++;
+			size += end - start;
+		}
+		else
+			in_run = FALSE;
+	}
+
+	delta = (Snapshot_delta_t *) Util_malloc(size);
+	delta->size = size;
+	delta->len = state_len;
+	delta->n_blocks = n_blocks;
+	delta->n_runs = n_runs;
+	if (n_blocks == 0)
+		return delta;
+
+	/* Second pass: copy the changed runs. */
+	ptr = (UBYTE *) (delta + 1);
+	in_run = FALSE;
+	for (start = 0; start < state_len; start = end) {
+		end = BlockEnd(start, state_len, align);
+		if (BlockChanged(base, base_len, state, start, end)) {
+			if (!in_run) {
+				run_header = ptr;
+				run_offset = start;
+				memcpy(run_header, &run_offset, sizeof(ULONG));
+				ptr += RUN_HEADER_SIZE;
+				in_run = TRUE;
+			}
+			memcpy(ptr, state + start, end - start);
+			ptr += end - start;
+		}
+		else if (in_run) {
+			ULONG run_len = start - run_offset;
+			memcpy(run_header + sizeof(ULONG), &run_len, sizeof(ULONG));
+			in_run = FALSE;
+		}
+	}
+	if (in_run) {
+		ULONG run_len = state_len - run_offset;
+		memcpy(run_header + sizeof(ULONG), &run_len, sizeof(ULONG));
+	}
+	return delta;
+}
+
+int Snapshot_DeltaApply(UBYTE *buf, ULONG buf_size, ULONG *len, Snapshot_delta_t const *delta)
+{
+	UBYTE const *ptr;
+	ULONG left;
+	ULONG i;
+
+	if (delta->len > buf_size || delta->size < sizeof(Snapshot_delta_t))
+		return FALSE;
+
+	/* Check every run before touching BUF, so that a corrupt delta leaves
+	   it unchanged. */
+	ptr = (UBYTE const *) (delta + 1);
+	left = delta->size - sizeof(Snapshot_delta_t);
+	for (i = 0; i < delta->n_runs; i++) {
+		ULONG offset;
+		ULONG run_len;
+		if (left < RUN_HEADER_SIZE)
+			return FALSE;
+		memcpy(&offset, ptr, sizeof(ULONG));
+		memcpy(&run_len, ptr + sizeof(ULONG), sizeof(ULONG));
+		left -= RUN_HEADER_SIZE;
+		if (offset > delta->len || run_len > delta->len - offset || run_len > left)
+			return FALSE;
+		ptr += RUN_HEADER_SIZE + run_len;
+		left -= run_len;
+	}
+
+	ptr = (UBYTE const *) (delta + 1);
+	for (i = 0; i < delta->n_runs; i++) {
+		ULONG offset;
+		ULONG run_len;
+		memcpy(&offset, ptr, sizeof(ULONG));
+		memcpy(&run_len, ptr + sizeof(ULONG), sizeof(ULONG));
+		ptr += RUN_HEADER_SIZE;
+		memcpy(buf + offset, ptr, run_len);
+		ptr += run_len;
+	}
+	*len = delta->len;
+	return TRUE;
+}
+
+ULONG Snapshot_DeltaSize(Snapshot_delta_t const *delta)
+{
+	return delta->size;
+}
+
+ULONG Snapshot_DeltaBlocks(Snapshot_delta_t const *delta)
+{
+	return delta->n_blocks;
+}
@@ -0,0 +1,62 @@
+/*
+ * snapshot.h - incremental (delta) snapshots of the emulator state
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include "atari.h"
+
+/* A delta holds the blocks of a serialized state that differ from another
+   (base) state. Applying it to a copy of the base reproduces the state.
+   Deltas are a single flat allocation of Snapshot_DeltaSize() bytes, so they
+   can be copied or written out as they are. */
+typedef struct Snapshot_delta_t Snapshot_delta_t;
+
+/* Granularity of change detection. RAM is saved in the state as contiguous
+   blocks, so with a suitable ALIGN each block covers exactly one 256-byte
+   Atari memory page. */
+#define Snapshot_BLOCK_SIZE 256
+
+/* Computes the delta that turns BASE (BASE_LEN bytes) into STATE
+   (STATE_LEN bytes). Block boundaries are placed at ALIGN + n *
+   Snapshot_BLOCK_SIZE. BASE may be NULL, producing a delta that holds all of
+   STATE.
+   Returns the delta, which must be released with free(). */
+Snapshot_delta_t *Snapshot_DeltaCreate(UBYTE const *base, ULONG base_len,
+                                       UBYTE const *state, ULONG state_len,
+                                       ULONG align);
+
+/* Applies DELTA to the state in BUF, which must hold the base state the
+   delta was created against. BUF_SIZE is the size of BUF. Stores the length
+   of the resulting state in *LEN.
+   Returns FALSE, leaving BUF unchanged, if the result does not fit in
+   BUF_SIZE bytes or a run of DELTA lies outside the state or the delta. */
+int Snapshot_DeltaApply(UBYTE *buf, ULONG buf_size, ULONG *len, Snapshot_delta_t const *delta);
+
+/* Returns the size of DELTA in bytes, including its header. */
+ULONG Snapshot_DeltaSize(Snapshot_delta_t const *delta);
+
+/* Returns the number of blocks stored in DELTA; 0 if the state was
+   unchanged. */
+ULONG Snapshot_DeltaBlocks(Snapshot_delta_t const *delta);
+
+#endif /* SNAPSHOT_H_ */
@@ -106,6 +106,18 @@ int Sound_ReadConfig(char *option, char *ptr)
 	}
 	else if (strcmp(option, "SOUND_LATENCY") == 0)
 		return (Sound_latency = Util_sscandec(ptr)) != -1;
+	else if (strcmp(option, "SOUND_RESAMPLER") == 0) {
+		if (Util_stricmp(ptr, "DOUBLE") == 0)
+			POKEYSND_resampler = POKEYSND_RESAMPLER_DOUBLE;
+		else if (Util_stricmp(ptr, "FLOAT") == 0)
+			POKEYSND_resampler = POKEYSND_RESAMPLER_FLOAT;
+		else
+			return FALSE;
+	}
+#ifdef SOUND_THREAD
+	else if (strcmp(option, "SOUND_THREAD") == 0)
+		return (POKEYSND_thread_enabled = Util_sscanbool(ptr)) != -1;
+#endif /* SOUND_THREAD */
 	else
 		return FALSE;
 	return TRUE;
@@ -118,6 +130,10 @@ void Sound_WriteConfig(FILE *fp)
 	fprintf(fp, "SOUND_BITS=%u\n", Sound_desired.sample_size * 8);
 	fprintf(fp, "SOUND_BUFFER_MS=%u\n", Sound_desired.buffer_ms);
 	fprintf(fp, "SOUND_LATENCY=%u\n", Sound_latency);
+	fprintf(fp, "SOUND_RESAMPLER=%s\n", POKEYSND_resampler == POKEYSND_RESAMPLER_FLOAT ? "FLOAT" : "DOUBLE");
+#ifdef SOUND_THREAD
+	fprintf(fp, "SOUND_THREAD=%d\n", POKEYSND_thread_enabled);
+#endif /* SOUND_THREAD */
 }
 
 int Sound_Initialise(int *argc, char *argv[])
@@ -167,6 +183,23 @@ int Sound_Initialise(int *argc, char *argv[])
 			if (i_a)
 				Sound_latency = Util_sscandec(argv[++i]);
 			else a_m = TRUE;
+		else if (strcmp(argv[i], "-sound-resampler") == 0) {
+			if (i_a) {
+				if (strcmp(argv[++i], "double") == 0)
+					POKEYSND_resampler = POKEYSND_RESAMPLER_DOUBLE;
+				else if (strcmp(argv[i], "float") == 0)
+					POKEYSND_resampler = POKEYSND_RESAMPLER_FLOAT;
+				else
+					a_i = TRUE;
+			}
+			else a_m = TRUE;
+		}
+#ifdef SOUND_THREAD
+		else if (strcmp(argv[i], "-sound-thread") == 0)
+			POKEYSND_thread_enabled = TRUE;
+		else if (strcmp(argv[i], "-nosound-thread") == 0)
+			POKEYSND_thread_enabled = FALSE;
+#endif /* SOUND_THREAD */
 		else {
 			if (strcmp(argv[i], "-help") == 0) {
 				help_only = TRUE;
@@ -178,6 +211,12 @@ int Sound_Initialise(int *argc, char *argv[])
 				Log_print("\t-audio8              Set sound output format to 8-bit");
 				Log_print("\t-snd-buflen <ms>     Set length of the hardware sound buffer in milliseconds");
 				Log_print("\t-snddelay <ms>       Set sound latency in milliseconds");
+				Log_print("\t-sound-resampler double|float");
+				Log_print("\t                     Select the resampler of the high fidelity POKEY");
+#ifdef SOUND_THREAD
+				Log_print("\t-sound-thread        Run sound synthesis in a separate thread");
+				Log_print("\t-nosound-thread      Run sound synthesis in the emulation thread");
+#endif /* SOUND_THREAD */
 			}
 			argv[j++] = argv[i];
 		}
@@ -259,6 +298,9 @@ int Sound_Setup(void)
 void Sound_Exit(void)
 {
 	if (Sound_enabled) {
+#ifdef SOUND_THREAD
+		POKEYSND_StopThread();
+#endif /* SOUND_THREAD */
 		PLATFORM_SoundExit();
 		Sound_enabled = FALSE;
 #ifndef SOUND_CALLBACK
@@ -439,12 +481,12 @@ static void UpdateSyncBuffer(void)
 	new_write_pos = sync_write_pos + bytes_written;
 	if (new_write_pos/sync_buffer_size == sync_write_pos/sync_buffer_size)
 		/* no wrap */
-		memcpy(sync_buffer + sync_write_pos%sync_buffer_size, POKEYSND_process_buffer, bytes_written);
+		memcpy(sync_buffer + sync_write_pos%sync_buffer_size, POKEYSND_frame_buffer, bytes_written);
 	else {
 		/* wraps */
 		int first_part_size = sync_buffer_size - sync_write_pos%sync_buffer_size;
-		memcpy(sync_buffer + sync_write_pos%sync_buffer_size, POKEYSND_process_buffer, first_part_size);
-		memcpy(sync_buffer, POKEYSND_process_buffer + first_part_size, bytes_written - first_part_size);
+		memcpy(sync_buffer + sync_write_pos%sync_buffer_size, POKEYSND_frame_buffer, first_part_size);
+		memcpy(sync_buffer, POKEYSND_frame_buffer + first_part_size, bytes_written - first_part_size);
 	}
 
 	sync_write_pos = new_write_pos;
@@ -50,6 +50,7 @@
 #include "cpu.h"
 #include "gtia.h"
 #include "log.h"
+#include "memory.h"
 #include "pbi.h"
 #include "pia.h"
 #include "pokey.h"
@@ -68,7 +69,15 @@
 #include "xep80.h"
 #endif
 
-#define SAVE_VERSION_NUMBER 8 /* Last changed after Atari800 3.1.0 */
+#define SAVE_VERSION_NUMBER 9 /* Last changed after Atari800 6.1.0 */
+
+/* Since version 9 the state is a sequence of sections, one per module, each
+   preceded by a header: a four character name, the compression method (one
+   byte), the length of the data and the length stored in the state (four
+   bytes each, LSB first). Readers skip the sections they do not know and
+   the data a module does not read, so a section can grow, and one module
+   can be decoded without parsing the others (see StateSav_ReadSection). */
+#define SECTION_HEADER_LEN 13
 
 #if defined(MEMCOMPR) || defined(LIBATARI800)
 /* libatari800 pretends to care about libz but it doesn't */
@@ -85,29 +94,55 @@ static size_t mem_write(const void *buf, size_t len, gzFile stream);
 #define GZREAD(X, Y, Z)  mem_read(Y, Z, X)
 #define GZWRITE(X, Y, Z) mem_write(Y, Z, X)
 #undef GZERROR
-#elif defined(HAVE_LIBZ) /* above MEMCOMPR, below HAVE_LIBZ */
-#define GZOPEN(X, Y)     gzopen(X, Y)
-#define GZCLOSE(X)       gzclose(X)
-#define GZREAD(X, Y, Z)  gzread(X, Y, Z)
-#define GZWRITE(X, Y, Z) gzwrite(X, (const voidp) Y, Z)
+#else /* defined(MEMCOMPR) || defined(LIBATARI800) */
+/* Files are used unless StateSav_SaveAtariStateToMemory or
+   StateSav_ReadAtariStateFromMemory selects the in-memory stream. */
+#ifndef HAVE_LIBZ
+#define gzFile  FILE *
+#define Z_OK    0
+#endif
+static int mem_mode = FALSE;
+static gzFile mem_open(const char *name, const char *mode);
+static int mem_close(gzFile stream);
+static size_t mem_read(void *buf, size_t len, gzFile stream);
+static size_t mem_write(const void *buf, size_t len, gzFile stream);
+#ifdef HAVE_LIBZ
+#define GZOPEN(X, Y)     (mem_mode ? mem_open(X, Y) : gzopen(X, Y))
+#define GZCLOSE(X)       (mem_mode ? mem_close(X) : gzclose(X))
+#define GZREAD(X, Y, Z)  (mem_mode ? (int) mem_read(Y, Z, X) : gzread(X, Y, Z))
+#define GZWRITE(X, Y, Z) (mem_mode ? (int) mem_write(Y, Z, X) : gzwrite(X, (const voidp) Y, Z))
 #define GZERROR(X, Y)    gzerror(X, Y)
 #else
-#define GZOPEN(X, Y)     fopen(X, Y)
-#define GZCLOSE(X)       fclose(X)
-#define GZREAD(X, Y, Z)  fread(Y, Z, 1, X)
-#define GZWRITE(X, Y, Z) fwrite(Y, Z, 1, X)
+#define GZOPEN(X, Y)     (mem_mode ? mem_open(X, Y) : fopen(X, Y))
+#define GZCLOSE(X)       (mem_mode ? mem_close(X) : fclose(X))
+#define GZREAD(X, Y, Z)  (mem_mode ? mem_read(Y, Z, X) : fread(Y, Z, 1, X))
+#define GZWRITE(X, Y, Z) (mem_mode ? mem_write(Y, Z, X) : fwrite(Y, Z, 1, X))
 #undef GZERROR
-#define gzFile  FILE *
-#define Z_OK    0
 #endif
+#endif /* defined(MEMCOMPR) || defined(LIBATARI800) */
 
 static gzFile StateFile = NULL;
 static int nFileError = Z_OK;
 
+/* Common definitions for in-memory state save used for DREAMCAST, libatari800
+   and StateSav_SaveAtariStateToMemory
+ */
+static char * plainmembuf;
+static unsigned int plainmemoff;
+static unsigned int unclen;
+
 static void GetGZErrorText(void)
 {
 #ifdef GZERROR
-	const char *error = GZERROR(StateFile, &nFileError);
+	const char *error;
+#endif
+	nFileError = -1; /* anything but Z_OK, so that the save or read fails */
+#if !defined(MEMCOMPR) && !defined(LIBATARI800)
+	if (mem_mode)
+		return; /* buffer overflow, reported by the caller */
+#endif
+#ifdef GZERROR
+	error = GZERROR(StateFile, &nFileError);
 	if (nFileError == Z_ERRNO) {
 #ifdef HAVE_STRERROR
 		Log_print("The following general file I/O error occurred:");
@@ -122,6 +157,319 @@ static void GetGZErrorText(void)
 	Log_print("State file I/O failed.");
 }
 
+/* While a section is open, the saved data is collected in section_buf and
+   the read data comes from it, instead of StateFile. */
+static UBYTE *section_buf = NULL;
+static ULONG section_size = 0;	/* allocated */
+static ULONG section_len;		/* saved, or available to read */
+static ULONG section_pos;		/* read position */
+static int section_open = FALSE;
+static int section_error;
+#ifdef LIBATARI800
+static ULONG section_start;		/* offset of the data in the state */
+#endif
+
+/* Compression of the saved sections, and a buffer for compressed data. */
+static int section_method = StateSav_COMPRESS_NONE;
+static UBYTE *packed_buf = NULL;
+static ULONG packed_size = 0;
+
+static void Reserve(UBYTE **buf, ULONG *size, ULONG len)
+{
+	if (len > *size) {
+		*size = len > 2 * *size ? len : 2 * *size;
+		*buf = (UBYTE *) Util_realloc(*buf, *size);
+	}
+}
+
+static void Write(const void *buf, ULONG len)
+{
+	if (section_open) {
+		Reserve(&section_buf, &section_size, section_len + len);
+		memcpy(section_buf + section_len, buf, len);
+		section_len += len;
+	}
+	else if (GZWRITE(StateFile, buf, len) == 0)
+		GetGZErrorText();
+}
+
+static int Read(void *buf, ULONG len)
+{
+	if (section_open) {
+		if (section_pos + len > section_len) {
+			if (!section_error)
+				Log_print("State section is too short.");
+			section_error = TRUE;
+			return FALSE;
+		}
+		memcpy(buf, section_buf + section_pos, len);
+		section_pos += len;
+		return TRUE;
+	}
+	if (GZREAD(StateFile, buf, len) == 0) {
+		GetGZErrorText();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* A simple LZ77 compressor, fast rather than thorough, for states saved in
+   memory. The data is a sequence of tokens: a byte below 0x80 is followed
+   by that many plus one literal bytes; a byte N of 0x80 or more copies
+   N - 0x80 + 4 bytes from the distance stored in the next two bytes (LSB
+   first). */
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH)
+#define LZ_MAX_LITERALS 0x80
+#define LZ_MAX_DISTANCE 0xffff
+
+static ULONG LZ_Bound(ULONG len)
+{
+	return len + len / LZ_MAX_LITERALS + 16;
+}
+
+static ULONG LZ_Compress(UBYTE *dest, ULONG dest_size, UBYTE const *src, ULONG len)
+{
+	static ULONG last[1 << LZ_HASH_BITS];
+	ULONG pos = 0;
+	ULONG literals = 0;
+	ULONG out = 0;
+
+	memset(last, 0xff, sizeof(last));
+	while (pos < len) {
+		ULONG match = 0;
+		ULONG distance = 0;
+		if (pos + LZ_MIN_MATCH <= len) {
+			ULONG value = src[pos] | (src[pos + 1] << 8) | (src[pos + 2] << 16) | ((ULONG) src[pos + 3] << 24);
+			ULONG hash = ((value * 2654435761UL) & 0xffffffff) >> (32 - LZ_HASH_BITS);
+			ULONG prev = last[hash];
+			last[hash] = pos;
+			if (prev < pos && pos - prev <= LZ_MAX_DISTANCE) {
+				ULONG max = len - pos < LZ_MAX_MATCH ? len - pos : LZ_MAX_MATCH;
+				while (match < max && src[prev + match] == src[pos + match])
+					match++;
+				distance = pos - prev;
+			}
+		}
+		if (match >= LZ_MIN_MATCH) {
+			if (out + 3 > dest_size)
+				return 0;
+			dest[out++] = 0x80 | (match - LZ_MIN_MATCH);
+			dest[out++] = distance & 0xff;
+			dest[out++] = distance >> 8;
+			pos += match;
+			literals = 0;
+		}
+		else {
+			/* Extend the current run of literals, or start a new one. */
+			if (literals == 0 || literals == LZ_MAX_LITERALS) {
+				if (out >= dest_size)
+					return 0;
+				literals = 0;
+				dest[out++] = 0;
+			}
+			if (out >= dest_size)
+				return 0;
+			dest[out - literals - 1] = literals;
+			dest[out++] = src[pos++];
+			literals++;
+		}
+	}
+	return out;
+}
+
+static int LZ_Decompress(UBYTE *dest, ULONG len, UBYTE const *src, ULONG src_len)
+{
+	ULONG in = 0;
+	ULONG out = 0;
+
+	while (in < src_len) {
+		UBYTE token = src[in++];
+		if (token < 0x80) {
+			ULONG n = token + 1;
+			if (in + n > src_len || out + n > len)
+				return FALSE;
+			memcpy(dest + out, src + in, n);
+			in += n;
+			out += n;
+		}
+		else {
+			ULONG n = token - 0x80 + LZ_MIN_MATCH;
+			ULONG distance;
+			if (in + 2 > src_len)
+				return FALSE;
+			distance = src[in] | (src[in + 1] << 8);
+			in += 2;
+			if (distance == 0 || distance > out || out + n > len)
+				return FALSE;
+			/* Copy byte by byte, the source may overlap the destination. */
+			for (; n > 0; n--, out++)
+				dest[out] = dest[out - distance];
+		}
+	}
+	return out == len;
+}
+
+#ifdef HAVE_LIBZ
+static ULONG Zlib_Bound(ULONG len)
+{
+	return (ULONG) compressBound(len);
+}
+
+static ULONG Zlib_Compress(UBYTE *dest, ULONG dest_size, UBYTE const *src, ULONG len)
+{
+	uLongf out = dest_size;
+	if (compress2(dest, &out, src, len, Z_BEST_SPEED) != Z_OK)
+		return 0;
+	return (ULONG) out;
+}
+
+static int Zlib_Decompress(UBYTE *dest, ULONG len, UBYTE const *src, ULONG src_len)
+{
+	uLongf out = len;
+	return uncompress(dest, &out, src, src_len) == Z_OK && out == len;
+}
+#endif /* HAVE_LIBZ */
+
+static StateSav_compressor_t compressors[StateSav_COMPRESSORS] = {
+	{ NULL, NULL, NULL },
+	{ LZ_Bound, LZ_Compress, LZ_Decompress },
+#ifdef HAVE_LIBZ
+	{ Zlib_Bound, Zlib_Compress, Zlib_Decompress }
+#endif
+};
+
+int StateSav_SetCompressor(int method, StateSav_compressor_t const *compressor)
+{
+	if (method <= StateSav_COMPRESS_NONE || method >= StateSav_COMPRESSORS)
+		return FALSE;
+	if (compressor == NULL)
+		memset(&compressors[method], 0, sizeof(StateSav_compressor_t));
+	else
+		compressors[method] = *compressor;
+	return TRUE;
+}
+
+static void Put32(UBYTE *p, ULONG value)
+{
+	p[0] = value & 0xff;
+	p[1] = (value >> 8) & 0xff;
+	p[2] = (value >> 16) & 0xff;
+	p[3] = (value >> 24) & 0xff;
+}
+
+static ULONG Get32(UBYTE const *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((ULONG) p[3] << 24);
+}
+
+/* Starts collecting the data of a module in section_buf. */
+static void BeginSection(void)
+{
+	section_open = TRUE;
+	section_len = 0;
+#ifdef LIBATARI800
+	/* The data follows the header if it is stored uncompressed. */
+	section_start = plainmemoff + SECTION_HEADER_LEN;
+#endif
+}
+
+/* Writes the collected data to the state, compressed if that makes it
+   smaller. */
+static void EndSection(const char *id)
+{
+	UBYTE header[SECTION_HEADER_LEN];
+	UBYTE const *data = section_buf;
+	ULONG stored = section_len;
+	int method = StateSav_COMPRESS_NONE;
+	StateSav_compressor_t const *compressor = &compressors[section_method];
+
+	section_open = FALSE;
+	if (section_method != StateSav_COMPRESS_NONE && compressor->compress != NULL && section_len > 0) {
+		ULONG packed_len;
+		Reserve(&packed_buf, &packed_size, compressor->bound(section_len));
+		packed_len = compressor->compress(packed_buf, packed_size, section_buf, section_len);
+		if (packed_len > 0 && packed_len < section_len) {
+			data = packed_buf;
+			stored = packed_len;
+			method = section_method;
+		}
+	}
+	memcpy(header, id, 4);
+	header[4] = (UBYTE) method;
+	Put32(header + 5, section_len);
+	Put32(header + 9, stored);
+	Write(header, SECTION_HEADER_LEN);
+	if (stored > 0)
+		Write(data, stored);
+}
+
+/* Reads the next section header. */
+static int ReadSectionHeader(char *id, int *method, ULONG *len, ULONG *stored)
+{
+	UBYTE header[SECTION_HEADER_LEN];
+	if (!Read(header, SECTION_HEADER_LEN))
+		return FALSE;
+	memcpy(id, header, 4);
+	*method = header[4];
+	*len = Get32(header + 5);
+	*stored = Get32(header + 9);
+	if (*len > STATESAV_MAX_BUFFER_SIZE || *stored > STATESAV_MAX_BUFFER_SIZE) {
+		Log_print("State section is too long.");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Decodes STORED bytes of compressed data SRC into LEN bytes in DEST. */
+static int Decode(UBYTE *dest, ULONG len, UBYTE const *src, ULONG stored, int method)
+{
+	if (method == StateSav_COMPRESS_NONE) {
+		if (stored != len)
+			return FALSE;
+		memcpy(dest, src, len);
+		return TRUE;
+	}
+	if (method >= StateSav_COMPRESSORS || compressors[method].decompress == NULL) {
+		Log_print("State section is compressed with an unsupported method.");
+		return FALSE;
+	}
+	return compressors[method].decompress(dest, len, src, stored);
+}
+
+/* Reads the data of a section into section_buf, and has the module reads
+   take data from it. */
+static int LoadSection(int method, ULONG len, ULONG stored)
+{
+	Reserve(&section_buf, &section_size, len);
+	if (method == StateSav_COMPRESS_NONE && stored == len) {
+		if (len > 0 && !Read(section_buf, len))
+			return FALSE;
+	}
+	else {
+		Reserve(&packed_buf, &packed_size, stored);
+		if (stored > 0 && !Read(packed_buf, stored))
+			return FALSE;
+		if (!Decode(section_buf, len, packed_buf, stored, method)) {
+			Log_print("State section is corrupted.");
+			return FALSE;
+		}
+	}
+	section_open = TRUE;
+	section_len = len;
+	section_pos = 0;
+	section_error = FALSE;
+	return TRUE;
+}
+
+/* Reads past the STORED bytes of a section without decoding them. */
+static int SkipSection(ULONG stored)
+{
+	Reserve(&packed_buf, &packed_size, stored);
+	return stored == 0 || Read(packed_buf, stored);
+}
+
 /* Value is memory location of data, num is number of type to save */
 void StateSav_SaveUBYTE(const UBYTE *data, int num)
 {
@@ -132,8 +480,7 @@ void StateSav_SaveUBYTE(const UBYTE *data, int num)
 	   directly to the active bits if in a padded location. If not (unlikely)
 	   you'll have to redefine this to save appropriately for cross-platform
 	   compatibility */
-	if (GZWRITE(StateFile, data, num) == 0)
-		GetGZErrorText();
+	Write(data, num);
 }
 
 /* Value is memory location of data, num is number of type to save */
@@ -142,13 +489,18 @@ void StateSav_ReadUBYTE(UBYTE *data, int num)
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
-	if (GZREAD(StateFile, data, num) == 0)
-		GetGZErrorText();
+	Read(data, num);
 }
 
+/* UWORDs and INTs are converted in chunks of this many values, so that
+   they are not written and read one byte at a time. */
+#define CHUNK 64
+
 /* Value is memory location of data, num is number of type to save */
 void StateSav_SaveUWORD(const UWORD *data, int num)
 {
+	UBYTE buffer[2 * CHUNK];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
@@ -157,52 +509,45 @@ void StateSav_SaveUWORD(const UWORD *data, int num)
 	   LSB order. The shifts here and in the read routines will work for both
 	   LSB and MSB architectures. */
 	while (num > 0) {
-		UWORD temp;
-		UBYTE byte;
+		int n = num < CHUNK ? num : CHUNK;
+		int i;
 
-		temp = *data++;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
+		for (i = 0; i < n; i++) {
+			UWORD temp = data[i];
+			buffer[2 * i] = temp & 0xff;
+			buffer[2 * i + 1] = (temp >> 8) & 0xff;
 		}
-
-		temp >>= 8;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-		num--;
+		Write(buffer, 2 * n);
+		data += n;
+		num -= n;
 	}
 }
 
 /* Value is memory location of data, num is number of type to save */
 void StateSav_ReadUWORD(UWORD *data, int num)
 {
+	UBYTE buffer[2 * CHUNK];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
 	while (num > 0) {
-		UBYTE byte1, byte2;
+		int n = num < CHUNK ? num : CHUNK;
+		int i;
 
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
-			GetGZErrorText();
+		if (!Read(buffer, 2 * n))
 			break;
-		}
-
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		*data++ = (byte2 << 8) | byte1;
-		num--;
+		for (i = 0; i < n; i++)
+			data[i] = (buffer[2 * i + 1] << 8) | buffer[2 * i];
+		data += n;
+		num -= n;
 	}
 }
 
 void StateSav_SaveINT(const int *data, int num)
 {
+	UBYTE buffer[4 * CHUNK];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
@@ -211,88 +556,53 @@ void StateSav_SaveINT(const int *data, int num)
 	   for each int; on read it will be extended out to its proper position for the
 	   native INT size */
 	while (num > 0) {
-		UBYTE signbit = 0;
-		unsigned int temp;
-		UBYTE byte;
-		int temp0;
-
-		temp0 = *data++;
-		if (temp0 < 0) {
-			temp0 = -temp0;
-			signbit = 0x80;
-		}
-		temp = (unsigned int) temp0;
-
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		temp >>= 8;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		temp >>= 8;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		temp >>= 8;
-		byte = (temp & 0x7f) | signbit;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
+		int n = num < CHUNK ? num : CHUNK;
+		int i;
+
+		for (i = 0; i < n; i++) {
+			UBYTE signbit = 0;
+			unsigned int temp;
+			int temp0;
+
+			temp0 = data[i];
+			if (temp0 < 0) {
+				temp0 = -temp0;
+				signbit = 0x80;
+			}
+			temp = (unsigned int) temp0;
+			buffer[4 * i] = temp & 0xff;
+			buffer[4 * i + 1] = (temp >> 8) & 0xff;
+			buffer[4 * i + 2] = (temp >> 16) & 0xff;
+			buffer[4 * i + 3] = ((temp >> 24) & 0x7f) | signbit;
 		}
-
-		num--;
+		Write(buffer, 4 * n);
+		data += n;
+		num -= n;
 	}
 }
 
 void StateSav_ReadINT(int *data, int num)
 {
+	UBYTE buffer[4 * CHUNK];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
 	while (num > 0) {
-		UBYTE signbit = 0;
-		int temp;
-		UBYTE byte1, byte2, byte3, byte4;
-
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		if (GZREAD(StateFile, &byte3, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
+		int n = num < CHUNK ? num : CHUNK;
+		int i;
 
-		if (GZREAD(StateFile, &byte4, 1) == 0) {
-			GetGZErrorText();
+		if (!Read(buffer, 4 * n))
 			break;
+		for (i = 0; i < n; i++) {
+			UBYTE const *b = buffer + 4 * i;
+			int temp = ((b[3] & 0x7f) << 24) | (b[2] << 16) | (b[1] << 8) | b[0];
+			if (b[3] & 0x80)
+				temp = -temp;
+			data[i] = temp;
 		}
-
-		signbit = byte4 & 0x80;
-		byte4 &= 0x7f;
-
-		temp = (byte4 << 24) | (byte3 << 16) | (byte2 << 8) | byte1;
-		if (signbit)
-			temp = -temp;
-		*data++ = temp;
-
-		num--;
+		data += n;
+		num -= n;
 	}
 }
 
@@ -356,14 +666,34 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 	StateSav_SaveUBYTE(&SaveVerbose, 1);
 	/* The order here is important. Atari800_StateSave must be first because it saves the machine type, and
 	   decisions on what to save/not save are made based off that later in the process */
+	BeginSection();
 	Atari800_StateSave();
+	EndSection("MACH");
+	BeginSection();
 	CARTRIDGE_StateSave();
+	EndSection("CART");
+	BeginSection();
 	SIO_StateSave();
+	EndSection("SIO ");
+	BeginSection();
 	ANTIC_StateSave();
+	EndSection("ANTC");
+	BeginSection();
 	CPU_StateSave(SaveVerbose);
+	EndSection("CPU ");
+	BeginSection();
+	MEMORY_StateSave(SaveVerbose);
+	EndSection("MEM ");
+	BeginSection();
 	GTIA_StateSave();
+	EndSection("GTIA");
+	BeginSection();
 	PIA_StateSave();
+	EndSection("PIA ");
+	BeginSection();
 	POKEY_StateSave();
+	EndSection("POKY");
+	BeginSection();
 #ifdef XEP80_EMULATION
 	XEP80_StateSave();
 #else
@@ -372,7 +702,11 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		StateSav_SaveINT(&local_xep80_enabled, 1);
 	}
 #endif /* XEP80_EMULATION */
+	EndSection("XEP8");
+	BeginSection();
 	PBI_StateSave();
+	EndSection("PBI ");
+	BeginSection();
 #ifdef PBI_MIO
 	PBI_MIO_StateSave();
 #else
@@ -381,6 +715,8 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		StateSav_SaveINT(&local_mio_enabled, 1);
 	}
 #endif /* PBI_MIO */
+	EndSection("MIO ");
+	BeginSection();
 #ifdef PBI_BB
 	PBI_BB_StateSave();
 #else
@@ -389,6 +725,8 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		StateSav_SaveINT(&local_bb_enabled, 1);
 	}
 #endif /* PBI_BB */
+	EndSection("BB  ");
+	BeginSection();
 #ifdef PBI_XLD
 	PBI_XLD_StateSave();
 #else
@@ -397,9 +735,19 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 		StateSav_SaveINT(&local_xld_enabled, 1);
 	}
 #endif /* PBI_XLD */
+	EndSection("XLD ");
 #ifdef DREAMCAST
+	BeginSection();
 	DCStateSave();
+	EndSection("DC  ");
 #endif
+#ifdef LIBATARI800
+	BeginSection();
+	LIBATARI800_StateSaveFlags();
+	EndSection("LIB ");
+#endif
+	BeginSection();
+	EndSection("END ");
 
 	STATESAV_TAG(size);
 	if (GZCLOSE(StateFile) != 0) {
@@ -414,11 +762,173 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 	return TRUE;
 }
 
+/* Reads the enable flag saved in place of a device this version does not
+   emulate. Returns FALSE if the device was enabled. */
+static int ReadDisabledDevice(const char *name)
+{
+	int enabled = FALSE;
+	StateSav_ReadINT(&enabled, 1);
+	if (enabled) {
+		Log_print("Cannot read this state file because this version does not support %s.", name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Reads the devices saved after POKEY. */
+static int ReadDevices(void)
+{
+#ifdef XEP80_EMULATION
+	XEP80_StateRead();
+#else
+	if (!ReadDisabledDevice("XEP80"))
+		return FALSE;
+#endif /* XEP80_EMULATION */
+	PBI_StateRead();
+#ifdef PBI_MIO
+	PBI_MIO_StateRead();
+#else
+	if (!ReadDisabledDevice("MIO"))
+		return FALSE;
+#endif /* PBI_MIO */
+#ifdef PBI_BB
+	PBI_BB_StateRead();
+#else
+	if (!ReadDisabledDevice("the Black Box"))
+		return FALSE;
+#endif /* PBI_BB */
+#ifdef PBI_XLD
+	PBI_XLD_StateRead();
+#else
+	if (!ReadDisabledDevice("the 1400XL/1450XLD"))
+		return FALSE;
+#endif /* PBI_XLD */
+	return TRUE;
+}
+
+/* Returns TRUE if ReadSection passes section ID to a module. */
+static int KnownSection(const char *id)
+{
+	static const char known[] = "MACH" "CART" "SIO " "ANTC" "CPU " "MEM " "GTIA" "PIA " "POKY"
+		"XEP8" "PBI " "MIO " "BB  " "XLD "
+#ifdef DREAMCAST
+		"DC  "
+#endif
+#ifdef LIBATARI800
+		"LIB "
+#endif
+		;
+	const char *p;
+	for (p = known; *p != '\0'; p += 4) {
+		if (memcmp(p, id, 4) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* Passes the data of section ID to its module. */
+static int ReadSection(const char *id, UBYTE StateVersion, UBYTE SaveVerbose)
+{
+	if (memcmp(id, "MACH", 4) == 0)
+		Atari800_StateRead(StateVersion);
+	else if (memcmp(id, "CART", 4) == 0)
+		CARTRIDGE_StateRead(StateVersion);
+	else if (memcmp(id, "SIO ", 4) == 0)
+		SIO_StateRead();
+	else if (memcmp(id, "ANTC", 4) == 0)
+		ANTIC_StateRead();
+	else if (memcmp(id, "CPU ", 4) == 0)
+		CPU_StateRead(SaveVerbose, StateVersion);
+	else if (memcmp(id, "MEM ", 4) == 0)
+		MEMORY_StateRead(SaveVerbose, StateVersion);
+	else if (memcmp(id, "GTIA", 4) == 0)
+		GTIA_StateRead(StateVersion);
+	else if (memcmp(id, "PIA ", 4) == 0)
+		PIA_StateRead(StateVersion);
+	else if (memcmp(id, "POKY", 4) == 0)
+		POKEY_StateRead();
+	else if (memcmp(id, "XEP8", 4) == 0) {
+#ifdef XEP80_EMULATION
+		XEP80_StateRead();
+#else
+		return ReadDisabledDevice("XEP80");
+#endif /* XEP80_EMULATION */
+	}
+	else if (memcmp(id, "PBI ", 4) == 0)
+		PBI_StateRead();
+	else if (memcmp(id, "MIO ", 4) == 0) {
+#ifdef PBI_MIO
+		PBI_MIO_StateRead();
+#else
+		return ReadDisabledDevice("MIO");
+#endif /* PBI_MIO */
+	}
+	else if (memcmp(id, "BB  ", 4) == 0) {
+#ifdef PBI_BB
+		PBI_BB_StateRead();
+#else
+		return ReadDisabledDevice("the Black Box");
+#endif /* PBI_BB */
+	}
+	else if (memcmp(id, "XLD ", 4) == 0) {
+#ifdef PBI_XLD
+		PBI_XLD_StateRead();
+#else
+		return ReadDisabledDevice("the 1400XL/1450XLD");
+#endif /* PBI_XLD */
+	}
+#ifdef DREAMCAST
+	else if (memcmp(id, "DC  ", 4) == 0)
+		DCStateRead();
+#endif
+#ifdef LIBATARI800
+	else if (memcmp(id, "LIB ", 4) == 0)
+		LIBATARI800_StateReadFlags();
+#endif
+	return TRUE;
+}
+
+/* Reads the sections of a version 9 state up to the end marker. */
+static int ReadSections(UBYTE StateVersion, UBYTE SaveVerbose)
+{
+	for (;;) {
+		char id[4];
+		int method;
+		ULONG len;
+		ULONG stored;
+		int result;
+
+		if (!ReadSectionHeader(id, &method, &len, &stored))
+			return FALSE;
+		if (memcmp(id, "END ", 4) == 0)
+			return TRUE;
+		/* Sections of later versions, or of modules that are not compiled
+		   in, are skipped, whatever their compression. */
+		if (!KnownSection(id)) {
+			if (!SkipSection(stored))
+				return FALSE;
+			continue;
+		}
+		if (method != StateSav_COMPRESS_NONE
+		 && (method >= StateSav_COMPRESSORS || compressors[method].decompress == NULL)) {
+			Log_print("State section is compressed with an unsupported method.");
+			return FALSE;
+		}
+		if (!LoadSection(method, len, stored))
+			return FALSE;
+		result = ReadSection(id, StateVersion, SaveVerbose);
+		section_open = FALSE;
+		if (!result || section_error)
+			return FALSE;
+	}
+}
+
 int StateSav_ReadAtariState(const char *filename, const char *mode)
 {
 	char header_string[8];
 	UBYTE StateVersion = 0;  /* The version of the save file */
 	UBYTE SaveVerbose = 0;   /* Verbose mode means save basic, OS if patched */
+	int result = TRUE;
 
 	if (StateFile != NULL) {
 		GZCLOSE(StateFile);
@@ -462,93 +972,70 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 		return FALSE;
 	}
 
-	Atari800_StateRead(StateVersion);
-	if (StateVersion >= 4) {
-		CARTRIDGE_StateRead(StateVersion);
-		SIO_StateRead();
-	}
-	ANTIC_StateRead();
-	CPU_StateRead(SaveVerbose, StateVersion);
-	GTIA_StateRead(StateVersion);
-	PIA_StateRead(StateVersion);
-	POKEY_StateRead();
-	if (StateVersion >= 6) {
-#ifdef XEP80_EMULATION
-		XEP80_StateRead();
-#else
-		int local_xep80_enabled = FALSE;
-		StateSav_ReadINT(&local_xep80_enabled,1);
-		if (local_xep80_enabled) {
-			Log_print("Cannot read this state file because this version does not support XEP80.");
-			GZCLOSE(StateFile);
-			StateFile = NULL;
-			return FALSE;
-		}
-#endif /* XEP80_EMULATION */
-		PBI_StateRead();
-#ifdef PBI_MIO
-		PBI_MIO_StateRead();
-#else
-		{
-			int local_mio_enabled;
-			StateSav_ReadINT(&local_mio_enabled,1);
-			if (local_mio_enabled) {
-				Log_print("Cannot read this state file because this version does not support MIO.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
-				return FALSE;
-			}
-		}
-#endif /* PBI_MIO */
-#ifdef PBI_BB
-		PBI_BB_StateRead();
-#else
-		{
-			int local_bb_enabled;
-			StateSav_ReadINT(&local_bb_enabled,1);
-			if (local_bb_enabled) {
-				Log_print("Cannot read this state file because this version does not support the Black Box.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
-				return FALSE;
-			}
-		}
-#endif /* PBI_BB */
-#ifdef PBI_XLD
-		PBI_XLD_StateRead();
-#else
-		{
-			int local_xld_enabled;
-			StateSav_ReadINT(&local_xld_enabled,1);
-			if (local_xld_enabled) {
-				Log_print("Cannot read this state file because this version does not support the 1400XL/1450XLD.");
-				GZCLOSE(StateFile);
-				StateFile = NULL;
-				return FALSE;
-			}
+	if (StateVersion >= 9)
+		result = ReadSections(StateVersion, SaveVerbose);
+	else {
+		Atari800_StateRead(StateVersion);
+		if (StateVersion >= 4) {
+			CARTRIDGE_StateRead(StateVersion);
+			SIO_StateRead();
 		}
-#endif /* PBI_XLD */
-	}
+		ANTIC_StateRead();
+		CPU_StateRead(SaveVerbose, StateVersion);
+		GTIA_StateRead(StateVersion);
+		PIA_StateRead(StateVersion);
+		POKEY_StateRead();
+		if (StateVersion >= 6)
+			result = ReadDevices();
 #ifdef DREAMCAST
-	DCStateRead();
+		if (result)
+			DCStateRead();
 #endif
+	}
 
 	GZCLOSE(StateFile);
 	StateFile = NULL;
 
-	if (nFileError != Z_OK)
+	if (!result || nFileError != Z_OK)
 		return FALSE;
 
 	return TRUE;
 }
 
+/* Returns the data of section ID of a version 9 state, decompressed into a
+   new buffer, or NULL. */
+UBYTE *StateSav_ReadSection(UBYTE const *buffer, ULONG len, const char *id, ULONG *size)
+{
+	ULONG offset = 10;
+
+	if (len < offset || memcmp(buffer, "ATARI800", 8) != 0 || buffer[8] < 9)
+		return NULL;
+	while (len - offset >= SECTION_HEADER_LEN) {
+		UBYTE const *header = buffer + offset;
+		ULONG section_len = Get32(header + 5);
+		ULONG stored = Get32(header + 9);
+
+		offset += SECTION_HEADER_LEN;
+		if (stored > len - offset || memcmp(header, "END ", 4) == 0)
+			return NULL;
+		if (memcmp(header, id, 4) == 0) {
+			UBYTE *data;
+			if (section_len > STATESAV_MAX_BUFFER_SIZE)
+				return NULL;
+			data = (UBYTE *) Util_malloc(section_len > 0 ? section_len : 1);
+			if (!Decode(data, section_len, buffer + offset, stored, header[4])) {
+				free(data);
+				return NULL;
+			}
+			if (size != NULL)
+				*size = section_len;
+			return data;
+		}
+		offset += stored;
+	}
+	return NULL;
+}
 
-/* Common definitions for in-memory state save used for DREAMCAST and libatari800
- */
-#if defined(MEMCOMPR) || defined(LIBATARI800)
-static char * plainmembuf;
-static unsigned int plainmemoff;
-static unsigned int unclen;
 
 /* hack to compress in memory before writing
  * - for DREAMCAST only
@@ -647,13 +1134,22 @@ static int mem_close(gzFile stream)
 #endif /* #ifdef MEMCOMPR */
 
 
-#ifdef LIBATARI800
+#ifndef MEMCOMPR
+/* Buffer selected by StateSav_SaveAtariStateToMemory and
+   StateSav_ReadAtariStateFromMemory */
+static UBYTE *mem_target = NULL;
+static ULONG mem_target_size = 0;
+/* Set by StateSav_SaveAtariStateCompressed to enlarge the buffer as the
+   state is written. */
+static UBYTE **mem_grow_buffer = NULL;
+static ULONG *mem_grow_size = NULL;
+
 /* replacement for GZOPEN */
 static gzFile mem_open(const char *name, const char *mode)
 {
-	plainmembuf = (char *)LIBATARI800_StateSav_buffer;
+	plainmembuf = (char *)mem_target;
 	plainmemoff = 0; /*HDR_LEN;*/
-	unclen = STATESAV_MAX_SIZE;
+	unclen = mem_target_size;
 	return (gzFile) plainmembuf;
 }
 
@@ -662,9 +1158,14 @@ static int mem_close(gzFile stream)
 {
 	return 0;
 }
+#endif /* #ifndef MEMCOMPR */
 
+#ifdef LIBATARI800
+/* Returns the offset in the state of the next saved byte. */
 ULONG StateSav_Tell()
 {
+	if (section_open)
+		return section_start + section_len;
 	return (ULONG)plainmemoff;
 }
 #endif /* #ifdef LIBATARI800 */
@@ -682,13 +1183,90 @@ static size_t mem_read(void *buf, size_t len, gzFile stream)
 /* replacement for GZWRITE */
 static size_t mem_write(const void *buf, size_t len, gzFile stream)
 {
+#ifndef MEMCOMPR
+	if (plainmemoff + len > unclen && mem_grow_buffer != NULL) {
+		ULONG size = unclen == 0 ? STATESAV_MAX_SIZE : unclen;
+		while (size < plainmemoff + len && size < STATESAV_MAX_BUFFER_SIZE)
+			size *= 2;
+		if (size > STATESAV_MAX_BUFFER_SIZE)
+			size = STATESAV_MAX_BUFFER_SIZE;
+		if (size > unclen) {
+			*mem_grow_buffer = (UBYTE *) Util_realloc(*mem_grow_buffer, size);
+			*mem_grow_size = size;
+			plainmembuf = (char *) *mem_grow_buffer;
+			unclen = size;
+		}
+	}
+#endif /* MEMCOMPR */
 	if (plainmemoff + len > unclen) return 0;  /* shouldn't happen */
 	memcpy(plainmembuf + plainmemoff, buf, len);
 	plainmemoff += len;
 	return len;
 }
 
-#endif /* defined(MEMCOMPR) || defined(LIBATARI800) */
+#ifndef MEMCOMPR
+int StateSav_SaveAtariStateToMemory(UBYTE *buffer, ULONG size, ULONG *len)
+{
+	int result;
+
+	mem_target = buffer;
+	mem_target_size = size;
+#if !defined(LIBATARI800)
+	mem_mode = TRUE;
+#endif
+	result = StateSav_SaveAtariState("memory", "wb", 0);
+#if !defined(LIBATARI800)
+	mem_mode = FALSE;
+#endif
+	mem_target = NULL;
+	if (len != NULL)
+		*len = plainmemoff;
+	return result;
+}
+
+int StateSav_ReadAtariStateFromMemory(UBYTE const *buffer, ULONG len)
+{
+	int result;
+
+	mem_target = (UBYTE *) buffer;
+	mem_target_size = len;
+#if !defined(LIBATARI800)
+	mem_mode = TRUE;
+#endif
+	result = StateSav_ReadAtariState("memory", "rb");
+#if !defined(LIBATARI800)
+	mem_mode = FALSE;
+#endif
+	mem_target = NULL;
+	return result;
+}
+
+int StateSav_SaveAtariStateCompressed(UBYTE **buffer, ULONG *size, ULONG *len, int method)
+{
+	int result;
+
+	if (method < StateSav_COMPRESS_NONE || method >= StateSav_COMPRESSORS
+	 || (method != StateSav_COMPRESS_NONE && compressors[method].compress == NULL))
+		return FALSE;
+	if (*size == 0) {
+		*size = STATESAV_MAX_SIZE;
+		*buffer = (UBYTE *) Util_realloc(*buffer, *size);
+	}
+	mem_grow_buffer = buffer;
+	mem_grow_size = size;
+	section_method = method;
+	result = StateSav_SaveAtariStateToMemory(*buffer, *size, len);
+	section_method = StateSav_COMPRESS_NONE;
+	mem_grow_buffer = NULL;
+	mem_grow_size = NULL;
+	return result;
+}
+
+int StateSav_SaveAtariStateToBuffer(UBYTE **buffer, ULONG *size, ULONG *len)
+{
+	return StateSav_SaveAtariStateCompressed(buffer, size, len, StateSav_COMPRESS_NONE);
+}
+#endif /* #ifndef MEMCOMPR */
 
 /*
 vim:ts=4:sw=4:
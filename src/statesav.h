@@ -7,6 +7,43 @@
 int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose);
 int StateSav_ReadAtariState(const char *filename, const char *mode);
 
+/* Save the state uncompressed into BUFFER of SIZE bytes, storing the number
+   of bytes used in *LEN. Returns FALSE if the state does not fit. */
+int StateSav_SaveAtariStateToMemory(UBYTE *buffer, ULONG size, ULONG *len);
+/* Read a state saved by StateSav_SaveAtariStateToMemory. */
+int StateSav_ReadAtariStateFromMemory(UBYTE const *buffer, ULONG len);
+/* Like StateSav_SaveAtariStateToMemory, but enlarges *BUFFER (of *SIZE
+   bytes, may be NULL) with realloc() until the state fits. */
+int StateSav_SaveAtariStateToBuffer(UBYTE **buffer, ULONG *size, ULONG *len);
+#define STATESAV_MAX_BUFFER_SIZE (16 * 1024 * 1024)
+
+/* Compression methods for the sections of a state saved in memory. */
+#define StateSav_COMPRESS_NONE 0
+#define StateSav_COMPRESS_LZ 1		/* built-in, fast */
+#define StateSav_COMPRESS_ZLIB 2	/* only if compiled with zlib */
+#define StateSav_COMPRESSORS 8		/* methods 3..7 are free for SetCompressor */
+
+typedef struct {
+	/* Maximum compressed size of LEN bytes. */
+	ULONG (*bound)(ULONG len);
+	/* Returns the compressed size, or 0 if it does not fit in DEST_SIZE. */
+	ULONG (*compress)(UBYTE *dest, ULONG dest_size, UBYTE const *src, ULONG len);
+	/* Returns TRUE if SRC decompresses to exactly LEN bytes. */
+	int (*decompress)(UBYTE *dest, ULONG len, UBYTE const *src, ULONG src_len);
+} StateSav_compressor_t;
+
+/* Installs (or with NULL, removes) the compressor for METHOD. Returns FALSE
+   if METHOD is out of range. */
+int StateSav_SetCompressor(int method, StateSav_compressor_t const *compressor);
+/* Like StateSav_SaveAtariStateToBuffer, but compresses each section with
+   METHOD where that makes it smaller. The buffer is enlarged while the state
+   is written, so the state is saved in one pass. */
+int StateSav_SaveAtariStateCompressed(UBYTE **buffer, ULONG *size, ULONG *len, int method);
+/* Returns section ID ("MEM ", "CPU " etc.) of a state saved in memory,
+   decompressed into a buffer allocated with malloc(), with its length in
+   *SIZE; NULL if there is no such section. */
+UBYTE *StateSav_ReadSection(UBYTE const *buffer, ULONG len, const char *id, ULONG *size);
+
 void StateSav_SaveUBYTE(const UBYTE *data, int num);
 void StateSav_SaveUWORD(const UWORD *data, int num);
 void StateSav_SaveINT(const int *data, int num);
@@ -21,7 +58,7 @@ void StateSav_ReadFNAME(char *filename);
 ULONG StateSav_Tell(void);
 #include "libatari800/statesav.h"
 /* STATESAV_MAX_SIZE defined in libatari800 include file */
-#define STATESAV_TAG(a) (LIBATARI800_StateSav_tags->a = StateSav_Tell())
+#define STATESAV_TAG(a) do { if (LIBATARI800_StateSav_tags != NULL) LIBATARI800_StateSav_tags->a = StateSav_Tell(); } while (0)
 #else /* LIBATARI800 */
 #define STATESAV_MAX_SIZE 210000 /* max size of state save data */
 #define STATESAV_TAG(a)
@@ -56,6 +56,9 @@
 #ifdef HAVE_DIRECT_H
 #include <direct.h> /* getcwd on MSVC*/
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "atari.h"
 #include "platform.h"
@@ -493,6 +496,48 @@ int Util_flen(FILE *fp)
 	return (int) ftell(fp);
 }
 
+void *Util_mmap(FILE *fp, size_t len, int writable)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+	void *ptr;
+	if (len == 0)
+		return NULL;
+	fflush(fp);
+	ptr = mmap(NULL, len, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+	           MAP_SHARED, fileno(fp), 0);
+	return ptr == MAP_FAILED ? NULL : ptr;
+#else
+	return NULL;
+#endif
+}
+
+void Util_munmap(void *ptr, size_t len)
+{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+	munmap(ptr, len);
+#endif
+}
+
+int Util_msync(void *ptr, size_t len)
+{
+#if defined(HAVE_MSYNC) && defined(HAVE_SYS_MMAN_H)
+	return msync(ptr, len, MS_SYNC) == 0;
+#else
+	return TRUE;
+#endif
+}
+
+int Util_fsync(FILE *fp)
+{
+	if (fflush(fp) != 0)
+		return FALSE;
+#ifdef HAVE_FSYNC
+	return fsync(fileno(fp)) == 0;
+#else
+	return TRUE;
+#endif
+}
+
 /* Creates a file that does not exist and fills in filename with its name.
    filename must point to FILENAME_MAX characters buffer which doesn't need
    to be initialized. */
@@ -176,6 +176,23 @@ int Util_direxists(const char *filename);
    May change the current position. */
 int Util_flen(FILE *fp);
 
+/* Maps the first len bytes of an open stream into memory. Changes made
+   to the memory go to the file if writable is TRUE (the stream must be
+   open for update then). Returns NULL if the file cannot be mapped,
+   e.g. because the system doesn't support it. */
+void *Util_mmap(FILE *fp, size_t len, int writable);
+
+/* Unmaps memory returned by Util_mmap(). */
+void Util_munmap(void *ptr, size_t len);
+
+/* Writes the changes made to memory returned by Util_mmap() to the file.
+   Returns FALSE on failure. */
+int Util_msync(void *ptr, size_t len);
+
+/* Flushes an open stream and asks the system to store its data on the
+   disk. Returns FALSE on failure. */
+int Util_fsync(FILE *fp);
+
 /* Deletes a file, returns 0 on success, -1 on failure. */
 #ifdef HAVE_WINDOWS_H
 int Util_unlink(const char *filename);
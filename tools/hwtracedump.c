@@ -0,0 +1,249 @@
+/*
+ * Print a hardware event trace recorded with the -hwtrace option of the
+ * atari800 emulator (atari800.github.io)
+ *
+ * Copyright (C) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "hwtrace.h"
+
+static const char *gtia_names[32] = {
+	"HPOSP0", "HPOSP1", "HPOSP2", "HPOSP3", "HPOSM0", "HPOSM1", "HPOSM2", "HPOSM3",
+	"SIZEP0", "SIZEP1", "SIZEP2", "SIZEP3", "SIZEM", "GRAFP0", "GRAFP1", "GRAFP2",
+	"GRAFP3", "GRAFM", "COLPM0", "COLPM1", "COLPM2", "COLPM3", "COLPF0", "COLPF1",
+	"COLPF2", "COLPF3", "COLBK", "PRIOR", "VDELAY", "GRACTL", "HITCLR", "CONSOL"
+};
+
+static const char *pokey_names[16] = {
+	"AUDF1", "AUDC1", "AUDF2", "AUDC2", "AUDF3", "AUDC3", "AUDF4", "AUDC4",
+	"AUDCTL", "STIMER", "SKRES", "POTGO", "", "SEROUT", "IRQEN", "SKCTL"
+};
+
+static const char *pia_names[4] = {
+	"PORTA", "PORTB", "PACTL", "PBCTL"
+};
+
+static const char *antic_names[16] = {
+	"DMACTL", "CHACTL", "DLISTL", "DLISTH", "HSCROL", "VSCROL", "", "PMBASE",
+	"", "CHBASE", "WSYNC", "", "", "", "NMIEN", "NMIRES"
+};
+
+static const char *irq_names[8] = {
+	"TIMER1", "TIMER2", "TIMER4", "SEROC", "SEROUT", "SERIN", "KEY", "BREAK"
+};
+
+static int is_5200;
+
+/* Writes per register, for -s. */
+static unsigned long write_count[65536];
+static unsigned long event_count[HWTRACE_SIO_PATCH + 1];
+
+static const char *register_name(unsigned int addr)
+{
+	switch (addr & 0xff00) {
+	case 0xd000:
+		return gtia_names[addr & 0x1f];
+	case 0xd200:
+		return pokey_names[addr & 0x0f];
+	case 0xd300:
+		return is_5200 ? "" : pia_names[addr & 0x03];
+	case 0xd400:
+		return antic_names[addr & 0x0f];
+	case 0xd500:
+		return "CARTCTL";
+	default:
+		if (is_5200 && addr >= 0xc000 && addr < 0xd000)
+			return gtia_names[addr & 0x1f];
+		if (is_5200 && addr >= 0xe800 && addr < 0xf000)
+			return pokey_names[addr & 0x0f];
+		return "";
+	}
+}
+
+static void print_sio(uint32_t data)
+{
+	unsigned int device = data & 0xff;
+	unsigned int command = (data >> 8) & 0xff;
+	unsigned int aux = data >> 16;
+	printf("device %02X command %02X aux %04X", device, command, aux);
+	if (device >= 0x31 && device <= 0x38) {
+		switch (command) {
+		case 0x21:
+			printf(" (D%u: format)", device - 0x30);
+			break;
+		case 0x52:
+			printf(" (D%u: read sector %u)", device - 0x30, aux);
+			break;
+		case 0x50:
+		case 0x57:
+			printf(" (D%u: write sector %u)", device - 0x30, aux);
+			break;
+		case 0x53:
+			printf(" (D%u: status)", device - 0x30);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void print_record(const uint8_t *p, uint32_t frame)
+{
+	unsigned int type = p[0];
+	unsigned int cycle = p[1];
+	unsigned int line = p[2] | (p[3] << 8);
+	uint32_t data = p[4] | (p[5] << 8) | ((uint32_t) p[6] << 16) | ((uint32_t) p[7] << 24);
+	int i;
+
+	printf("%8lu %3u %3u  ", (unsigned long) frame, line, cycle);
+	switch (type) {
+	case HWTRACE_FRAME:
+		printf("FRAME\n");
+		break;
+	case HWTRACE_WRITE:
+		printf("WRITE %04X %-7s %02X\n", (unsigned int) (data & 0xffff),
+		       register_name(data & 0xffff), (unsigned int) ((data >> 16) & 0xff));
+		break;
+	case HWTRACE_IRQ:
+		printf("IRQ   PC=%04X", (unsigned int) (data & 0xffff));
+		for (i = 7; i >= 0; i--) {
+			if (data & (0x10000 << i))
+				printf(" %s", irq_names[i]);
+		}
+		printf("\n");
+		break;
+	case HWTRACE_NMI:
+		printf("NMI   PC=%04X", (unsigned int) (data & 0xffff));
+		if (data & 0x800000)
+			printf(" DLI");
+		if (data & 0x400000)
+			printf(" VBI");
+		if (data & 0x200000)
+			printf(" RESET");
+		printf("\n");
+		break;
+	case HWTRACE_SIO:
+	case HWTRACE_SIO_PATCH:
+		printf(type == HWTRACE_SIO ? "SIO   " : "SIOP  ");
+		print_sio(data);
+		printf("\n");
+		break;
+	default:
+		printf("unknown record type %u\n", type);
+		break;
+	}
+}
+
+static void print_summary(void)
+{
+	static const char *type_names[HWTRACE_SIO_PATCH + 1] = {
+		"frames", "register writes", "IRQs", "NMIs", "SIO command frames", "SIO patch calls"
+	};
+	unsigned int i;
+	for (i = 0; i <= HWTRACE_SIO_PATCH; i++)
+		printf("%-20s %10lu\n", type_names[i], event_count[i]);
+	printf("\nWrites per register:\n");
+	for (i = 0; i < 65536; i++) {
+		if (write_count[i] != 0)
+			printf("%04X %-7s %10lu\n", i, register_name(i), write_count[i]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *fp;
+	uint8_t header[HWTRACE_HEADER_SIZE];
+	uint8_t record[HWTRACE_RECORD_SIZE];
+	uint32_t frame = 0;
+	unsigned long first = 0;
+	unsigned long last = (unsigned long) -1;
+	int summary = 0;
+	const char *filename = NULL;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-s") == 0)
+			summary = 1;
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			first = strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			last = strtoul(argv[++i], NULL, 0);
+		else if (argv[i][0] != '-' && filename == NULL)
+			filename = argv[i];
+		else {
+			filename = NULL;
+			break;
+		}
+	}
+	if (filename == NULL) {
+		printf("%s - Print a hardware event trace\n", argv[0]);
+		printf("\t%s [-f <frame>] [-t <frame>] [-s] <tracefile>\n", argv[0]);
+		printf("\t-f <frame> -- Start at frame <frame>\n");
+		printf("\t-t <frame> -- Stop after frame <frame>\n");
+		printf("\t-s -- Print event counts instead of the events\n");
+		exit(1);
+	}
+
+	fp = fopen(filename, "rb");
+	if (fp == NULL) {
+		perror(filename);
+		exit(1);
+	}
+	if (fread(header, 1, sizeof(header), fp) != sizeof(header)
+	 || memcmp(header, "A8HWTRC", 7) != 0) {
+		fprintf(stderr, "Error: %s is not a hardware trace file\n", filename);
+		exit(1);
+	}
+	if (header[7] != HWTRACE_VERSION) {
+		fprintf(stderr, "Error: unsupported trace format version %d\n", header[7]);
+		exit(1);
+	}
+	is_5200 = (header[10] | (header[11] << 8)) == 2;
+	if (!summary)
+		printf("%s, %d scanlines per frame\n   frame line cyc  event\n",
+		       is_5200 ? "5200" : "Atari 8-bit", header[8] | (header[9] << 8));
+
+	while (fread(record, 1, sizeof(record), fp) == sizeof(record)) {
+		if (record[0] == HWTRACE_FRAME) {
+			frame = record[4] | (record[5] << 8) | ((uint32_t) record[6] << 16) | ((uint32_t) record[7] << 24);
+			if (frame > last)
+				break;
+		}
+		if (frame < first)
+			continue;
+		if (summary) {
+			if (record[0] <= HWTRACE_SIO_PATCH)
+				event_count[record[0]]++;
+			if (record[0] == HWTRACE_WRITE)
+				write_count[record[4] | (record[5] << 8)]++;
+		}
+		else
+			print_record(record, frame);
+	}
+	fclose(fp);
+
+	if (summary)
+		print_summary();
+	return 0;
+}
@@ -32,8 +32,13 @@
  *                                                                           *
  *****************************************************************************/
 
+/* Build against the emulator's objects, e.g. a libatari800 build:
+   gcc -O2 -Isrc -I<build>/src util/pokeybench.c <build>/src/libatari800.a -lm -lpthread
+*/
+
+#include "config.h"
+#include "pokey.h"
 #include "pokeysnd.h"
-#include "mzpokeysnd.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,8 +50,9 @@
 /* How many seconds of sound to generate per each test trial */
 #define MZM_TRIAL_TIME 2
 
-/* How many samples per each buffer run */
-#define MZM_BUF_SAMPLES 100
+/* How many samples per each buffer run: one PAL frame of stereo sound at
+   44.1 kHz, as the emulator processes it */
+#define MZM_BUF_SAMPLES 1764
 
 /* How many test trials to run for statistics */
 #define TEST_TRIALS 5
@@ -54,6 +60,9 @@
 /* How many seconds of sound to save in the outfile */
 #define MZM_SAVE_TIME 10
 
+/* Number of POKEY chips: stereo, the most the emulator supports */
+#define NUM_POKEYS 2
+
 
 /* Wrapper for fgets, removes trailing whitespace */
 char* fgetl(char* s, int len, FILE* fs)
@@ -70,46 +79,48 @@ char* fgetl(char* s, int len, FILE* fs)
     return s2;
 }
 
-int pktest(unsigned char *audf, unsigned char *audc, unsigned char audctl,
-           const char* ofn8, const char* ofn16,
-           unsigned short samplerate)
+/* Initializes the high fidelity engine and sets the registers. The second
+   chip plays the same sound one step lower, so that the channels differ. */
+int pkinit(unsigned char *audf, unsigned char *audc, unsigned char audctl,
+           unsigned short samplerate, int flags)
 {
-    unsigned char* buf;
-    short* buf16;
-    double rate;
-    double rasum;
-    double rasum2;
-    double varian;
-    double stddev;
-    unsigned long samremain, samproc;
     int i;
-    time_t start,finish;
-    FILE* ft;
+    int chip;
 
-    buf = malloc(MZM_BUF_SAMPLES);
-    if(buf == NULL)
+    POKEYSND_enable_new_pokey = 1;
+    if((i=POKEYSND_Init(POKEYSND_FREQ_17_EXACT,samplerate,NUM_POKEYS,flags)))
     {
-        printf("Out of memory\n");
-        return 1;
+        printf("Error initializing Pokey sound: %d\n",i);
+        return i;
     }
+    srand(1);
 
-    if(i=Pokey_sound_init(1790000,samplerate,1,0,1))
+    for(chip=0; chip<NUM_POKEYS; chip++)
     {
-        printf("Error initializing Pokey sound: %d\n",i);
-        return 1;
+        for(i=0; i<4; i++)
+        {
+            POKEYSND_Update_ptr(POKEY_OFFSET_AUDF1+i*2,(unsigned char)(audf[i]+chip),chip,1);
+            POKEYSND_Update_ptr(POKEY_OFFSET_AUDC1+i*2,audc[i],chip,1);
+        }
+        POKEYSND_Update_ptr(POKEY_OFFSET_AUDCTL,audctl,chip,1);
     }
+    return 0;
+}
 
-    Update_pokey_sound(_AUDF1,audf[0],0,1);
-    Update_pokey_sound(_AUDC1,audc[0],0,1);
-    Update_pokey_sound(_AUDF2,audf[1],0,1);
-    Update_pokey_sound(_AUDC2,audc[1],0,1);
-    Update_pokey_sound(_AUDF3,audf[2],0,1);
-    Update_pokey_sound(_AUDC3,audc[2],0,1);
-    Update_pokey_sound(_AUDF4,audf[3],0,1);
-    Update_pokey_sound(_AUDC4,audc[3],0,1);
-    Update_pokey_sound(_AUDCTL,audctl,0,1);
-    Pokey_debugreset(0);
-    
+/* Returns the average rate in samples per second */
+double pkrate(unsigned char *audf, unsigned char *audc, unsigned char audctl,
+              unsigned short samplerate, short* buf16)
+{
+    double rate;
+    double rasum;
+    double rasum2;
+    double varian;
+    double stddev;
+    int i;
+    time_t start,finish;
+
+    if(pkinit(audf,audc,audctl,samplerate,POKEYSND_BIT16))
+        return 0.0;
 
     rasum = 0.0;
     rasum2 = 0.0;
@@ -129,7 +140,7 @@ int pktest(unsigned char *audf, unsigned char *audc, unsigned char audctl,
         /* Generate until test time elapses */
         do
         {
-            Pokey_process(buf,MZM_BUF_SAMPLES);
+            POKEYSND_Process(buf16,MZM_BUF_SAMPLES);
             rate += MZM_BUF_SAMPLES;
             time(&finish);
         } while(difftime(finish,start) < MZM_TRIAL_TIME);
@@ -150,78 +161,128 @@ int pktest(unsigned char *audf, unsigned char *audc, unsigned char audctl,
 
     printf("Standard deviation: %10.0f samples/sec\n",stddev);
 
-    printf("Gen/play ratio = %3.1f\n",rasum/TEST_TRIALS/samplerate);
+    printf("Gen/play ratio = %3.1f\n\n",rasum/TEST_TRIALS/samplerate/NUM_POKEYS);
 
-    /* And now, write 8-bit output file */
+    return rasum/TEST_TRIALS;
+}
 
-    if(i=Pokey_sound_init(1790000,samplerate,1,0,1))
+/* Writes MZM_SAVE_TIME seconds of sound to FN. Returns 0 if successful. */
+int pksave(unsigned char *audf, unsigned char *audc, unsigned char audctl,
+           unsigned short samplerate, int flags, const char* fn)
+{
+    unsigned long samtotal = (unsigned long)samplerate*MZM_SAVE_TIME*NUM_POKEYS;
+    unsigned long samremain, samproc;
+    int size = (flags & POKEYSND_BIT16) ? 2 : 1;
+    unsigned char* buf;
+    FILE* ft;
+
+    buf = malloc(samtotal*size);
+    if(buf == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    if(pkinit(audf,audc,audctl,samplerate,flags))
     {
-        printf("Error initializing Pokey sound: %d\n",i);
         free(buf);
         return 1;
     }
-    Update_pokey_sound(_AUDF1,audf[0],0,1);
-    Update_pokey_sound(_AUDC1,audc[0],0,1);
-    Update_pokey_sound(_AUDF2,audf[1],0,1);
-    Update_pokey_sound(_AUDC2,audc[1],0,1);
-    Update_pokey_sound(_AUDF3,audf[2],0,1);
-    Update_pokey_sound(_AUDC3,audc[2],0,1);
-    Update_pokey_sound(_AUDF4,audf[3],0,1);
-    Update_pokey_sound(_AUDC4,audc[3],0,1);
-    Update_pokey_sound(_AUDCTL,audctl,0,1);
-    Pokey_debugreset(0);
-
-    if(!(ft=fopen(ofn8,"wb")))
+    for(samremain=samtotal; samremain>0; samremain-=samproc)
+    {
+        samproc = samremain>=MZM_BUF_SAMPLES ? MZM_BUF_SAMPLES : samremain;
+        POKEYSND_Process(buf+(samtotal-samremain)*size,(int)samproc);
+    }
+
+    if(!(ft=fopen(fn,"wb")))
     {
-        perror(ofn8);
+        perror(fn);
         free(buf);
         return 2;
     }
-
-    samremain = samplerate*MZM_SAVE_TIME;
-    while(samremain>0)
+    if(fwrite(buf,size,samtotal,ft) < samtotal)
     {
-        if(samremain>=MZM_BUF_SAMPLES)
-        {
-            samproc = MZM_BUF_SAMPLES;
-        }
-        else
-        {
-            samproc = samremain;
-        }
-        Pokey_process(buf,(unsigned short)samproc);
-        i = fwrite(buf,1,samproc,ft);
-        if(i<samproc)
-        {
-            perror(ofn8);
-            free(buf);
-            fclose(ft);
-            return 2;
-        }
-        samremain -= samproc;
+        perror(fn);
+        free(buf);
+        fclose(ft);
+        return 2;
     }
 
     free(buf);
     fclose(ft);
+    return 0;
+}
 
-    /* Write 16-bit output file */
-
-    if(i=Pokey_sound_init(1790000,samplerate,1,SND_BIT16,1))
+/* Compares MZM_SAVE_TIME seconds of 16-bit sound from the single precision
+   resampler with the double precision reference, in each filter quality.
+   Returns 0 if no sample differs by more than one step of dithering. */
+int pkresam(unsigned char *audf, unsigned char *audc, unsigned char audctl,
+            unsigned short samplerate)
+{
+    unsigned long samtotal = (unsigned long)samplerate*MZM_SAVE_TIME*NUM_POKEYS;
+    unsigned long samremain, samproc, j;
+    short* out[2];
+    int quality;
+    int maxdiff;
+    int r;
+
+    out[0] = malloc(samtotal*2);
+    out[1] = malloc(samtotal*2);
+    if(out[0] == NULL || out[1] == NULL)
     {
-        printf("Error initializing Pokey sound: %d\n",i);
+        printf("Out of memory\n");
+        free(out[0]);
+        free(out[1]);
         return 1;
     }
-    Update_pokey_sound(_AUDF1,audf[0],0,1);
-    Update_pokey_sound(_AUDC1,audc[0],0,1);
-    Update_pokey_sound(_AUDF2,audf[1],0,1);
-    Update_pokey_sound(_AUDC2,audc[1],0,1);
-    Update_pokey_sound(_AUDF3,audf[2],0,1);
-    Update_pokey_sound(_AUDC3,audc[2],0,1);
-    Update_pokey_sound(_AUDF4,audf[3],0,1);
-    Update_pokey_sound(_AUDC4,audc[3],0,1);
-    Update_pokey_sound(_AUDCTL,audctl,0,1);
-    Pokey_debugreset(0);
 
+    for(quality=0; quality<=2; quality++)
+    {
+        POKEYSND_SetMzQuality(quality);
+        for(r=0; r<2; r++)
+        {
+            POKEYSND_resampler = r ? POKEYSND_RESAMPLER_FLOAT : POKEYSND_RESAMPLER_DOUBLE;
+            if(pkinit(audf,audc,audctl,samplerate,POKEYSND_BIT16))
+            {
+                POKEYSND_resampler = POKEYSND_RESAMPLER_DOUBLE;
+                free(out[0]);
+                free(out[1]);
+                return 1;
+            }
+            for(samremain=samtotal; samremain>0; samremain-=samproc)
+            {
+                samproc = samremain>=MZM_BUF_SAMPLES ? MZM_BUF_SAMPLES : samremain;
+                POKEYSND_Process(out[r]+(samtotal-samremain),(int)samproc);
+            }
+        }
+        POKEYSND_resampler = POKEYSND_RESAMPLER_DOUBLE;
+
+        maxdiff = 0;
+        for(j=0; j<samtotal; j++)
+        {
+            int d = abs(out[0][j] - out[1][j]);
+            if(d > maxdiff)
+                maxdiff = d;
+        }
+        printf("Quality %d: largest difference of single and double precision resampling: %d\n",
+            quality, maxdiff);
+        if(maxdiff > 1)
+            break;
+    }
+    POKEYSND_SetMzQuality(0);
+
+    free(out[0]);
+    free(out[1]);
+    return maxdiff > 1 ? 3 : 0;
+}
+
+int pktest(unsigned char *audf, unsigned char *audc, unsigned char audctl,
+           const char* ofn8, const char* ofn16,
+           unsigned short samplerate)
+{
+    short* buf16;
+    double reference;
+    int i;
 
     buf16 = malloc(2*MZM_BUF_SAMPLES);
     if(buf16 == NULL)
@@ -230,40 +291,26 @@ int pktest(unsigned char *audf, unsigned char *audc, unsigned char audctl,
         return 1;
     }
 
-    if(!(ft=fopen(ofn16,"wb")))
+    printf("Double precision resampler, %d chips:\n", NUM_POKEYS);
+    reference = pkrate(audf,audc,audctl,samplerate,buf16);
     {
-        perror(ofn16);
-        free(buf16);
-        return 2;
+        double single;
+        POKEYSND_resampler = POKEYSND_RESAMPLER_FLOAT;
+        printf("Single precision resampler:\n");
+        single = pkrate(audf,audc,audctl,samplerate,buf16);
+        POKEYSND_resampler = POKEYSND_RESAMPLER_DOUBLE;
+        if(reference > 0.0)
+            printf("Speedup: %4.2f\n\n",single/reference);
     }
-
-    samremain = samplerate*MZM_SAVE_TIME;
-    while(samremain>0)
-    {
-        if(samremain>=MZM_BUF_SAMPLES)
-        {
-            samproc = MZM_BUF_SAMPLES;
-        }
-        else
-        {
-            samproc = samremain;
-        }
-        Pokey_process(buf16,(unsigned short)samproc);
-        i = fwrite(buf16,2,samproc,ft);
-        if(i<samproc)
-        {
-            perror(ofn16);
-            free(buf16);
-            fclose(ft);
-            return 2;
-        }
-        samremain -= samproc;
-    }
-
     free(buf16);
-    fclose(ft);
 
-    return 0;
+    if((i=pkresam(audf,audc,audctl,samplerate)))
+        return i;
+
+    /* And now, write the output files */
+    if((i=pksave(audf,audc,audctl,samplerate,0,ofn8)))
+        return i;
+    return pksave(audf,audc,audctl,samplerate,POKEYSND_BIT16,ofn16);
 }
 
 int main(int argc, char* argv[])